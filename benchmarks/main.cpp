@@ -0,0 +1,177 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+/* widgetbench times the widget hot paths against synthetic data and
+   compares the result with a stored baseline. Run it offscreen against a
+   local xTuple database:
+
+     QT_QPA_PLATFORM=offscreen widgetbench -databaseURL=psql://localhost:5432/dev \
+                                           -username=admin -passwd=... \
+                                           -output=baseline.json
+     ...
+     QT_QPA_PLATFORM=offscreen widgetbench -databaseURL=... -username=... -passwd=... \
+                                           -baseline=baseline.json
+
+   The exit status is 1 if any span got slower than the baseline by more
+   than -tolerance percent (20) and -minimum ms (1), and 2 if the benchmark
+   could not run.
+
+   benchmarks/baseline.json is the stored baseline. Record it on the
+   reference machine with -output=benchmarks/baseline.json and commit it
+   with the change that moved the numbers. Spans with a count of 0 have
+   not been measured yet and are not compared.
+ */
+
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <parameter.h>
+
+#include "login2.h"
+#include "metrics.h"
+#include "widgetbench.h"
+#include "xtupleplugin.h"
+#include "xttrace.h"
+
+int main(int argc, char *argv[])
+{
+  QString username;
+  QString databaseURL;
+  QString passwd;
+  QString baselineFile;
+  QString outputFile;
+  QString traceFile;
+  int     rows       = -1;
+  int     iterations = -1;
+  double  tolerance  = 20.0;
+  double  minimum    = 1.0;
+
+  QApplication app(argc, argv);
+  app.setOrganizationDomain("xTuple.com");
+  app.setOrganizationName("xTuple");
+  app.setApplicationName("xTuple");
+
+  for (int intCounter = 1; intCounter < argc; intCounter++)
+  {
+    QString argument(argv[intCounter]);
+
+    if (argument.startsWith("-databaseURL=", Qt::CaseInsensitive))
+      databaseURL = argument.mid(13);
+    else if (argument.startsWith("-username=", Qt::CaseInsensitive))
+      username = argument.mid(10);
+    else if (argument.startsWith("-passwd=", Qt::CaseInsensitive))
+      passwd = argument.mid(8);
+    else if (argument.startsWith("-rows=", Qt::CaseInsensitive))
+      rows = argument.mid(6).toInt();
+    else if (argument.startsWith("-iterations=", Qt::CaseInsensitive))
+      iterations = argument.mid(12).toInt();
+    else if (argument.startsWith("-trace=", Qt::CaseInsensitive))
+      traceFile = argument.mid(7);
+    else if (argument.startsWith("-output=", Qt::CaseInsensitive))
+      outputFile = argument.mid(8);
+    else if (argument.startsWith("-baseline=", Qt::CaseInsensitive))
+      baselineFile = argument.mid(10);
+    else if (argument.startsWith("-tolerance=", Qt::CaseInsensitive))
+      tolerance = argument.mid(11).toDouble();
+    else if (argument.startsWith("-minimum=", Qt::CaseInsensitive))
+      minimum = argument.mid(9).toDouble();
+    else
+    {
+      qWarning("Unknown argument %s", qPrintable(argument));
+      return 2;
+    }
+  }
+
+  if (databaseURL.isEmpty() || username.isEmpty())
+  {
+    qWarning("usage: widgetbench -databaseURL=psql://host:port/database"
+             " -username=user [-passwd=password] [-rows=5000] [-iterations=20]"
+             " [-trace=file] [-output=file] [-baseline=file]"
+             " [-tolerance=percent] [-minimum=ms]");
+    return 2;
+  }
+
+  ParameterList params;
+  params.append("databaseURL",     databaseURL);
+  params.append("username",        username);
+  params.append("password",        passwd);
+  params.append("applicationName", QString("xTuple Widget Benchmark"));
+  params.append("setSearchPath",   true);
+  params.append("cmd");
+  params.append("login");
+
+  login2 newdlg(0, "", true);
+  newdlg.set(params, 0);
+  if (newdlg.result() != QDialog::Accepted)
+    return 2;
+
+  Metrics     *metrics     = new Metrics();
+  Preferences *preferences = new Preferences(username);
+  Privileges  *privileges  = new Privileges();
+  initializePlugin(preferences, metrics, privileges, username, 0);
+
+  WidgetBench bench;
+  if (rows > 0)
+    bench.setRows(rows);
+  if (iterations > 0)
+    bench.setIterations(iterations);
+  if (! bench.setup())
+  {
+    qWarning("Could not create the benchmark data: %s", qPrintable(bench.lastError()));
+    return 2;
+  }
+
+  if (traceFile.isEmpty())
+    traceFile = QDir::temp().filePath("widgetbench-trace.json");
+
+  bench.warmUp();
+  XtTrace::start(traceFile);
+  bench.run();
+  if (! XtTrace::stop())
+    return 2;
+
+  QVariantMap summary = WidgetBench::summarize(traceFile);
+  QByteArray  text    = QJsonDocument(QJsonObject::fromVariantMap(summary)).toJson();
+  if (! outputFile.isEmpty())
+  {
+    QFile output(outputFile);
+    if (! output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+      qWarning("Could not write %s: %s", qPrintable(outputFile),
+               qPrintable(output.errorString()));
+      return 2;
+    }
+    output.write(text);
+  }
+  else if (baselineFile.isEmpty())
+    QTextStream(stdout) << text;
+
+  if (! baselineFile.isEmpty())
+  {
+    QFile baseline(baselineFile);
+    if (! baseline.open(QIODevice::ReadOnly))
+    {
+      qWarning("Could not read %s: %s", qPrintable(baselineFile),
+               qPrintable(baseline.errorString()));
+      return 2;
+    }
+    QVariantMap old = QJsonDocument::fromJson(baseline.readAll()).object().toVariantMap();
+    QStringList regressions = WidgetBench::compare(summary, old, tolerance, minimum * 1000);
+    foreach (QString regression, regressions)
+      qWarning("%s", qPrintable(regression));
+    return regressions.isEmpty() ? 0 : 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "widgetbench.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlError>
+#include <QStringList>
+#include <QVBoxLayout>
+#include <QtAlgorithms>
+
+#include "format.h"
+#include "scriptablewidget.h"
+#include "virtualCluster.h"
+#include "xcombobox.h"
+#include "xsqlquery.h"
+#include "xtreewidget.h"
+#include "xttrace.h"
+
+#define DEBUG false
+
+// calls per decimalPlaces/formatNumber span; one call is too short to time
+#define FORMATBATCH 10000
+
+static const char *scaleNames[] = {
+  "qty", "curr", "percent", "cost", "qtyper", "salesprice",
+  "purchprice", "uomratio", "extprice", "weight", "2"
+};
+
+WidgetBench::WidgetBench(QObject *parent)
+  : QObject(parent),
+    _iterations(20),
+    _rows(5000),
+    _combo(0),
+    _lineEdit(0),
+    _tree(0),
+    _window(0)
+{
+}
+
+WidgetBench::~WidgetBench()
+{
+  delete _window;
+}
+
+/** Create the synthetic data and the widgets the cases share.
+    The data lives in a temporary table, so nothing is left behind in the
+    database.
+    @return false if the data could not be created; see lastError()
+ */
+bool WidgetBench::setup()
+{
+  XSqlQuery dataq;
+  dataq.prepare("CREATE TEMPORARY TABLE widgetbench AS"
+                " SELECT id AS wb_id,"
+                "        'WB' || to_char(id, 'FM0000000') AS wb_number,"
+                "        'Synthetic item ' || id AS wb_descrip,"
+                "        CURRENT_DATE + (id * 37 % 365) AS wb_date,"
+                "        (id * 7919 % 100000) / 100.0 AS wb_qty,"
+                "        (id * 104729 % 1000000) / 10000.0 AS wb_cost"
+                "   FROM generate_series(1, :rows) AS id;");
+  dataq.bindValue(":rows", _rows);
+  dataq.exec();
+  if (dataq.lastError().type() != QSqlError::NoError)
+  {
+    _lastError = dataq.lastError().text();
+    return false;
+  }
+
+  _window = new QWidget();
+  _window->setObjectName("widgetbench");
+  QVBoxLayout *layout = new QVBoxLayout(_window);
+
+  _tree = new XTreeWidget(_window);
+  _tree->setObjectName("_tree");
+  _tree->setPopulateLinear(true);
+  _tree->addColumn(tr("Number"),      -1, Qt::AlignLeft,   true, "wb_number");
+  _tree->addColumn(tr("Description"), -1, Qt::AlignLeft,   true, "wb_descrip");
+  _tree->addColumn(tr("Date"),        -1, Qt::AlignCenter, true, "wb_date");
+  _tree->addColumn(tr("Qty."),        -1, Qt::AlignRight,  true, "wb_qty");
+  _tree->addColumn(tr("Cost"),        -1, Qt::AlignRight,  true, "wb_cost");
+  _tree->addColumn(tr("Value"),       -1, Qt::AlignRight,  true, "wb_value");
+  _tree->addColumn(tr("Balance"),     -1, Qt::AlignRight,  true, "wb_balance");
+  layout->addWidget(_tree);
+
+  _combo = new XComboBox(_window, "_combo");
+  layout->addWidget(_combo);
+
+  _lineEdit = new VirtualClusterLineEdit(_window, "widgetbench", "wb_id",
+                                         "wb_number", "wb_descrip", 0, 0,
+                                         "_lineEdit");
+  layout->addWidget(_lineEdit);
+
+  _window->show();
+  QApplication::setActiveWindow(_window);
+  _lineEdit->setFocus();
+  qApp->processEvents();
+
+  return true;
+}
+
+/** Run every case once to fill the caches the later runs would otherwise
+    pay for. Call this before starting XtTrace.
+ */
+void WidgetBench::warmUp()
+{
+  runOnce();
+}
+
+/** Run every case iterations() times. Start XtTrace before calling this
+    to record the spans.
+ */
+void WidgetBench::run()
+{
+  for (int i = 0; i < _iterations; i++)
+    runOnce();
+}
+
+void WidgetBench::runOnce()
+{
+  benchPopulate();
+  benchSort();
+  benchExport();
+  benchComboBox();
+  benchCompleter();
+  benchFormat();
+  benchScriptEngine();
+  qApp->processEvents();
+}
+
+// populate records populate and the populateCalculatedColumns pass it ends with
+void WidgetBench::benchPopulate()
+{
+  XSqlQuery listq;
+  listq.exec("SELECT wb_id, wb_number, wb_descrip, wb_date, wb_qty, wb_cost,"
+             "       wb_qty * wb_cost AS wb_value, wb_qty AS wb_balance,"
+             "       'qty' AS wb_qty_xtnumericrole,"
+             "       'cost' AS wb_cost_xtnumericrole,"
+             "       'extprice' AS wb_value_xtnumericrole,"
+             "       'qty' AS wb_balance_xtnumericrole,"
+             "       0 AS wb_balance_xtrunningrole,"
+             "       0 AS wb_value_xttotalrole,"
+             "       CASE WHEN wb_qty < 50 THEN 'error' END AS wb_qty_qtforegroundrole,"
+             "       wb_descrip AS wb_number_qttooltiprole"
+             "  FROM widgetbench"
+             " ORDER BY wb_id;");
+  _tree->populate(listq);
+}
+
+// each click flips the order so every row moves and the calculated
+// columns are rebuilt from the top
+void WidgetBench::benchSort()
+{
+  QMetaObject::invokeMethod(_tree, "sHeaderClicked", Q_ARG(int, 4));
+}
+
+void WidgetBench::benchExport()
+{
+  {
+    XtTraceSpan span("toCsv", "benchmark");
+    (void)_tree->toCsv();
+  }
+  {
+    XtTraceSpan span("toHtml", "benchmark");
+    (void)_tree->toHtml();
+  }
+}
+
+void WidgetBench::benchComboBox()
+{
+  _combo->populate("SELECT wb_id, wb_number, wb_number"
+                   "  FROM widgetbench"
+                   " ORDER BY wb_number"
+                   " LIMIT 1000;");
+}
+
+void WidgetBench::benchCompleter()
+{
+  static bool warned = false;
+  if (! _lineEdit->hasFocus())
+  {
+    if (! warned)
+      qWarning("The completer case is skipped because the line edit could not get the focus.");
+    warned = true;
+    return;
+  }
+
+  for (int digit = 0; digit < 10; digit++)
+  {
+    _lineEdit->setText(QString("WB000%1").arg(digit));
+    QMetaObject::invokeMethod(_lineEdit, "sHandleCompleter");
+  }
+  _lineEdit->clear();
+}
+
+void WidgetBench::benchFormat()
+{
+  int names = sizeof(scaleNames) / sizeof(scaleNames[0]);
+  int total = 0;
+  {
+    XtTraceSpan span("decimalPlaces", "benchmark", FORMATBATCH);
+    for (int i = 0; i < FORMATBATCH; i++)
+      total += decimalPlaces(scaleNames[i % names]);
+  }
+  {
+    XtTraceSpan span("formatNumber", "benchmark", FORMATBATCH);
+    for (int i = 0; i < FORMATBATCH; i++)
+      total += formatNumber(i * 1.37, i % 6).length();
+  }
+  if (DEBUG)
+    qDebug("WidgetBench::benchFormat() checksum %d", total);
+}
+
+// createScriptEngine is recorded by ScriptableWidget::engine()
+void WidgetBench::benchScriptEngine()
+{
+  QWidget widget;
+  widget.setObjectName("widgetbenchScript");
+  ScriptableWidget scriptable(&widget);
+  (void)scriptable.engine();
+}
+
+static qint64 percentile(const QList<qint64> &ordered, double fraction)
+{
+  if (ordered.isEmpty())
+    return 0;
+  int index = qMin(ordered.size() - 1, qRound(fraction * (ordered.size() - 1)));
+  return ordered.at(index);
+}
+
+/** Summarize a trace file by span name.
+    @return a map from span name to a map of count, total_us, median_us,
+            p95_us and max_us, or an empty map if the file can't be read
+ */
+QVariantMap WidgetBench::summarize(const QString &traceFile)
+{
+  QVariantMap result;
+  QFile file(traceFile);
+  if (! file.open(QIODevice::ReadOnly))
+    return result;
+
+  QMap<QString, QList<qint64> > durations;
+  QJsonArray events = QJsonDocument::fromJson(file.readAll()).object()
+                                                             .value("traceEvents")
+                                                             .toArray();
+  foreach (const QJsonValue &value, events)
+  {
+    QJsonObject event = value.toObject();
+    if (event.value("ph").toString() != "X")
+      continue;
+    durations[event.value("name").toString()].append(qint64(event.value("dur").toDouble()));
+  }
+
+  QMapIterator<QString, QList<qint64> > it(durations);
+  while (it.hasNext())
+  {
+    it.next();
+    QList<qint64> values = it.value();
+    qSort(values);
+    qint64 total = 0;
+    foreach (qint64 duration, values)
+      total += duration;
+
+    QVariantMap stats;
+    stats.insert("count",     values.size());
+    stats.insert("total_us",  total);
+    stats.insert("median_us", percentile(values, 0.5));
+    stats.insert("p95_us",    percentile(values, 0.95));
+    stats.insert("max_us",    values.last());
+    result.insert(it.key(), stats);
+  }
+
+  return result;
+}
+
+/** Compare a summary against a baseline summary.
+    A span has regressed if its median grew by more than tolerance percent
+    and by at least minimumUs microseconds. Spans missing from either
+    side, and baseline entries with a count of 0, are ignored.
+    @return one line per span that regressed
+ */
+QStringList WidgetBench::compare(const QVariantMap &summary,
+                                 const QVariantMap &baseline,
+                                 double tolerance, double minimumUs)
+{
+  QStringList regressions;
+  QMapIterator<QString, QVariant> it(baseline);
+  while (it.hasNext())
+  {
+    it.next();
+    if (! summary.contains(it.key()) || it.value().toMap().value("count").toInt() == 0)
+      continue;
+
+    double oldMedian = it.value().toMap().value("median_us").toDouble();
+    double newMedian = summary.value(it.key()).toMap().value("median_us").toDouble();
+    if (newMedian > oldMedian * (1.0 + tolerance / 100.0) &&
+        newMedian - oldMedian >= minimumUs)
+      regressions << QString("%1: median %2 ms, baseline %3 ms")
+                       .arg(it.key())
+                       .arg(newMedian / 1000.0, 0, 'f', 1)
+                       .arg(oldMedian / 1000.0, 0, 'f', 1);
+  }
+  return regressions;
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef WIDGETBENCH_H
+#define WIDGETBENCH_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+class VirtualClusterLineEdit;
+class XComboBox;
+class XTreeWidget;
+class QWidget;
+
+/** @class WidgetBench
+
+    @brief Exercises the widget hot paths against synthetic data so their
+           XtTrace spans can be compared between builds.
+
+    setup() fills a temporary table with rows() rows of generated data.
+    warmUp() runs each case once and run() then repeats them iterations()
+    times. The widgets record their own spans (populate,
+    populateCalculatedColumns, sortItems, XComboBox::populate, completer,
+    createScriptEngine) and the cases add spans for the calls that aren't
+    traced in the client (toCsv, toHtml, and batches of decimalPlaces and
+    formatNumber calls).
+
+    summarize() and compare() read the resulting trace file. Their output
+    has the same layout as utilities/tracesummary.py so either can be used
+    to keep and check a baseline.
+ */
+class WidgetBench : public QObject
+{
+  Q_OBJECT
+
+  public:
+    WidgetBench(QObject *parent = 0);
+    ~WidgetBench();
+
+    int     rows()       const { return _rows; }
+    void    setRows(int rows)  { _rows = rows; }
+    int     iterations() const { return _iterations; }
+    void    setIterations(int iterations) { _iterations = iterations; }
+
+    bool    setup();
+    void    warmUp();
+    void    run();
+    QString lastError() const { return _lastError; }
+
+    static QVariantMap summarize(const QString &traceFile);
+    static QStringList compare(const QVariantMap &summary,
+                               const QVariantMap &baseline,
+                               double tolerance, double minimumUs);
+
+  private:
+    void    runOnce();
+
+    void    benchPopulate();
+    void    benchSort();
+    void    benchExport();
+    void    benchComboBox();
+    void    benchCompleter();
+    void    benchFormat();
+    void    benchScriptEngine();
+
+    int                     _iterations;
+    QString                 _lastError;
+    int                     _rows;
+    XComboBox              *_combo;
+    VirtualClusterLineEdit *_lineEdit;
+    XTreeWidget            *_tree;
+    QWidget                *_window;
+};
+
+#endif
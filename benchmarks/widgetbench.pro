@@ -0,0 +1,45 @@
+#
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+
+# Not built by default; run qmake with CONFIG+=benchmarks from the top level.
+
+include( ../global.pri )
+
+TARGET   = widgetbench
+TEMPLATE = app
+CONFIG  += qt warn_on
+QT      += concurrent core network printsupport script scripttools sql \
+           webkit webkitwidgets widgets xml
+
+greaterThan(QT_MAJOR_VERSION, 4) {
+  QT += designer serialport uitools webchannel websockets
+} else {
+  CONFIG += designer uitools
+}
+
+INCLUDEPATH += ../common ../scriptapi ../widgets ../widgets/tmp/lib .
+DEPENDPATH  += $${INCLUDEPATH}
+
+QMAKE_LIBDIR = ../lib $${OPENRPT_LIBDIR} $$QMAKE_LIBDIR
+LIBS        += -lxtuplewidgets -lxtuplecommon -lwrtembed -lopenrptcommon
+LIBS        += -lrenderer -lxtuplescriptapi -lqzint $${DMTXLIB} -lMetaSQL
+
+unix: !macx {
+  LIBS += -lz
+}
+
+DESTDIR     = ../bin
+MOC_DIR     = tmp
+OBJECTS_DIR = tmp
+UI_DIR      = tmp
+
+HEADERS = widgetbench.h
+SOURCES = main.cpp \
+          widgetbench.cpp
@@ -11,13 +11,16 @@
 #include "applock.h"
 
 #include <QtScript>
+#include <QHash>
 #include <QMessageBox>
 #include <QSqlError>
+#include <QStringList>
 #include <QVariant>
 #include <QWidget>
 
 #include "errorReporter.h"
 #include "xsqlquery.h"
+#include "xpreparedquery.h"
 
 class AppLockPrivate
 {
@@ -32,6 +35,12 @@ class AppLockPrivate
       if (! _dbIsOpen)
         return;
 
+      (void)isWebEnabled(parent->parent());
+      updateLockStatus();
+    }
+
+    static bool isWebEnabled(QObject *parent)
+    {
       if (_isWebEnabled.isNull())
       {
         XSqlQuery q("SELECT EXISTS(SELECT 1"
@@ -43,12 +52,11 @@ class AppLockPrivate
           _isWebEnabled = q.value("mobilized");
         else
           (void)ErrorReporter::error(QtCriticalMsg,
-                                     qobject_cast<QWidget*>(parent->parent()),
-                                     parent->tr("Locking Error"),
+                                     qobject_cast<QWidget*>(parent),
+                                     AppLock::tr("Locking Error"),
                                      q, __FILE__, __LINE__);
       }
-
-      updateLockStatus();
+      return _isWebEnabled.toBool();
     }
 
     void updateLockStatus()
@@ -56,26 +64,28 @@ class AppLockPrivate
       if (! _dbIsOpen || _id < 0)
         return;
 
+      int oid = relationOid(_table, _parent->parent());
+      if (oid < 0)
+        return;
+
       XSqlQuery q;
       if (_isWebEnabled.toBool())
         q.prepare("SELECT lock_pid = pg_backend_pid() AS mylock, lock_username"
                   "  FROM xt.lock"
-                  "  JOIN pg_class c ON lock_table_oid = c.oid"
-                  " WHERE relname = :table"
+                  " WHERE lock_table_oid = :oid"
                   "   AND lock_record_id = :id;");
       else
         q.prepare("SELECT l.pid = pg_backend_pid() AS mylock, usename AS lock_username"
                   "  FROM pg_locks l"
-                  "  JOIN pg_class c    on classid = c.oid"
                   "  JOIN pg_database d on database = d.oid"
                   "  JOIN pg_stat_activity a ON l.pid = a.pid"
                   " WHERE d.datname = current_database()"
-                  "   AND relname = :table"
+                  "   AND classid = :oid"
                   "   AND objid   = :id"
                   "   AND locktype = 'advisory';");
 
-      q.bindValue(":table", _table);
-      q.bindValue(":id",    _id);
+      q.bindValue(":oid", oid);
+      q.bindValue(":id",  _id);
       q.exec();
       if (q.first())
       {
@@ -96,6 +106,47 @@ class AppLockPrivate
       }
     }
 
+    /* Look up and remember the pg_class oids of the given tables, which
+       are what the locks are keyed on. Tables that don't exist are left out.
+     */
+    static bool cacheOids(const QStringList &tables, QObject *parent)
+    {
+      QStringList missing;
+      foreach (QString table, tables)
+        if (! _oids.contains(table) && ! missing.contains(table))
+          missing.append(table);
+      if (missing.isEmpty())
+        return true;
+
+      XSqlQuery q;
+      q.prepare("SELECT DISTINCT ON (relname) relname, CAST(oid AS INTEGER) AS oid"
+                "  FROM pg_class"
+                " WHERE relname = ANY(CAST(:tables AS TEXT[]))"
+                " ORDER BY relname, pg_table_is_visible(oid) DESC;");
+      q.bindValue(":tables", arrayLiteral(missing));
+      q.exec();
+      while (q.next())
+        _oids.insert(q.value("relname").toString(), q.value("oid").toInt());
+      return ! ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent),
+                                    AppLock::tr("Locking Error"),
+                                    q, __FILE__, __LINE__);
+    }
+
+    static int relationOid(const QString &table, QObject *parent)
+    {
+      if (! cacheOids(QStringList(table), parent))
+        return -1;
+      return _oids.value(table, -1);
+    }
+
+    static QString arrayLiteral(const QStringList &list)
+    {
+      QStringList quoted;
+      foreach (QString item, list)
+        quoted.append("\"" + QString(item).replace("\\", "\\\\").replace("\"", "\\\"") + "\"");
+      return "{" + quoted.join(",") + "}";
+    }
+
     QString  _error;
     int      _id;
     bool     _dbIsOpen;
@@ -105,10 +156,12 @@ class AppLockPrivate
     QString  _table;
     QString  _username;
 
-    static QVariant _isWebEnabled;
+    static QVariant            _isWebEnabled;
+    static QHash<QString, int> _oids;
 };
 
-QVariant AppLockPrivate::_isWebEnabled;
+QVariant            AppLockPrivate::_isWebEnabled;
+QHash<QString, int> AppLockPrivate::_oids;
 
 AppLock::AppLock(QObject *parent)
   : QObject(parent)
@@ -155,16 +208,21 @@ bool AppLock::acquire(AppLock::AcquireMode mode)
 
   bool result = false;
   _p->_error.clear();
-  XSqlQuery q;
-  q.prepare("SELECT tryLock(CAST(oid AS INTEGER), :id) AS locked"
-            "  FROM pg_class"
-            " WHERE relname=:table;");
-  q.bindValue(":id",    _p->_id);
-  q.bindValue(":table", _p->_table);
+  int oid = AppLockPrivate::relationOid(_p->_table, parent());
+  if (oid < 0)
+  {
+    _p->_error = tr("Cannot lock a record in %1, which does not appear to exist.")
+                   .arg(_p->_table);
+    return false;
+  }
+
+  XPreparedQuery q("SELECT tryLock(:oid, :id) AS locked;");
+  q->bindValue(":oid", oid);
+  q->bindValue(":id",  _p->_id);
   q.exec();
-  if (q.first())
+  if (q->first())
   {
-    result = q.value("locked").toBool();
+    result = q->value("locked").toBool();
     if (result)
     {
       _p->_myLock    = true;
@@ -187,8 +245,8 @@ bool AppLock::acquire(AppLock::AcquireMode mode)
   }
   else if (ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent()),
                                 tr("Locking Error"),
-                                q, __FILE__, __LINE__))
-    _p->_error = q.lastError().databaseText();
+                                *q, __FILE__, __LINE__))
+    _p->_error = q->lastError().databaseText();
 
   return result;
 }
@@ -228,16 +286,13 @@ bool AppLock::release()
   _p->_error.clear();
   if (_p->_myLock)
   {
-    XSqlQuery q;
-    q.prepare("SELECT pg_advisory_unlock(CAST(oid AS INTEGER), :id) AS released"
-              "  FROM pg_class"
-              " WHERE relname = :table;");
-    q.bindValue(":id",    _p->_id);
-    q.bindValue(":table", _p->_table);
+    XPreparedQuery q("SELECT pg_advisory_unlock(:oid, :id) AS released;");
+    q->bindValue(":oid", AppLockPrivate::relationOid(_p->_table, parent()));
+    q->bindValue(":id",  _p->_id);
     q.exec();
-    if (q.first())
+    if (q->first())
     {
-      released = q.value("released").toBool();
+      released = q->value("released").toBool();
       if (released)
       {
         _p->_myLock    = false;
@@ -246,8 +301,8 @@ bool AppLock::release()
     }
     else if (ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent()),
                                   tr("Unlocking Error"),
-                                  q, __FILE__, __LINE__))
-      _p->_error = q.lastError().text();
+                                  *q, __FILE__, __LINE__))
+      _p->_error = q->lastError().text();
   }
   if (! released)
   {
@@ -266,12 +321,283 @@ QString AppLock::lastError() const
   return _p->_error;
 }
 
+/** Forget the table oids and server features remembered for this
+    session. Call this when the database connection is replaced.
+ */
+void AppLock::clearCache()
+{
+  AppLockPrivate::_oids.clear();
+  AppLockPrivate::_isWebEnabled = QVariant();
+}
+
 QString AppLock::toString()  const
 {
   QString result("AppLock[%1, %2 (%3)]");
   return result.arg(_p->_table).arg(_p->_id).arg(_p->_error);
 }
 
+// AppLockSet ////////////////////////////////////////////////////////////////
+
+class AppLockSetPrivate
+{
+  public:
+    struct Record
+    {
+      QString table;
+      int     id;
+      QString holder;
+    };
+
+    AppLockSetPrivate()
+      : _held(false)
+    {
+    }
+
+    /* the oid and id arrays for the records, or false if a table is missing */
+    bool arrays(QObject *parent, QString &oids, QString &ids)
+    {
+      QStringList tables;
+      foreach (Record r, _records)
+        tables.append(r.table);
+      if (! AppLockPrivate::cacheOids(tables, parent))
+        return false;
+
+      QStringList oidlist;
+      QStringList idlist;
+      foreach (Record r, _records)
+      {
+        if (! AppLockPrivate::_oids.contains(r.table))
+        {
+          _error = AppLock::tr("Cannot lock a record in %1, which does not appear to exist.")
+                     .arg(r.table);
+          return false;
+        }
+        oidlist.append(QString::number(AppLockPrivate::_oids.value(r.table)));
+        idlist.append(QString::number(r.id));
+      }
+      oids = "{" + oidlist.join(",") + "}";
+      ids  = "{" + idlist.join(",")  + "}";
+      return true;
+    }
+
+    QString       _error;
+    bool          _held;
+    QList<Record> _records;
+};
+
+AppLockSet::AppLockSet(QObject *parent)
+  : QObject(parent)
+{
+  _p = new AppLockSetPrivate();
+}
+
+AppLockSet::~AppLockSet()
+{
+  (void)release();
+  delete _p;
+  _p = 0;
+}
+
+/** Add a record to the set. The set must not be locked. */
+void AppLockSet::append(QString table, int id)
+{
+  if (_p->_held)
+  {
+    _p->_error = AppLock::tr("Cannot change the description of a locked object.");
+    return;
+  }
+  AppLockSetPrivate::Record r;
+  r.table = table;
+  r.id    = id;
+  _p->_records.append(r);
+}
+
+/** Release any locks and empty the set. */
+void AppLockSet::clear()
+{
+  (void)release();
+  _p->_records.clear();
+}
+
+int AppLockSet::count() const
+{
+  return _p->_records.size();
+}
+
+/** Lock all of the records in the set or none of them.
+
+   @return true if this set now holds every lock
+   @see lockedOut()
+ */
+bool AppLockSet::acquire(AppLock::AcquireMode mode)
+{
+  _p->_error.clear();
+  if (_p->_held)
+    return true;
+  if (! QSqlDatabase::database().isOpen())
+    return false;
+  if (_p->_records.isEmpty())
+  {
+    _p->_error = AppLock::tr("Cannot acquire a lock without a table and record id.");
+    if (mode == AppLock::Interactive)
+      QMessageBox::critical(0, AppLock::tr("Cannot Acquire Lock"), _p->_error);
+    return false;
+  }
+
+  QString oids, ids;
+  if (! _p->arrays(parent(), oids, ids))
+    return false;
+
+  // the CTEs call volatile functions so each is evaluated once, in full,
+  // and the undo sees every tryLock result before giving locks back.
+  // undone is selected only to make the undo CTE run.
+  QString holders = AppLockPrivate::isWebEnabled(parent())
+    ? "SELECT lock_table_oid AS oid, lock_record_id AS id,"
+      "       string_agg(DISTINCT lock_username, ', ') AS lock_username"
+      "  FROM xt.lock"
+      " WHERE lock_pid != pg_backend_pid()"
+      " GROUP BY lock_table_oid, lock_record_id"
+    : "SELECT CAST(classid AS INTEGER) AS oid, CAST(objid AS INTEGER) AS id,"
+      "       string_agg(DISTINCT CAST(usename AS TEXT), ', ') AS lock_username"
+      "  FROM pg_locks l"
+      "  JOIN pg_database d on database = d.oid"
+      "  JOIN pg_stat_activity a ON l.pid = a.pid"
+      " WHERE d.datname = current_database()"
+      "   AND locktype = 'advisory'"
+      "   AND l.pid != pg_backend_pid()"
+      " GROUP BY classid, objid";
+
+  XSqlQuery q;
+  q.prepare("WITH req AS ("
+            "  SELECT oid, id, ord"
+            "    FROM unnest(CAST(:oids AS INTEGER[]), CAST(:ids AS INTEGER[]))"
+            "         WITH ORDINALITY AS r(oid, id, ord)"
+            "), got AS ("
+            "  SELECT oid, id, ord, tryLock(oid, id) AS locked FROM req"
+            "), failed AS ("
+            "  SELECT EXISTS(SELECT 1 FROM got WHERE NOT locked) AS failed"
+            "), undo AS ("
+            "  SELECT count(pg_advisory_unlock(oid, id)) AS undone"
+            "    FROM got CROSS JOIN failed"
+            "   WHERE locked AND failed"
+            "), holder AS (" + holders +
+            ")"
+            "SELECT got.locked AND NOT failed AS locked, lock_username, undone"
+            "  FROM got CROSS JOIN failed CROSS JOIN undo"
+            "  LEFT OUTER JOIN holder ON holder.oid = got.oid AND holder.id = got.id"
+            " ORDER BY got.ord;");
+  q.bindValue(":oids", oids);
+  q.bindValue(":ids",  ids);
+  q.exec();
+
+  bool locked = true;
+  int  row    = 0;
+  while (q.next() && row < _p->_records.size())
+  {
+    locked = locked && q.value("locked").toBool();
+    _p->_records[row++].holder = q.value("lock_username").toString();
+  }
+  if (ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent()),
+                           AppLock::tr("Locking Error"),
+                           q, __FILE__, __LINE__))
+  {
+    _p->_error = q.lastError().databaseText();
+    return false;
+  }
+
+  _p->_held = locked && row == _p->_records.size();
+  if (! _p->_held)
+  {
+    QStringList holders;
+    foreach (AppLockSetPrivate::Record r, _p->_records)
+      if (! r.holder.isEmpty() && ! holders.contains(r.holder))
+        holders.append(r.holder);
+    _p->_error = tr("One or more of the records you are trying to edit are "
+                    "currently being edited by another user (%1).")
+                   .arg(holders.join(", "));
+    if (mode == AppLock::Interactive)
+      QMessageBox::critical(0, AppLock::tr("Cannot Acquire Lock"), _p->_error);
+  }
+  else
+    for (int i = 0; i < _p->_records.size(); i++)
+      _p->_records[i].holder.clear();
+
+  return _p->_held;
+}
+
+/** @return true if this set holds the locks on all of its records */
+bool AppLockSet::holdsLocks() const
+{
+  return _p->_held;
+}
+
+/** @return who held the lock on this record the last time acquire()
+            failed, or an empty string
+ */
+QString AppLockSet::holder(QString table, int id) const
+{
+  foreach (AppLockSetPrivate::Record r, _p->_records)
+    if (r.table == table && r.id == id)
+      return r.holder;
+  return QString();
+}
+
+QString AppLockSet::lastError() const
+{
+  return _p->_error;
+}
+
+/** @return the records that kept the last acquire() from succeeding, as
+            maps with table, id, and username
+ */
+QVariantList AppLockSet::lockedOut() const
+{
+  QVariantList result;
+  foreach (AppLockSetPrivate::Record r, _p->_records)
+  {
+    if (r.holder.isEmpty())
+      continue;
+    QVariantMap record;
+    record.insert("table",    r.table);
+    record.insert("id",       r.id);
+    record.insert("username", r.holder);
+    result.append(record);
+  }
+  return result;
+}
+
+/** Release all of the locks in one statement. */
+bool AppLockSet::release()
+{
+  if (! _p->_held || ! QSqlDatabase::database().isOpen())
+    return true;
+
+  _p->_error.clear();
+  QString oids, ids;
+  if (! _p->arrays(parent(), oids, ids))
+    return false;
+
+  XSqlQuery q;
+  q.prepare("SELECT bool_and(pg_advisory_unlock(oid, id)) AS released"
+            "  FROM unnest(CAST(:oids AS INTEGER[]), CAST(:ids AS INTEGER[])) AS r(oid, id);");
+  q.bindValue(":oids", oids);
+  q.bindValue(":ids",  ids);
+  q.exec();
+  if (q.first())
+  {
+    _p->_held = false;
+    if (! q.value("released").toBool())
+      _p->_error = AppLock::tr("Could not release the lock.");
+    return q.value("released").toBool();
+  }
+  else if (ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent()),
+                                AppLock::tr("Unlocking Error"),
+                                q, __FILE__, __LINE__))
+    _p->_error = q.lastError().text();
+
+  return false;
+}
+
 // script exposure /////////////////////////////////////////////////////////////
 
 QScriptValue AppLockToScriptValue(QScriptEngine *engine, AppLock *const &lock)
@@ -284,9 +610,30 @@ void AppLockFromScriptValue(const QScriptValue &obj, AppLock * &lock)
   lock = qobject_cast<AppLock *>(obj.toQObject());
 }
 
+QScriptValue AppLockSetToScriptValue(QScriptEngine *engine, AppLockSet *const &set)
+{
+  return engine->newQObject(set);
+}
+
+void AppLockSetFromScriptValue(const QScriptValue &obj, AppLockSet * &set)
+{
+  set = qobject_cast<AppLockSet *>(obj.toQObject());
+}
+
+QScriptValue constructAppLockSet(QScriptContext *context, QScriptEngine *engine)
+{
+  QObject *parent = 0;
+  if (context->argumentCount() > 0)
+    parent = context->argument(0).toQObject();
+
+  return engine->toScriptValue(new AppLockSet(parent));
+}
+
 void setupAppLockProto(QScriptEngine *engine)
 {
   qScriptRegisterMetaType(engine, AppLockToScriptValue, AppLockFromScriptValue);
+  qScriptRegisterMetaType(engine, AppLockSetToScriptValue, AppLockSetFromScriptValue);
+  engine->globalObject().setProperty("AppLockSet", engine->newFunction(constructAppLockSet));
 
   QScriptValue proto = engine->newQObject(new AppLockProto(engine));
   engine->setDefaultPrototype(qMetaTypeId<AppLock*>(), proto);
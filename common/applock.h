@@ -39,11 +39,48 @@ class AppLock : public QObject
     Q_INVOKABLE bool    release();
     Q_INVOKABLE QString toString()    const;
 
+    static void clearCache();
+
   private:
     AppLockPrivate *_p;
 };
 
+class AppLockSetPrivate;
+
+/** @class AppLockSet
+
+    @brief Application-level locks on a set of records, acquired and
+           released together.
+
+    acquire() locks every record in one statement or none of them. If any
+    record is locked by someone else, the locks that were taken are given
+    back and lockedOut() says who holds the others.
+ */
+class AppLockSet : public QObject
+{
+  Q_OBJECT
+
+  public:
+    AppLockSet(QObject *parent = 0);
+    ~AppLockSet();
+
+    Q_INVOKABLE void         append(QString table, int id);
+    Q_INVOKABLE void         clear();
+    Q_INVOKABLE int          count()       const;
+
+    Q_INVOKABLE bool         acquire(AppLock::AcquireMode mode = AppLock::Silent);
+    Q_INVOKABLE bool         holdsLocks()  const;
+    Q_INVOKABLE QString      holder(QString table, int id) const;
+    Q_INVOKABLE QString      lastError()   const;
+    Q_INVOKABLE QVariantList lockedOut()   const;
+    Q_INVOKABLE bool         release();
+
+  private:
+    AppLockSetPrivate *_p;
+};
+
 Q_DECLARE_METATYPE(AppLock *)
+Q_DECLARE_METATYPE(AppLockSet *)
 Q_DECLARE_METATYPE(enum AppLock::AcquireMode)
 
 void setupAppLockProto(QScriptEngine *engine);
@@ -19,9 +19,6 @@
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QMessageBox>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
-#include <QNetworkRequest>
 #include <QProcess>
 #include <QProgressDialog>
 #include <QPushButton>
@@ -38,6 +35,7 @@
 #include <parameter.h>
 
 #include "xsqlquery.h"
+#include "xtNetworkRequestManager.h"
 
 #define QT_NO_URL_CAST_FROM_STRING
 
@@ -147,7 +145,8 @@ class checkForUpdatesPrivate {
 
 checkForUpdates::checkForUpdates(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : QDialog(parent, modal ? (fl | Qt::Dialog) : fl),
-      reply(0)
+      file(0),
+      _request(0)
 {
   Q_UNUSED(name);
 
@@ -158,6 +157,11 @@ checkForUpdates::checkForUpdates(QWidget* parent, const char* name, bool modal,
   connect(_ok,        SIGNAL(clicked()),  this, SLOT(downloadButtonPressed()));
   connect(_buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
   connect(_ignore,    SIGNAL(clicked()),  this, SLOT(accept()));
+  connect(progressDialog, SIGNAL(canceled()), this, SLOT(cancelDownload()));
+
+  xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
+  connect(network, SIGNAL(finished(int)),                         this, SLOT(downloadFinished(int)));
+  connect(network, SIGNAL(downloadProgress(int, qint64, qint64)), this, SLOT(downloadProgress(int, qint64, qint64)));
 
   XSqlQuery metric;
   metric.exec("SELECT fetchMetricText('ServerVersion') AS dbver,"
@@ -221,55 +225,48 @@ void checkForUpdates::downloadButtonPressed()
   }
 
   downloadRequestAborted = false;
-  reply = manager.get(QNetworkRequest(url));
-  connect(reply, SIGNAL(finished()),  this, SLOT(downloadFinished()));
-  connect(reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
-  connect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
-  connect(progressDialog, SIGNAL(canceled()), this, SLOT(cancelDownload()));
+  _request = xtNetworkRequestManager::instance()->get(url, xtNetworkRequestManager::UseCache, file);
 
   progressDialog->setLabelText(tr("Downloading %1...").arg(filename));
   _ok->setEnabled(false);
   progressDialog->exec();
 }
 
-void checkForUpdates::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+void checkForUpdates::downloadProgress(int request, qint64 bytesReceived, qint64 bytesTotal)
 {
-    if(downloadRequestAborted)
+    if(request != _request || downloadRequestAborted)
         return;
     progressDialog->setMaximum(bytesTotal);
     filesize = bytesTotal;
     progressDialog->setValue(bytesReceived);
 }
 
-void checkForUpdates::downloadReadyRead()
-{
-    if(file)
-        file->write(reply->readAll());
-}
-
 void checkForUpdates::cancelDownload()
 {
     downloadRequestAborted = true;
-    reply->abort();
+    xtNetworkRequestManager::instance()->cancel(_request);
     _ok->setEnabled(true);
 }
 
-void checkForUpdates::downloadFinished()
+void checkForUpdates::downloadFinished(int request)
 {
+  if (request != _request)
+    return;
   if (DEBUG) qDebug() << "downloadFinished() entered";
+
+  xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
   if(!downloadRequestAborted)
   {
-    downloadReadyRead();
     file->flush();
 
-    if(reply->error())
+    if(network->error(request) != QNetworkReply::NoError)
       QMessageBox::information(this, tr("Download Failed"),
-                               tr("Failed: %1").arg(reply->errorString()));
+                               tr("Failed: %1").arg(network->errorString(request)));
     else
       startUpdate();
   }
-  reply->deleteLater();
-  reply = 0;
+  network->release(request);
+  _request = 0;
   progressDialog->hide();
   _ok->setEnabled(true);
 
@@ -428,6 +425,8 @@ void checkForUpdates::startUpdate()
 
 checkForUpdates::~checkForUpdates()
 {
+  if (_request)
+    xtNetworkRequestManager::instance()->release(_request);
   if (progressDialog) {
     delete progressDialog;
     progressDialog = 0;
@@ -12,12 +12,10 @@
 #define CHECKFORUPDATES_H
 
 #include <QDialog>
-#include <QNetworkAccessManager>
 
 #include "tmp/ui_checkForUpdates.h"
 
 class QFile;
-class QNetworkReply;
 class QProgressDialog;
 class QPushButton;
 class checkForUpdatesPrivate;
@@ -36,9 +34,8 @@ public:
 
 public slots:
     void downloadButtonPressed();
-    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
-    void downloadFinished();
-    void downloadReadyRead();
+    void downloadProgress(int request, qint64 bytesReceived, qint64 bytesTotal);
+    void downloadFinished(int request);
     void cancelDownload();
     void startUpdate();
 
@@ -47,10 +44,9 @@ protected slots:
 
 private:
     checkForUpdatesPrivate *_private;
-    QNetworkAccessManager   manager;
     QFile                *file;
     QProgressDialog      *progressDialog;
-    QNetworkReply        *reply;
+    int                   _request;
     bool                  downloadRequestAborted;
     qint64                filesize;
 };
@@ -49,9 +49,17 @@ SOURCES = applock.cpp              \
           statusbarmessagehandler.cpp \
           storedProcErrorLookup.cpp \
           tarfile.cpp \
+          uiformhash.cpp \
           xabstractmessagehandler.cpp \
           xbase32.cpp \
           xcachedhash.cpp               \
+          xdiskcache.cpp \
+          xdocumenttransfer.cpp \
+          ximagecache.cpp \
+          xpreparedquery.cpp \
+          xreadreplica.cpp \
+          xsqlprofiler.cpp \
+          xttrace.cpp \
           xtupleproductkey.cpp \
           xtNetworkRequestManager.cpp \
           xtsettings.cpp
@@ -78,15 +86,23 @@ HEADERS = applock.h              \
           statusbarmessagehandler.h \
           storedProcErrorLookup.h \
           tarfile.h \
+          uiformhash.h \
           xabstractmessagehandler.h \
           xbase32.h \
           xcachedhash.h                 \
+          xdiskcache.h \
+          xdocumenttransfer.h \
+          ximagecache.h \
+          xpreparedquery.h \
+          xreadreplica.h \
+          xsqlprofiler.h \
+          xttrace.h \
           xtupleproductkey.h \
           xtNetworkRequestManager.h \
           xtsettings.h
 
 FORMS = login2.ui checkForUpdates.ui
 
-QT +=  script sql xml xmlpatterns network widgets
+QT +=  concurrent script sql xml xmlpatterns network widgets
 
 RESOURCES += xTupleCommon.qrc
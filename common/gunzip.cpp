@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2010 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -13,6 +13,8 @@
 #include <zlib.h>
 #include <qbuffer.h>
 
+#define GUNZIPBUFFER (64 * 1024)
+
 QByteArray gunzipFile(const QString & file)
 {
   QByteArray data;
@@ -20,6 +22,7 @@ QByteArray gunzipFile(const QString & file)
   gzFile fin = gzopen(file.toLatin1().data(), "rb");
   if(!fin)
     return data;
+  gzbuffer(fin, GUNZIPBUFFER);
 
   QBuffer fout(&data);
   if(!fout.open(QIODevice::WriteOnly))
@@ -28,16 +31,16 @@ QByteArray gunzipFile(const QString & file)
     return data;
   }
 
-  char bytes[1024];
+  QByteArray bytes(GUNZIPBUFFER, '\0');
   int byte_count;
 
   while(!gzeof(fin))
   {
-    byte_count = gzread(fin, &bytes[0], 1024);
+    byte_count = gzread(fin, bytes.data(), GUNZIPBUFFER);
     if(byte_count == -1)
       break;
     if(byte_count > 0)
-      fout.write(&bytes[0], byte_count);
+      fout.write(bytes.constData(), byte_count);
   }
 
   fout.close();
@@ -13,6 +13,8 @@
 
 #include <QString>
 
+// Holds the whole uncompressed file in memory; see TarReader in tarfile.h
+// for unpacking archives without doing that.
 QByteArray gunzipFile(const QString & file);
 
 #endif
@@ -18,11 +18,13 @@
 
 #include "errorReporter.h"
 #include "xsqlquery.h"
+#include "xpreparedquery.h"
 
 Parameters::Parameters(QObject * parent)
   : QObject(parent)
 {
   _dirty = false;
+  _parentsValid = false;
 }
 
 void Parameters::load()
@@ -42,9 +44,18 @@ void Parameters::load()
 
   _dirty = false;
 
+  valuesLoaded();
   emit loaded();
 }
 
+/* Called after load() has refreshed _values but before loaded() is emitted
+   so subclasses can rebuild anything derived from them.
+ */
+void Parameters::valuesLoaded()
+{
+  _parentsValid = false;
+}
+
 void Parameters::sSetDirty(const QString &note)
 {
     if(note == _notifyName)
@@ -119,28 +130,41 @@ void Parameters::set(const QString &pName, const QString &pValue)
   else
     _values[pName] = pValue;
 
+  _parentsValid = false;
   _set(pName, pValue);
 }
 
 void Parameters::_set(const QString &pName, QVariant pValue)
 {
-  XSqlQuery q;
-  q.prepare(_setSql);
-  q.bindValue(":username", _username);
-  q.bindValue(":name", pName);
-  q.bindValue(":value", pValue);
+  XPreparedQuery q(_setSql);
+  q->bindValue(":username", _username);
+  q->bindValue(":name", pName);
+  q->bindValue(":value", pValue);
   q.exec();
 
   _dirty = true;
 }
 
+/* Find the first key, in key order, whose value is pValue. The reverse
+   index is rebuilt on the first lookup after the values change.
+ */
 QString Parameters::parent(const QString &pValue)
 {
-  for (MetricMap::iterator it = _values.begin(); it != _values.end(); it++)
-    if (it.value() == pValue)
-      return it.key();
+  if (! _parentsValid)
+  {
+    _parents.clear();
+    _parents.reserve(_values.size());
+    for (MetricMap::const_iterator it = _values.constBegin(); it != _values.constEnd(); it++)
+      if (! _parents.contains(it.value()))
+        _parents.insert(it.value(), it.key());
+    _parentsValid = true;
+  }
+
+  QHash<QString, QString>::const_iterator it = _parents.constFind(pValue);
+  if (it == _parents.constEnd())
+    return QString::null;
 
-  return QString::null;
+  return it.value();
 }
 
 Metrics::Metrics()
@@ -176,7 +200,9 @@ void Preferences::remove(const QString &pPrefName)
 
 Privileges::Privileges()
 {
-  _notifyName = "usrprivUpdated";
+  _notifyName  = "usrprivUpdated";
+  _superuserId = intern("#superuser");
+  _dba         = -1;
   QString user;
   XSqlQuery userq("SELECT getEffectiveXtUser() AS user;");
   if (userq.lastError().type() != QSqlError::NoError)
@@ -202,36 +228,110 @@ Privileges::Privileges()
   load();
 }
 
+/* Privilege expressions are compiled once into a list of alternatives,
+   each a list of privilege ids that must all be granted:
+   "A B+C" means A or (B and C). The user's privileges are kept as a bitset
+   indexed by those ids.
+ */
+int Privileges::intern(const QString &pName)
+{
+  QHash<QString, int>::const_iterator it = _ids.constFind(pName);
+  if (it != _ids.constEnd())
+    return it.value();
+
+  int id = _ids.size();
+  _ids.insert(pName, id);
+  _granted.resize(id + 1);
+  _granted.setBit(id, _values.contains(pName));
+  _changed.resize(id + 1);
+  _changed.setBit(id);
+  return id;
+}
+
+const Privileges::Expression &Privileges::compile(const QString &pName)
+{
+  QHash<QString, Expression>::const_iterator it = _compiled.constFind(pName);
+  if (it != _compiled.constEnd())
+    return it.value();
+
+  Expression expr;
+  foreach (QString term, pName.split(' ', QString::SkipEmptyParts))
+  {
+    QVector<int> ids;
+    foreach (QString priv, term.split('+', QString::SkipEmptyParts))
+      ids.append(intern(priv));
+    if (! ids.isEmpty())
+      expr.append(ids);
+  }
+  return _compiled.insert(pName, expr).value();
+}
+
+bool Privileges::granted(int pId)
+{
+  if (pId == _superuserId)
+  {
+    if (_dba < 0)
+      _dba = isDba() ? 1 : 0;
+    return _dba == 1;
+  }
+  return _granted.testBit(pId);
+}
+
+/* Rebuild the bitset and remember which privileges were granted or revoked
+   so callers can skip re-evaluating expressions that didn't change.
+ */
+void Privileges::valuesLoaded()
+{
+  Parameters::valuesLoaded();
+
+  QBitArray previous = _granted;
+  _granted = QBitArray(_ids.size());
+  for (QHash<QString, int>::const_iterator it = _ids.constBegin(); it != _ids.constEnd(); it++)
+    if (_values.contains(it.key()))
+      _granted.setBit(it.value());
+
+  _changed = previous ^ _granted;
+  _changed.setBit(_superuserId);
+  _dba = -1;
+}
+
 bool Privileges::check(const QString &pName)
 {
-    if (pName == "#superuser")
-      return isDba();
+  if (pName == "#superuser")
+    return isDba();
 
-    if(_dirty)
-      load();
+  if(_dirty)
+    load();
 
-    MetricMap::iterator it = _values.find(pName);
-    if (it != _values.end())
+  const Expression &expr = compile(pName);
+  for (int i = 0; i < expr.size(); i++)
+  {
+    const QVector<int> &ids = expr.at(i);
+    bool anded = true;
+    for (int j = 0; anded && j < ids.size(); j++)
+      anded = granted(ids.at(j));
+    if (anded)
       return true;
+  }
+
+  return false;
+}
 
-    if (pName.contains(" ")) {
-      QStringList privlist = pName.split(' ', QString::SkipEmptyParts);
-      foreach (QString priv, privlist) {
-        if (check(priv))
-          return true;
-      }
-    }
-
-    if (pName.contains("+")) {
-      bool anded = true;
-      QStringList privlist = pName.split('+', QString::SkipEmptyParts);
-      foreach (QString priv, privlist) {
-        anded = anded && check(priv);
-      }
-      return anded;
-    }
-
- return false;
+/** Return true if any privilege named in pName was granted or revoked by
+    the most recent load, or if pName hasn't been checked before.
+ */
+bool Privileges::changed(const QString &pName)
+{
+  if (! _compiled.contains(pName))
+    return true;
+
+  const Expression &expr = compile(pName);
+  for (int i = 0; i < expr.size(); i++)
+    for (int j = 0; j < expr.at(i).size(); j++)
+      if (_changed.testBit(expr.at(i).at(j)))
+        return true;
+
+  return false;
 }
 
 bool Privileges::isDba()
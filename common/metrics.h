@@ -12,9 +12,12 @@
 #ifndef metrics_h
 #define metrics_h
 
+#include <QBitArray>
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QMap>
+#include <QVector>
 
 class QScriptEngine;
 
@@ -31,6 +34,8 @@ class Parameters : public QObject
     QString   _username;
     bool      _dirty;
     QString   _notifyName;
+    QHash<QString, QString> _parents;  // value -> first key, built by parent()
+    bool      _parentsValid;
 
   public:
     Parameters(QObject * parent = 0);
@@ -57,6 +62,7 @@ class Parameters : public QObject
 
   protected:
     virtual void _set(const QString &, QVariant);
+    virtual void valuesLoaded();
 
   signals:
     void loaded();
@@ -89,9 +95,28 @@ class Privileges : public Parameters
   public:
     Privileges();
 
+    Q_INVOKABLE bool changed(const QString &);
+
   public slots:
     bool check(const QString &);
     bool isDba();
+
+  protected:
+    virtual void valuesLoaded();
+
+  private:
+    typedef QVector<QVector<int> > Expression; // OR of ANDed privilege ids
+
+    const Expression &compile(const QString &);
+    bool              granted(int);
+    int               intern(const QString &);
+
+    QHash<QString, Expression> _compiled;
+    QHash<QString, int>        _ids;
+    QBitArray                  _granted;
+    QBitArray                  _changed;
+    int                        _superuserId;
+    int                        _dba;        // -1 until isDba() is asked
 };
 
 void setupParameters(QScriptEngine *engine, QString name, Parameters *params);
@@ -10,6 +10,7 @@
 
 #include "mqlhash.h"
 
+#include <QRegExp>
 #include <QVariant>
 
 #include "xsqlquery.h"
@@ -40,6 +41,57 @@ bool MqlHash::refresh(const QString &key)
   return false;
 }
 
+/* Fetch the best grade of every statement in keys with one query. */
+int MqlHash::refresh(const QList<QString> &keys)
+{
+  if (keys.size() == 1)
+    return refresh(keys.first()) ? 1 : 0;
+
+  XSqlQuery q;
+  q.prepare("SELECT DISTINCT ON (metasql_group, metasql_name)"
+            "       metasql_group || '%' || metasql_name AS key, metasql_query"
+            "  FROM metasql"
+            " WHERE metasql_group || '%' || metasql_name"
+            "       = ANY(string_to_array(:keys, E'\\n'))"
+            " ORDER BY metasql_group, metasql_name, metasql_grade DESC;");
+  q.bindValue(":keys", QStringList(keys).join("\n"));
+  q.exec();
+
+  int fetched = 0;
+  while (q.next())
+  {
+    insert(q.value("key").toString(), q.value("metasql_query").toString());
+    fetched++;
+  }
+  return fetched;
+}
+
+/* The payload is either "group%name" to drop one statement or "group" to
+   drop every statement in the group. Anything else isn't ours to guess
+   at, so return false and let the whole cache be reloaded.
+ */
+bool MqlHash::keysForPayload(const QString &pNotification, const QString &pPayload, QList<QString> &pKeys) const
+{
+  Q_UNUSED(pNotification);
+  static const QRegExp format("^[\\w.-]+(%[\\w.-]+)?$");
+  if (! format.exactMatch(pPayload))
+    return false;
+
+  if (pPayload.contains("%"))
+  {
+    pKeys.append(pPayload);
+    return true;
+  }
+
+  QString prefix = pPayload + "%";
+  for (const_iterator it = constBegin(); it != constEnd(); ++it)
+  {
+    if (it.key().startsWith(prefix))
+      pKeys.append(it.key());
+  }
+  return true;
+}
+
 const QString MqlHash::value(const QString &pGroup, const QString &pName)
 {
   return value(pGroup + "%" + pName);   // must match key.split() above
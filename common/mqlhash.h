@@ -22,7 +22,11 @@ class MqlHash : public XCachedHash<QString, QString>
     using XCachedHash::value;
 
     virtual       bool    refresh(const QString &key);
+    virtual       int     refresh(const QList<QString> &keys);
     virtual const QString value(const QString &pGroup, const QString &pName);
+
+  protected:
+    virtual bool keysForPayload(const QString &pNotification, const QString &pPayload, QList<QString> &pKeys) const;
 };
 
 #endif
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -13,6 +13,24 @@
 #include <qtextstream.h>
 #include <qbuffer.h>
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QRegExp>
+#include <QSaveFile>
+#include <QtDebug>
+
+#include <stddef.h>
+#include <string.h>
+#include <zlib.h>
+
+#define DEBUG false
+
+#define TARBLOCK          512
+#define DEFAULTBUFFERSIZE (256 * 1024)
+#define MAXEXTENDEDHEADER (64 * 1024)
+
 struct tarHeaderBlock {
     char name[100];     // name of file
     char mode[8];       // file mode
@@ -41,6 +59,9 @@ const char TYPE_BLOCK       = '4';  // Block special device
 const char TYPE_DIR         = '5';  // Directory
 const char TYPE_FIFO        = '6';  // FIFO special file
 const char TYPE_CONTIGUOS   = '7';  // RESERVERED/Contiguous file
+const char TYPE_PAX_GLOBAL  = 'g';  // pax global extended header
+const char TYPE_PAX         = 'x';  // pax extended header for the next member
+const char TYPE_GNU_LONG    = 'L';  // GNU long name for the next member
 
 
 TarFile::TarFile(const QByteArray & bytes)
@@ -113,3 +134,481 @@ TarFile::TarFile(const QByteArray & bytes)
 TarFile::~TarFile()
 {
 }
+
+static int _tarBufferSize = DEFAULTBUFFERSIZE;
+
+/* Header numbers are octal text, except that GNU tar writes values too
+   big for the field in base 256, flagged by the high bit.
+ */
+static qint64 tarNumber(const char *pField, int pLength)
+{
+  qint64 result = 0;
+  if (pLength > 0 && (pField[0] & 0x80))
+  {
+    result = pField[0] & 0x3f;
+    for (int i = 1; i < pLength; i++)
+      result = (result << 8) | (unsigned char)pField[i];
+    return result;
+  }
+
+  for (int i = 0; i < pLength && pField[i]; i++)
+  {
+    if (pField[i] == ' ')
+    {
+      if (result)
+        break;
+      continue;
+    }
+    if (pField[i] < '0' || pField[i] > '7')
+      break;
+    result = result * 8 + (pField[i] - '0');
+  }
+  return result;
+}
+
+static QString tarString(const char *pField, int pLength)
+{
+  return QString::fromUtf8(pField, qstrnlen(pField, pLength));
+}
+
+/* The checksum is the sum of the header's bytes with the checksum field
+   taken as spaces. Some old tars summed them as signed chars.
+ */
+static bool tarChecksumOk(const tarHeaderBlock &pHead)
+{
+  const unsigned char *ubytes = (const unsigned char *)&pHead;
+  const signed char   *sbytes = (const signed char *)&pHead;
+  const int start = offsetof(tarHeaderBlock, chksum);
+  const int end   = start + sizeof pHead.chksum;
+
+  qint64 usum = 0;
+  qint64 ssum = 0;
+  for (int i = 0; i < TARBLOCK; i++)
+  {
+    if (i >= start && i < end)
+    {
+      usum += ' ';
+      ssum += ' ';
+    }
+    else
+    {
+      usum += ubytes[i];
+      ssum += sbytes[i];
+    }
+  }
+  qint64 expected = tarNumber(pHead.chksum, sizeof pHead.chksum);
+  return expected == usum || expected == ssum;
+}
+
+static qint64 tarPadded(qint64 pSize)
+{
+  return (pSize + TARBLOCK - 1) / TARBLOCK * TARBLOCK;
+}
+
+/* Where pName should go under pDir, or an empty string if it would end
+   up somewhere else.
+ */
+static QString tarDestination(const QString &pDir, const QString &pName)
+{
+  QString clean = QDir::cleanPath(pName);
+  if (clean.isEmpty() || clean == "." || clean == ".." ||
+      clean.startsWith("../") || clean.contains(':') ||
+      QDir::isAbsolutePath(clean))
+    return QString();
+  return QDir(pDir).filePath(clean);
+}
+
+bool TarReader::Member::isFile() const
+{
+  return type == TYPE_REGULAR || type == TYPE_REGULAR_ALT || type == TYPE_CONTIGUOS;
+}
+
+bool TarReader::Member::isDir() const
+{
+  return type == TYPE_DIR;
+}
+
+TarReader::TarReader(const QString &pFilename)
+  : _filename(pFilename),
+    _in(0),
+    _pos(0),
+    _indexed(false)
+{
+}
+
+TarReader::~TarReader()
+{
+  close();
+}
+
+/** The size of the read buffer, and of the chunks members are copied in. */
+int TarReader::bufferSize()
+{
+  return _tarBufferSize;
+}
+
+void TarReader::setBufferSize(int pBytes)
+{
+  _tarBufferSize = qMax(TARBLOCK, pBytes / TARBLOCK * TARBLOCK);
+}
+
+QString TarReader::lastError() const
+{
+  return _lastError;
+}
+
+bool TarReader::open()
+{
+  close();
+  _in = gzopen(QFile::encodeName(_filename).constData(), "rb");
+  if (! _in)
+  {
+    _lastError = QObject::tr("Could not open %1").arg(_filename);
+    return false;
+  }
+  gzbuffer(_in, _tarBufferSize);
+  _pos = 0;
+  return true;
+}
+
+void TarReader::close()
+{
+  if (_in)
+  {
+    gzclose(_in);
+    _in = 0;
+  }
+}
+
+/** The members of the archive, in order. Empty if it can't be read. */
+QList<TarReader::Member> TarReader::members()
+{
+  if (! buildIndex())
+    return QList<Member>();
+  return _index;
+}
+
+bool TarReader::contains(const QString &pName)
+{
+  return buildIndex() && _byName.contains(pName);
+}
+
+/** Copy member pName to pOutput, which must already be open. */
+bool TarReader::extract(const QString &pName, QIODevice *pOutput)
+{
+  if (! buildIndex())
+    return false;
+
+  int i = _byName.value(pName, -1);
+  if (i < 0 || ! _index.at(i).isFile())
+  {
+    _lastError = QObject::tr("%1 does not contain a file named %2")
+                   .arg(_filename, pName);
+    return false;
+  }
+  return seek(_index.at(i).offset) && copyData(_index.at(i), pOutput);
+}
+
+/** The contents of member pName. This holds the whole member in memory,
+    so use extract() for anything that might be large.
+ */
+QByteArray TarReader::read(const QString &pName)
+{
+  QByteArray result;
+  QBuffer    buffer(&result);
+  buffer.open(QIODevice::WriteOnly);
+  if (! extract(pName, &buffer))
+    result.clear();
+  return result;
+}
+
+/** Unpack the files whose names match one of pPatterns, or every file
+    if there are none, into pDir in one pass over the archive. Each file
+    is written to a temporary file and only replaces an existing one
+    once it is complete.
+
+    @return the number of files extracted, or -1 on error
+ */
+int TarReader::extractAll(const QString &pDir, const QStringList &pPatterns)
+{
+  if (! _in && ! open())
+    return -1;
+  if (! seek(0))
+    return -1;
+
+  QList<QRegExp> filters;
+  foreach (QString pattern, pPatterns)
+    filters.append(QRegExp(pattern, Qt::CaseSensitive, QRegExp::Wildcard));
+
+  if (! QDir().mkpath(pDir))
+  {
+    _lastError = QObject::tr("Could not create %1").arg(pDir);
+    return -1;
+  }
+
+  bool indexing = ! _indexed;
+  if (indexing)
+  {
+    _index.clear();
+    _byName.clear();
+  }
+
+  int count = 0;
+  forever
+  {
+    Member member;
+    HeaderResult result = readHeader(member);
+    if (result == EndOfArchive)
+      break;
+    if (result == Error)
+      return -1;
+    if (indexing)
+      addToIndex(member);
+
+    bool wanted = filters.isEmpty();
+    for (int i = 0; ! wanted && i < filters.size(); i++)
+      wanted = filters.at(i).exactMatch(member.name);
+
+    if (wanted && member.isFile())
+    {
+      if (! extractTo(member, pDir))
+        return -1;
+      count++;
+      continue;
+    }
+    if (wanted && member.isDir())
+    {
+      QString path = tarDestination(pDir, member.name);
+      if (! path.isEmpty())
+        QDir().mkpath(path);
+    }
+    if (! skipData(member))
+      return -1;
+  }
+
+  if (indexing)
+    _indexed = true;
+  return count;
+}
+
+bool TarReader::extractTo(const Member &pMember, const QString &pDir)
+{
+  QString path = tarDestination(pDir, pMember.name);
+  if (path.isEmpty())
+  {
+    _lastError = QObject::tr("%1 contains %2, which would be written outside %3")
+                   .arg(_filename, pMember.name, pDir);
+    return false;
+  }
+  if (DEBUG)
+    qDebug() << "TarReader extracting" << pMember.name << pMember.size << "to" << path;
+
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QSaveFile output(path);
+  if (! output.open(QIODevice::WriteOnly))
+  {
+    _lastError = QObject::tr("Could not write %1: %2").arg(path, output.errorString());
+    return false;
+  }
+  if (! copyData(pMember, &output))
+  {
+    output.cancelWriting();
+    return false;
+  }
+  if (! output.commit())
+  {
+    _lastError = QObject::tr("Could not write %1: %2").arg(path, output.errorString());
+    return false;
+  }
+  return true;
+}
+
+bool TarReader::buildIndex()
+{
+  if (_indexed)
+    return true;
+  if (! _in && ! open())
+    return false;
+  if (! seek(0))
+    return false;
+
+  _index.clear();
+  _byName.clear();
+  forever
+  {
+    Member member;
+    HeaderResult result = readHeader(member);
+    if (result == EndOfArchive)
+      break;
+    if (result == Error || ! skipData(member))
+      return false;
+    addToIndex(member);
+  }
+  _indexed = true;
+  return true;
+}
+
+void TarReader::addToIndex(const Member &pMember)
+{
+  _byName.insert(pMember.name, _index.size());   // a later copy wins, as with tar
+  _index.append(pMember);
+}
+
+/* Read the next member's header, along with any long-name or pax header
+   in front of it.
+ */
+TarReader::HeaderResult TarReader::readHeader(Member &pMember)
+{
+  QString longName;
+  forever
+  {
+    tarHeaderBlock head;
+    int got = gzread(_in, &head, TARBLOCK);
+    if (got == 0)
+      return EndOfArchive;      // missing the trailing zero blocks
+    if (got != TARBLOCK)
+    {
+      int errnum = 0;
+      _lastError = got < 0 ? QString(gzerror(_in, &errnum))
+                           : QObject::tr("%1 ends in the middle of a header").arg(_filename);
+      return Error;
+    }
+    _pos += TARBLOCK;
+
+    const char *bytes = (const char *)&head;
+    bool empty = true;
+    for (int i = 0; empty && i < TARBLOCK; i++)
+      empty = bytes[i] == '\0';
+    if (empty)
+      return EndOfArchive;
+
+    if (! tarChecksumOk(head))
+    {
+      _lastError = QObject::tr("%1 has a damaged header at offset %2")
+                     .arg(_filename).arg(_pos - TARBLOCK);
+      return Error;
+    }
+
+    Member member;
+    member.type     = head.typeflag == TYPE_REGULAR_ALT ? TYPE_REGULAR : head.typeflag;
+    member.size     = tarNumber(head.size, sizeof head.size);
+    member.offset   = _pos;
+    member.modified = QDateTime::fromTime_t(tarNumber(head.mtime, sizeof head.mtime));
+
+    if (member.type == TYPE_GNU_LONG || member.type == TYPE_PAX ||
+        member.type == TYPE_PAX_GLOBAL)
+    {
+      if (member.size > MAXEXTENDEDHEADER)
+      {
+        _lastError = QObject::tr("%1 has an extended header that is too long")
+                       .arg(_filename);
+        return Error;
+      }
+      QByteArray data(tarPadded(member.size), '\0');
+      if (! readBlocks(data.data(), data.size()))
+        return Error;
+      data.truncate(member.size);
+
+      if (member.type == TYPE_GNU_LONG)
+        longName = tarString(data.constData(), data.size());
+      else if (member.type == TYPE_PAX)
+      {
+        // records look like "<length> <key>=<value>\n"
+        int pos = 0;
+        while (pos < data.size())
+        {
+          int space  = data.indexOf(' ', pos);
+          int length = space > pos ? data.mid(pos, space - pos).toInt() : 0;
+          if (length <= 0)
+            break;
+          QByteArray record = data.mid(space + 1, pos + length - space - 2);
+          if (record.startsWith("path="))
+            longName = QString::fromUtf8(record.mid(5));
+          pos += length;
+        }
+      }
+      continue;
+    }
+
+    if (! longName.isEmpty())
+      member.name = longName;
+    else
+    {
+      member.name = tarString(head.name, sizeof head.name);
+      if (memcmp(head.magic, "ustar\0", 6) == 0 && head.prefix[0])
+        member.name = tarString(head.prefix, sizeof head.prefix) + "/" + member.name;
+    }
+
+    pMember = member;
+    return Header;
+  }
+}
+
+bool TarReader::readBlocks(char *pBuffer, qint64 pLength)
+{
+  while (pLength > 0)
+  {
+    int got = gzread(_in, pBuffer, (unsigned)qMin<qint64>(pLength, _tarBufferSize));
+    if (got <= 0)
+    {
+      int errnum = 0;
+      _lastError = got < 0 ? QString(gzerror(_in, &errnum))
+                           : QObject::tr("%1 is truncated").arg(_filename);
+      return false;
+    }
+    pBuffer += got;
+    pLength -= got;
+    _pos    += got;
+  }
+  return true;
+}
+
+/* Copy pMember's data, which the archive must be positioned at, to
+   pOutput a buffer at a time, then step over the padding after it.
+ */
+bool TarReader::copyData(const Member &pMember, QIODevice *pOutput)
+{
+  QByteArray buffer(_tarBufferSize, '\0');
+  qint64 toRead  = tarPadded(pMember.size);
+  qint64 toWrite = pMember.size;
+  while (toRead > 0)
+  {
+    int chunk = (int)qMin<qint64>(buffer.size(), toRead);
+    if (! readBlocks(buffer.data(), chunk))
+      return false;
+    toRead -= chunk;
+
+    qint64 length = qMin<qint64>(chunk, toWrite);
+    if (pOutput && length > 0 && pOutput->write(buffer.constData(), length) != length)
+    {
+      _lastError = QObject::tr("Could not write %1: %2")
+                     .arg(pMember.name, pOutput->errorString());
+      return false;
+    }
+    toWrite -= length;
+  }
+  return true;
+}
+
+bool TarReader::skipData(const Member &pMember)
+{
+  return seek(_pos + tarPadded(pMember.size));
+}
+
+/* gzseek() skips forward by decompressing and discarding, and goes back
+   by starting over, so this is only cheap for uncompressed archives and
+   for short hops forward.
+ */
+bool TarReader::seek(qint64 pOffset)
+{
+  if (pOffset == _pos)
+    return true;
+  if (gzseek(_in, pOffset, SEEK_SET) != pOffset)
+  {
+    int errnum = 0;
+    _lastError = QObject::tr("Could not read %1: %2").arg(_filename, gzerror(_in, &errnum));
+    return false;
+  }
+  _pos = pOffset;
+  return true;
+}
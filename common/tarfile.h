@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2010 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -11,9 +11,19 @@
 #ifndef __TARFILE_H__
 #define __TARFILE_H__
 
-#include <QString>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
 #include <QMap>
+#include <QString>
+#include <QStringList>
+
+class QIODevice;
+struct gzFile_s;
 
+/* Parses an archive that is already in memory. For anything that might
+   be large, use TarReader instead.
+ */
 class TarFile {
   public:
     TarFile(const QByteArray &);
@@ -27,5 +37,80 @@ class TarFile {
     bool _valid;
 };
 
+/** @class TarReader
+
+    @brief Reads a tar archive from a file, a block at a time, whether or
+           not it is gzip-compressed.
+
+    Members are copied straight from the archive to wherever they are
+    going, through a fixed-size buffer, so memory use does not depend on
+    the size of the archive or of its members.
+
+    extractAll() unpacks the members whose names match any of a list of
+    wildcard patterns in a single pass. Every member's header checksum is
+    checked before its data is used, and names that would land outside
+    the destination directory are refused.
+
+    The first pass also records where each member starts. After that,
+    extract() and read() go directly to a member instead of reading the
+    archive from the top. For compressed archives that still means
+    decompressing up to that point, since gzip has no index of its own,
+    but nothing before it is parsed or kept.
+
+    A TarReader may be used from any thread, but only from one at a time.
+ */
+class TarReader
+{
+  public:
+    struct Member
+    {
+      QString   name;
+      char      type;
+      qint64    size;
+      qint64    offset;     // of the data in the uncompressed archive
+      QDateTime modified;
+
+      bool isFile() const;
+      bool isDir()  const;
+    };
+
+    TarReader(const QString &pFilename);
+    virtual ~TarReader();
+
+    bool            open();
+    void            close();
+    QString         lastError() const;
+
+    QList<Member>   members();
+    bool            contains(const QString &pName);
+    bool            extract(const QString &pName, QIODevice *pOutput);
+    QByteArray      read(const QString &pName);
+    int             extractAll(const QString &pDir,
+                               const QStringList &pPatterns = QStringList());
+
+    static int      bufferSize();
+    static void     setBufferSize(int pBytes);
+
+  private:
+    enum HeaderResult { Header, EndOfArchive, Error };
+
+    HeaderResult    readHeader(Member &pMember);
+    bool            buildIndex();
+    bool            copyData(const Member &pMember, QIODevice *pOutput);
+    bool            readBlocks(char *pBuffer, qint64 pLength);
+    bool            seek(qint64 pOffset);
+    bool            skipData(const Member &pMember);
+    bool            extractTo(const Member &pMember, const QString &pDir);
+    void            addToIndex(const Member &pMember);
+
+    QString                 _filename;
+    gzFile_s               *_in;
+    qint64                  _pos;
+    QString                 _lastError;
+    QList<Member>           _index;
+    QHash<QString, int>     _byName;
+    bool                    _indexed;
+};
+
 #endif
 
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "uiformhash.h"
+
+#include <QRegExp>
+#include <QSqlError>
+#include <QVariant>
+
+#include "xsqlquery.h"
+
+UiFormHash::UiFormHash(QObject *pParent, QSqlDatabase pDb)
+  : XCachedHash<QString, QString>(pParent, QString(), pDb)
+{
+  setNotification(QStringList() << "uiform" << "pkguiform");
+}
+
+bool UiFormHash::refresh(const QString &key)
+{
+  XSqlQuery q;
+  q.prepare("SELECT uiform_source"
+            "  FROM uiform"
+            " WHERE uiform_name = :uiform_name"
+            "   AND uiform_enabled"
+            " ORDER BY uiform_order DESC"
+            " LIMIT 1;");
+  q.bindValue(":uiform_name", key);
+  q.exec();
+  _lastError = q.lastError();
+  if (q.first())
+  {
+    insert(key, q.value("uiform_source").toString());
+    return true;
+  }
+  return false;
+}
+
+int UiFormHash::refresh(const QList<QString> &keys)
+{
+  if (keys.size() == 1)
+    return refresh(keys.first()) ? 1 : 0;
+
+  XSqlQuery q;
+  q.prepare("SELECT DISTINCT ON (uiform_name) uiform_name, uiform_source"
+            "  FROM uiform"
+            " WHERE uiform_name = ANY(string_to_array(:keys, E'\\n'))"
+            "   AND uiform_enabled"
+            " ORDER BY uiform_name, uiform_order DESC;");
+  q.bindValue(":keys", QStringList(keys).join("\n"));
+  q.exec();
+  _lastError = q.lastError();
+
+  int fetched = 0;
+  while (q.next())
+  {
+    insert(q.value("uiform_name").toString(), q.value("uiform_source").toString());
+    fetched++;
+  }
+  return fetched;
+}
+
+/* The payload is the name of the form that changed. Anything that can't
+   be a form name makes the caller reload the whole cache instead.
+ */
+bool UiFormHash::keysForPayload(const QString &pNotification, const QString &pPayload, QList<QString> &pKeys) const
+{
+  Q_UNUSED(pNotification);
+  static const QRegExp format("^[\\w.-]+$");
+  if (! format.exactMatch(pPayload))
+    return false;
+  pKeys.append(pPayload);
+  return true;
+}
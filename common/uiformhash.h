@@ -0,0 +1,39 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef uiformhash_h
+#define uiformhash_h
+
+#include <QSqlError>
+
+#include "xcachedhash.h"
+
+/** @brief Caches the source of the highest-order enabled uiform by name. */
+class UiFormHash : public XCachedHash<QString, QString>
+{
+  Q_OBJECT
+
+  public:
+    UiFormHash(QObject *pParent = 0, QSqlDatabase pDb = QSqlDatabase::database());
+
+    virtual bool refresh(const QString &key);
+    virtual int  refresh(const QList<QString> &keys);
+
+    /** The error from the last lookup that failed, if any. */
+    QSqlError    lastError() const { return _lastError; }
+
+  protected:
+    virtual bool keysForPayload(const QString &pNotification, const QString &pPayload, QList<QString> &pKeys) const;
+
+  private:
+    QSqlError    _lastError;
+};
+
+#endif
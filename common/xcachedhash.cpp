@@ -10,10 +10,85 @@
 
 #include "xcachedhash.h"
 
+#include <QtDebug>
+
+#define DEBUG false
+
 XCachedHashQObject::XCachedHashQObject(QObject *pParent, QSqlDatabase pDb)
-  : QObject(pParent)
+  : QObject(pParent),
+    _capacity(0)
 {
-  connect(pDb.driver(), SIGNAL(notification(const QString&)), this, SLOT(sNotified(const QString&)));
+  resetStatistics();
+  connect(pDb.driver(), SIGNAL(notification(const QString&, QSqlDriver::NotificationSource, const QVariant&)),
+          this,         SLOT(sNotified(const QString&, QSqlDriver::NotificationSource, const QVariant&)));
+}
+
+/** The maximum number of entries kept, or 0 if the hash is unbounded. */
+int XCachedHashQObject::capacity() const
+{
+  return _capacity;
+}
+
+/** Limit the hash to @a pCapacity entries, dropping the least recently used
+    ones first. 0 or less removes the limit.
+ */
+void XCachedHashQObject::setCapacity(int pCapacity)
+{
+  _capacity = qMax(0, pCapacity);
+  trim();
+}
+
+void XCachedHashQObject::resetStatistics()
+{
+  _hits            = 0;
+  _misses          = 0;
+  _refreshes       = 0;
+  _refreshMsecs    = 0;
+  _refreshMaxMsecs = 0;
+  _refreshedKeys   = 0;
+  _invalidations   = 0;
+  _evictions       = 0;
+}
+
+/** Counters describing how well the hash is working since it was created
+    or resetStatistics() was last called.
+ */
+QVariantMap XCachedHashQObject::statistics() const
+{
+  QVariantMap result;
+  result.insert("size",            cachedCount());
+  result.insert("capacity",        _capacity);
+  result.insert("hits",            _hits);
+  result.insert("misses",          _misses);
+  result.insert("hitRatio",        (_hits + _misses) ? double(_hits) / (_hits + _misses) : 0.0);
+  result.insert("refreshes",       _refreshes);
+  result.insert("refreshedKeys",   _refreshedKeys);
+  result.insert("refreshMsecs",    _refreshMsecs);
+  result.insert("refreshMaxMsecs", _refreshMaxMsecs);
+  result.insert("refreshAvgMsecs", _refreshes ? double(_refreshMsecs) / _refreshes : 0.0);
+  result.insert("invalidations",   _invalidations);
+  result.insert("evictions",       _evictions);
+  return result;
+}
+
+void XCachedHashQObject::countLookup(bool pHit)
+{
+  if (pHit)
+    _hits++;
+  else
+    _misses++;
+}
+
+void XCachedHashQObject::countRefresh(qint64 pMsecs, int pKeys)
+{
+  _refreshes++;
+  _refreshedKeys += pKeys;
+  _refreshMsecs  += pMsecs;
+  if (pMsecs > _refreshMaxMsecs)
+    _refreshMaxMsecs = pMsecs;
+  if (DEBUG)
+    qDebug() << metaObject()->className() << "refreshed" << pKeys
+             << "keys in" << pMsecs << "ms";
 }
 
 void XCachedHashQObject::sConnectionLost()
@@ -24,6 +99,20 @@ void XCachedHashQObject::sConnectionLost()
 void XCachedHashQObject::sNotified(const QString &pNotification)
 {
   if (_notice.contains(pNotification))
+  {
     clear();
+    _invalidations++;
+  }
 }
 
+void XCachedHashQObject::sNotified(const QString &pNotification, QSqlDriver::NotificationSource pSource, const QVariant &pPayload)
+{
+  Q_UNUSED(pSource);
+  if (_notice.contains(pNotification))
+  {
+    if (DEBUG)
+      qDebug() << metaObject()->className() << "notified" << pNotification
+               << pPayload.toString();
+    invalidate(pNotification, pPayload.toString());
+  }
+}
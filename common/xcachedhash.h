@@ -16,11 +16,17 @@
 #ifndef xtcachedhash_h
 #define xtcachedhash_h
 
+#include <QDataStream>
+#include <QElapsedTimer>
 #include <QHash>
+#include <QList>
+#include <QMap>
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QString>
 #include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
 
 template <class K, class v> class XCachedHash;
 
@@ -31,13 +37,35 @@ class XCachedHashQObject : public QObject
   public:
     explicit XCachedHashQObject(QObject *pParent = 0, QSqlDatabase pDb = QSqlDatabase::database());
 
+    Q_INVOKABLE virtual int         capacity() const;
+    Q_INVOKABLE virtual void        resetStatistics();
+    Q_INVOKABLE virtual void        setCapacity(int pCapacity);
+    Q_INVOKABLE virtual QVariantMap statistics() const;
+
   public slots:
     virtual void sConnectionLost();
     virtual void sNotified(const QString &pNotification);
+    virtual void sNotified(const QString &pNotification, QSqlDriver::NotificationSource pSource, const QVariant &pPayload);
     virtual void clear() = 0;
 
   protected:
+    virtual void invalidate(const QString &pNotification, const QString &pPayload) = 0;
+    virtual void trim() = 0;
+    virtual int  cachedCount() const = 0;
+
+    void countLookup(bool pHit);
+    void countRefresh(qint64 pMsecs, int pKeys);
+
     QStringList _notice;
+    int         _capacity;
+    qint64      _hits;
+    qint64      _misses;
+    qint64      _refreshes;
+    qint64      _refreshMsecs;
+    qint64      _refreshMaxMsecs;
+    qint64      _refreshedKeys;
+    qint64      _invalidations;
+    qint64      _evictions;
 };
 
 
@@ -56,6 +84,22 @@ class XCachedHashQObject : public QObject
   The hash clears itself when the named database notification is received. Thus
   the next time a caller requests that named object, the hash requeries.
 
+  If the notification carries a payload, subclasses can override keysForPayload()
+  to map it to the keys that changed; only those keys are dropped. A notification
+  without a payload, or one keysForPayload() doesn't understand, clears the whole
+  hash as before.
+
+  setCapacity() bounds the hash. When more than that many keys are cached, the
+  least recently used ones are dropped. The default of 0 means no limit.
+
+  prefetch() fills in many missing keys at once. Subclasses can override
+  refresh(const QList<K> &) to fetch them with a single query.
+
+  statistics() reports hits, misses, refresh counts and refresh time.
+
+  save() and restore() write and read the cached entries so they can be kept
+  between sessions. @see XDiskCache
+
   This is currently designed to be subclassed. @see MqlHash for an example.
  */
 template <class K, class V>
@@ -66,10 +110,75 @@ class XCachedHash : public QHash<K, V>, public XCachedHashQObject
 
     virtual const V value(const K &key)
     {
-      if (! QHash<K,V>::contains(key))
+      bool hit = QHash<K,V>::contains(key);
+      countLookup(hit);
+      if (! hit)
+      {
+        QElapsedTimer timer;
+        timer.start();
         (void)refresh(key);
+        countRefresh(timer.elapsed(), 1);
+      }
 
-      return QHash<K,V>::value(key);
+      touch(key);
+      V result = QHash<K,V>::value(key);
+      trim();
+      return result;
+    }
+
+    /** Make sure all of the @a keys are cached, fetching the missing ones
+        together. Returns the number of keys that were fetched.
+     */
+    virtual int prefetch(const QList<K> &keys)
+    {
+      QList<K> missing;
+      foreach (K key, keys)
+      {
+        if (! QHash<K,V>::contains(key) && ! missing.contains(key))
+          missing.append(key);
+      }
+      if (missing.isEmpty())
+        return 0;
+
+      QElapsedTimer timer;
+      timer.start();
+      int fetched = refresh(missing);
+      countRefresh(timer.elapsed(), missing.size());
+
+      foreach (K key, missing)
+        touch(key);
+      trim();
+      return fetched;
+    }
+
+    /** Write every cached key and value to @a out. */
+    virtual void save(QDataStream &out) const
+    {
+      out << static_cast<const QHash<K, V> &>(*this);
+    }
+
+    /** Add the keys and values written by save() to the hash. Keys that are
+        already cached keep their current values.
+     */
+    virtual void restore(QDataStream &in)
+    {
+      QHash<K, V> saved;
+      in >> saved;
+      if (in.status() != QDataStream::Ok)
+        return;
+      for (typename QHash<K, V>::const_iterator it = saved.constBegin(); it != saved.constEnd(); ++it)
+      {
+        if (! QHash<K, V>::contains(it.key()))
+          QHash<K, V>::insert(it.key(), it.value());
+      }
+      trim();
+    }
+
+    virtual int remove(const K &key)
+    {
+      if (_used.contains(key))
+        _lru.remove(_used.take(key));
+      return QHash<K, V>::remove(key);
     }
 
   protected:
@@ -86,7 +195,8 @@ class XCachedHash : public QHash<K, V>, public XCachedHashQObject
     XCachedHash(QObject *pParent = 0, const QString &pNotification = QString(), QSqlDatabase pDb = QSqlDatabase::database())
       : QHash<K, V>(),
         XCachedHashQObject(pParent, pDb),
-        _db(pDb)
+        _db(pDb),
+        _tick(0)
     {
       (void)setNotification(QStringList() << pNotification);
     }
@@ -94,7 +204,8 @@ class XCachedHash : public QHash<K, V>, public XCachedHashQObject
     XCachedHash(QObject *pParent, const QStringList &pNotification, QSqlDatabase pDb = QSqlDatabase::database())
       : QHash<K, V>(),
         XCachedHashQObject(pParent, pDb),
-        _db(pDb)
+        _db(pDb),
+        _tick(0)
     {
       (void)setNotification(pNotification);
     }
@@ -102,12 +213,96 @@ class XCachedHash : public QHash<K, V>, public XCachedHashQObject
     virtual void clear()
     {
       QHash<K, V>::clear();
+      _used.clear();
+      _lru.clear();
+    }
+
+    virtual int cachedCount() const
+    {
+      return QHash<K, V>::size();
+    }
+
+    /** Map a notification payload to the keys it affects. Return false if
+        the payload can't be interpreted, in which case the whole hash is
+        cleared.
+     */
+    virtual bool keysForPayload(const QString &pNotification, const QString &pPayload, QList<K> &pKeys) const
+    {
+      Q_UNUSED(pNotification);
+      Q_UNUSED(pPayload);
+      Q_UNUSED(pKeys);
+      return false;
+    }
+
+    virtual void invalidate(const QString &pNotification, const QString &pPayload)
+    {
+      QList<K> keys;
+      if (pPayload.isEmpty() || ! keysForPayload(pNotification, pPayload, keys))
+      {
+        clear();
+        _invalidations++;
+        return;
+      }
+      foreach (K key, keys)
+        remove(key);
+      _invalidations++;
     }
 
     virtual bool refresh(const K &key) = 0;
 
+    /** Fetch several keys at once. The default fetches them one at a time. */
+    virtual int refresh(const QList<K> &keys)
+    {
+      int fetched = 0;
+      foreach (K key, keys)
+      {
+        if (refresh(key))
+          fetched++;
+      }
+      return fetched;
+    }
+
+    void touch(const K &key)
+    {
+      if (_capacity <= 0 || ! QHash<K,V>::contains(key))
+        return;
+      if (_used.contains(key))
+        _lru.remove(_used.value(key));
+      _used.insert(key, ++_tick);
+      _lru.insert(_tick, key);
+    }
+
+    virtual void trim()
+    {
+      if (_capacity <= 0)
+        return;
+
+      // entries inserted without going through value() have no use yet
+      if (_used.size() < QHash<K,V>::size())
+      {
+        QList<K> keys = QHash<K,V>::keys();
+        foreach (K key, keys)
+        {
+          if (! _used.contains(key))
+            touch(key);
+        }
+      }
+
+      while (QHash<K,V>::size() > _capacity && ! _lru.isEmpty())
+      {
+        K oldest = _lru.take(_lru.firstKey());
+        _used.remove(oldest);
+        QHash<K, V>::remove(oldest);
+        _evictions++;
+      }
+    }
+
     QSqlDatabase _db;
+
+  private:
+    quint64             _tick;
+    QHash<K, quint64>   _used;  // key -> last use
+    QMap<quint64, K>    _lru;   // last use -> key, oldest first
 };
 
 #endif
-
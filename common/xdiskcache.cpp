@@ -0,0 +1,198 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xdiskcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QVariant>
+#include <QtDebug>
+
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+#define MAGIC   0x78746463      // "xtdc"
+#define VERSION 1
+
+/* One row per kind of cached definition. A stamp changes whenever a row
+   in the underlying tables is inserted, updated or deleted: xmin is the
+   transaction that wrote the row and tableoid tells package tables apart.
+ */
+static QString stampSql(const QString &pTable, const QString &pId)
+{
+  return QString("COALESCE((SELECT string_agg(tableoid::text || '.' || %2::text"
+                 "                          || '.' || xmin::text, ','"
+                 "                          ORDER BY tableoid, %2)"
+                 "           FROM %1), '')").arg(pTable, pId);
+}
+
+XDiskCache::XDiskCache(QSqlDatabase pDb)
+  : _db(pDb)
+{
+}
+
+/** The file this database's definitions are kept in. */
+QString XDiskCache::filename() const
+{
+  QString server = QString("%1:%2/%3").arg(_db.hostName())
+                                      .arg(_db.port())
+                                      .arg(_db.databaseName());
+  QString hash = QCryptographicHash::hash(server.toUtf8(), QCryptographicHash::Md5).toHex();
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+         + "/definitions-" + hash + ".xtcache";
+}
+
+QString XDiskCache::lastError() const
+{
+  return _lastError;
+}
+
+bool XDiskCache::currentStamps(QHash<QString, QString> &pStamps)
+{
+  XSqlQuery q(_db);
+  q.exec("SELECT md5(" + stampSql("metasql", "metasql_id") + ") AS metasql,"
+         "       md5(" + stampSql("script",  "script_id")  + " || '|' ||"
+         "           " + stampSql("pkghead", "pkghead_id") + ") AS script,"
+         "       md5(" + stampSql("uiform",  "uiform_id")  + ") AS uiform;");
+  if (! q.first())
+  {
+    _lastError = q.lastError().text();
+    return false;
+  }
+
+  pStamps.clear();
+  pStamps.insert("metasql", q.value("metasql").toString());
+  pStamps.insert("script",  q.value("script").toString());
+  pStamps.insert("uiform",  q.value("uiform").toString());
+  return true;
+}
+
+/** Read the cache file and keep the sections that are still current.
+    @return false if the file could not be read or the stamps could not be
+            checked; the cache is empty in that case
+ */
+bool XDiskCache::load()
+{
+  _sections.clear();
+  _stamps.clear();
+  _lastError.clear();
+
+  if (! currentStamps(_stamps))
+    return false;
+
+  QFile file(filename());
+  if (! file.exists())
+    return true;
+  if (! file.open(QIODevice::ReadOnly))
+  {
+    _lastError = file.errorString();
+    return false;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_0);
+
+  quint32 magic   = 0;
+  quint32 version = 0;
+  QHash<QString, QString>    stamps;
+  QHash<QString, QByteArray> sections;
+  in >> magic >> version;
+  if (magic != MAGIC || version != VERSION)
+  {
+    if (DEBUG) qDebug() << "XDiskCache::load() ignoring" << file.fileName();
+    return true;
+  }
+  in >> stamps >> sections;
+  if (in.status() != QDataStream::Ok)
+  {
+    _lastError = QObject::tr("%1 is damaged").arg(file.fileName());
+    return false;
+  }
+
+  for (QHash<QString, QByteArray>::const_iterator it = sections.constBegin();
+       it != sections.constEnd(); ++it)
+  {
+    if (_stamps.contains(it.key()) && stamps.value(it.key()) == _stamps.value(it.key()))
+      _sections.insert(it.key(), qUncompress(it.value()));
+    else if (DEBUG)
+      qDebug() << "XDiskCache::load() dropping stale" << it.key();
+  }
+  return true;
+}
+
+/** Write the sections whose tables have not changed since load(). */
+bool XDiskCache::save()
+{
+  _lastError.clear();
+
+  QHash<QString, QString> now;
+  if (_stamps.isEmpty() || ! currentStamps(now))
+    return false;
+
+  QHash<QString, QString>    stamps;
+  QHash<QString, QByteArray> sections;
+  for (QHash<QString, QByteArray>::const_iterator it = _sections.constBegin();
+       it != _sections.constEnd(); ++it)
+  {
+    if (! it.value().isEmpty() && now.value(it.key()) == _stamps.value(it.key()))
+    {
+      stamps.insert(it.key(), _stamps.value(it.key()));
+      sections.insert(it.key(), qCompress(it.value()));
+    }
+  }
+
+  QString name = filename();
+  QDir().mkpath(QFileInfo(name).absolutePath());
+
+  QFile file(name + ".tmp");
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    _lastError = file.errorString();
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << quint32(MAGIC) << quint32(VERSION) << stamps << sections;
+  file.close();
+  if (out.status() != QDataStream::Ok || file.error() != QFile::NoError)
+  {
+    _lastError = file.errorString();
+    file.remove();
+    return false;
+  }
+
+  QFile::remove(name);
+  if (! file.rename(name))
+  {
+    _lastError = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+/** The saved contents for pKind, or an empty QByteArray if there are none
+    or they are out of date.
+ */
+QByteArray XDiskCache::section(const QString &pKind) const
+{
+  return _sections.value(pKind);
+}
+
+void XDiskCache::setSection(const QString &pKind, const QByteArray &pData)
+{
+  _sections.insert(pKind, pData);
+}
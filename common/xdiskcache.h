@@ -0,0 +1,60 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XDISKCACHE_H
+#define XDISKCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QString>
+
+/** @class XDiskCache
+
+    @brief Keeps definitions read from the database in a local file between
+           sessions.
+
+    The file holds one section per kind of definition (MetaSQL statements,
+    scripts, UI forms). Each section is a compressed blob written by the
+    in-memory cache that owns it, together with a change stamp for the
+    database tables it came from.
+
+    load() reads the file and gets the current change stamps for every
+    kind with a single query. Sections whose stamp no longer matches are
+    dropped. save() only writes the sections whose tables have not changed
+    since load(), so a definition edited during the session is never
+    written back with a stamp that says it is current.
+
+    There is one file per database, under the user's cache directory.
+ */
+class XDiskCache
+{
+  public:
+    XDiskCache(QSqlDatabase pDb = QSqlDatabase::database());
+
+    bool        load();
+    bool        save();
+
+    QByteArray  section(const QString &pKind) const;
+    void        setSection(const QString &pKind, const QByteArray &pData);
+
+    QString     filename() const;
+    QString     lastError() const;
+
+  private:
+    bool        currentStamps(QHash<QString, QString> &pStamps);
+
+    QSqlDatabase                _db;
+    QString                     _lastError;
+    QHash<QString, QByteArray>  _sections;
+    QHash<QString, QString>     _stamps;    // as of load()
+};
+
+#endif
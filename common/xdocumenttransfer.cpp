@@ -0,0 +1,543 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xdocumenttransfer.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QIODevice>
+#include <QMap>
+#include <QProgressDialog>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QVariant>
+#include <QtDebug>
+
+#include "xsqlquery.h"
+#include "xttrace.h"
+
+#define DEBUG false
+
+#define MAGIC   0x78746478      // "xtdx"
+#define VERSION 1
+
+static int    _chunkSize     = 1024 * 1024;
+static qint64 _maxCacheBytes = Q_INT64_C(512) * 1024 * 1024;
+
+/* Which cached file holds which document, and when each file was last
+   used. Documents are keyed by database and url_id since the same url_id
+   means different things in different databases.
+ */
+class XDocumentCacheIndex
+{
+  public:
+    XDocumentCacheIndex()
+    {
+      QSqlDatabase db = QSqlDatabase::database();
+      _server = QString("%1:%2/%3").arg(db.hostName())
+                                   .arg(db.port())
+                                   .arg(db.databaseName());
+      load();
+    }
+
+    QString filename() const
+    {
+      return XDocumentTransfer::cacheDir() + "/index";
+    }
+
+    QString blobPath(const QString &pHash) const
+    {
+      return XDocumentTransfer::cacheDir() + "/" + pHash;
+    }
+
+    QString key(int pUrlId) const
+    {
+      return _server + "#" + QString::number(pUrlId);
+    }
+
+    void load()
+    {
+      QFile file(filename());
+      if (! file.open(QIODevice::ReadOnly))
+        return;
+
+      QDataStream in(&file);
+      in.setVersion(QDataStream::Qt_5_0);
+      quint32 magic   = 0;
+      quint32 version = 0;
+      in >> magic >> version;
+      if (magic != MAGIC || version != VERSION)
+        return;
+      in >> _documents >> _lastUsed;
+      if (in.status() != QDataStream::Ok)
+      {
+        if (DEBUG) qDebug() << "XDocumentCacheIndex ignoring damaged" << file.fileName();
+        _documents.clear();
+        _lastUsed.clear();
+      }
+    }
+
+    void save()
+    {
+      QFile file(filename());
+      if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+      {
+        qWarning() << "Could not write the document cache index"
+                   << file.fileName() << file.errorString();
+        return;
+      }
+      QDataStream out(&file);
+      out.setVersion(QDataStream::Qt_5_0);
+      out << (quint32)MAGIC << (quint32)VERSION << _documents << _lastUsed;
+    }
+
+    /* the hash of the cached copy of pUrlId if it's still current */
+    QString lookup(int pUrlId, const QString &pStamp) const
+    {
+      QStringList entry = _documents.value(key(pUrlId));
+      if (entry.size() != 2 || entry.at(0) != pStamp ||
+          ! QFile::exists(blobPath(entry.at(1))))
+        return QString();
+      return entry.at(1);
+    }
+
+    void insert(int pUrlId, const QString &pStamp, const QString &pHash)
+    {
+      _documents.insert(key(pUrlId), QStringList() << pStamp << pHash);
+      touch(pHash);
+    }
+
+    void touch(const QString &pHash)
+    {
+      _lastUsed.insert(pHash, QDateTime::currentMSecsSinceEpoch());
+    }
+
+    /* remove the least recently used files until the cache fits, but
+       never pKeep, which the caller is about to hand out
+     */
+    void evict(qint64 pMaxBytes, const QString &pKeep)
+    {
+      QMultiMap<qint64, QString> byAge;
+      qint64 total = 0;
+      foreach (QString hash, _lastUsed.keys())
+      {
+        QFileInfo fi(blobPath(hash));
+        if (! fi.exists())
+        {
+          _lastUsed.remove(hash);
+          continue;
+        }
+        total += fi.size();
+        if (hash != pKeep)
+          byAge.insert(_lastUsed.value(hash), hash);
+      }
+
+      for (QMultiMap<qint64, QString>::const_iterator it = byAge.constBegin();
+           total > pMaxBytes && it != byAge.constEnd(); ++it)
+      {
+        QFile blob(blobPath(it.value()));
+        qint64 size = blob.size();
+        if (blob.remove())
+        {
+          if (DEBUG) qDebug() << "XDocumentCacheIndex evicting" << it.value() << size;
+          total -= size;
+          _lastUsed.remove(it.value());
+        }
+      }
+
+      QMutableHashIterator<QString, QStringList> doc(_documents);
+      while (doc.hasNext())
+      {
+        doc.next();
+        if (doc.value().size() != 2 || ! _lastUsed.contains(doc.value().at(1)))
+          doc.remove();
+      }
+    }
+
+  private:
+    QString                     _server;
+    QHash<QString, QStringList> _documents;   // key -> (stamp, hash)
+    QHash<QString, qint64>      _lastUsed;    // hash -> msecs since epoch
+};
+
+XDocumentTransfer::XDocumentTransfer(QWidget *pProgressParent)
+  : QObject(0),
+    _cancelled(false),
+    _progress(0),
+    _progressParent(pProgressParent)
+{
+}
+
+XDocumentTransfer::~XDocumentTransfer()
+{
+  delete _progress;
+}
+
+/** The directory cached documents are kept in, shared by all databases. */
+QString XDocumentTransfer::cacheDir()
+{
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+         + "/documents";
+}
+
+int XDocumentTransfer::chunkSize()
+{
+  return _chunkSize;
+}
+
+void XDocumentTransfer::setChunkSize(int pBytes)
+{
+  _chunkSize = qMax(4096, pBytes);
+}
+
+qint64 XDocumentTransfer::maxCacheBytes()
+{
+  return _maxCacheBytes;
+}
+
+void XDocumentTransfer::setMaxCacheBytes(qint64 pBytes)
+{
+  _maxCacheBytes = qMax(Q_INT64_C(0), pBytes);
+}
+
+/** The hex SHA-256 of the content of the last upload() or fetch(). */
+QByteArray XDocumentTransfer::hash() const
+{
+  return _hash;
+}
+
+QString XDocumentTransfer::lastError() const
+{
+  return _lastError;
+}
+
+bool XDocumentTransfer::wasCancelled() const
+{
+  return _cancelled;
+}
+
+void XDocumentTransfer::cancel()
+{
+  _cancelled = true;
+}
+
+void XDocumentTransfer::start(const QString &pLabel)
+{
+  _cancelled = false;
+  _hash.clear();
+  _lastError.clear();
+  QDir().mkpath(cacheDir());
+
+  if (_progressParent && ! _progress)
+  {
+    _progress = new QProgressDialog(_progressParent);
+    _progress->setWindowModality(Qt::WindowModal);
+    _progress->setMinimumDuration(1000);
+    _progress->setRange(0, 100);
+    _progress->setAutoReset(false);
+    connect(_progress, SIGNAL(canceled()), this, SLOT(cancel()));
+  }
+  if (_progress)
+  {
+    _progress->setLabelText(pLabel);
+    _progress->reset();
+    _progress->setValue(0);
+  }
+}
+
+void XDocumentTransfer::report(qint64 pDone, qint64 pTotal)
+{
+  emit progress(pDone, pTotal);
+  if (_progress)
+  {
+    _progress->setValue(pTotal > 0 ? (int)(pDone * 100 / pTotal) : 0);
+    if (pDone >= pTotal)
+      _progress->reset();
+  }
+  // a modal QProgressDialog handles the Cancel button in setValue()
+}
+
+void XDocumentTransfer::unlink(qint64 pOid)
+{
+  XSqlQuery q;
+  q.prepare("SELECT lo_unlink(:oid);");
+  q.bindValue(":oid", pOid);
+  q.exec();
+}
+
+/** Replace the content of document pUrlId, a url_id (which is the
+    docass_id of a FILE attachment), with everything read from pSource.
+    The content is written to a large object a chunk at a time and copied
+    into file_stream by the server in a single statement, so run this
+    inside the caller's transaction if the document row is new. A copy
+    goes into the local cache as it streams past.
+
+    @return false if the upload failed or was cancelled; file_stream is
+            unchanged in that case
+ */
+bool XDocumentTransfer::upload(QIODevice *pSource, int pUrlId)
+{
+  start(tr("Saving document..."));
+  XtTraceSpan span("uploadDocument", "document", pUrlId);
+
+  XSqlQuery lo;
+  lo.exec("SELECT lo_create(0) AS oid;");
+  if (! lo.first())
+  {
+    _lastError = lo.lastError().text();
+    return false;
+  }
+  qint64 oid = lo.value("oid").toLongLong();
+
+  QTemporaryFile copy(cacheDir() + "/upload-XXXXXX");
+  bool caching = _maxCacheBytes > 0 && copy.open();
+
+  QCryptographicHash sha(QCryptographicHash::Sha256);
+  qint64 total  = pSource->isSequential() ? 0 : pSource->size();
+  qint64 offset = 0;
+
+  XSqlQuery put;
+  put.prepare("SELECT lo_put(:oid, :offset, :chunk);");
+  while (! pSource->atEnd())
+  {
+    QByteArray chunk = pSource->read(_chunkSize);
+    if (chunk.isEmpty())
+      break;
+
+    put.bindValue(":oid",    oid);
+    put.bindValue(":offset", offset);
+    put.bindValue(":chunk",  chunk);
+    if (! put.exec())
+    {
+      _lastError = put.lastError().text();
+      unlink(oid);
+      return false;
+    }
+
+    sha.addData(chunk);
+    if (caching && copy.write(chunk) != chunk.size())
+      caching = false;
+    offset += chunk.size();
+    report(offset, qMax(total, offset));
+
+    if (_cancelled)
+    {
+      unlink(oid);
+      return false;
+    }
+  }
+
+  if (offset < total)
+  {
+    _lastError = tr("Could not read the whole document: %1").arg(pSource->errorString());
+    unlink(oid);
+    return false;
+  }
+
+  XSqlQuery store;
+  // url is a view without xmin, so update the file row behind it
+  store.prepare("UPDATE file SET file_stream = lo_get(:oid)"
+                "  FROM docass"
+                " WHERE ((docass_id=:url_id)"
+                "    AND (docass_target_type='FILE')"
+                "    AND (docass_target_id=file_id))"
+                " RETURNING CAST(file.xmin AS TEXT) AS stamp;");
+  store.bindValue(":oid",    oid);
+  store.bindValue(":url_id", pUrlId);
+  store.exec();
+  bool stored = store.first();
+  if (! stored)
+    _lastError = store.lastError().type() != QSqlError::NoError
+               ? store.lastError().text()
+               : tr("Document %1 was not found.").arg(pUrlId);
+  unlink(oid);
+  if (! stored)
+    return false;
+
+  _hash = sha.result().toHex();
+  report(offset, offset);
+
+  if (caching && copy.flush())
+  {
+    XDocumentCacheIndex index;
+    QString path = index.blobPath(_hash);
+    bool cached = QFile::exists(path);   // same content, drop the copy
+    if (! cached && copy.rename(path))
+    {
+      copy.setAutoRemove(false);
+      cached = true;
+    }
+    if (cached)
+    {
+      index.insert(pUrlId, store.value("stamp").toString(), _hash);
+      index.evict(_maxCacheBytes, _hash);
+      index.save();
+    }
+  }
+
+  if (DEBUG)
+    qDebug() << "XDocumentTransfer::upload()" << pUrlId << offset << _hash;
+  return true;
+}
+
+/** Return the path of a local copy of the content of document pUrlId.
+    If the cache has the content as of the row's current change stamp the
+    database copy isn't read at all. Otherwise it's read a chunk at a time
+    into the cache. The file is shared, so copy it before changing it.
+
+    @return the path, or an empty string if the document could not be read
+            or the transfer was cancelled
+ */
+QString XDocumentTransfer::fetch(int pUrlId)
+{
+  start(tr("Loading document..."));
+  XtTraceSpan span("fetchDocument", "document", pUrlId);
+
+  /* octet_length reads the toast header, not the value */
+  XSqlQuery stampq;
+  stampq.prepare("SELECT CAST(file.xmin AS TEXT) AS stamp,"
+                 "       COALESCE(octet_length(file_stream), 0) AS size"
+                 "  FROM docass"
+                 "  JOIN file ON (docass_target_id=file_id)"
+                 " WHERE ((docass_id=:url_id)"
+                 "    AND (docass_target_type='FILE'));");
+  stampq.bindValue(":url_id", pUrlId);
+  stampq.exec();
+  if (! stampq.first())
+  {
+    _lastError = stampq.lastError().type() != QSqlError::NoError
+               ? stampq.lastError().text()
+               : tr("Document %1 was not found.").arg(pUrlId);
+    return QString();
+  }
+  QString stamp = stampq.value("stamp").toString();
+  qint64  total = stampq.value("size").toLongLong();
+
+  XDocumentCacheIndex index;
+  QString cached = index.lookup(pUrlId, stamp);
+  if (! cached.isEmpty())
+  {
+    if (DEBUG) qDebug() << "XDocumentTransfer::fetch() cached" << pUrlId << cached;
+    _hash = cached.toLatin1();
+    index.touch(cached);
+    index.save();
+    report(total, total);
+    return index.blobPath(cached);
+  }
+
+  QTemporaryFile copy(cacheDir() + "/download-XXXXXX");
+  if (! copy.open())
+  {
+    _lastError = copy.errorString();
+    return QString();
+  }
+
+  /* Slicing file_stream with substring() would decompress the whole value
+     for every chunk of a compressed document, so copy it once into a large
+     object and read that a chunk at a time. The stamp check makes sure the
+     copy is of the version the cache lookup used.
+   */
+  qint64 oid = 0;
+  if (total > 0)
+  {
+    XSqlQuery lo;
+    lo.prepare("SELECT lo_from_bytea(0, file_stream) AS oid"
+               "  FROM docass"
+               "  JOIN file ON (docass_target_id=file_id)"
+               " WHERE ((docass_id=:url_id)"
+               "    AND (docass_target_type='FILE')"
+               "    AND (CAST(file.xmin AS TEXT)=:stamp));");
+    lo.bindValue(":url_id", pUrlId);
+    lo.bindValue(":stamp",  stamp);
+    lo.exec();
+    if (! lo.first())
+    {
+      _lastError = lo.lastError().type() != QSqlError::NoError
+                 ? lo.lastError().text()
+                 : tr("Document %1 was changed while it was being read.").arg(pUrlId);
+      return QString();
+    }
+    oid = lo.value("oid").toLongLong();
+  }
+
+  XSqlQuery get;
+  get.prepare("SELECT lo_get(:oid, :offset, :count) AS chunk;");
+  QCryptographicHash sha(QCryptographicHash::Sha256);
+  qint64 offset = 0;
+  while (oid && offset < total)
+  {
+    get.bindValue(":oid",    oid);
+    get.bindValue(":offset", offset);
+    get.bindValue(":count",  _chunkSize);
+    get.exec();
+    if (! get.first())
+    {
+      _lastError = get.lastError().text();
+      unlink(oid);
+      return QString();
+    }
+
+    QByteArray chunk = get.value("chunk").toByteArray();
+    if (chunk.isEmpty())
+      break;
+    if (copy.write(chunk) != chunk.size())
+    {
+      _lastError = copy.errorString();
+      unlink(oid);
+      return QString();
+    }
+    sha.addData(chunk);
+    offset += chunk.size();
+    report(offset, total);
+
+    if (_cancelled)
+    {
+      unlink(oid);
+      return QString();
+    }
+  }
+  if (oid)
+    unlink(oid);
+
+  if (! copy.flush())
+  {
+    _lastError = copy.errorString();
+    return QString();
+  }
+
+  _hash = sha.result().toHex();
+  QString path = index.blobPath(_hash);
+  if (! QFile::exists(path))
+  {
+    if (! copy.rename(path))
+    {
+      _lastError = copy.errorString();
+      return QString();
+    }
+    copy.setAutoRemove(false);
+  }
+
+  index.insert(pUrlId, stamp, _hash);
+  index.evict(_maxCacheBytes, _hash);
+  index.save();
+  report(total, total);
+
+  if (DEBUG)
+    qDebug() << "XDocumentTransfer::fetch()" << pUrlId << offset << _hash;
+  return path;
+}
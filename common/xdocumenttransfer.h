@@ -0,0 +1,91 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XDOCUMENTTRANSFER_H
+#define XDOCUMENTTRANSFER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QIODevice;
+class QProgressDialog;
+class QWidget;
+
+/** @class XDocumentTransfer
+
+    @brief Moves the contents of file documents (file.file_stream) between
+           the database and local files a chunk at a time.
+
+    Documents are identified by url_id, the docass_id of the FILE
+    attachment. The url view has no change stamp of its own, so the
+    transfer reads and writes the file row behind it.
+
+    upload() reads from any QIODevice and writes the database copy through
+    a temporary large object, so neither the client nor a single statement
+    ever holds the whole file. fetch() copies the database copy into a
+    local cache file the same way and returns its path.
+
+    Both compute the SHA-256 of the content as it streams past. The cache
+    is content-addressed: files are named by their hash and shared by every
+    document and database with the same content. An index maps each
+    document to its hash and the row's change stamp, so fetching a
+    document that hasn't changed since it was last fetched or uploaded
+    costs one small query and no transfer.
+
+    The cache holds at most maxCacheBytes(), least recently used files
+    first out.
+
+    Given a parent widget, the transfer shows a progress dialog with a
+    Cancel button when it takes more than a moment. The dialog is window
+    modal, so only its Cancel button gets events while the transfer runs.
+    Otherwise connect to progress() and cancel(); the transfer doesn't
+    process events itself.
+ */
+class XDocumentTransfer : public QObject
+{
+  Q_OBJECT
+
+  public:
+    XDocumentTransfer(QWidget *pProgressParent = 0);
+    virtual ~XDocumentTransfer();
+
+    bool       upload(QIODevice *pSource, int pUrlId);
+    QString    fetch(int pUrlId);
+
+    QByteArray hash()         const;
+    QString    lastError()    const;
+    bool       wasCancelled() const;
+
+    static QString cacheDir();
+    static int     chunkSize();
+    static void    setChunkSize(int pBytes);
+    static qint64  maxCacheBytes();
+    static void    setMaxCacheBytes(qint64 pBytes);
+
+  public slots:
+    void cancel();
+
+  signals:
+    void progress(qint64 pDone, qint64 pTotal);
+
+  private:
+    void report(qint64 pDone, qint64 pTotal);
+    void start(const QString &pLabel);
+    void unlink(qint64 pOid);
+
+    bool             _cancelled;
+    QByteArray       _hash;
+    QString          _lastError;
+    QProgressDialog *_progress;
+    QWidget         *_progressParent;
+};
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "ximagecache.h"
+
+#include <QFutureWatcher>
+#include <QVariant>
+#include <QtConcurrent>
+#include <QtDebug>
+
+#include <quuencode.h>
+
+#include "xpreparedquery.h"
+#include "xttrace.h"
+
+#define DEBUG false
+
+#define DEFAULTMAXBYTES (64 * 1024 * 1024)
+
+struct XDecodedImage
+{
+  int           id;
+  QString       stamp;
+  QImage        full;
+  QList<QImage> thumbnails;     // one per XImageCache::thumbnailSizes()
+};
+
+// runs on a worker thread: QImage, unlike QPixmap, is safe to use there
+static XDecodedImage decodeImage(int pId, QString pStamp, QString pData)
+{
+  XDecodedImage result;
+  result.id    = pId;
+  result.stamp = pStamp;
+  result.full.loadFromData(QUUDecode(pData));
+  if (! result.full.isNull())
+    foreach (QSize size, XImageCache::thumbnailSizes())
+      result.thumbnails.append(result.full.scaled(size, Qt::KeepAspectRatio,
+                                                  Qt::SmoothTransformation));
+  return result;
+}
+
+static QString cacheKey(int pId, const QString &pStamp, const QSize &pSize)
+{
+  return QString("%1/%2/%3x%4").arg(pId).arg(pStamp)
+                               .arg(pSize.width()).arg(pSize.height());
+}
+
+// QCache costs are ints, so count in KB to allow caches over 2GB
+static int cost(const QImage &pImage)
+{
+  return qMax(1, pImage.byteCount() / 1024);
+}
+
+XImageCache *XImageCache::instance()
+{
+  static XImageCache *cache = 0;
+  if (! cache)
+    cache = new XImageCache();
+  return cache;
+}
+
+XImageCache::XImageCache()
+  : QObject(0),
+    _largeId(-1)
+{
+  _images.setMaxCost(DEFAULTMAXBYTES / 1024);
+}
+
+XImageCache::~XImageCache()
+{
+  foreach (QFutureWatcher<XDecodedImage> *watcher, _decoding)
+  {
+    watcher->waitForFinished();
+    delete watcher;
+  }
+}
+
+QList<QSize> XImageCache::thumbnailSizes()
+{
+  static QList<QSize> sizes;
+  if (sizes.isEmpty())
+    sizes << QSize(32, 32) << QSize(64, 64) << QSize(256, 256);
+  return sizes;
+}
+
+int XImageCache::maxBytes() const
+{
+  return _images.maxCost() * 1024;
+}
+
+void XImageCache::setMaxBytes(int pBytes)
+{
+  _images.setMaxCost(qMax(1, pBytes / 1024));
+}
+
+void XImageCache::clear()
+{
+  _images.clear();
+  _stamps.clear();
+  _failed.clear();
+  _largeId = -1;
+  _large   = QImage();
+}
+
+/* The row's xmin changes whenever the image is updated, so it serves as a
+   change stamp without fetching image_data.
+ */
+QString XImageCache::currentStamp(int pId)
+{
+  XPreparedQuery q("SELECT CAST(xmin AS TEXT) AS stamp"
+                   "  FROM image"
+                   " WHERE (image_id=:image_id);");
+  q->bindValue(":image_id", pId);
+  q.exec();
+  if (! q->first())
+    return QString();
+
+  QString stamp = q->value("stamp").toString();
+  if (_stamps.contains(pId) && _stamps.value(pId) != stamp)
+  {
+    QString old = _stamps.value(pId);
+    _images.remove(cacheKey(pId, old, QSize()));
+    foreach (QSize size, thumbnailSizes())
+      _images.remove(cacheKey(pId, old, size));
+    _failed.remove(pId);
+    if (_largeId == pId)
+    {
+      _largeId = -1;
+      _large   = QImage();
+    }
+  }
+  _stamps.insert(pId, stamp);
+  return stamp;
+}
+
+/* Look for the image at the given size. Sizes that aren't thumbnail sizes
+   are scaled from the full image and cached too.
+ */
+QImage XImageCache::cached(int pId, const QString &pStamp, const QSize &pSize)
+{
+  QImage *found = _images.object(cacheKey(pId, pStamp, pSize));
+  if (found)
+    return *found;
+
+  if (_largeId == pId && _largeStamp == pStamp)
+    return pSize.isValid() ? _large.scaled(pSize, Qt::KeepAspectRatio,
+                                           Qt::SmoothTransformation)
+                           : _large;
+  if (! pSize.isValid())
+    return QImage();
+
+  QImage *full = _images.object(cacheKey(pId, pStamp, QSize()));
+  if (! full)
+    return QImage();
+
+  QImage *scaled = new QImage(full->scaled(pSize, Qt::KeepAspectRatio,
+                                           Qt::SmoothTransformation));
+  QImage result = *scaled;
+  _images.insert(cacheKey(pId, pStamp, pSize), scaled, cost(*scaled));
+  return result;
+}
+
+/* Failed decodes are recorded so fetch() doesn't start them over, and an
+   image bigger than the whole cache, which QCache would drop, is kept
+   aside instead.
+ */
+void XImageCache::insert(const XDecodedImage &pImage)
+{
+  if (_stamps.value(pImage.id) != pImage.stamp)
+    return;
+
+  if (pImage.full.isNull())
+  {
+    _failed.insert(pImage.id, pImage.stamp);
+    return;
+  }
+
+  QList<QSize> sizes = thumbnailSizes();
+  for (int i = 0; i < pImage.thumbnails.size() && i < sizes.size(); i++)
+    _images.insert(cacheKey(pImage.id, pImage.stamp, sizes.at(i)),
+                   new QImage(pImage.thumbnails.at(i)), cost(pImage.thumbnails.at(i)));
+
+  if (cost(pImage.full) > _images.maxCost())
+  {
+    _largeId    = pImage.id;
+    _largeStamp = pImage.stamp;
+    _large      = pImage.full;
+  }
+  else
+    _images.insert(cacheKey(pImage.id, pImage.stamp, QSize()),
+                   new QImage(pImage.full), cost(pImage.full));
+}
+
+QFutureWatcher<XDecodedImage> *XImageCache::startDecode(int pId, const QString &pStamp)
+{
+  QFutureWatcher<XDecodedImage> *watcher = _decoding.value(pId);
+  if (watcher)
+    return watcher;
+
+  XPreparedQuery q("SELECT image_data"
+                   "  FROM image"
+                   " WHERE (image_id=:image_id);");
+  q->bindValue(":image_id", pId);
+  q.exec();
+  if (! q->first())
+    return 0;
+
+  watcher = new QFutureWatcher<XDecodedImage>(this);
+  connect(watcher, SIGNAL(finished()), this, SLOT(sDecodeFinished()));
+  watcher->setFuture(QtConcurrent::run(decodeImage, pId, pStamp,
+                                       q->value("image_data").toString()));
+  _decoding.insert(pId, watcher);
+  return watcher;
+}
+
+void XImageCache::sDecodeFinished()
+{
+  QFutureWatcher<XDecodedImage> *watcher =
+                        static_cast<QFutureWatcher<XDecodedImage> *>(sender());
+  if (! watcher)
+    return;
+
+  XDecodedImage result = watcher->result();
+  if (_decoding.value(result.id) == watcher)
+    _decoding.remove(result.id);
+  watcher->deleteLater();
+
+  insert(result);
+  if (DEBUG)
+    qDebug() << "XImageCache decoded" << result.id << result.full.size();
+  emit decoded(result.id, result.full);
+}
+
+/** Return image pId scaled to fit pSize, or at full size if pSize is not
+    valid. If the image isn't cached it's decoded before returning.
+ */
+QImage XImageCache::image(int pId, const QSize &pSize)
+{
+  QString stamp = currentStamp(pId);
+  if (stamp.isEmpty())
+    return QImage();
+
+  QImage result = cached(pId, stamp, pSize);
+  if (! result.isNull() || _failed.value(pId) == stamp)
+    return result;
+
+  XtTraceSpan span("decodeImage", "image", pId);
+  QFutureWatcher<XDecodedImage> *watcher = _decoding.take(pId);
+  if (watcher)
+  {
+    watcher->disconnect(this);
+    watcher->waitForFinished();
+    insert(watcher->result());
+    watcher->deleteLater();
+  }
+  else
+  {
+    XPreparedQuery q("SELECT image_data"
+                     "  FROM image"
+                     " WHERE (image_id=:image_id);");
+    q->bindValue(":image_id", pId);
+    q.exec();
+    if (! q->first())
+      return QImage();
+    insert(decodeImage(pId, stamp, q->value("image_data").toString()));
+  }
+
+  return cached(pId, stamp, pSize);
+}
+
+QImage XImageCache::image(const QString &pName, const QSize &pSize)
+{
+  int id = idForName(pName);
+  return id < 0 ? QImage() : image(id, pSize);
+}
+
+/** Return image pId scaled to fit pSize if it's cached. Otherwise start
+    decoding it, return a null image, and emit decoded() when done. An
+    image that failed to decode returns a null image without trying again.
+ */
+QImage XImageCache::fetch(int pId, const QSize &pSize)
+{
+  QString stamp = currentStamp(pId);
+  if (stamp.isEmpty())
+    return QImage();
+
+  QImage result = cached(pId, stamp, pSize);
+  if (result.isNull() && _failed.value(pId) != stamp)
+    (void)startDecode(pId, stamp);
+  return result;
+}
+
+int XImageCache::idForName(const QString &pName)
+{
+  XPreparedQuery q("SELECT image_id"
+                   "  FROM image"
+                   " WHERE (image_name=:image_name)"
+                   " LIMIT 1;");
+  q->bindValue(":image_name", pName);
+  q.exec();
+  if (q->first())
+    return q->value("image_id").toInt();
+  return -1;
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XIMAGECACHE_H
+#define XIMAGECACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+
+template <class T> class QFutureWatcher;
+struct XDecodedImage;
+
+/** @class XImageCache
+
+    @brief Decoded copies of the images in the image table, shared by
+           every widget that shows them.
+
+    Images are stored uuencoded, so showing one means fetching and decoding
+    it. The cache keeps the decoded images, keyed by image_id and the row's
+    change stamp, so an image is decoded again only after it is edited. It
+    also keeps copies scaled to each of thumbnailSizes(), made when the
+    image is decoded.
+
+    image() returns the image right away, decoding it on the spot if it
+    isn't cached. fetch() never blocks: it returns a null image and starts
+    decoding on a worker thread if the image isn't cached, then emits
+    decoded() with the full-size image when it's done. Listeners should use
+    the image passed to them rather than calling fetch() again:
+
+    @code
+    connect(XImageCache::instance(), SIGNAL(decoded(int, QImage)),
+            this,                    SLOT(sDecoded(int, QImage)));
+    ...
+    QImage img = XImageCache::instance()->fetch(id);
+    if (img.isNull())
+      ;  // show a placeholder, sDecoded(id, img) will be called
+    @endcode
+
+    The cache holds at most maxBytes() of images, least recently used
+    first out. The most recent image too big to fit is kept aside so it can
+    still be shown. An image that can't be decoded is remembered, and
+    decoded again only after it is edited; decoded() passes a null image
+    for it.
+
+    Use the cache from the GUI thread.
+ */
+class XImageCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static XImageCache *instance();
+
+    QImage image(int pId, const QSize &pSize = QSize());
+    QImage image(const QString &pName, const QSize &pSize = QSize());
+    QImage fetch(int pId, const QSize &pSize = QSize());
+    int    idForName(const QString &pName);
+
+    int    maxBytes() const;
+    void   setMaxBytes(int pBytes);
+    void   clear();
+
+    static QList<QSize> thumbnailSizes();
+
+  signals:
+    void decoded(int pId, const QImage &pImage);
+
+  protected slots:
+    void sDecodeFinished();
+
+  private:
+    XImageCache();
+    ~XImageCache();
+
+    QString currentStamp(int pId);
+    QImage  cached(int pId, const QString &pStamp, const QSize &pSize);
+    void    insert(const XDecodedImage &pImage);
+    QFutureWatcher<XDecodedImage> *startDecode(int pId, const QString &pStamp);
+
+    QCache<QString, QImage>                     _images;
+    QHash<int, QString>                         _failed;
+    int                                         _largeId;
+    QString                                     _largeStamp;
+    QImage                                      _large;
+    QHash<int, QString>                         _stamps;
+    QHash<int, QFutureWatcher<XDecodedImage> *> _decoding;
+};
+
+#endif
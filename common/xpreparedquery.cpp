@@ -0,0 +1,181 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xpreparedquery.h"
+#include "xsqlprofiler.h"
+
+#include <QHash>
+#include <QList>
+#include <QSqlError>
+#include <QtDebug>
+
+#define DEBUG false
+
+class XPreparedQueryPool
+{
+  public:
+    XPreparedQueryPool()
+      : capacity(64),
+        generation(0),
+        idleCount(0),
+        hits(0),
+        prepares(0),
+        evictions(0)
+    {
+    }
+
+    ~XPreparedQueryPool()
+    {
+      clear();
+    }
+
+    void clear()
+    {
+      foreach (QList<XSqlQuery *> queries, idle)
+        qDeleteAll(queries);
+      idle.clear();
+      lru.clear();
+      idleCount = 0;
+      generation++;
+    }
+
+    void trim()
+    {
+      while (idleCount > capacity && ! lru.isEmpty())
+      {
+        QString key = lru.takeFirst();
+        QList<XSqlQuery *> &queries = idle[key];
+        if (! queries.isEmpty())
+        {
+          delete queries.takeFirst();
+          idleCount--;
+          evictions++;
+        }
+        if (queries.isEmpty())
+          idle.remove(key);
+      }
+    }
+
+    int                                capacity;
+    quint64                            generation;
+    QHash<QString, QList<XSqlQuery *> > idle;
+    QList<QString>                     lru;       // one entry per idle query, oldest first
+    int                                idleCount;
+    qint64                             hits;
+    qint64                             prepares;
+    qint64                             evictions;
+};
+
+static XPreparedQueryPool *pool()
+{
+  static XPreparedQueryPool pool;
+  return &pool;
+}
+
+/** Borrow a query for pSql on pDb, preparing it only if there isn't an
+    idle one in the pool already.
+ */
+XPreparedQuery::XPreparedQuery(const QString &pSql, QSqlDatabase pDb)
+  : _query(0),
+    _reusable(true)
+{
+  XPreparedQueryPool *p = pool();
+  _key        = pDb.connectionName() + "\n" + pSql;
+  _generation = p->generation;
+
+  QHash<QString, QList<XSqlQuery *> >::iterator it = p->idle.find(_key);
+  if (it != p->idle.end() && ! it.value().isEmpty())
+  {
+    _query = it.value().takeLast();
+    if (it.value().isEmpty())
+      p->idle.erase(it);
+    p->lru.removeAt(p->lru.lastIndexOf(_key));
+    p->idleCount--;
+    p->hits++;
+    return;
+  }
+
+  _query = new XSqlQuery(pDb);
+  if (pSql.isEmpty())
+  {
+    _reusable = false;
+    return;
+  }
+
+  p->prepares++;
+  if (! _query->prepare(pSql))
+  {
+    _reusable = false;
+    if (DEBUG)
+      qDebug() << "XPreparedQuery could not prepare" << pSql
+               << _query->lastError().text();
+  }
+}
+
+XPreparedQuery::~XPreparedQuery()
+{
+  XPreparedQueryPool *p = pool();
+  if (! _reusable || _generation != p->generation ||
+      _query->lastError().type() == QSqlError::ConnectionError)
+  {
+    delete _query;
+    return;
+  }
+
+  _query->finish();
+  p->idle[_key].append(_query);
+  p->lru.append(_key);
+  p->idleCount++;
+  p->trim();
+}
+
+/** Execute the query, reporting how long it took to any
+    XSqlQueryTimingListeners.
+ */
+bool XPreparedQuery::exec()
+{
+  XSqlProfiler timing;
+  bool result = _query->exec();
+  timing.finish(*_query);
+  return result;
+}
+
+/** The most idle queries the pool keeps. */
+int XPreparedQuery::capacity()
+{
+  return pool()->capacity;
+}
+
+void XPreparedQuery::setCapacity(int pCapacity)
+{
+  pool()->capacity = qMax(0, pCapacity);
+  pool()->trim();
+}
+
+/** Throw away every pooled query. Queries in use when this is called are
+    deleted instead of being returned to the pool.
+ */
+void XPreparedQuery::clear()
+{
+  if (DEBUG) qDebug() << "XPreparedQuery::clear()";
+  pool()->clear();
+}
+
+QVariantMap XPreparedQuery::statistics()
+{
+  XPreparedQueryPool *p = pool();
+  QVariantMap result;
+  result.insert("capacity",  p->capacity);
+  result.insert("idle",      p->idleCount);
+  result.insert("hits",      p->hits);
+  result.insert("prepares",  p->prepares);
+  result.insert("evictions", p->evictions);
+  return result;
+}
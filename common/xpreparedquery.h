@@ -0,0 +1,71 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XPREPAREDQUERY_H
+#define XPREPAREDQUERY_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariantMap>
+
+#include "xsqlquery.h"
+
+/** @class XPreparedQuery
+
+    @brief An XSqlQuery borrowed from a per-connection pool of statements that
+           have already been prepared.
+
+    Code that runs the same SQL over and over can use an XPreparedQuery in
+    place of a local XSqlQuery and prepare(). The first use of a statement
+    prepares it on the server; later uses only bind and execute:
+
+    @code
+    XPreparedQuery q("SELECT tryLock(...) AS locked ...;");
+    q->bindValue(":id", id);
+    q.exec();
+    if (q->first())
+      ...
+    @endcode
+
+    The query goes back to the pool when the XPreparedQuery is destroyed. If
+    the same statement is in use elsewhere, for example in a recursive
+    call, a second query is prepared for it. The pool holds at most
+    capacity() idle queries, dropping the least recently used ones first.
+    Call clear() when the database connection is lost and before it is
+    closed, since the pool itself is only destroyed at exit.
+
+    This is meant for use on the GUI thread only.
+ */
+class XPreparedQuery
+{
+  public:
+    XPreparedQuery(const QString &pSql, QSqlDatabase pDb = QSqlDatabase::database());
+    ~XPreparedQuery();
+
+    bool exec();
+
+    XSqlQuery &operator*()  { return *_query; }
+    XSqlQuery *operator->() { return _query;  }
+
+    static int         capacity();
+    static void        clear();
+    static void        setCapacity(int pCapacity);
+    static QVariantMap statistics();
+
+  private:
+    Q_DISABLE_COPY(XPreparedQuery)
+
+    QString    _key;
+    XSqlQuery *_query;
+    bool       _reusable;
+    quint64    _generation;
+};
+
+#endif
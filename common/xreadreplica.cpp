@@ -0,0 +1,234 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xreadreplica.h"
+
+#include <QDateTime>
+#include <QSqlError>
+#include <QVariant>
+#include <QtDebug>
+
+#include <dbtools.h>
+
+#include "xpreparedquery.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+#define CONNECTIONNAME  "readreplica"
+#define RETRYSECS       60      // wait this long after a failure before reconnecting
+#define LAGCHECKSECS    10      // how long a StaleOk lag check stays good
+
+static bool      _open        = false;
+static bool      _walNames    = true;   // PostgreSQL 10+ renamed xlog to wal
+static int       _maxLag      = 5;
+static QDateTime _failedAt;
+static QDateTime _lagCheckedAt;
+static bool      _lagOk       = false;
+static QString   _lastError;
+static QString   _writeLsn;             // primary position after our last write
+static bool      _caughtUp    = true;   // the replica has replayed _writeLsn
+
+static QSqlDatabase primary()
+{
+  return QSqlDatabase::database();
+}
+
+static void fail(const QString &pError)
+{
+  _lastError = pError;
+  _failedAt  = QDateTime::currentDateTime();
+  _lagOk     = false;
+  qWarning() << "Read replica unavailable, using the primary:" << pError;
+}
+
+/* Connect to the replica with the same credentials as the primary and make
+   it look like the primary to the queries that run there.
+ */
+static bool connectReplica(const QString &pDatabaseURL)
+{
+  QString protocol, hostName, dbName, port;
+  parseDatabaseURL(pDatabaseURL, protocol, hostName, dbName, port);
+
+  QSqlDatabase main = primary();
+  QSqlDatabase db = QSqlDatabase::contains(CONNECTIONNAME)
+                    ? QSqlDatabase::database(CONNECTIONNAME, false)
+                    : QSqlDatabase::addDatabase(main.driverName(), CONNECTIONNAME);
+  db.setHostName(hostName);
+  db.setDatabaseName(dbName);
+  db.setPort(port.toInt());
+  db.setUserName(main.userName());
+  db.setPassword(main.password());
+  db.setConnectOptions(main.connectOptions());
+  if (! db.open())
+  {
+    fail(db.lastError().text());
+    return false;
+  }
+
+  XSqlQuery pathq(main);
+  pathq.exec("SELECT current_setting('search_path') AS path,"
+             "       current_setting('server_version_num')::integer >= 100000 AS wal;");
+  if (! pathq.first())
+  {
+    fail(pathq.lastError().text());
+    db.close();
+    return false;
+  }
+  _walNames = pathq.value("wal").toBool();
+
+  XSqlQuery setq(db);
+  setq.exec("SET SESSION CHARACTERISTICS AS TRANSACTION READ ONLY;");
+  setq.exec(QString("SET search_path TO %1;").arg(pathq.value("path").toString()));
+  if (setq.lastError().type() != QSqlError::NoError)
+  {
+    fail(setq.lastError().text());
+    db.close();
+    return false;
+  }
+
+  setq.exec("SELECT pg_is_in_recovery() AS standby;");
+  if (setq.first() && ! setq.value("standby").toBool())
+    qWarning() << "The read replica" << pDatabaseURL << "is not a standby server";
+
+  return true;
+}
+
+/** Open the read replica at pDatabaseURL, e.g. psql://standby:5432/prod.
+    The primary connection must already be open.
+ */
+bool XReadReplica::open(const QString &pDatabaseURL)
+{
+  _lastError.clear();
+  _failedAt = QDateTime();
+  _writeLsn.clear();
+  _caughtUp = true;
+  _open = connectReplica(pDatabaseURL);
+  if (DEBUG) qDebug() << "XReadReplica::open(" << pDatabaseURL << ") returning" << _open;
+  return _open;
+}
+
+void XReadReplica::close()
+{
+  if (QSqlDatabase::contains(CONNECTIONNAME))
+    QSqlDatabase::database(CONNECTIONNAME, false).close();
+  _open = false;
+}
+
+bool XReadReplica::isOpen()
+{
+  return _open;
+}
+
+QString XReadReplica::lastError()
+{
+  return _lastError;
+}
+
+int XReadReplica::maxLag()
+{
+  return _maxLag;
+}
+
+void XReadReplica::setMaxLag(int pSeconds)
+{
+  _maxLag = qMax(0, pSeconds);
+}
+
+/** Remember how far the primary's WAL had got after this client committed
+    something. Current reads use the primary until the replica has replayed
+    that far; commits by other clients do not hold them back.
+ */
+void XReadReplica::noteWrite()
+{
+  if (! _open)
+    return;
+
+  XPreparedQuery lsnq(_walNames ? "SELECT pg_current_wal_lsn()::text AS lsn;"
+                                : "SELECT pg_current_xlog_location()::text AS lsn;",
+                      primary());
+  lsnq.exec();
+  if (lsnq->first())
+  {
+    _writeLsn = lsnq->value("lsn").toString();
+    _caughtUp = false;
+  }
+  if (DEBUG) qDebug() << "XReadReplica::noteWrite()" << _writeLsn;
+}
+
+/** The connection to use for a read-only query: the replica if it is open
+    and fresh enough, the primary otherwise.
+ */
+QSqlDatabase XReadReplica::database(Freshness pFreshness)
+{
+  if (! _open)
+    return primary();
+
+  QSqlDatabase replica = QSqlDatabase::database(CONNECTIONNAME, false);
+  if (! replica.isOpen())
+  {
+    if (_failedAt.isValid() && _failedAt.secsTo(QDateTime::currentDateTime()) < RETRYSECS)
+      return primary();
+    if (! replica.open())
+    {
+      fail(replica.lastError().text());
+      return primary();
+    }
+  }
+
+  // replay positions only move forward, so once the replica has our last
+  // write it keeps having it until we write again
+  if (pFreshness == Current && _caughtUp)
+    return replica;
+
+  QDateTime now = QDateTime::currentDateTime();
+  if (pFreshness == StaleOk && _lagCheckedAt.isValid() &&
+      _lagCheckedAt.secsTo(now) < LAGCHECKSECS)
+    return _lagOk ? replica : primary();
+
+  // an idle primary makes the replay timestamp look old, so a replica that
+  // has replayed all it received counts as not lagging
+  XPreparedQuery replayq(_walNames
+                         ? "SELECT COALESCE(pg_last_wal_replay_lsn() >= CAST(:lsn AS pg_lsn),"
+                           "                true) AS current,"
+                           "       COALESCE(pg_last_wal_replay_lsn() >= pg_last_wal_receive_lsn(),"
+                           "                true) AS replayed,"
+                           "       COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()),"
+                           "                0) AS lag;"
+                         : "SELECT COALESCE(pg_last_xlog_replay_location() >= CAST(:lsn AS pg_lsn),"
+                           "                true) AS current,"
+                           "       COALESCE(pg_last_xlog_replay_location() >= pg_last_xlog_receive_location(),"
+                           "                true) AS replayed,"
+                           "       COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()),"
+                           "                0) AS lag;",
+                         replica);
+  replayq->bindValue(":lsn", _writeLsn.isEmpty() ? QVariant(QVariant::String)
+                                                 : QVariant(_writeLsn));
+  replayq.exec();
+  if (! replayq->first())
+  {
+    fail(replayq->lastError().text());
+    replica.close();
+    return primary();
+  }
+
+  bool current = replayq->value("current").toBool();
+  _caughtUp     = current;
+  _lagOk        = replayq->value("replayed").toBool() ||
+                  replayq->value("lag").toDouble() <= _maxLag;
+  _lagCheckedAt = now;
+  if (DEBUG)
+    qDebug() << "XReadReplica::database() current" << current
+             << "lag" << replayq->value("lag").toDouble();
+
+  if (pFreshness == Current)
+    return current ? replica : primary();
+  return _lagOk ? replica : primary();
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XREADREPLICA_H
+#define XREADREPLICA_H
+
+#include <QSqlDatabase>
+#include <QString>
+
+/** @class XReadReplica
+
+    @brief An optional read-only connection to a hot-standby copy of the
+           database, for queries that only read.
+
+    Code that runs expensive read-only queries asks for a connection with
+    database() instead of using QSqlDatabase::database():
+
+    @code
+    XSqlQuery q(XReadReplica::database());
+    @endcode
+
+    If no replica was opened, or it cannot be used right now, database()
+    returns the primary connection, so callers do not need to check.
+
+    With the default Current freshness the replica is only used once it has
+    replayed this client's own writes, so a window refreshed right after a
+    save sees the save. Call noteWrite() after committing; until the next
+    write a Current read costs no extra round trip. StaleOk accepts a
+    replica that is at most maxLag() seconds behind, which is fine for
+    things like completers.
+ */
+class XReadReplica
+{
+  public:
+    enum Freshness { Current, StaleOk };
+
+    static bool         open(const QString &pDatabaseURL);
+    static void         close();
+    static bool         isOpen();
+    static QSqlDatabase database(Freshness pFreshness = Current);
+    static QString      lastError();
+    static void         noteWrite();
+
+    static int          maxLag();
+    static void         setMaxLag(int pSeconds);
+};
+
+#endif
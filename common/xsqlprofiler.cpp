@@ -0,0 +1,70 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xsqlprofiler.h"
+
+#include <QList>
+#include <QSqlError>
+#include <QSqlQuery>
+
+static QList<XSqlQueryTimingListener *> _timingListeners;
+
+XSqlProfiler::XSqlProfiler(const QString &group, const QString &name,
+                           const QString &window, const QString &script)
+  : _active(! _timingListeners.isEmpty())
+{
+  if (_active)
+  {
+    _group  = group;
+    _name   = name;
+    _window = window;
+    _script = script;
+    _timer.start();
+  }
+}
+
+/** Report the time since this XSqlProfiler was created, along with the
+    statement and row count of the query that was just executed.
+ */
+void XSqlProfiler::finish(const QSqlQuery &query)
+{
+  if (! _active)
+    return;
+
+  XSqlQueryTiming timing;
+  timing.usecs  = _timer.nsecsElapsed() / 1000;
+  timing.sql    = query.lastQuery();
+  timing.group  = _group;
+  timing.name   = _name;
+  timing.window = _window;
+  timing.script = _script;
+  timing.failed = query.lastError().type() != QSqlError::NoError;
+  timing.rows   = query.isSelect() ? query.size() : query.numRowsAffected();
+
+  _active = false;
+  foreach (XSqlQueryTimingListener *listener, _timingListeners)
+    listener->timed(timing);
+}
+
+void XSqlProfiler::addListener(XSqlQueryTimingListener *listener)
+{
+  if (listener && ! _timingListeners.contains(listener))
+    _timingListeners.append(listener);
+}
+
+void XSqlProfiler::removeListener(XSqlQueryTimingListener *listener)
+{
+  _timingListeners.removeAll(listener);
+}
+
+bool XSqlProfiler::isActive()
+{
+  return ! _timingListeners.isEmpty();
+}
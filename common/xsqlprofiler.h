@@ -0,0 +1,85 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XSQLPROFILER_H
+#define XSQLPROFILER_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+class QSqlQuery;
+
+/** @brief One timed statement, as reported to an XSqlQueryTimingListener. */
+struct XSqlQueryTiming
+{
+  QString sql;      //!< the statement as prepared, before binding values
+  QString group;    //!< MetaSQL group, if the statement came from one
+  QString name;     //!< MetaSQL name, if the statement came from one
+  QString window;   //!< objectName() of the window that ran the statement
+  QString script;   //!< name of the script that ran the statement
+  qint64  usecs;
+  int     rows;     //!< rows returned or affected, -1 if unknown
+  bool    failed;
+};
+
+/** @brief Abstract interface for objects that want to hear how long
+           statements took.
+
+    This is the timing counterpart of XSqlQueryErrorListener. Listeners are
+    registered with XSqlProfiler::addListener().
+ */
+class XSqlQueryTimingListener
+{
+  public:
+    virtual ~XSqlQueryTimingListener() {}
+    virtual void timed(const XSqlQueryTiming &timing) = 0;
+};
+
+/** @class XSqlProfiler
+
+    @brief Times a single statement and reports it to the registered
+           XSqlQueryTimingListeners.
+
+    XSqlQuery does not report its own timing, so the places in the
+    application that run a lot of queries wrap the exec() call:
+
+    @code
+    XSqlProfiler timing("customer", "detail", objectName());
+    q.exec();
+    timing.finish(q);
+    @endcode
+
+    If nobody is listening, constructing an XSqlProfiler and calling
+    finish() costs next to nothing.
+ */
+class XSqlProfiler
+{
+  public:
+    XSqlProfiler(const QString &group  = QString(),
+                 const QString &name   = QString(),
+                 const QString &window = QString(),
+                 const QString &script = QString());
+
+    void finish(const QSqlQuery &query);
+
+    static void addListener(XSqlQueryTimingListener *listener);
+    static void removeListener(XSqlQueryTimingListener *listener);
+    static bool isActive();
+
+  private:
+    bool          _active;
+    QString       _group;
+    QString       _name;
+    QString       _window;
+    QString       _script;
+    QElapsedTimer _timer;
+};
+
+#endif
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2015 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -9,74 +9,411 @@
  */
 
 #include "xtNetworkRequestManager.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QEventLoop>
+#include <QIODevice>
 #include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
 #include <QNetworkRequest>
-#include <QNetworkReply>
-#include <QMutex>
-#include <QMutexLocker>
-#include <QObject>
-#include <QDebug>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include "xttrace.h"
 
 #define DEBUG false
 
-xtNetworkRequestManager::xtNetworkRequestManager(const QUrl & url, QMutex &mutex) {
-  nwam = new QNetworkAccessManager;
-  _nwrep = 0;
-  _response = 0;
-  _url = url;
-  _mutex = &mutex;
-  _mutex->lock();
-  _loop = new QEventLoop;
-  startRequest(_url);
-}
-void xtNetworkRequestManager::startRequest(const QUrl & url) {
-    _nwrep = nwam->get(QNetworkRequest(url));
-    connect(_nwrep, SIGNAL(finished()), SLOT(requestCompleted()));
-    connect(nwam, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)), this, SLOT(sslErrors(QNetworkReply*,QList<QSslError>)));
-#if QT_VERSION < 0x050000 //this feels hackish, ignore error or provide root cert, we'll ignore for now
-    connect(nwam, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)), _nwrep, SLOT(ignoreSslErrors()));
-#endif
-    connect(nwam, SIGNAL(finished(QNetworkReply*)), _loop, SLOT(quit()));
-    _loop->exec();
-}
-void xtNetworkRequestManager::requestCompleted() {
-  _response = _nwrep->readAll(); //we don't really care here but store it anyways
-  _nwrep->close();
-  QVariant possibleRedirect = _nwrep->attribute(QNetworkRequest::RedirectionTargetAttribute);
-  if(DEBUG){
-      qDebug() << "redirect=" << possibleRedirect.isValid();
-      qDebug() << "replyError=" << _nwrep->errorString();
-      qDebug() << "replyErrorCode=" << _nwrep->error();
+#define DEFAULTCACHESIZE  (100 * 1024 * 1024)
+#define MAXREDIRECTS      5
+
+class xtNetworkRequestManager::Request
+{
+  public:
+    Request()
+      : id(0),
+        policy(UseCache),
+        output(0),
+        reply(0),
+        redirects(0),
+        done(false),
+        detached(false),
+        cancelled(false),
+        fromCache(false),
+        error(QNetworkReply::NoError),
+        httpStatus(0)
+    {
+    }
+
+    int                          id;
+    QUrl                         url;
+    CachePolicy                  policy;
+    QIODevice                   *output;
+    QNetworkReply               *reply;
+    int                          redirects;
+    bool                         done;
+    bool                         detached;
+    bool                         cancelled;
+    bool                         fromCache;
+    QByteArray                   data;
+    QNetworkReply::NetworkError  error;
+    QString                      errorString;
+    int                          httpStatus;
+};
+
+/* QNetworkDiskCache serves a cached response without asking the server
+   until it expires, and most of what we fetch says nothing about when
+   that is. Treat every entry as already expired so Qt always sends a
+   conditional request with the entry's ETag and Last-Modified date, and
+   uses the cached copy only when the server answers 304 Not Modified.
+ */
+class xtRevalidatingCache : public QNetworkDiskCache
+{
+  public:
+    xtRevalidatingCache(QObject *pParent) : QNetworkDiskCache(pParent) {}
+
+    virtual QNetworkCacheMetaData metaData(const QUrl &pUrl)
+    {
+      QNetworkCacheMetaData result = QNetworkDiskCache::metaData(pUrl);
+      if (result.isValid())
+        result.setExpirationDate(QDateTime::currentDateTimeUtc().addSecs(-1));
+      return result;
+    }
+};
+
+xtNetworkRequestManager::xtNetworkRequestManager(QObject *pParent)
+  : QObject(pParent),
+    _nextId(0)
+{
+  _cache = new xtRevalidatingCache(this);
+  _cache->setCacheDirectory(cacheDir());
+  _cache->setMaximumCacheSize(DEFAULTCACHESIZE);
+
+  _manager = new QNetworkAccessManager(this);
+  _manager->setCache(_cache);   // the manager takes ownership
+  connect(_manager, SIGNAL(sslErrors(QNetworkReply*, QList<QSslError>)),
+          this,     SLOT(sslErrors(QNetworkReply*, QList<QSslError>)));
+}
+
+xtNetworkRequestManager::~xtNetworkRequestManager()
+{
+  foreach (Request *req, _requests)
+  {
+    if (req->reply)
+    {
+      req->reply->disconnect(this);
+      req->reply->abort();
+    }
   }
-  if(_nwrep->error() != QNetworkReply::NoError){
-      qDebug() << "network reply error on request" << _nwrep->error() << _nwrep->errorString();
-      _nwrep->deleteLater();
-      _mutex->unlock();
+  qDeleteAll(_requests);
+}
+
+/** The manager shared by the whole application. */
+xtNetworkRequestManager *xtNetworkRequestManager::instance()
+{
+  static xtNetworkRequestManager *manager = 0;
+  if (! manager)
+    manager = new xtNetworkRequestManager(QCoreApplication::instance());
+  return manager;
+}
+
+QString xtNetworkRequestManager::cacheDir()
+{
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+         + "/network";
+}
+
+qint64 xtNetworkRequestManager::maxCacheSize() const
+{
+  return _cache->maximumCacheSize();
+}
+
+void xtNetworkRequestManager::setMaxCacheSize(qint64 pBytes)
+{
+  _cache->setMaximumCacheSize(pBytes);
+}
+
+/** Counters since the manager was created: requests started, downloaded
+    in full, notModified (answered from the cache after a 304), failed,
+    cancelled, and bytesDownloaded, plus the number still active and the
+    cacheSize on disk.
+ */
+QVariantMap xtNetworkRequestManager::statistics() const
+{
+  int active = 0;
+  foreach (Request *req, _requests)
+    if (! req->done)
+      active++;
+
+  QVariantMap result = _stats;
+  result.insert("active",    active);
+  result.insert("cacheSize", _cache->cacheSize());
+  return result;
+}
+
+void xtNetworkRequestManager::count(const QString &pCounter)
+{
+  _stats.insert(pCounter, _stats.value(pCounter).toLongLong() + 1);
+}
+
+/** Start fetching pUrl and return the request's id.
+
+    With NoCache the response neither comes from nor goes into the
+    cache; use it for requests that report something to the server.
+    If pOutput is given, the response is written to it as it arrives
+    instead of being kept for data(). The device must stay open until
+    the request is finished.
+ */
+int xtNetworkRequestManager::get(const QUrl &pUrl, CachePolicy pPolicy, QIODevice *pOutput)
+{
+  Request *req = new Request();
+  req->id     = ++_nextId;
+  req->url    = pUrl;
+  req->policy = pPolicy;
+  req->output = pOutput;
+  _requests.insert(req->id, req);
+
+  count("requests");
+  send(req, pUrl);
+  return req->id;
+}
+
+void xtNetworkRequestManager::send(Request *pRequest, const QUrl &pUrl)
+{
+  if (DEBUG)
+    qDebug() << "xtNetworkRequestManager::send()" << pRequest->id << pUrl;
+
+  QNetworkRequest request(pUrl);
+  if (pRequest->policy == NoCache)
+  {
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                         QNetworkRequest::AlwaysNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
   }
-  if(_nwrep->error() == QNetworkReply::NoError && !possibleRedirect.isValid()){
-      //success and no redirect
-      _nwrep->deleteLater();
-      _mutex->unlock();
+  else
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                         QNetworkRequest::PreferNetwork);
+
+  pRequest->reply = _manager->get(request);
+  pRequest->reply->setProperty("requestid", pRequest->id);
+  connect(pRequest->reply, SIGNAL(readyRead()),                      this, SLOT(sReadyRead()));
+  connect(pRequest->reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(sDownloadProgress(qint64, qint64)));
+  connect(pRequest->reply, SIGNAL(finished()),                       this, SLOT(sReplyFinished()));
+}
+
+xtNetworkRequestManager::Request *xtNetworkRequestManager::requestFor(QObject *pReply) const
+{
+  if (! pReply)
+    return 0;
+  Request *req = _requests.value(pReply->property("requestid").toInt());
+  return (req && req->reply == pReply) ? req : 0;
+}
+
+void xtNetworkRequestManager::sReadyRead()
+{
+  Request *req = requestFor(sender());
+  if (! req)
+    return;
+
+  QByteArray chunk = req->reply->readAll();
+  if (req->reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid())
+    return;     // the body of a redirect isn't what was asked for
+  if (! req->reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool())
+    _stats.insert("bytesDownloaded", _stats.value("bytesDownloaded").toLongLong()
+                                     + chunk.size());
+  if (req->output)
+    req->output->write(chunk);
+  else
+    req->data.append(chunk);
+}
+
+void xtNetworkRequestManager::sDownloadProgress(qint64 pReceived, qint64 pTotal)
+{
+  Request *req = requestFor(sender());
+  if (req)
+    emit downloadProgress(req->id, pReceived, pTotal);
+}
+
+void xtNetworkRequestManager::sReplyFinished()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+  Request *req = requestFor(reply);
+  if (reply)
+    reply->deleteLater();
+  if (! req)
+    return;
+
+  sReadyRead();
+  req->reply = 0;
+
+  QVariant redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
+  if (reply->error() == QNetworkReply::NoError && redirect.isValid())
+  {
+    if (req->redirects++ < MAXREDIRECTS)
+    {
+      send(req, reply->url().resolved(redirect.toUrl()));
+      return;
+    }
+    req->error       = QNetworkReply::ProtocolFailure;
+    req->errorString = tr("Too many redirects fetching %1").arg(req->url.toString());
   }
-  else {
-      QUrl newUrl = _url.resolved(possibleRedirect.toUrl());
-      _nwrep->deleteLater();
-      startRequest(newUrl);
+  else
+  {
+    req->error       = reply->error();
+    req->errorString = reply->errorString();
   }
+  req->done       = true;
+  req->httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  req->fromCache  = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+
+  if (req->cancelled)
+    count("cancelled");
+  else if (req->error != QNetworkReply::NoError)
+  {
+    count("failed");
+    qDebug() << "network reply error on request" << req->url
+             << req->error << req->errorString;
+  }
+  else if (req->fromCache)
+    count("notModified");
+  else
+    count("downloaded");
+
+  int id = req->id;
+  emit finished(id);
+
+  // a slot connected to finished() may already have released it
+  req = _requests.value(id);
+  if (req && req->detached)
+    release(id);
 }
-void xtNetworkRequestManager::sslErrors(QNetworkReply*, const QList<QSslError> &errors) {
-#if QT_VERSION >= 0x050000
-    QString errorString;
-       foreach (const QSslError &error, errors) {
-           if (!errorString.isEmpty())
-               errorString += ", ";
-           errorString += error.errorString();
-       }
-   qDebug() << "errorString= " << errorString;
-#endif
+
+/** Stop request pId. finished(pId) is still emitted, with error()
+    OperationCanceledError.
+ */
+void xtNetworkRequestManager::cancel(int pId)
+{
+  Request *req = _requests.value(pId);
+  if (! req || req->done)
+    return;
+  req->cancelled = true;
+  if (req->reply)
+    req->reply->abort();
 }
-xtNetworkRequestManager::~xtNetworkRequestManager() {
-    nwam->deleteLater();
-    nwam = 0;
+
+/** Let request pId run to the end without anybody collecting it. */
+void xtNetworkRequestManager::detach(int pId)
+{
+  Request *req = _requests.value(pId);
+  if (! req)
+    return;
+  if (req->done)
+    release(pId);
+  else
+    req->detached = true;
+}
+
+/** Forget request pId and its data, cancelling it if it isn't done.
+    No finished() signal follows.
+ */
+void xtNetworkRequestManager::release(int pId)
+{
+  Request *req = _requests.take(pId);
+  if (! req)
+    return;
+  if (req->reply)
+  {
+    req->reply->disconnect(this);
+    req->reply->abort();
+    req->reply->deleteLater();
+  }
+  delete req;
 }
 
+/** Run an event loop until request pId is finished or pMsecs have
+    passed. Only for the rare caller that cannot go on without the
+    answer, such as when the application is about to exit; everyone else
+    should connect to finished().
+
+    @return true if the request finished without error
+ */
+bool xtNetworkRequestManager::wait(int pId, int pMsecs)
+{
+  XtTraceSpan span("networkRequest", "network", pId);
+
+  QEventLoop loop;
+  QTimer     timer;
+  timer.setSingleShot(true);
+  connect(&timer, SIGNAL(timeout()),     &loop, SLOT(quit()));
+  connect(this,   SIGNAL(finished(int)), &loop, SLOT(quit()));
+  if (pMsecs >= 0)
+    timer.start(pMsecs);
+
+  while (_requests.contains(pId) && ! isFinished(pId) &&
+         (pMsecs < 0 || timer.isActive()))
+    loop.exec();
+
+  return isFinished(pId) && error(pId) == QNetworkReply::NoError;
+}
+
+bool xtNetworkRequestManager::isFinished(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req && req->done;
+}
+
+QNetworkReply::NetworkError xtNetworkRequestManager::error(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->error : QNetworkReply::UnknownNetworkError;
+}
+
+QString xtNetworkRequestManager::errorString(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->errorString : QString();
+}
+
+int xtNetworkRequestManager::httpStatus(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->httpStatus : 0;
+}
+
+/** Whether request pId was answered from the cache because the server
+    said the cached copy was still current.
+ */
+bool xtNetworkRequestManager::fromCache(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req && req->fromCache;
+}
+
+/** The response to request pId, unless it was written to an output
+    device.
+ */
+QByteArray xtNetworkRequestManager::data(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->data : QByteArray();
+}
+
+/** The URL request pId was started with, before any redirects. */
+QUrl xtNetworkRequestManager::url(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->url : QUrl();
+}
+
+void xtNetworkRequestManager::sslErrors(QNetworkReply*, const QList<QSslError> &errors)
+{
+  QString errorString;
+  foreach (const QSslError &error, errors)
+  {
+    if (! errorString.isEmpty())
+      errorString += ", ";
+    errorString += error.errorString();
+  }
+  qDebug() << "errorString= " << errorString;
+}
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2015 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -11,39 +11,98 @@
 #ifndef __XTNETWORKREQUESTMANAGER_H__
 #define __XTNETWORKREQUESTMANAGER_H__
 
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QNetworkReply>
 #include <QObject>
-#include <QThread>
+#include <QSslError>
 #include <QString>
 #include <QUrl>
-#include <QNetworkAccessManager>
-#include <QEventLoop>
-#include <QMutex>
+#include <QVariantMap>
 
+class QIODevice;
 class QNetworkAccessManager;
-class QNetworkReply;
+class QNetworkDiskCache;
 
+/** @class xtNetworkRequestManager
+
+    @brief Fetches files from xTuple's web services without blocking the
+           caller.
+
+    get() starts a request and returns its id right away. Any number of
+    requests can be running at once. downloadProgress(id, ...) reports
+    on each one and finished(id) is emitted when it is done, whether it
+    succeeded, failed, or was cancelled. Redirects are followed.
+
+    Responses are kept in a cache on disk. The next request for the same
+    URL asks the server whether its copy is still current, using the
+    ETag and Last-Modified headers the server sent, so an unchanged file
+    costs a 304 Not Modified instead of a new download. fromCache(id)
+    tells whether that happened.
+
+    A finished request's data stays available until release(id). Callers
+    that only want a request sent, like the registration notice, call
+    detach(id) instead and the manager cleans up after it.
+
+    Use it from the GUI thread.
+ */
 class xtNetworkRequestManager : public QObject
 {
-    Q_OBJECT
+  Q_OBJECT
 
-public:
-    xtNetworkRequestManager(const QUrl &, QMutex &);
+  public:
+    xtNetworkRequestManager(QObject *pParent = 0);
     virtual ~xtNetworkRequestManager();
 
+    static xtNetworkRequestManager *instance();
+
+    enum CachePolicy { UseCache, NoCache };
+
+    int   get(const QUrl &pUrl, CachePolicy pPolicy = UseCache, QIODevice *pOutput = 0);
+    void  cancel(int pId);
+    void  detach(int pId);
+    bool  wait(int pId, int pMsecs = 30000);
 
-protected slots:
-    virtual void startRequest(const QUrl &);
-    virtual void requestCompleted();
+    bool                        isFinished(int pId)  const;
+    QNetworkReply::NetworkError error(int pId)       const;
+    QString                     errorString(int pId) const;
+    int                         httpStatus(int pId)  const;
+    bool                        fromCache(int pId)   const;
+    QByteArray                  data(int pId)        const;
+    QUrl                        url(int pId)         const;
+
+    qint64      maxCacheSize() const;
+    void        setMaxCacheSize(qint64 pBytes);
+    QVariantMap statistics()   const;
+
+    static QString cacheDir();
+
+  public slots:
+    void  release(int pId);
+
+  signals:
+    void  downloadProgress(int pId, qint64 pReceived, qint64 pTotal);
+    void  finished(int pId);
+
+  protected slots:
+    virtual void sDownloadProgress(qint64 pReceived, qint64 pTotal);
+    virtual void sReadyRead();
+    virtual void sReplyFinished();
     virtual void sslErrors(QNetworkReply*, const QList<QSslError> &errors);
 
-private:
-    QNetworkAccessManager * nwam;
-    QNetworkReply * _nwrep;
-    QNetworkRequest * _request;
-    QByteArray _response;
-    QMutex * _mutex;
-    QEventLoop *_loop;
-    QUrl _url;
+  private:
+    class Request;
+
+    void      count(const QString &pCounter);
+    void      send(Request *pRequest, const QUrl &pUrl);
+    Request  *requestFor(QObject *pReply) const;
+
+    QNetworkAccessManager  *_manager;
+    QNetworkDiskCache      *_cache;
+    QHash<int, Request *>   _requests;
+    int                     _nextId;
+    QVariantMap             _stats;
 };
 
 #endif
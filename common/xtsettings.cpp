@@ -10,33 +10,160 @@
 
 #include "xtsettings.h"
 
+#include <QBasicTimer>
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSettings>
+#include <QThread>
+#include <QTimerEvent>
 
-QVariant xtsettingsValue(const QString & key, const QVariant & defaultValue)
+#define WRITEDELAY 2000 // ms to collect changes before writing them out
+
+/* One QSettings for the whole process instead of one per call, with
+   changes held in memory and written out at most once every WRITEDELAY
+   ms. QSettings::sync() re-reads the file and only applies the keys that
+   changed here, under a lock, and replaces the file atomically, so two
+   clients sharing the file don't lose each other's changes.
+ */
+class XtSettingsStore : public QObject
 {
-  QSettings settings(QSettings::UserScope, "xTuple.com", "xTuple");
+  public:
+    XtSettingsStore();
+    ~XtSettingsStore();
+
+    QVariant value(const QString &key, const QVariant &defaultValue);
+    void     setValue(const QString &key, const QVariant &value);
+    void     flush();
+
+  protected:
+    virtual void timerEvent(QTimerEvent *event);
+
+  private:
+    QSettings               _settings;
+    QSettings              *_legacy;
+    QHash<QString, QVariant> _pending;
+    QMutex                  _mutex;
+    QBasicTimer             _timer;
+};
+
+static XtSettingsStore *_store = 0;
+
+static void flushXtSettingsOnExit()
+{
+  delete _store;
+  _store = 0;
+}
+
+static XtSettingsStore *store()
+{
+  if (! _store && QCoreApplication::instance())
+  {
+    _store = new XtSettingsStore();
+    qAddPostRoutine(flushXtSettingsOnExit);
+  }
+  return _store;
+}
+
+XtSettingsStore::XtSettingsStore()
+  : _settings(QSettings::UserScope, "xTuple.com", "xTuple"),
+    _legacy(0)
+{
+}
+
+XtSettingsStore::~XtSettingsStore()
+{
+  flush();
+  delete _legacy;
+}
+
+QVariant XtSettingsStore::value(const QString &key, const QVariant &defaultValue)
+{
+  QMutexLocker locker(&_mutex);
+  if (_pending.contains(key))
+    return _pending.value(key);
+  if (_settings.contains(key))
+    return _settings.value(key, defaultValue);
+
+  // settings saved before the company was renamed
   QString key2 = key;
-  if(key.startsWith("/xTuple/"))
+  if (key.startsWith("/xTuple/"))
     key2 = key2.replace(0, 8, QString("/OpenMFG/"));
-  if(settings.contains(key))
-    return settings.value(key, defaultValue);
-  else
+  if (! _legacy)
+    _legacy = new QSettings(QSettings::UserScope, "OpenMFG.com", "OpenMFG");
+  if (! _legacy->contains(key2))
+    return defaultValue;
+
+  QVariant val = _legacy->value(key2, defaultValue);
+  locker.unlock();
+  setValue(key, val);
+  return val;
+}
+
+void XtSettingsStore::setValue(const QString &key, const QVariant &value)
+{
+  QMutexLocker locker(&_mutex);
+  _pending.insert(key, value);
+  if (QThread::currentThread() != thread())
   {
-    QSettings oldsettings(QSettings::UserScope, "OpenMFG.com", "OpenMFG");
-    if(oldsettings.contains(key2))
-    {
-      QVariant val = oldsettings.value(key2, defaultValue);
-      xtsettingsSetValue(key, val);
-      return val;
-    }
+    locker.unlock();
+    flush();
   }
-  return defaultValue;
+  else if (! _timer.isActive())
+    _timer.start(WRITEDELAY, this);
 }
 
-void xtsettingsSetValue(const QString & key, const QVariant & value)
+void XtSettingsStore::flush()
+{
+  QMutexLocker locker(&_mutex);
+  if (_timer.isActive() && QThread::currentThread() == thread())
+    _timer.stop();
+  if (_pending.isEmpty())
+    return;
+
+  QHash<QString, QVariant>::const_iterator it;
+  for (it = _pending.constBegin(); it != _pending.constEnd(); ++it)
+    _settings.setValue(it.key(), it.value());
+  _pending.clear();
+  _settings.sync();
+}
+
+void XtSettingsStore::timerEvent(QTimerEvent *event)
+{
+  if (event->timerId() == _timer.timerId())
+    flush();
+  else
+    QObject::timerEvent(event);
+}
+
+QVariant xtsettingsValue(const QString & key, const QVariant & defaultValue)
 {
+  if (store())
+    return store()->value(key, defaultValue);
+
   QSettings settings(QSettings::UserScope, "xTuple.com", "xTuple");
-  settings.setValue(key, value);
+  return settings.value(key, defaultValue);
+}
+
+void xtsettingsSetValue(const QString & key, const QVariant & value)
+{
+  if (store())
+    store()->setValue(key, value);
+  else
+  {
+    QSettings settings(QSettings::UserScope, "xTuple.com", "xTuple");
+    settings.setValue(key, value);
+  }
+}
+
+/** Write out any settings changes that are still being held in memory.
+    This happens on its own shortly after each change and at exit.
+ */
+void xtsettingsFlush()
+{
+  if (_store)
+    _store->flush();
 }
 
 QScriptValue xtsettingsValueProto(QScriptContext *context, QScriptEngine *engine)
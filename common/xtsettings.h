@@ -18,6 +18,7 @@
 
 QVariant xtsettingsValue(const QString & key, const QVariant & defaultValue = QVariant());
 void xtsettingsSetValue(const QString & key, const QVariant & value);
+void xtsettingsFlush();
 
 void setupXtSettings(QScriptEngine *engine);
 
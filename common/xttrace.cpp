@@ -0,0 +1,241 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xttrace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+#include <QtDebug>
+
+#define DEBUG false
+
+// roughly 20 MB of events before we stop recording
+#define MAXEVENTS 200000
+
+struct XtTraceEvent
+{
+  const char *name;
+  const char *category;
+  QString     detail;
+  qint64      start;
+  qint64      duration;
+  quintptr    thread;
+  int         depth;
+};
+
+QAtomicInt XtTrace::_enabled(0);
+
+static QElapsedTimer          _clock;
+static QMutex                 _mutex;
+static QVector<XtTraceEvent>  _events;
+static QString                _filename;
+static int                    _dropped = 0;
+static bool                   _postRoutineAdded = false;
+static QThreadStorage<int>    _threadDepth;   // open spans on each thread
+
+static void writeTraceOnExit()
+{
+  XtTrace::stop();
+}
+
+static QString jsonString(const QString &str)
+{
+  QString result;
+  result.reserve(str.length() + 2);
+  result.append('"');
+  for (int i = 0; i < str.length(); i++)
+  {
+    QChar c = str.at(i);
+    if (c == '"' || c == '\\')
+      result.append('\\').append(c);
+    else if (c == '\n')
+      result.append("\\n");
+    else if (c == '\t')
+      result.append("\\t");
+    else if (c.unicode() < 0x20)
+      result.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+    else
+      result.append(c);
+  }
+  result.append('"');
+  return result;
+}
+
+/** Start recording spans, to be written to filename. Calling start() while
+    tracing is already on only changes the file name.
+ */
+void XtTrace::start(const QString &filename)
+{
+  QMutexLocker locker(&_mutex);
+  _filename = filename;
+  if (isEnabled())
+    return;
+
+  _events.clear();
+  _events.reserve(4096);
+  _dropped = 0;
+  _clock.start();
+  _enabled.storeRelease(1);
+
+  if (! _postRoutineAdded)
+  {
+    qAddPostRoutine(writeTraceOnExit);
+    _postRoutineAdded = true;
+  }
+  if (DEBUG) qDebug() << "XtTrace::start()" << filename;
+}
+
+/** Stop recording and write what was recorded.
+    @return false if the trace file could not be written
+ */
+bool XtTrace::stop()
+{
+  QMutexLocker locker(&_mutex);
+  if (! isEnabled())
+    return true;
+  _enabled.storeRelease(0);
+
+  QFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+  {
+    qWarning() << "Could not write trace file" << _filename << file.errorString();
+    return false;
+  }
+
+  qint64 pid = QCoreApplication::applicationPid();
+  QTextStream out(&file);
+  out.setCodec("UTF-8");
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  for (int i = 0; i < _events.size(); i++)
+  {
+    const XtTraceEvent &e = _events.at(i);
+    out << (i ? ",\n" : "")
+        << "{\"name\":"  << jsonString(QString::fromLatin1(e.name))
+        << ",\"cat\":"   << jsonString(QString::fromLatin1(e.category))
+        << ",\"ph\":\"X\",\"ts\":" << e.start
+        << ",\"dur\":"   << e.duration
+        << ",\"pid\":"   << pid
+        << ",\"tid\":"   << e.thread
+        << ",\"args\":{\"depth\":" << e.depth;
+    if (! e.detail.isEmpty())
+      out << ",\"detail\":" << jsonString(e.detail);
+    out << "}}";
+  }
+  out << "\n],\"otherData\":{\"dropped\":" << _dropped << "}}\n";
+  out.flush();
+
+  if (DEBUG)
+    qDebug() << "XtTrace::stop() wrote" << _events.size() << "events to" << _filename;
+  _events.clear();
+  return file.error() == QFile::NoError;
+}
+
+QString XtTrace::filename()
+{
+  QMutexLocker locker(&_mutex);
+  return _filename;
+}
+
+qint64 XtTrace::now()
+{
+  return _clock.nsecsElapsed() / 1000;
+}
+
+void XtTrace::record(const char *name, const char *category,
+                     const QString &detail, qint64 start, qint64 end,
+                     int depth)
+{
+  XtTraceEvent e;
+  e.name     = name;
+  e.category = category;
+  e.detail   = detail;
+  e.start    = start;
+  e.duration = end - start;
+  e.thread   = reinterpret_cast<quintptr>(QThread::currentThreadId());
+  e.depth    = depth;
+
+  QMutexLocker locker(&_mutex);
+  if (! isEnabled())
+    return;
+  if (_events.size() < MAXEVENTS)
+    _events.append(e);
+  else
+    _dropped++;
+}
+
+XtTraceSpan::XtTraceSpan(const char *name, const char *category,
+                         const QString &detail)
+  : _active(XtTrace::isEnabled()),
+    _name(name),
+    _category(category),
+    _start(0),
+    _depth(0)
+{
+  if (_active)
+  {
+    _detail = detail;
+    begin();
+  }
+}
+
+XtTraceSpan::XtTraceSpan(const char *name, const char *category,
+                         const QObject *detail)
+  : _active(XtTrace::isEnabled()),
+    _name(name),
+    _category(category),
+    _start(0),
+    _depth(0)
+{
+  if (_active)
+  {
+    if (detail)
+      _detail = detail->objectName();
+    begin();
+  }
+}
+
+XtTraceSpan::XtTraceSpan(const char *name, const char *category,
+                         qint64 detail)
+  : _active(XtTrace::isEnabled()),
+    _name(name),
+    _category(category),
+    _start(0),
+    _depth(0)
+{
+  if (_active)
+  {
+    _detail = QString::number(detail);
+    begin();
+  }
+}
+
+void XtTraceSpan::begin()
+{
+  _depth = _threadDepth.localData();
+  _threadDepth.setLocalData(_depth + 1);
+  _start = XtTrace::now();
+}
+
+XtTraceSpan::~XtTraceSpan()
+{
+  if (_active)
+  {
+    _threadDepth.setLocalData(_depth);
+    XtTrace::record(_name, _category, _detail, _start, XtTrace::now(), _depth);
+  }
+}
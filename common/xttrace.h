@@ -0,0 +1,90 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTTRACE_H
+#define XTTRACE_H
+
+#include <QAtomicInt>
+#include <QString>
+
+class QObject;
+
+/** @class XtTrace
+
+    @brief Records timed, nested spans and writes them as a Chrome
+           trace-event JSON file.
+
+    Tracing is off unless the client was started with @c -trace=filename
+    or the @c TraceWindows user preference is set. While it is off, an
+    XtTraceSpan costs one atomic load; pass the detail as an object or a
+    number rather than a QString built at the call site so that nothing
+    is formatted unless the span is recorded.
+
+    The file is written when the application exits or stop() is called.
+    Load it in chrome://tracing or any other viewer that reads the
+    trace-event format.
+
+    @see XtTraceSpan
+ */
+class XtTrace
+{
+  public:
+    static void start(const QString &filename);
+    static bool stop();
+    static bool isEnabled() { return _enabled.loadAcquire() != 0; }
+    static QString filename();
+
+  private:
+    friend class XtTraceSpan;
+
+    static void record(const char *name, const char *category,
+                       const QString &detail, qint64 start, qint64 end,
+                       int depth);
+    static qint64 now();
+
+    static QAtomicInt _enabled;
+};
+
+/** @class XtTraceSpan
+
+    @brief Times the enclosing scope as one span in the trace.
+
+    @code
+    XtTraceSpan span("loadScriptEngine", "script", this);
+    @endcode
+
+    The name and category must be string literals, or at least outlive the
+    trace. The detail shows up as an argument of the span; the object and
+    number forms only look up the object name or format the number while
+    tracing is on.
+ */
+class XtTraceSpan
+{
+  public:
+    XtTraceSpan(const char *name, const char *category = "window",
+                const QString &detail = QString());
+    XtTraceSpan(const char *name, const char *category, const QObject *detail);
+    XtTraceSpan(const char *name, const char *category, qint64 detail);
+    ~XtTraceSpan();
+
+  private:
+    Q_DISABLE_COPY(XtTraceSpan)
+
+    void begin();
+
+    bool        _active;
+    const char *_name;
+    const char *_category;
+    QString     _detail;
+    qint64      _start;
+    int         _depth;
+};
+
+#endif
@@ -25,72 +25,33 @@ apWorkBench::apWorkBench(QWidget* parent, const char* name, Qt::WindowFlags fl)
 {
   setupUi(this);
 
-  QWidget *hideme = 0;
-
-  _vouchers = new openVouchers(this, "openVouchers", Qt::Widget);
-  _vouchersTab->layout()->addWidget(_vouchers);
-  hideme = _vouchers->findChild<QWidget*>("_close");
-  if (hideme)
-    hideme->hide();
-  _vouchers->show();
-  _vendorgroup->synchronize((VendorGroup*)(_vouchers->findChild<QWidget*>("_vendorgroup")));
-
-  _payables = new selectPayments(this, "selectPayments", Qt::Widget, false);
-  _payablesTab->layout()->addWidget(_payables);
-  hideme = _payables->findChild<QWidget*>("_close");
-  if (hideme)
-    hideme->hide();
-  _payables->show();
-  _vendorgroup->synchronize((VendorGroup*)(_payables->findChild<QWidget*>("_vendorgroup")));
-
-  _credits = new unappliedAPCreditMemos(this, "creditMemos", Qt::Widget);
-  _creditsTab->layout()->addWidget(_credits);
-  hideme = _credits->findChild<QWidget*>("_close");
-  if (hideme)
-    hideme->hide();
-  _credits->show();
-  _vendorgroup->synchronize((VendorGroup*)(_credits->findChild<QWidget*>("_vendorgroup")));
-
-  _selectedPayments = new selectedPayments(this, "selectedPayments", Qt::Widget);
-  _selectionsTab->layout()->addWidget(_selectedPayments);
-  hideme = _selectedPayments->findChild<QWidget*>("_close");
-  if (hideme)
-    hideme->hide();
-  _selectedPayments->show();
-  _vendorgroup->synchronize((VendorGroup*)(_selectedPayments->findChild<QWidget*>("_vendorgroup")));
-
-  QWidget * _checkRun = new viewCheckRun(this, "viewCheckRun", Qt::Widget);
-  _checkRunTab->layout()->addWidget(_checkRun);
-  hideme = _checkRun->findChild<QWidget*>("_close");
-  if (hideme)
-    hideme->hide();
-  _checkRun->setWindowFlags(Qt::Widget);
-  _checkRun->show();
-  _vendorgroup->synchronize((VendorGroup*)(_checkRun->findChild<QWidget*>("_vendorgroup")));
-  if (!_privileges->check("MaintainPayments"))
-    _checkRun->setEnabled(false);
-
+  _checkRun         = 0;
+  _credits          = 0;
+  _history          = 0;
+  _payables         = 0;
+  _selectedPayments = 0;
+  _vouchers         = 0;
+
+  _pages = new WorkbenchPages(this);
+  _pages->addPage(_vouchersTab);
+  _pages->addPage(_payablesTab);
+  _pages->addPage(_creditsTab);
+  _pages->addPage(_selectionsTab);
+  _pages->addPage(_checkRunTab);
   if (_privileges->check("ViewAPOpenItems"))
-  {
-    _history = new dspVendorAPHistory(this, "dspVendorAPHistory", Qt::Widget);
-    _apHistoryTab->layout()->addWidget(_history);
-    _history->setCloseVisible(false);
-    _history->findChild<DateCluster*>("_dates")->setStartNull(tr("Earliest"), omfgThis->startOfTime(), true);
-    _history->findChild<DateCluster*>("_dates")->setEndNull(tr("Latest"),     omfgThis->endOfTime(),   true);
-    _history->show();
-    _vendorgroup->synchronize(_history->findChild<VendorGroup*>("_vend"));
-  }
+    _pages->addPage(_apHistoryTab);
   else
     _apHistoryTab->setEnabled(false);
 
-  connect(_query, SIGNAL(clicked()), _vouchers, SLOT(sFillList()));
-  connect(_query, SIGNAL(clicked()), _payables, SLOT(sFillList()));
-  connect(_query, SIGNAL(clicked()), _credits, SLOT(sFillList()));
-  connect(_query, SIGNAL(clicked()), _selectedPayments, SLOT(sFillList()));
-  connect(_query, SIGNAL(clicked()), _checkRun, SLOT(sFillList()));
-  connect(_query, SIGNAL(clicked()), _history,  SLOT(sFillList()));
+  connect(_pages, SIGNAL(create(QWidget*)),  this, SLOT(sCreatePage(QWidget*)));
+  connect(_pages, SIGNAL(refresh(QWidget*)), this, SLOT(sRefreshPage(QWidget*)));
+  connect(_pages, SIGNAL(created(QWidget*)), this, SIGNAL(pageCreated(QWidget*)));
+  connect(_query,       SIGNAL(clicked()), this, SLOT(sFillList()));
+  connect(_vendorgroup, SIGNAL(updated()), this, SLOT(sFillList()));
 
-  _payables->sFillList();
+  // payables were always filled when the window opened
+  _pages->setStale(_payablesTab);
+  _pages->sCurrentChanged();
 }
 
 apWorkBench::~apWorkBench()
@@ -116,3 +77,122 @@ enum SetResponse apWorkBench::set(const ParameterList & pParams)
   return NoError;
 }
 
+/* Refresh the tab the user can see. The others catch up when shown. */
+void apWorkBench::sFillList()
+{
+  _pages->setStale();
+  _pages->refreshCurrent();
+}
+
+QWidget *apWorkBench::createPage(QWidget *pPage)
+{
+  _pages->ensureCreated(pPage);
+  return pPage;
+}
+
+void apWorkBench::sCreatePage(QWidget *pPage)
+{
+  QWidget *window = 0;
+  QWidget *hideme = 0;
+
+  if (pPage == _vouchersTab)
+    window = _vouchers = new openVouchers(this, "openVouchers", Qt::Widget);
+  else if (pPage == _payablesTab)
+    window = _payables = new selectPayments(this, "selectPayments", Qt::Widget, false);
+  else if (pPage == _creditsTab)
+    window = _credits = new unappliedAPCreditMemos(this, "creditMemos", Qt::Widget);
+  else if (pPage == _selectionsTab)
+    window = _selectedPayments = new selectedPayments(this, "selectedPayments", Qt::Widget);
+  else if (pPage == _checkRunTab)
+  {
+    window = _checkRun = new viewCheckRun(this, "viewCheckRun", Qt::Widget);
+    _checkRun->setWindowFlags(Qt::Widget);
+    if (!_privileges->check("MaintainPayments"))
+      _checkRun->setEnabled(false);
+  }
+  else if (pPage == _apHistoryTab)
+  {
+    window = _history = new dspVendorAPHistory(this, "dspVendorAPHistory", Qt::Widget);
+    _history->setCloseVisible(false);
+    _history->findChild<DateCluster*>("_dates")->setStartNull(tr("Earliest"), omfgThis->startOfTime(), true);
+    _history->findChild<DateCluster*>("_dates")->setEndNull(tr("Latest"),     omfgThis->endOfTime(),   true);
+  }
+
+  if (! window)
+    return;
+
+  pPage->layout()->addWidget(window);
+  hideme = window->findChild<QWidget*>("_close");
+  if (hideme)
+    hideme->hide();
+  window->show();
+
+  VendorGroup *group = vendorGroup(pPage);
+  if (group)
+    group->hide();
+}
+
+/* Bring the page's vendor selection in line with the workbench's. If that
+   changed anything the page has already refilled itself.
+ */
+void apWorkBench::sRefreshPage(QWidget *pPage)
+{
+  VendorGroup *group = vendorGroup(pPage);
+  bool changed = false;
+  if (group)
+  {
+    if (group->state() != _vendorgroup->state())
+    {
+      group->setState(_vendorgroup->state());
+      changed = (pPage != _apHistoryTab);  // history only listens for ids
+    }
+    if (group->vendId() != _vendorgroup->vendId())
+    {
+      group->setVendId(_vendorgroup->vendId());
+      changed = true;
+    }
+    if (group->vendTypeId() != _vendorgroup->vendTypeId())
+    {
+      group->setVendTypeId(_vendorgroup->vendTypeId());
+      changed = true;
+    }
+    if (group->typePattern() != _vendorgroup->typePattern())
+    {
+      group->setTypePattern(_vendorgroup->typePattern());
+      changed = true;
+    }
+  }
+  if (changed)
+    return;
+
+  if (pPage == _vouchersTab)
+    _vouchers->sFillList();
+  else if (pPage == _payablesTab)
+    _payables->sFillList();
+  else if (pPage == _creditsTab)
+    _credits->sFillList();
+  else if (pPage == _selectionsTab)
+    _selectedPayments->sFillList();
+  else if (pPage == _checkRunTab)
+    _checkRun->sFillList();
+  else if (pPage == _apHistoryTab)
+    _history->sFillList();
+}
+
+VendorGroup *apWorkBench::vendorGroup(QWidget *pPage) const
+{
+  if (pPage == _apHistoryTab && _history)
+    return _history->findChild<VendorGroup*>("_vend");
+  else if (pPage == _vouchersTab && _vouchers)
+    return _vouchers->findChild<VendorGroup*>("_vendorgroup");
+  else if (pPage == _payablesTab && _payables)
+    return _payables->findChild<VendorGroup*>("_vendorgroup");
+  else if (pPage == _creditsTab && _credits)
+    return _credits->findChild<VendorGroup*>("_vendorgroup");
+  else if (pPage == _selectionsTab && _selectedPayments)
+    return _selectedPayments->findChild<VendorGroup*>("_vendorgroup");
+  else if (pPage == _checkRunTab && _checkRun)
+    return _checkRun->findChild<VendorGroup*>("_vendorgroup");
+  return 0;
+}
+
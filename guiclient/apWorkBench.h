@@ -28,6 +28,7 @@ class viewCheckRun;
 class dspVendorAPHistory;
 
 #include "vendorgroup.h"
+#include "workbenchPages.h"
 
 class apWorkBench : public XWidget, public Ui::apWorkBench
 {
@@ -39,8 +40,17 @@ class apWorkBench : public XWidget, public Ui::apWorkBench
 
     virtual SetResponse set(const ParameterList & pParams);
 
+  public slots:
+    virtual QWidget *createPage(QWidget *pPage);
+    virtual void sFillList();
+
+  signals:
+    void pageCreated(QWidget *pPage);
+
   protected slots:
     virtual void languageChange();
+    virtual void sCreatePage(QWidget *pPage);
+    virtual void sRefreshPage(QWidget *pPage);
 
   protected:
     viewCheckRun           *_checkRun;
@@ -49,6 +59,10 @@ class apWorkBench : public XWidget, public Ui::apWorkBench
     openVouchers           *_vouchers;
     selectedPayments       *_selectedPayments;
     dspVendorAPHistory     *_history;
+    WorkbenchPages         *_pages;
+
+  private:
+    VendorGroup *vendorGroup(QWidget *pPage) const;
 };
 
 #endif // APWORKBENCH_H
@@ -29,29 +29,17 @@ arWorkBench::arWorkBench(QWidget* parent, const char* name, Qt::WindowFlags fl)
 {
   setupUi(this);
 
-  _aritems = new dspAROpenItems(this, "_aritems", Qt::Widget);
-  _aropenFrame->layout()->addWidget(_aritems);
-  _aritems->setCloseVisible(false);
-  _aritems->findChild<QWidget*>("_customerSelector")->hide();
-  _aritems->queryAction()->setVisible(false);
-  _aritems->findChild<QWidget*>("_asofGroup")->hide();
-  _aritems->findChild<DLineEdit*>("_asOf")->setDate(omfgThis->endOfTime());
-  _aritems->findChild<QWidget*>("_dateGroup")->hide();
-  _aritems->findChild<QWidget*>("_showGroup")->hide();
-  _aritems->findChild<QWidget*>("_printGroup")->hide();
-  _aritems->findChild<QRadioButton*>("_dueDate")->click();
-  
-  _cctrans = new dspCreditCardTransactions(this, "_cctrans", Qt::Widget);
-  _creditCardTab->layout()->addWidget(_cctrans);
-  _cctrans->findChild<QWidget*>("_close")->hide();
-  _cctrans->findChild<QWidget*>("_customerSelector")->hide();
-  _cctrans->findChild<QWidget*>("_query")->hide();
-  _cctrans->findChild<QWidget*>("_alltrans")->hide();
-  _cctrans->findChild<QWidget*>("_pending")->hide();
-  _cctrans->findChild<QWidget*>("_processed")->hide();
-  _cctrans->findChild<XTreeWidget*>("_preauth")->hideColumn("type");
-  _cctrans->findChild<XTreeWidget*>("_preauth")->hideColumn("status");
-  
+  _aritems = 0;
+  _cctrans = 0;
+
+  _pages = new WorkbenchPages(this);
+  _pages->addPage(_receivablesTab);
+  _pages->addPage(_cashRecptTab);
+  _pages->addPage(_creditCardTab);
+  connect(_pages, SIGNAL(create(QWidget*)),  this, SLOT(sCreatePage(QWidget*)));
+  connect(_pages, SIGNAL(refresh(QWidget*)), this, SLOT(sRefreshPage(QWidget*)));
+  connect(_pages, SIGNAL(created(QWidget*)), this, SIGNAL(pageCreated(QWidget*)));
+
   connect(_query, SIGNAL(clicked()), this, SLOT(sFillList()));
   connect(_newCashrcpt, SIGNAL(clicked()), this, SLOT(sNewCashrcpt()));
   connect(_editCashrcpt, SIGNAL(clicked()), this, SLOT(sEditCashrcpt()));
@@ -66,32 +54,6 @@ arWorkBench::arWorkBench(QWidget* parent, const char* name, Qt::WindowFlags fl)
   connect(_customerSelector, SIGNAL(newTypePattern(QString)), this, SLOT(sClear()));
   connect(_customerSelector, SIGNAL(newCustGroupId(int)), this, SLOT(sClear()));
 
-  connect(_customerSelector, SIGNAL(newState(int)), 
-          _aritems->findChild<CustomerSelector*>("_customerSelector"), SLOT(setState(int)));
-  connect(_customerSelector, SIGNAL(newCustId(int)), 
-          _aritems->findChild<CustomerSelector*>("_customerSelector"), SLOT(setCustId(int)));
-  connect(_customerSelector, SIGNAL(newCustTypeId(int)), 
-          _aritems->findChild<CustomerSelector*>("_customerSelector"), SLOT(setCustTypeId(int)));
-  connect(_customerSelector, SIGNAL(newCustGroupId(int)), 
-          _aritems->findChild<CustomerSelector*>("_customerSelector"), SLOT(setCustGroupId(int)));
-  connect(_customerSelector, SIGNAL(newTypePattern(QString)), 
-          _aritems->findChild<CustomerSelector*>("_customerSelector"), SLOT(setTypePattern(QString)));
-  connect(_customerSelector, SIGNAL(newState(int)), 
-          _cctrans->findChild<CustomerSelector*>("_customerSelector"), SLOT(setState(int)));
-  connect(_customerSelector, SIGNAL(newCustId(int)), 
-          _cctrans->findChild<CustomerSelector*>("_customerSelector"), SLOT(setCustId(int)));
-  connect(_customerSelector, SIGNAL(newCustTypeId(int)), 
-          _cctrans->findChild<CustomerSelector*>("_customerSelector"), SLOT(setCustTypeId(int)));
-  connect(_customerSelector, SIGNAL(newCustGroupId(int)), 
-          _cctrans->findChild<CustomerSelector*>("_customerSelector"), SLOT(setCustGroupId(int)));
-  connect(_customerSelector, SIGNAL(newTypePattern(QString)), 
-          _cctrans->findChild<CustomerSelector*>("_customerSelector"), SLOT(setTypePattern(QString)));
-  connect(_debits, SIGNAL(clicked()), 
-          _aritems->findChild<QRadioButton*>("_debits"), SLOT(click()));
-  connect(_credits, SIGNAL(clicked()), 
-          _aritems->findChild<QRadioButton*>("_credits"), SLOT(click()));
-  connect(_both, SIGNAL(clicked()), 
-          _aritems->findChild<QRadioButton*>("_both"), SLOT(click()));
   connect(_searchDocNum, SIGNAL(textChanged(const QString&)), this, SLOT(sSearchDocNumChanged()));
 
   _cashrcpt->addColumn(tr("Cust. #"),       _bigMoneyColumn, Qt::AlignLeft,  true, "cust_number");                                                                
@@ -122,6 +84,8 @@ arWorkBench::arWorkBench(QWidget* parent, const char* name, Qt::WindowFlags fl)
 
   if (!_metrics->boolean("CCAccept") || !_privileges->check("ProcessCreditCards"))
     _tab->removeTab(_tab->indexOf(_creditCardTab));
+
+  _pages->sCurrentChanged();
 }
 
 arWorkBench::~arWorkBench()
@@ -165,38 +129,118 @@ bool arWorkBench::setParams(ParameterList &params)
 }
 
 
+/* Refresh the tab the user can see. The others catch up when shown. */
 void arWorkBench::sFillList()
-{ 
-  if (_selectDate->currentIndex()==0)
+{
+  _pages->setStale();
+  _pages->refreshCurrent();
+}
+
+QWidget *arWorkBench::createPage(QWidget *pPage)
+{
+  _pages->ensureCreated(pPage);
+  return pPage;
+}
+
+void arWorkBench::sCreatePage(QWidget *pPage)
+{
+  if (pPage == _receivablesTab)
   {
-    _aritems->findChild<DateCluster*>("_dates")->setStartNull(tr("Earliest"), omfgThis->startOfTime(), true);
-    _aritems->findChild<DateCluster*>("_dates")->setEndNull(tr("Latest"), omfgThis->endOfTime(), true);
+    _aritems = new dspAROpenItems(this, "_aritems", Qt::Widget);
+    _aropenFrame->layout()->addWidget(_aritems);
+    _aritems->setCloseVisible(false);
+    _aritems->findChild<QWidget*>("_customerSelector")->hide();
+    _aritems->queryAction()->setVisible(false);
+    _aritems->findChild<QWidget*>("_asofGroup")->hide();
+    _aritems->findChild<DLineEdit*>("_asOf")->setDate(omfgThis->endOfTime());
+    _aritems->findChild<QWidget*>("_dateGroup")->hide();
+    _aritems->findChild<QWidget*>("_showGroup")->hide();
+    _aritems->findChild<QWidget*>("_printGroup")->hide();
+    _aritems->findChild<QRadioButton*>("_dueDate")->click();
+
+    connect(_debits, SIGNAL(clicked()),
+            _aritems->findChild<QRadioButton*>("_debits"), SLOT(click()));
+    connect(_credits, SIGNAL(clicked()),
+            _aritems->findChild<QRadioButton*>("_credits"), SLOT(click()));
+    connect(_both, SIGNAL(clicked()),
+            _aritems->findChild<QRadioButton*>("_both"), SLOT(click()));
+    if (_debits->isChecked())
+      _aritems->findChild<QRadioButton*>("_debits")->click();
+    else if (_credits->isChecked())
+      _aritems->findChild<QRadioButton*>("_credits")->click();
+    else if (_both->isChecked())
+      _aritems->findChild<QRadioButton*>("_both")->click();
   }
-  else if (_selectDate->currentIndex()==1)
+  else if (pPage == _creditCardTab)
   {
-    _aritems->findChild<DateCluster*>("_dates")->setStartNull(tr("Earliest"), omfgThis->startOfTime(), true);
-    _aritems->findChild<DateCluster*>("_dates")->setEndDate(_onOrBeforeDate->date());
+    _cctrans = new dspCreditCardTransactions(this, "_cctrans", Qt::Widget);
+    _creditCardTab->layout()->addWidget(_cctrans);
+    _cctrans->findChild<QWidget*>("_close")->hide();
+    _cctrans->findChild<QWidget*>("_customerSelector")->hide();
+    _cctrans->findChild<QWidget*>("_query")->hide();
+    _cctrans->findChild<QWidget*>("_alltrans")->hide();
+    _cctrans->findChild<QWidget*>("_pending")->hide();
+    _cctrans->findChild<QWidget*>("_processed")->hide();
+    _cctrans->findChild<XTreeWidget*>("_preauth")->hideColumn("type");
+    _cctrans->findChild<XTreeWidget*>("_preauth")->hideColumn("status");
   }
-  else
+}
+
+void arWorkBench::sRefreshPage(QWidget *pPage)
+{
+  if (pPage == _receivablesTab)
   {
-    _aritems->findChild<DateCluster*>("_dates")->setStartDate(_startDate->date());
-    _aritems->findChild<DateCluster*>("_dates")->setEndDate(_endDate->date());
-  }
+    syncCustomerSelector(_aritems->findChild<CustomerSelector*>("_customerSelector"));
 
-  _aritems->findChild<XCheckBox*>("_unposted")->setChecked(_unposted->isChecked());
-  
-  _aritems->findChild<QWidget*>("_dateGroup")->hide();
-  _aritems->findChild<QWidget*>("_dateGroup")->hide();
-  _aritems->sFillList();
-  sFillCashrcptList();
-  _cctrans->sFillList();
+    if (_selectDate->currentIndex()==0)
+    {
+      _aritems->findChild<DateCluster*>("_dates")->setStartNull(tr("Earliest"), omfgThis->startOfTime(), true);
+      _aritems->findChild<DateCluster*>("_dates")->setEndNull(tr("Latest"), omfgThis->endOfTime(), true);
+    }
+    else if (_selectDate->currentIndex()==1)
+    {
+      _aritems->findChild<DateCluster*>("_dates")->setStartNull(tr("Earliest"), omfgThis->startOfTime(), true);
+      _aritems->findChild<DateCluster*>("_dates")->setEndDate(_onOrBeforeDate->date());
+    }
+    else
+    {
+      _aritems->findChild<DateCluster*>("_dates")->setStartDate(_startDate->date());
+      _aritems->findChild<DateCluster*>("_dates")->setEndDate(_endDate->date());
+    }
+
+    _aritems->findChild<XCheckBox*>("_unposted")->setChecked(_unposted->isChecked());
+
+    _aritems->findChild<QWidget*>("_dateGroup")->hide();
+    _aritems->sFillList();
+  }
+  else if (pPage == _cashRecptTab)
+    sFillCashrcptList();
+  else if (pPage == _creditCardTab)
+  {
+    syncCustomerSelector(_cctrans->findChild<CustomerSelector*>("_customerSelector"));
+    _cctrans->sFillList();
+  }
 }
 
 void arWorkBench::sClear()
 {
-  _aritems->list()->clear();
+  if (_aritems)
+    _aritems->list()->clear();
   _cashrcpt->clear();
-  _cctrans->findChild<XTreeWidget*>("_preauth")->clear();
+  if (_cctrans)
+    _cctrans->findChild<XTreeWidget*>("_preauth")->clear();
+}
+
+void arWorkBench::syncCustomerSelector(CustomerSelector *pSelector)
+{
+  if (! pSelector)
+    return;
+
+  pSelector->setState(_customerSelector->state());
+  pSelector->setCustId(_customerSelector->custId());
+  pSelector->setCustTypeId(_customerSelector->custTypeId());
+  pSelector->setCustGroupId(_customerSelector->custGroupId());
+  pSelector->setTypePattern(_customerSelector->typePattern());
 }
 
 void arWorkBench::sFillCashrcptList()
@@ -389,6 +433,9 @@ void arWorkBench::sPopulateCashRcptMenu(QMenu *pMenu)
 
 void arWorkBench::sSearchDocNumChanged()
 {
+  if (! _aritems)
+    return;
+
   XTreeWidget *aropen = _aritems->list();
   QString sub = _searchDocNum->text().trimmed();
   if(sub.isEmpty())
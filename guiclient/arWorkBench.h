@@ -22,6 +22,9 @@
 
 #include "dspAROpenItems.h"
 #include "dspCreditCardTransactions.h"
+#include "workbenchPages.h"
+
+class CustomerSelector;
 
 class arWorkBench : public XWidget, public Ui::arWorkBench
 {
@@ -34,6 +37,7 @@ public:
     virtual SetResponse set( const ParameterList & pParams );
 
 public slots:
+    virtual QWidget *createPage(QWidget *pPage);
     virtual bool setParams(ParameterList &params);
     virtual void sDeleteCashrcpt();
     virtual void sEditCashrcpt();
@@ -45,13 +49,21 @@ public slots:
     virtual void sViewCashrcpt();
     virtual void sClear();
     virtual void sSearchDocNumChanged();
-    
+
+signals:
+    void pageCreated(QWidget *pPage);
+
 protected:
     dspAROpenItems *_aritems;
     dspCreditCardTransactions *_cctrans;
+    WorkbenchPages *_pages;
+
+    void syncCustomerSelector(CustomerSelector *pSelector);
     
 protected slots:
     virtual void languageChange();
+    virtual void sCreatePage(QWidget *pPage);
+    virtual void sRefreshPage(QWidget *pPage);
 
 };
 
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -17,6 +17,7 @@
 #include <QVariant>
 
 #include "createLotSerial.h"
+#include "createLotSerials.h"
 #include "printOptions.h"
 #include "xtsettings.h"
 #include "metasql.h"
@@ -38,6 +39,7 @@ assignLotSerial::assignLotSerial(QWidget* parent, const char* name, bool modal,
   _print = _buttonBox->addButton(tr("Print"), QDialogButtonBox::ActionRole);
 
   connect(_new, SIGNAL(clicked()), this, SLOT(sNew()));
+  connect(_bulk, SIGNAL(clicked()), this, SLOT(sBulk()));
   connect(_delete, SIGNAL(clicked()), this, SLOT(sDelete()));
   connect(_buttonBox, SIGNAL(accepted()), this, SLOT(sAssign()));
   connect(_buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
@@ -163,6 +165,17 @@ void assignLotSerial::sNew()
   }
 }
 
+void assignLotSerial::sBulk()
+{
+  ParameterList params;
+  params.append("itemloc_series", _itemlocSeries);
+  params.append("itemlocdist_id", _itemlocdistid);
+
+  createLotSerials newdlg(this, "", true);
+  if (newdlg.set(params) == NoError && newdlg.exec() != XDialog::Rejected)
+    sFillList();
+}
+
 void assignLotSerial::sDelete()
 {
   XSqlQuery assignDelete;
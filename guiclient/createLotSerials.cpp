@@ -0,0 +1,208 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "createLotSerials.h"
+
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QRegExp>
+#include <QVariant>
+
+#include <parameter.h>
+
+#include "errorReporter.h"
+#include "guiErrorCheck.h"
+#include "inputManager.h"
+#include "lotSerialBatch.h"
+
+#define MAXERRORS 20
+
+createLotSerials::createLotSerials(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
+    : XDialog(parent, name, modal, fl)
+{
+  setupUi(this);
+
+  _batch = new LotSerialBatch(this);
+
+  connect(_assign,         SIGNAL(clicked()),     this, SLOT(sAssign()));
+  connect(_list,           SIGNAL(textChanged()), this, SLOT(sHandleList()));
+  connect(_rangeButton,    SIGNAL(toggled(bool)), this, SLOT(sHandleSource()));
+  connect(_listButton,     SIGNAL(toggled(bool)), this, SLOT(sHandleSource()));
+  connect(_sequenceButton, SIGNAL(toggled(bool)), this, SLOT(sHandleSource()));
+
+  omfgThis->inputManager()->notify(cBCLotSerialNumber, this, this, SLOT(sCatchLotSerialNumber(QString)));
+
+  _item->setReadOnly(true);
+  _qty->setValidator(omfgThis->qtyVal());
+  _qty->setDouble(1.0);
+  _qtyRemaining->setPrecision(omfgThis->qtyVal());
+
+  sHandleList();
+  sHandleSource();
+}
+
+createLotSerials::~createLotSerials()
+{
+  // no need to delete child widgets, Qt does it all for us
+}
+
+void createLotSerials::languageChange()
+{
+  retranslateUi(this);
+}
+
+enum SetResponse createLotSerials::set(const ParameterList &pParams)
+{
+  XDialog::set(pParams);
+  QVariant param;
+  bool     valid;
+  int      itemlocSeries = -1;
+
+  param = pParams.value("itemloc_series", &valid);
+  if (valid)
+    itemlocSeries = param.toInt();
+
+  param = pParams.value("itemlocdist_id", &valid);
+  if (valid)
+  {
+    if (! _batch->setItemlocdist(param.toInt(), itemlocSeries))
+    {
+      ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Lot/Serial Information"),
+                           _batch->lastError(), __FILE__, __LINE__);
+      return UndefinedError;
+    }
+
+    _item->setItemsiteid(_batch->itemsiteId());
+    _qtyRemaining->setDouble(_batch->qtyRemaining());
+    _expiration->setEnabled(_batch->isPerishable());
+    _warranty->setEnabled(_batch->hasWarranty());
+    _sequenceButton->setEnabled(_batch->hasSequence());
+
+    if (_batch->isSerial())
+    {
+      _qty->setDouble(1.0);
+      _qty->setEnabled(false);
+      _sequenceCount->setValue(qRound(_batch->qtyRemaining()));
+    }
+  }
+
+  return NoError;
+}
+
+void createLotSerials::sHandleSource()
+{
+  _from->setEnabled(_rangeButton->isChecked());
+  _to->setEnabled(_rangeButton->isChecked());
+  _list->setEnabled(_listButton->isChecked());
+  _sequenceCount->setEnabled(_sequenceButton->isChecked());
+}
+
+void createLotSerials::sHandleList()
+{
+  int lines = _list->toPlainText().split(QRegExp("[\\r\\n]+"), QString::SkipEmptyParts).size();
+  _listCount->setText(tr("%1 entered").arg(lines));
+}
+
+void createLotSerials::sCatchLotSerialNumber(const QString plotserial)
+{
+  _listButton->setChecked(true);
+  _list->appendPlainText(plotserial);
+}
+
+void createLotSerials::sAssign()
+{
+  QList<GuiErrorCheck> errors;
+  errors<<GuiErrorCheck(_rangeButton->isChecked() &&
+                        (_from->text().trimmed().isEmpty() || _to->text().trimmed().isEmpty()),
+                        _from,
+                        tr("<p>You must enter the first and last Lot/Serial number of the range."))
+        <<GuiErrorCheck(_listButton->isChecked() && _list->toPlainText().trimmed().isEmpty(), _list,
+                        tr("<p>You must enter or scan at least one Lot/Serial number."))
+        <<GuiErrorCheck(_qty->isEnabled() && _qty->toDouble() <= 0.0, _qty,
+                        tr("<p>You must enter a positive value to assign to "
+                           "each Lot/Serial number."))
+        <<GuiErrorCheck((_expiration->isEnabled()) && (!_expiration->isValid()), _expiration,
+                        tr("<p>You must enter an expiration date to these "
+                           "Perishable Lot/Serial numbers."))
+        <<GuiErrorCheck((_warranty->isEnabled()) && (!_warranty->isValid()), _warranty,
+                        tr("<p>You must enter a warranty expiration date for these "
+                           "Lot/Serial numbers."))
+  ;
+
+  if(GuiErrorCheck::reportErrors(this,tr("Cannot Assign Lot/Serial numbers"),errors))
+      return;
+
+  double qty = _qty->toDouble();
+  bool   ok  = true;
+  _batch->clear();
+  if (_rangeButton->isChecked())
+    ok = _batch->appendRange(_from->text(), _to->text(), qty);
+  else if (_listButton->isChecked())
+    _batch->appendList(_list->toPlainText(), qty);
+  else
+    ok = _batch->appendSequence(_sequenceCount->value(), qty);
+  if (! ok)
+  {
+    QMessageBox::critical(this, tr("Cannot Assign Lot/Serial numbers"),
+                          "<p>" + _batch->lastError());
+    return;
+  }
+
+  if (! _batch->validate())
+  {
+    QStringList problems = _batch->errors();
+    int more = problems.size() - MAXERRORS;
+    if (more > 0)
+    {
+      problems = problems.mid(0, MAXERRORS);
+      problems << tr("... and %1 more.").arg(more);
+    }
+    QMessageBox::critical(this, tr("Cannot Assign Lot/Serial numbers"),
+                          "<p>" + problems.join("<br>"));
+    return;
+  }
+
+  int spaces = 0;
+  foreach (QString lotserial, _batch->lotSerials())
+    if (lotserial.contains(QRegExp("\\s")))
+      spaces++;
+  if (spaces > 0 &&
+      QMessageBox::question(this, tr("Lot/Serial Number Contains Spaces"),
+                            tr("<p>%1 of the Lot/Serial Numbers contain spaces. Do "
+                               "you want to save them anyway?").arg(spaces),
+                            QMessageBox::Yes | QMessageBox::No,
+                            QMessageBox::No) == QMessageBox::No)
+    return;
+
+  if (! _batch->existing().isEmpty() &&
+      QMessageBox::question(this, tr("Use Existing?"),
+                            tr("<p>Records for %1 of these lot numbers for this item "
+                               "already exist. Reference the existing lots?")
+                              .arg(_batch->existing().size()),
+                            QMessageBox::Yes | QMessageBox::No,
+                            QMessageBox::Yes) == QMessageBox::No)
+    return;
+
+  QProgressDialog progress(tr("Assigning Lot/Serial numbers..."), tr("Cancel"),
+                           0, _batch->count(), this);
+  progress.setWindowModality(Qt::WindowModal);
+  connect(_batch,    SIGNAL(progress(int, int)), &progress, SLOT(setValue(int)));
+  connect(&progress, SIGNAL(canceled()),         _batch,    SLOT(cancel()));
+
+  if (! _batch->distribute(_expiration->date(), _warranty->date()))
+  {
+    if (! progress.wasCanceled())
+      ErrorReporter::error(QtCriticalMsg, this, tr("Error Saving Lot/Serial Information"),
+                           _batch->lastError(), __FILE__, __LINE__);
+    return;
+  }
+
+  accept();
+}
@@ -0,0 +1,45 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef CREATELOTSERIALS_H
+#define CREATELOTSERIALS_H
+
+#include "guiclient.h"
+#include "xdialog.h"
+#include <parameter.h>
+
+#include "ui_createLotSerials.h"
+
+class LotSerialBatch;
+
+class createLotSerials : public XDialog, public Ui::createLotSerials
+{
+    Q_OBJECT
+
+public:
+    createLotSerials(QWidget* parent = 0, const char* name = 0, bool modal = false, Qt::WindowFlags fl = 0);
+    ~createLotSerials();
+
+public slots:
+    virtual enum SetResponse set(const ParameterList & pParams );
+    virtual void sAssign();
+    virtual void sCatchLotSerialNumber(const QString);
+    virtual void sHandleList();
+    virtual void sHandleSource();
+
+protected slots:
+    virtual void languageChange();
+
+private:
+    LotSerialBatch *_batch;
+
+};
+
+#endif // CREATELOTSERIALS_H
@@ -0,0 +1,337 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "creditcardgateway.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QTimer>
+#include <QUuid>
+#include <QtDebug>
+
+#include "xttrace.h"
+
+#define DEBUG false
+
+#define DEFAULTCONCURRENT 4
+#define DEFAULTRETRIES    2
+#define DEFAULTTIMEOUT    60000
+#define RETRYDELAY        500     // msec, times the number of attempts so far
+
+class CreditCardGateway::Request
+{
+  public:
+    Request()
+      : id(0),
+        attempts(0),
+        reply(0),
+        timer(0),
+        done(false),
+        timedOut(false),
+        error(QNetworkReply::NoError),
+        httpStatus(0)
+    {
+    }
+
+    int                          id;
+    QNetworkRequest              request;
+    QByteArray                   body;
+    int                          attempts;
+    QNetworkReply               *reply;
+    QTimer                      *timer;   // timeout while sent, backoff between attempts
+    bool                         done;
+    bool                         timedOut;
+    QByteArray                   response;
+    QNetworkReply::NetworkError  error;
+    QString                      errorString;
+    int                          httpStatus;
+};
+
+/* Errors where the request never left this machine, so the service
+   can't have acted on it. Anything later, such as a timeout, a closed
+   connection or a 5xx response, may come after the charge went through,
+   and most services (AIM, CyberSource, Paymentech) ignore the
+   Idempotency-Key header, so sending again could charge the card twice.
+ */
+static bool isRetryable(QNetworkReply::NetworkError pError)
+{
+  switch (pError)
+  {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::ProxyConnectionRefusedError:
+      return true;
+    default:
+      break;
+  }
+  return false;
+}
+
+CreditCardGateway *CreditCardGateway::instance()
+{
+  static CreditCardGateway *gateway = 0;
+  if (! gateway)
+    gateway = new CreditCardGateway();
+  return gateway;
+}
+
+CreditCardGateway::CreditCardGateway()
+  : QObject(QCoreApplication::instance()),
+    _active(0),
+    _maxConcurrent(DEFAULTCONCURRENT),
+    _maxRetries(DEFAULTRETRIES),
+    _nextId(0),
+    _timeout(DEFAULTTIMEOUT)
+{
+  _manager = new QNetworkAccessManager(this);
+  connect(_manager, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
+          this,     SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)));
+}
+
+CreditCardGateway::~CreditCardGateway()
+{
+  qDeleteAll(_requests);
+}
+
+int CreditCardGateway::maxConcurrent() const
+{
+  return _maxConcurrent;
+}
+
+void CreditCardGateway::setMaxConcurrent(int pCount)
+{
+  _maxConcurrent = qMax(1, pCount);
+  startNext();
+}
+
+int CreditCardGateway::maxRetries() const
+{
+  return _maxRetries;
+}
+
+void CreditCardGateway::setMaxRetries(int pCount)
+{
+  _maxRetries = qMax(0, pCount);
+}
+
+/** How long to wait for each attempt's answer, in milliseconds. */
+int CreditCardGateway::timeout() const
+{
+  return _timeout;
+}
+
+void CreditCardGateway::setTimeout(int pMsecs)
+{
+  _timeout = qMax(1000, pMsecs);
+}
+
+void CreditCardGateway::setProxy(const QNetworkProxy &pProxy)
+{
+  if (_manager->proxy() != pProxy)
+    _manager->setProxy(pProxy);
+}
+
+/** Counters since the application started: requests posted, attempts
+    sent, retries, timeouts, failed and succeeded, plus the number
+    currently active and waiting.
+ */
+QVariantMap CreditCardGateway::statistics() const
+{
+  QVariantMap result = _stats;
+  result.insert("active",  _active);
+  result.insert("waiting", _waiting.size());
+  return result;
+}
+
+void CreditCardGateway::count(const QString &pCounter)
+{
+  _stats.insert(pCounter, _stats.value(pCounter).toInt() + 1);
+}
+
+/** Queue pRequest to be POSTed with pBody and return its id.
+    pIdempotencyKey is sent with every attempt; a new one is made up if
+    it's empty.
+ */
+int CreditCardGateway::post(const QNetworkRequest &pRequest, const QByteArray &pBody,
+                            const QString &pIdempotencyKey)
+{
+  Request *req = new Request();
+  req->id      = ++_nextId;
+  req->request = pRequest;
+  req->body    = pBody;
+
+  QString key = pIdempotencyKey.isEmpty()
+              ? QUuid::createUuid().toString().mid(1, 36) : pIdempotencyKey;
+  req->request.setRawHeader("Idempotency-Key", key.toLatin1());
+
+  req->timer = new QTimer(this);
+  req->timer->setSingleShot(true);
+  req->timer->setProperty("requestid", req->id);
+  connect(req->timer, SIGNAL(timeout()), this, SLOT(sTimeout()));
+
+  _requests.insert(req->id, req);
+  _waiting.enqueue(req->id);
+  count("posted");
+  startNext();
+  return req->id;
+}
+
+void CreditCardGateway::startNext()
+{
+  while (_active < _maxConcurrent && ! _waiting.isEmpty())
+  {
+    Request *req = _requests.value(_waiting.dequeue());
+    if (req && ! req->done)
+      send(req);
+  }
+}
+
+void CreditCardGateway::send(Request *pRequest)
+{
+  if (DEBUG)
+    qDebug() << "CreditCardGateway::send()" << pRequest->id << pRequest->attempts
+             << pRequest->request.url();
+  pRequest->attempts++;
+  pRequest->timedOut = false;
+  pRequest->reply    = _manager->post(pRequest->request, pRequest->body);
+  pRequest->reply->setProperty("requestid", pRequest->id);
+  connect(pRequest->reply, SIGNAL(finished()), this, SLOT(sReplyFinished()));
+  pRequest->timer->start(_timeout);
+  _active++;
+  count("attempts");
+}
+
+void CreditCardGateway::sReplyFinished()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+  if (! reply)
+    return;
+  reply->deleteLater();
+
+  Request *req = _requests.value(reply->property("requestid").toInt());
+  if (! req || req->reply != reply)
+    return;
+
+  req->timer->stop();
+  req->reply = 0;
+  _active--;
+
+  QNetworkReply::NetworkError error = reply->error();
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (! req->timedOut && isRetryable(error) && req->attempts <= _maxRetries)
+  {
+    if (DEBUG)
+      qDebug() << "CreditCardGateway retrying" << req->id << error << status;
+    count("retries");
+    req->timer->start(RETRYDELAY * req->attempts);
+  }
+  else
+  {
+    req->done        = true;
+    req->error       = error;
+    req->errorString = req->timedOut ? tr("No response within %1 seconds").arg(_timeout / 1000)
+                                     : reply->errorString();
+    req->httpStatus  = status;
+    req->response    = reply->readAll();
+    if (req->timedOut)
+      count("timeouts");
+    count(error == QNetworkReply::NoError ? "succeeded" : "failed");
+    emit finished(req->id);
+  }
+
+  startNext();
+}
+
+/* Either an attempt took too long, so abort it (it fails without another
+   try), or the pause before a retry is over.
+ */
+void CreditCardGateway::sTimeout()
+{
+  Request *req = _requests.value(sender()->property("requestid").toInt());
+  if (! req || req->done)
+    return;
+
+  if (req->reply)
+  {
+    req->timedOut = true;
+    req->reply->abort();
+  }
+  else
+  {
+    _waiting.prepend(req->id);   // keep its place ahead of newer requests
+    startNext();
+  }
+}
+
+/** Run an event loop until request pId is finished.
+    @return false if the request failed
+ */
+bool CreditCardGateway::wait(int pId)
+{
+  XtTraceSpan span("creditCardGateway", "network", pId);
+  while (_requests.contains(pId) && ! isFinished(pId))
+  {
+    QEventLoop loop;
+    connect(this, SIGNAL(finished(int)), &loop, SLOT(quit()));
+    loop.exec();
+  }
+  return _requests.contains(pId) && error(pId) == QNetworkReply::NoError;
+}
+
+/** Forget request pId and its response. Cancels it if it isn't done. */
+void CreditCardGateway::release(int pId)
+{
+  Request *req = _requests.take(pId);
+  if (! req)
+    return;
+  _waiting.removeAll(pId);
+  if (req->reply)
+  {
+    req->reply->disconnect(this);
+    req->reply->abort();
+    req->reply->deleteLater();
+    _active--;
+  }
+  req->timer->deleteLater();
+  delete req;
+  startNext();
+}
+
+bool CreditCardGateway::isFinished(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req && req->done;
+}
+
+QNetworkReply::NetworkError CreditCardGateway::error(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->error : QNetworkReply::UnknownNetworkError;
+}
+
+QString CreditCardGateway::errorString(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->errorString : QString();
+}
+
+int CreditCardGateway::httpStatus(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->httpStatus : 0;
+}
+
+QByteArray CreditCardGateway::response(int pId) const
+{
+  Request *req = _requests.value(pId);
+  return req ? req->response : QByteArray();
+}
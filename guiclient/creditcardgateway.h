@@ -0,0 +1,111 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef CREDITCARDGATEWAY_H
+#define CREDITCARDGATEWAY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QQueue>
+#include <QSslError>
+#include <QString>
+#include <QVariantMap>
+
+class QNetworkAccessManager;
+class QNetworkProxy;
+class QTimer;
+
+/** @class CreditCardGateway
+
+    @brief Sends requests to credit card processing services over
+           connections that are kept open between transactions.
+
+    Every CreditCardProcessor shares one gateway, so consecutive charges
+    to the same service reuse its connection and TLS session instead of
+    paying for a new handshake each time.
+
+    post() queues a request and returns right away. At most
+    maxConcurrent() requests are in flight at once; the rest wait their
+    turn. finished(id) is emitted when a request is done, successfully or
+    not, and wait(id) runs an event loop until then for callers that need
+    the answer before going on.
+
+    A request that gets no answer within timeout() milliseconds is
+    aborted and fails. Only requests that never reached the service
+    (connection or proxy connection refused, host not found) are sent
+    again, up to maxRetries() times. A timeout, a dropped connection or an
+    HTTP error may come after the service charged the card, and most
+    services don't honor the Idempotency-Key header sent with each
+    request, so those are never retried.
+
+    Use it from the GUI thread.
+ */
+class CreditCardGateway : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static CreditCardGateway *instance();
+
+    int   post(const QNetworkRequest &pRequest, const QByteArray &pBody,
+               const QString &pIdempotencyKey = QString());
+    bool  wait(int pId);
+    void  release(int pId);
+
+    bool                        isFinished(int pId)  const;
+    QNetworkReply::NetworkError error(int pId)       const;
+    QString                     errorString(int pId) const;
+    int                         httpStatus(int pId)  const;
+    QByteArray                  response(int pId)    const;
+
+    int   maxConcurrent() const;
+    void  setMaxConcurrent(int pCount);
+    int   maxRetries()    const;
+    void  setMaxRetries(int pCount);
+    int   timeout()       const;
+    void  setTimeout(int pMsecs);
+    void  setProxy(const QNetworkProxy &pProxy);
+
+    QVariantMap statistics() const;
+
+  signals:
+    void finished(int pId);
+    void sslErrors(QNetworkReply *pReply, const QList<QSslError> &pErrors);
+
+  protected slots:
+    void sReplyFinished();
+    void sTimeout();
+
+  private:
+    class Request;
+
+    CreditCardGateway();
+    ~CreditCardGateway();
+
+    void count(const QString &pCounter);
+    void startNext();
+    void send(Request *pRequest);
+
+    QNetworkAccessManager *_manager;
+    QHash<int, Request *>  _requests;
+    QQueue<int>            _waiting;
+    int                    _active;
+    int                    _maxConcurrent;
+    int                    _maxRetries;
+    int                    _nextId;
+    int                    _timeout;
+    QVariantMap            _stats;
+};
+
+#endif
@@ -10,6 +10,7 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QEventLoop>
 #include <QFile>
 #include <QMessageBox>
 #include <QProcess>
@@ -23,6 +24,7 @@
 #include <QSslSocket>
 #include <QSslCertificate>
 #include <QSslConfiguration>
+#include <QSslKey>
 #include <QUrl>
 #include <QBuffer>
 #include <QDebug>
@@ -33,6 +35,7 @@
 #include <openreports.h>
 
 #include "guiclient.h"
+#include "creditcardgateway.h"
 #include "creditcardprocessor.h"
 #include "errorReporter.h"
 #include "storedProcErrorLookup.h"
@@ -45,6 +48,9 @@
 
 #define DEBUG false
 
+// sendViaHTTP() posted the request for a batch and didn't wait for the answer
+#define BATCHDEFERRED -1000
+
 /* TODO: split this into CreditCardProcessor and CreditCardTransaction.
          the _passedAvs and _passedCvv flags are examples of why the
          current structure is problematic. bug 8215 might be another example.
@@ -312,12 +318,15 @@ CreditCardProcessor::CreditCardProcessor()
     _defaultLiveServer("live.creditcardprocessor.com"),
     _defaultTestServer("test.creditcardprocessor.com"),
     _defaultLivePort(0),
-    _defaultTestPort(0),
-#if QT_VERSION >= 0x050000
-    _manager(0)
-#else
-    _http(0)
+    _defaultTestPort(0)
+#if QT_VERSION < 0x050000
+    , _http(0)
 #endif
+    , _batchMode(NoBatch),
+    _batchBusy(false),
+    _batchLoop(0),
+    _batchResults(0),
+    _batchErrors(0)
 {
   if (DEBUG)
     qDebug("CCP:CreditCardProcessor()");
@@ -945,7 +954,8 @@ int CreditCardProcessor::chargePreauthorized(const QString &pcvv, const double p
     return -110;
   }
 
-  if (_metrics->boolean("CCConfirmChargePreauth") &&
+  // a batch asks once for all of its charges
+  if (_batchMode == NoBatch && _metrics->boolean("CCConfirmChargePreauth") &&
       QMessageBox::question(0,
 	      tr("Confirm Post-authorization of Credit Card Purchase"),
               tr("Are you sure that you want to charge a pre-authorized "
@@ -962,7 +972,7 @@ int CreditCardProcessor::chargePreauthorized(const QString &pcvv, const double p
 
   ParameterList dbupdateinfo;
   returnVal = doChargePreauthorized(ccardid, pcvv, pamount, pcurrid, pneworder, preforder, pccpayid, dbupdateinfo);
-  if (returnVal == -71 || returnVal == -18)
+  if (returnVal == -71 || returnVal == -18 || returnVal == BATCHDEFERRED)
     return returnVal;
   else if (returnVal > 0)
     _errorMsg = errorMsg(4).arg(_errorMsg);
@@ -1007,6 +1017,172 @@ int CreditCardProcessor::chargePreauthorized(const QString &pcvv, const double p
   return returnVal;
 }
 
+/** @brief Capture several preauthorizations, each for its full amount.
+
+    Every capture is posted to the service before any answer is waited
+    for, so the requests overlap up to CreditCardGateway::maxConcurrent().
+    Each charge is then finished, and recorded in the database, as the
+    gateway reports its answer with finished(id). Charges that don't go
+    through the gateway, such as with the External processor or when
+    CCUseCurl is set, are handled one at a time while posting.
+
+    @param[in]  pccpayids The ccpay_ids of the preauthorizations to charge
+    @param[out] presults  The result of chargePreauthorized() for each
+                          ccpay_id
+    @param[out] perrors   The error message, if any, for each ccpay_id
+
+    @return The number of charges that failed
+ */
+int CreditCardProcessor::chargePreauthorized(const QList<int> &pccpayids, QHash<int, int> &presults, QHash<int, QString> &perrors)
+{
+  presults.clear();
+  perrors.clear();
+  if (pccpayids.isEmpty())
+    return 0;
+
+  if (_metrics->boolean("CCConfirmChargePreauth") &&
+      QMessageBox::question(0,
+              tr("Confirm Post-authorization of Credit Card Purchase"),
+              tr("Are you sure that you want to charge %n pre-authorized "
+                 "transaction(s)?", 0, pccpayids.size()),
+              QMessageBox::Yes | QMessageBox::No,
+              QMessageBox::Yes) == QMessageBox::No)
+  {
+    foreach (int ccpayid, pccpayids)
+    {
+      presults.insert(ccpayid, -71);
+      perrors.insert(ccpayid, errorMsg(-71));
+    }
+    return pccpayids.size();
+  }
+
+  CreditCardGateway *gateway = CreditCardGateway::instance();
+  connect(gateway, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
+          this,    SLOT(sslErrors(QNetworkReply*, const QList<QSslError> &)));
+  QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
+
+  _batchResults = &presults;
+  _batchErrors  = &perrors;
+  _batchOrder.clear();
+  _batchPending.clear();
+  foreach (int ccpayid, pccpayids)
+  {
+    _batchMode = BatchPosting;
+    _batchRequests.clear();
+    int returnVal = chargeBatched(ccpayid);
+    if (returnVal == BATCHDEFERRED)
+    {
+      _batchOrder.append(ccpayid);
+      _batchPending.insert(ccpayid, _batchRequests);
+    }
+    else
+    {
+      presults.insert(ccpayid, returnVal);
+      perrors.insert(ccpayid, _errorMsg);
+    }
+  }
+  _batchMode = NoBatch;
+  _batchRequests.clear();
+
+  connect(gateway, SIGNAL(finished(int)), this, SLOT(sBatchFinished(int)));
+  sBatchFinished();     // some answers may be in already
+  if (! _batchOrder.isEmpty())
+  {
+    QEventLoop loop;
+    _batchLoop = &loop;
+    loop.exec();
+    _batchLoop = 0;
+  }
+  disconnect(gateway, SIGNAL(finished(int)), this, SLOT(sBatchFinished(int)));
+
+  QApplication::restoreOverrideCursor();
+  disconnect(gateway, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
+             this,    SLOT(sslErrors(QNetworkReply*, const QList<QSslError> &)));
+  _batchResults = 0;
+  _batchErrors  = 0;
+
+  int failed = 0;
+  foreach (int returnVal, presults)
+    if (returnVal < 0)
+      failed++;
+  return failed;
+}
+
+/* Capture preauthorization pccpayid for its full amount. */
+int CreditCardProcessor::chargeBatched(int pccpayid)
+{
+  XSqlQuery ccq;
+  ccq.prepare("SELECT ccpay_amount, ccpay_curr_id, ccpay_order_number"
+              "  FROM ccpay"
+              " WHERE (ccpay_id=:ccpay_id);");
+  ccq.bindValue(":ccpay_id", pccpayid);
+  ccq.exec();
+  if (! ccq.first())
+  {
+    if (ccq.lastError().type() != QSqlError::NoError)
+    {
+      _errorMsg = ccq.lastError().databaseText();
+      return -1;
+    }
+    _errorMsg = errorMsg(-34);
+    return -34;
+  }
+
+  QString neworder = ccq.value("ccpay_order_number").toString();
+  QString reforder = neworder;
+  int     ccpayid  = pccpayid;
+  return chargePreauthorized("-2", ccq.value("ccpay_amount").toDouble(),
+                             ccq.value("ccpay_curr_id").toInt(),
+                             neworder, reforder, ccpayid);
+}
+
+/* Finish every batched charge whose requests have all been answered.
+   Finishing one can send more requests, such as a void after a failed
+   fraud check, and answers that arrive while it waits for those are
+   picked up by this loop rather than by a nested call.
+ */
+void CreditCardProcessor::sBatchFinished(int)
+{
+  if (_batchBusy || ! _batchResults)
+    return;
+  _batchBusy = true;
+
+  CreditCardGateway *gateway = CreditCardGateway::instance();
+  for (int i = 0; i < _batchOrder.size(); )
+  {
+    int  ccpayid  = _batchOrder.at(i);
+    bool answered = true;
+    foreach (int requestid, _batchPending.value(ccpayid))
+      answered = answered && gateway->isFinished(requestid);
+    if (! answered)
+    {
+      i++;
+      continue;
+    }
+
+    _batchOrder.removeAt(i);
+    _batchMode = BatchCollecting;
+    _batchRequests.clear();
+    _batchRequests.append(_batchPending.take(ccpayid));
+    int returnVal = chargeBatched(ccpayid);
+    if (! _batchRequests.isEmpty())
+      qWarning() << "CreditCardProcessor: ccpay" << ccpayid << "left"
+                 << _batchRequests.size() << "answer(s) from the service unread";
+    foreach (int requestid, _batchRequests)
+      gateway->release(requestid);
+    _batchRequests.clear();
+    _batchMode = NoBatch;
+
+    _batchResults->insert(ccpayid, returnVal);
+    _batchErrors->insert(ccpayid, _errorMsg);
+    i = 0;
+  }
+
+  _batchBusy = false;
+  if (_batchOrder.isEmpty() && _batchLoop)
+    _batchLoop->quit();
+}
+
 /** @brief Checks if all accounting related setup and mapping is valid for
            a Credit Card and Currency.
 
@@ -1939,40 +2115,76 @@ int CreditCardProcessor::sendViaHTTP(const QString &prequest,
     }
 
     if(ccurl.scheme().compare("https", Qt::CaseInsensitive) == 0)
-       request.setSslConfiguration(QSslConfiguration::defaultConfiguration());
-
-    _manager = new QNetworkAccessManager(this);
-    connect(_manager, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
-            this,  SLOT(sslErrors(QNetworkReply*, const QList<QSslError> &)));
+    {
+      QSslConfiguration sslconfig = QSslConfiguration::defaultConfiguration();
+      QFile pem(_pemfile);
+      if (! _pemfile.isEmpty() && pem.open(QIODevice::ReadOnly))
+      {
+        QByteArray pemdata = pem.readAll();
+        QList<QSslCertificate> certs = QSslCertificate::fromData(pemdata, QSsl::Pem);
+        QSslKey key(pemdata, QSsl::Rsa, QSsl::Pem);
+        if (! certs.isEmpty())
+          sslconfig.setLocalCertificate(certs.first());
+        if (! key.isNull())
+          sslconfig.setPrivateKey(key);
+      }
+      request.setSslConfiguration(sslconfig);
+    }
 
+    // one gateway for all processors, so the connection stays open between charges
+    CreditCardGateway *gateway = CreditCardGateway::instance();
     if(_metrics->boolean("CCUseProxyServer"))
+      gateway->setProxy(QNetworkProxy(QNetworkProxy::HttpProxy,
+                                      _metrics->value("CCProxyServer"),
+                                      _metrics->value("CCProxyPort").toInt(),
+                                      _metricsenc->value("CCProxyLogin"),
+                                      _metricsenc->value("CCPassword")));
+    else
+      gateway->setProxy(QNetworkProxy(QNetworkProxy::DefaultProxy));
+
+    // a batch posts every charge first and collects the answers later
+    if (_batchMode == BatchPosting)
     {
-      _manager->setProxy(QNetworkProxy(QNetworkProxy::HttpProxy,
-                                       _metrics->value("CCProxyServer"),
-                                       _metrics->value("CCProxyPort").toInt(),
-                                       _metricsenc->value("CCProxyLogin"),
-                                       _metricsenc->value("CCPassword")));
+      _batchRequests.enqueue(gateway->post(request, prequest.toUtf8()));
+      return BATCHDEFERRED;
     }
 
-    QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
-    QNetworkReply *reply;
-    reply =_manager->post(request, prequest.toUtf8());
-
-    if (!waitForHTTP())
+    int requestid;
+    if (_batchMode == BatchCollecting && ! _batchRequests.isEmpty())
     {
-      //TODO? handle waitForHTTP returning false => timeout
+      requestid = _batchRequests.dequeue();
+      gateway->wait(requestid);
+    }
+    else
+    {
+      bool batching = _batchMode != NoBatch;
+      if (! batching)
+      {
+        connect(gateway, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
+                this,    SLOT(sslErrors(QNetworkReply*, const QList<QSslError> &)));
+        QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
+      }
+      requestid = gateway->post(request, prequest.toUtf8());
+      gateway->wait(requestid);
+      if (! batching)
+      {
+        QApplication::restoreOverrideCursor();
+        disconnect(gateway, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
+                   this,    SLOT(sslErrors(QNetworkReply*, const QList<QSslError> &)));
+      }
     }
-    QApplication::restoreOverrideCursor();
 
-    if(reply->error() != QNetworkReply::NoError)
+    if(gateway->error(requestid) != QNetworkReply::NoError)
     {
       _errorMsg = errorMsg(-18)
                         .arg(ccurl.toString())
-                        .arg(reply->error())
-                        .arg(reply->errorString());
+                        .arg(gateway->error(requestid))
+                        .arg(gateway->errorString(requestid));
+      gateway->release(requestid);
       return -18;
     }
-    presponse = reply->readAll();
+    presponse = gateway->response(requestid);
+    gateway->release(requestid);
 #endif
   }
   else
@@ -2096,23 +2308,6 @@ int CreditCardProcessor::sendViaHTTP(const QString &prequest,
   return 0;
 }
 
-/** @brief Wait for the HTTP request sent by _manager to finish.
-           Added for Qt5.
-
-    @todo Add a timeout parameter and return false if it is exceeded.
-  */
-bool CreditCardProcessor::waitForHTTP()
-{
-#if QT_VERSION >= 0x050000
-  QEventLoop loop;
-
-  connect(_manager, SIGNAL(finished(QNetworkReply *)),
-          &loop, SLOT(quit()));
-  loop.exec();
-#endif
-  return true;
-}
-
 /** @brief Insert into or update the ccpay table based on parameters extracted
            from the credit card processing service' response to a transaction
            request.
@@ -12,7 +12,9 @@
 #define CREDITCARDPROCESSOR_H
 
 #include <QHash>
+#include <QList>
 #include <QObject>
+#include <QQueue>
 #include <QString>
 #if QT_VERSION < 0x050000
 #include <QHttp>
@@ -21,6 +23,7 @@
 #endif
 #include <parameter.h>
 
+class QEventLoop;
 class QSslCertificate;
 
 class CreditCardProcessor : public QObject
@@ -62,6 +65,7 @@ class CreditCardProcessor : public QObject
     virtual int authorize(const int pccardid, const QString &pcvv, const double pamount, double ptax, bool ptaxexempt, double pfreight, double pduty, const int pcurrid, QString &pneworder, QString &preforder, int &pccpayid, QString preftype, int &prefid);
     virtual int charge(const int pccardid, const QString &pcvv, const double pamount, const double ptax, const bool ptaxexempt, const double pfreight, const double pduty, const int pcurrid, QString &pneworder, QString &preforder, int &pccpayid, QString preftype, int &prefid);
     virtual int chargePreauthorized(const QString &pcvv, const double pamount, const int pcurrid, QString &pneworder, QString &preforder, int &pccpayid);
+    int         chargePreauthorized(const QList<int> &pccpayids, QHash<int, int> &presults, QHash<int, QString> &perrors);
     virtual int credit(const int pccardid, const QString &pcvv, const double pamount, const double ptax, const bool ptaxexempt, const double pfreight, const double pduty, const int pcurrid, QString &pneworder, QString &preforder, int &pccpayid, QString preftype, int &prefid);
     virtual int reversePreauthorized(const double pamount, const int pcurrid, QString &pneworder, QString &preforder, int &pccpayid, QString preftype, int prefid);
     virtual int voidPrevious(int &);
@@ -110,7 +114,6 @@ class CreditCardProcessor : public QObject
     virtual int     fraudChecks();
     virtual int     sendViaHTTP(const QString&, QString&);
     virtual int     updateCCPay(int &, ParameterList &);
-    virtual bool    waitForHTTP();
 
     QList<FraudCheckResult*> _avsCodes;
     QList<FraudCheckResult*> _cvvCodes;
@@ -131,8 +134,6 @@ class CreditCardProcessor : public QObject
     QString             _pemfile;
     #if QT_VERSION < 0x050000
     QHttp             * _http;
-    #else
-    QNetworkAccessManager *_manager;
     #endif
     QList<QPair<QString, QString> > _extraHeaders;
 
@@ -142,6 +143,21 @@ class CreditCardProcessor : public QObject
     #else
       void sslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
     #endif
+      void sBatchFinished(int pRequestId = 0);
+
+  private:
+    enum BatchMode { NoBatch, BatchPosting, BatchCollecting };
+
+    int chargeBatched(int pccpayid);
+
+    BatchMode                _batchMode;
+    bool                     _batchBusy;
+    QEventLoop              *_batchLoop;
+    QList<int>               _batchOrder;      // ccpay_ids still waiting for answers
+    QHash<int, QList<int> >  _batchPending;    // ccpay_id -> gateway requests
+    QQueue<int>              _batchRequests;   // requests of the charge being handled
+    QHash<int, int>         *_batchResults;
+    QHash<int, QString>     *_batchErrors;
 
 };
 
@@ -15,6 +15,7 @@
 #include <QValidator>
 #include <QVariant>
 
+#include "currratecache.h"
 #include "xcombobox.h"
 #include "guiErrorCheck.h"
 
@@ -219,6 +220,7 @@ void currencyConversion::_sSave()
       return;
   }
 
+  CurrRateCache::instance()->clear();
   done(_curr_rate_id);
 }
 
@@ -22,6 +22,7 @@
 
 #include "currencyConversion.h"
 #include "currency.h"
+#include "currratecache.h"
 #include "datecluster.h"
 #include "xcombobox.h"
 #include "errorReporter.h"
@@ -178,6 +179,7 @@ void currencyConversions::sDelete()
     {
       return;
     }
+    CurrRateCache::instance()->clear();
     sFillList();
 }
 
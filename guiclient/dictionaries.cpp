@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -14,35 +14,67 @@
 #include <QVariant>
 #include <QMessageBox>
 #include <QDesktopServices>
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QNetworkReply>
 #include <QDir>
 #include <QFile>
+#include <QFutureWatcher>
 #include <QTranslator>
+#include <QtConcurrent>
 
 #include <parameter.h>
-#include <gunzip.h>
 #include <tarfile.h>
 
+#include "xtNetworkRequestManager.h"
+
+enum UnpackResult { Unpacked, NoDictionaries, BadArchive };
+
+static QString dataLocation()
+{
+#if QT_VERSION >= 0x050000
+  return QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+  return QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+}
+
+/* Runs on a worker thread so a big archive doesn't freeze the window.
+   Only the files Hunspell reads are unpacked.
+ */
+static int unpackDictionaries(const QString archive, const QString dir)
+{
+  TarReader reader(archive);
+  int count = reader.extractAll(dir, QStringList() << "*.aff" << "*.dic");
+  if(count < 0)
+  {
+    qDebug() << "Error unpacking dictionaries:" << reader.lastError();
+    return BadArchive;
+  }
+  return count > 0 ? Unpacked : NoDictionaries;
+}
+
 dictionaries::dictionaries(QWidget* parent, const char* name, Qt::WindowFlags fl)
   : XWidget(parent, name, fl)
 {
   setupUi(this);
 
   _state = Idle;
-  nwam = new QNetworkAccessManager(this);
-  _nwrep = 0;
+  _request = 0;
+  _unpacking = new QFutureWatcher<int>(this);
 
-  connect(nwam, SIGNAL(finished(QNetworkReply*)), this, SLOT(finished(QNetworkReply*)));
+  xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
+  connect(network, SIGNAL(finished(int)),                        this, SLOT(finished(int)));
+  connect(network, SIGNAL(downloadProgress(int, qint64, qint64)), this, SLOT(downloadProgress(int, qint64, qint64)));
+  connect(_unpacking, SIGNAL(finished()), this, SLOT(sUnpacked()));
   connect(_button, SIGNAL(clicked()), this, SLOT(sAction()));
 
   langext = QLocale().name().toLower();
+  _file.setFileName(dataLocation() + "/spell." + langext + ".tar.gz");
 }
 
 dictionaries::~dictionaries()
 {
-  // no need to delete child widgets, Qt does it all for us
+  if(_request)
+    xtNetworkRequestManager::instance()->release(_request);
+  _unpacking->waitForFinished();
 }
 
 void dictionaries::languageChange()
@@ -50,110 +82,62 @@ void dictionaries::languageChange()
   retranslateUi(this);
 }
 
-void dictionaries::finished(QNetworkReply * nwrep)
+void dictionaries::finished(int request)
 {
-  if(nwrep->header(QNetworkRequest::LocationHeader).isValid())
+  if(request != _request)
+    return;
+
+  xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
+  bool ok = network->error(request) == QNetworkReply::NoError;
+  if(!ok)
+    qDebug() << "Error: " << network->errorString(request);
+  network->release(request);
+  _request = 0;
+  _file.close();
+
+  if(!ok)
+    done(tr("Could not retrieve dictionaries at this time."));
+  else if(_file.size() == 0)
+    done(tr("No dictionary is currently available."));
+  else
   {
-    QNetworkReply * newrep = nwam->get(QNetworkRequest(QUrl(nwrep->header(QNetworkRequest::LocationHeader).toString())));
-    connect(newrep, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(downloadProgress(qint64, qint64)));
-    _nwrep = newrep;
+    _label->setText(tr("Unpacking..."));
+    _progress->setRange(0, 0);
+    _button->setEnabled(false);
+    _unpacking->setFuture(QtConcurrent::run(unpackDictionaries, _file.fileName(), dataLocation()));
   }
-  else
+}
+
+void dictionaries::sUnpacked()
+{
+  switch(_unpacking->result())
   {
-    if(nwrep->error() == QNetworkReply::NoError)
-    {
-      QByteArray ba = nwrep->readAll();
-      if(!ba.isEmpty())
-      {
-        #if QT_VERSION >= 0x050000
-        QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
-        if(!dir.exists())
-          dir.mkpath(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
-        QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/spell." + langext + ".tar.gz");
-        #else
-        QDir dir(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
-        if(!dir.exists())
-           dir.mkpath(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
-        QFile file(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/spell." + langext + ".tar.gz");
-        #endif
-        if(file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-        {
-          file.write(ba);
-          file.close();
-          QByteArray data = gunzipFile(file.fileName());
-          if(!data.isEmpty())
-          {
-            TarFile *_files = new TarFile(data);
-            if(_files->isValid())
-            {
-              bool error = false;
-              QMapIterator<QString, QByteArray> i(_files->_list);
-              while (i.hasNext())
-              {
-                i.next();
-                //cout << i.key() << ": " << i.value() << endl;
-                #if QT_VERSION >= 0x050000
-                QFile ff(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + i.key());
-                #else
-                QFile ff(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/" + i.key());
-                #endif
-                if(ff.open(QIODevice::WriteOnly | QIODevice::Truncate))
-                {
-                  ff.write(i.value());
-                  ff.close();
-                }
-                else
-                {
-                  error = true;
-                }
-              }
-              if(error)
-              {
-                _label->setText(tr("Could not save one or more files."));
-              }
-              else
-              {
-                _label->setText(tr("Dictionaries downloaded."));
-              }
-            }
-            else
-            {
-              _label->setText(tr("Could not read archive format."));
-            }
-            delete _files;
-          }
-          else
-          {
-            _label->setText(tr("Could not uncompress file."));
-          }
-        }
-        else
-        {
-          _label->setText(tr("Could not save file."));
-        }
-      }
-      else
-      {
-        _label->setText(tr("No dictionary is currently available."));
-      }
-    }
-    else
-    {
-      qDebug() << "Error: " << nwrep->error();
-      _label->setText(tr("Could not retrieve dictionaries at this time."));
-    }
-    _progress->setRange(0, 100);
-    _progress->setValue(100);
-    _button->setText(tr("Start"));
-    _state = Idle;
+    case Unpacked:
+      done(tr("Dictionaries downloaded."));
+      break;
+    case NoDictionaries:
+      done(tr("No dictionary is currently available."));
+      break;
+    default:
+      done(tr("Could not read archive format."));
+      break;
   }
-  if(nwrep == _nwrep)
-    _nwrep = 0;
-  nwrep->deleteLater();
 }
 
-void dictionaries::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+void dictionaries::done(const QString &message)
 {
+  _label->setText(message);
+  _progress->setRange(0, 100);
+  _progress->setValue(100);
+  _button->setText(tr("Start"));
+  _button->setEnabled(true);
+  _state = Idle;
+}
+
+void dictionaries::downloadProgress(int request, qint64 bytesReceived, qint64 bytesTotal)
+{
+  if(request != _request)
+    return;
   if(bytesTotal == -1)
     bytesTotal = 5000000; // chose some number that is reasonable
   _progress->setRange(0, bytesTotal);
@@ -164,22 +148,28 @@ void dictionaries::sAction()
 {
   if(_state == Busy)
   {
-    if(_nwrep)
+    if(_request)
     {
-      _nwrep->abort();
-      _nwrep->deleteLater();
-      _nwrep = 0;
+      xtNetworkRequestManager::instance()->release(_request);
+      _request = 0;
+      _file.close();
     }
     _button->setText(tr("Start"));
     _state = Idle;
   }
   else
   {
-    _nwrep = nwam->get(QNetworkRequest(QUrl("http://www.xtuple.org/xttranslate/guiexport/spell/" + langext + "/current")));
-    connect(_nwrep, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(downloadProgress(qint64, qint64)));
+    QDir().mkpath(dataLocation());
+    if(!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+      _label->setText(tr("Could not save file."));
+      return;
+    }
+    // written to the file as it arrives rather than held in memory
+    _request = xtNetworkRequestManager::instance()->get(QUrl("http://www.xtuple.org/xttranslate/guiexport/spell/" + langext + "/current"),
+                                                        xtNetworkRequestManager::UseCache, &_file);
     _label->setText(tr("Downloading..."));
     _button->setText(tr("Cancel"));
     _state = Busy;
   }
 }
-
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -11,13 +11,14 @@
 #ifndef DICTIONARIES_H
 #define DICTIONARIES_H
 
+#include <QFile>
+
 #include "guiclient.h"
 #include "xwidget.h"
 
 #include "ui_dictionaries.h"
 
-class QNetworkAccessManager;
-class QNetworkReply;
+template <class T> class QFutureWatcher;
 
 class dictionaries : public XWidget, public Ui::dictionaries
 {
@@ -36,14 +37,18 @@ public slots:
 
 protected slots:
     virtual void languageChange();
-    virtual void finished(QNetworkReply*);
-    virtual void downloadProgress(qint64, qint64);
+    virtual void finished(int);
+    virtual void downloadProgress(int, qint64, qint64);
+    virtual void sUnpacked();
 
 private:
+    void done(const QString &message);
+
     QString langext;
     State _state;
-    QNetworkAccessManager * nwam;
-    QNetworkReply * _nwrep;
+    int _request;
+    QFile _file;
+    QFutureWatcher<int> *_unpacking;
 };
 
 #endif // DICTIONARIES_H
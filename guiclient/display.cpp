@@ -12,12 +12,19 @@
 #include "display.h"
 #include "ui_display.h"
 
+#include <QLabel>
 #include <QSqlError>
+#include <QSqlRecord>
 #include <QMessageBox>
 #include <QPrinter>
 #include <QPrintDialog>
+#include <QScrollBar>
 #include <QShortcut>
+#include <QTimer>
 #include <QToolButton>
+#include <QtDebug>
+
+#include <limits>
 
 #include <metasql.h>
 #include <metasql.h>
@@ -30,13 +37,22 @@
 #include "parameterlistsetup.h"
 #include "errorReporter.h"
 #include "displayprivate.h"
+#include "xreadreplica.h"
+#include "xsqlprofiler.h"
+#include "xttrace.h"
 
 displayPrivate::displayPrivate(::display *parent)
     : QObject(parent),
       _useAltId(false),
+      _useReadReplica(false),
       _queryOnStartEnabled(false),
       _autoUpdateEnabled(false),
       _filterChanged(false),
+      _pageSize(0),
+      _pageMore(false),
+      _pageFetching(false),
+      _pageRows(0),
+      _pageLabel(0),
       _parent(parent)
 {
   setupUi(_parent);
@@ -48,6 +64,15 @@ displayPrivate::displayPrivate(::display *parent)
   _searchLit->hide();
   _listLabelFrame->setVisible(false);
 
+  _pageLabel = new QLabel(_parent);
+  _pageLabel->setObjectName("_pageLabel");
+  _pageLabel->setVisible(false);
+  _labelLayout->addWidget(_pageLabel);
+  connect(_list->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(sPageScrolled(int)));
+  connect(_list, SIGNAL(populated()), this, SLOT(sPagePopulated()));
+  connect(_list, SIGNAL(resorted()),  this, SLOT(sPageResorted()));
+  connect(_list, SIGNAL(aboutToExport()), this, SLOT(sPageFetchAll()));
+
   // Build Toolbar even if we hide it so we get actions
   _newBtn = new QToolButton(_toolBar);
   _newBtn->setObjectName("_newBtn");
@@ -142,6 +167,396 @@ void displayPrivate::sFilterChanged()
   _filterChanged = true;
 }
 
+void displayPrivate::bindCharacteristics(XSqlQuery &pQuery, const ParameterList &pParams)
+{
+  QString column;
+  QVariant param;
+  bool valid;
+
+  foreach (QVariant columnid, _charidstext)
+  {
+    column = QString("char%1").arg(columnid.toString());
+    param = pParams.value(column, &valid);
+    if (valid)
+      pQuery.bindValue(QString(":%1").arg(column), param.toString());
+  }
+
+  foreach (QVariant columnid, _charidslist)
+  {
+    column = QString("char%1").arg(columnid.toString());
+    param = pParams.value(column, &valid);
+    if (valid)
+    {
+      QStringList list = param.toStringList();
+      for (int j = 0; j < list.count(); j++)
+        pQuery.bindValue(QString(":%1_%2").arg(column).arg(j), list.at(j));
+    }
+  }
+
+  foreach (QVariant columnid, _charidsdate)
+  {
+    // Look for start date
+    column = QString("char%1startDate").arg(columnid.toString());
+    param = pParams.value(column, &valid);
+    if (valid)
+      pQuery.bindValue(QString(":%1").arg(column), param.toString());
+
+    // Look for end date
+    column = QString("char%1endDate").arg(columnid.toString());
+    param = pParams.value(column, &valid);
+    if (valid)
+      pQuery.bindValue(QString(":%1").arg(column), param.toString());
+  }
+}
+
+/* The single statement in a display's MetaSQL without its trailing
+   semicolon, or an empty string if there's more than one statement.
+ */
+static QString singleStatement(const QString &pSource)
+{
+  QString inner = pSource.trimmed();
+  inner.remove(QRegExp(";\\s*$"));
+  if (inner.contains(';'))
+    return QString();
+  return inner;
+}
+
+/* FETCH FIRST ... WITH TIES came in PostgreSQL 13. Older servers get
+   LIMIT, which can split rows that tie on every sort column and the id.
+ */
+static bool supportsWithTies(const QSqlDatabase &pDb)
+{
+  static int ties = -1;
+  if (ties < 0)
+  {
+    XSqlQuery version(pDb);
+    version.exec("SELECT current_setting('server_version_num')::integer >= 130000 AS ties;");
+    if (! version.first())
+      return false;
+    ties = version.value("ties").toBool() ? 1 : 0;
+  }
+  return ties == 1;
+}
+
+/* Keys can only be compared as one row value if every sort column goes
+   the same way; otherwise the next page is found with OFFSET.
+ */
+bool displayPrivate::pageByKey() const
+{
+  if (_pageColumns.isEmpty())
+    return false;
+  foreach (Qt::SortOrder order, _pageOrders)
+    if (order != _pageOrders.first())
+      return false;
+  return true;
+}
+
+/* Wrap a display's MetaSQL so it returns xtpagesize rows at a time.
+
+   With sort columns the rows come back in _pageColumns order with the
+   first column (the id) as a tie breaker. When the sort columns all go
+   the same way, the xtpagekeyN values of the last row fetched select the
+   rows after it with a single row-value comparison, which an index on
+   the sort columns can serve. NULLs sort as PostgreSQL indexes put them,
+   last going up and first going down, so rows with a NULL after the
+   first column that differs still follow the key. Otherwise, and when
+   the last row has a NULL key, the next page starts at xtpageoffset.
+
+   A page ends with every row that ties with its last one, so no row is
+   left between pages even if the id isn't unique.
+
+   Returns an empty string if the query isn't a single statement.
+ */
+QString displayPrivate::pagedSource(const QString &pSource, bool pTies) const
+{
+  QString inner = singleStatement(pSource);
+  if (inner.isEmpty())
+    return QString();
+
+  QString offset = "<? if exists(\"xtpageoffset\") ?>"
+                   " OFFSET <? value(\"xtpageoffset\") ?> ROWS"
+                   "<? endif ?>";
+
+  if (_pageColumns.isEmpty())
+    return "SELECT * FROM (\n" + inner + "\n) AS xtpage\n" +
+           offset + " LIMIT <? value(\"xtpagesize\") ?>;";
+
+  QStringList columns = _pageColumns;
+  columns.append(_pageIdColumn);
+  bool desc = _pageOrders.first() == Qt::DescendingOrder;
+
+  QStringList cols;
+  QStringList keys;
+  QStringList orderBy;
+  QStringList after;
+  for (int i = 0; i < columns.size(); i++)
+  {
+    Qt::SortOrder order = i < _pageOrders.size() ? _pageOrders.at(i)
+                                                 : _pageOrders.first();
+    QString col = QString("xtpage.\"%1\"").arg(columns.at(i));
+    orderBy.append(col + (order == Qt::DescendingOrder ? " DESC" : ""));
+
+    // a NULL in column i sorts after a key that matches up to there going
+    // up, and before it going down
+    if (i == 0 && ! desc)
+      after.append(col + " IS NULL");
+    else if (i > 0)
+      after.append(QString("(%1 IS NULL AND (%2) %3 (%4))")
+                     .arg(col, cols.join(", "), desc ? "<" : ">=", keys.join(", ")));
+
+    cols.append(col);
+    keys.append(QString("<? value(\"xtpagekey%1\") ?>").arg(i));
+  }
+  after.prepend(QString("(%1) %2 (%3)").arg(cols.join(", "), desc ? "<" : ">",
+                                            keys.join(", ")));
+
+  return "SELECT * FROM (\n" + inner + "\n) AS xtpage\n"
+         "<? if exists(\"xtpagekey0\") ?>"
+         " WHERE " + after.join("\n    OR ") + "\n"
+         "<? endif ?>"
+         " ORDER BY " + orderBy.join(", ") + "\n" + offset +
+         (pTies ? " FETCH FIRST <? value(\"xtpagesize\") ?> ROWS WITH TIES;"
+                : " LIMIT <? value(\"xtpagesize\") ?>;");
+}
+
+/* Ask the database once for the totals of every xttotalrole column over
+   the whole query. fetchPage() takes each page's rows off these, so what
+   is left seeds the list's totals with the rows not fetched yet.
+ */
+bool displayPrivate::loadPageTotals(const QString &pInner, const QSqlDatabase &pDb)
+{
+  _pageTotals.clear();
+
+  QStringList selects;
+  for (int col = 0; col < _list->columnCount(); col++)
+  {
+    if (_list->headerItem()->data(col, Qt::UserRole).toString() != "xttotalrole")
+      continue;
+    QString name = _list->column(col);
+    if (name.isEmpty())
+      return false;
+    selects.append(QString("SELECT %1 AS xtcol, \"%2_xttotalrole\" AS xtset,"
+                           " sum(\"%2\") AS xttotal FROM xtpage GROUP BY 2")
+                     .arg(col).arg(name));
+  }
+  if (selects.isEmpty())
+    return true;
+
+  MetaSQLQuery mql("WITH xtpage AS (\n" + pInner + "\n)\n" +
+                   selects.join("\nUNION ALL ") + ";");
+  XSqlQuery totalq = mql.toQuery(_pageParams, pDb, false);
+  bindCharacteristics(totalq, _pageParams);
+  totalq.exec();
+  if (totalq.lastError().type() != QSqlError::NoError)
+  {
+    qWarning() << "Could not total" << _parent->objectName()
+               << totalq.lastError().text();
+    return false;
+  }
+  while (totalq.next())
+    _pageTotals[totalq.value("xtcol").toInt()][totalq.value("xtset").toInt()]
+      += totalq.value("xttotal").toDouble();
+  return true;
+}
+
+/* Fetch the first or the next page of the list. Returns false if the
+   display's query can't be paged, in which case the caller should load
+   the whole list the usual way.
+ */
+bool displayPrivate::fetchPage(bool pFirst, int pItemId)
+{
+  if (pFirst)
+  {
+    _pageRows     = 0;
+    _pageMore     = false;
+    _pageIdColumn.clear();
+    _pageKey.clear();
+    _pageColumns.clear();
+    _pageOrders.clear();
+    _pageTotals.clear();
+    _pageSort = _list->sortColumnOrder();
+
+    QPair<int, Qt::SortOrder> sort;
+    foreach (sort, _pageSort)
+    {
+      if (_list->headerItem()->data(sort.first, Qt::UserRole).toString() == "xtrunningrole")
+        continue;
+      QString name = _list->column(sort.first);
+      if (! name.isEmpty())
+      {
+        _pageColumns.append(name);
+        _pageOrders.append(sort.second);
+      }
+    }
+  }
+
+  QString mqltext = omfgThis->_mqlhash->value(metasqlGroup, metasqlName);
+  QSqlDatabase db = _useReadReplica ? XReadReplica::database() : QSqlDatabase();
+
+  // the id column breaks ties in the sort, so get its name before the first page
+  if (pFirst && ! _pageColumns.isEmpty())
+  {
+    QString inner = singleStatement(mqltext);
+    if (inner.isEmpty())
+      return false;
+    MetaSQLQuery probemql("SELECT * FROM (\n" + inner + "\n) AS xtpage LIMIT 0;");
+    XSqlQuery probe = probemql.toQuery(_pageParams, db, false);
+    bindCharacteristics(probe, _pageParams);
+    probe.exec();
+    if (probe.lastError().type() != QSqlError::NoError || probe.record().isEmpty())
+    {
+      qWarning() << "Turning off paging for" << _parent->objectName()
+                 << probe.lastError().text();
+      _pageSize = 0;
+      _pageLabel->setVisible(false);
+      return false;
+    }
+    _pageIdColumn = probe.record().fieldName(0);
+  }
+
+  QString source = pagedSource(mqltext, supportsWithTies(db.isValid() ? db
+                                                          : QSqlDatabase::database()));
+  if (source.isEmpty())
+    return false;
+
+  bool byKey = pageByKey();
+  foreach (QVariant key, _pageKey)
+    byKey &= ! key.isNull();
+
+  ParameterList params = _pageParams;
+  params.append("xtpagesize", _pageSize);
+  if (! pFirst && byKey)
+  {
+    for (int i = 0; i < _pageKey.size(); i++)
+      params.append(QString("xtpagekey%1").arg(i), _pageKey.at(i));
+  }
+  else if (! pFirst)
+    params.append("xtpageoffset", _pageRows);
+
+  MetaSQLQuery mql(source);
+  XSqlQuery xq = mql.toQuery(params, db, false);
+  bindCharacteristics(xq, _pageParams);
+
+  XSqlProfiler timing(metasqlGroup, metasqlName, _parent->objectName());
+  xq.exec();
+  timing.finish(xq);
+  if (xq.lastError().type() != QSqlError::NoError)
+  {
+    if (pFirst)
+    {
+      qWarning() << "Turning off paging for" << _parent->objectName()
+                 << xq.lastError().text();
+      _pageSize = 0;
+      _pageLabel->setVisible(false);
+      return false;
+    }
+    // stop here so scrolling doesn't retry and report the error again
+    _pageMore = false;
+    updatePageLabel();
+    ErrorReporter::error(QtCriticalMsg, _parent, ::display::tr("Error Retrieving Information"),
+                         xq, __FILE__, __LINE__);
+    return true;
+  }
+
+  int rows = xq.size();
+  _pageMore  = rows >= _pageSize;
+  _pageRows += rows;
+  if (xq.last() && ! _pageColumns.isEmpty())
+  {
+    _pageKey.clear();
+    foreach (QString column, _pageColumns)
+      _pageKey.append(xq.value(column));
+    _pageKey.append(xq.value(_pageIdColumn));
+  }
+
+  // pages are small, so add them in one go rather than in timed chunks
+  bool linear = _list->populateLinear();
+  _list->setPopulateLinear(true);
+  _pageFetching = true;
+  _list->populate(xq, pItemId, _useAltId,
+                  pFirst ? XTreeWidget::Replace : XTreeWidget::Append);
+  _list->setPopulateLinear(linear);
+
+  // the total columns are only known once the first page is in the list
+  if (pFirst && _pageMore &&
+      ! loadPageTotals(singleStatement(mqltext), db.isValid() ? db : QSqlDatabase::database()))
+  {
+    sPageFetchAll();
+    return true;
+  }
+
+  if (! _pageTotals.isEmpty())
+  {
+    QMutableMapIterator<int, QMap<int, double> > total(_pageTotals);
+    while (total.hasNext())
+    {
+      total.next();
+      QString name = _list->column(total.key());
+      xq.seek(-1);
+      while (xq.next())
+        total.value()[xq.value(name + "_xttotalrole").toInt()] -= xq.value(name).toDouble();
+    }
+    if (! _pageMore)
+      _pageTotals.clear();
+    _list->setTotalSeeds(_pageTotals);
+  }
+  return true;
+}
+
+/* Fetch every row that hasn't been fetched yet, for example before the
+   list is exported.
+ */
+void displayPrivate::sPageFetchAll()
+{
+  if (_pageSize <= 0 || ! _pageMore)
+    return;
+
+  int pageSize = _pageSize;
+  _pageSize = std::numeric_limits<int>::max();
+  fetchPage(false);
+  _pageSize = pageSize;
+  updatePageLabel();
+}
+
+void displayPrivate::sPageScrolled(int)
+{
+  QScrollBar *bar = _list->verticalScrollBar();
+  if (_pageSize > 0 && _pageMore && ! _pageFetching &&
+      bar->value() >= bar->maximum() - bar->pageStep())
+    fetchPage(false);
+}
+
+void displayPrivate::sPagePopulated()
+{
+  if (! _pageFetching)
+    return;
+  _pageFetching = false;
+  updatePageLabel();
+
+  // keep fetching until there's something to scroll
+  if (_pageMore)
+    QTimer::singleShot(0, this, SLOT(sPageScrolled()));
+}
+
+/* Rows that haven't been fetched can't be sorted locally,
+   so sorting a partly-loaded list starts over from the first page.
+ */
+void displayPrivate::sPageResorted()
+{
+  if (_pageSize > 0 && _pageMore && ! _pageFetching &&
+      _list->sortColumnOrder() != _pageSort)
+    fetchPage(true, _list->id());
+}
+
+void displayPrivate::updatePageLabel()
+{
+  if (! _pageMore)
+    _pageLabel->setText(::display::tr("%1 rows").arg(_pageRows));
+  else
+    _pageLabel->setText(::display::tr("%1 rows, scroll for more").arg(_pageRows));
+  _pageLabel->setVisible(_pageSize > 0);
+}
+
 void displayPrivate::print(ParameterList pParams, bool showPreview, bool forceSetParams)
 {
   int numCopies = 1;
@@ -182,6 +597,8 @@ void displayPrivate::print(ParameterList pParams, bool showPreview, bool forceSe
   }
 
   ORPreRender pre;
+  if (_useReadReplica)
+    pre.setDatabase(XReadReplica::database());
   pre.setDom(_doc);
   pre.setParamList(params);
   ORODocument * doc = pre.generate();
@@ -574,6 +991,37 @@ bool display::useAltId() const
   return _data->_useAltId;
 }
 
+/* Run the query and report for this window on the read replica, if one is
+   open. Only turn this on for windows whose query never writes.
+ */
+void display::setUseReadReplica(bool on)
+{
+  _data->_useReadReplica = on;
+}
+
+bool display::useReadReplica() const
+{
+  return _data->_useReadReplica;
+}
+
+/* Load the list pSize rows at a time, fetching more as the user scrolls
+   to the end. 0, the default, loads everything at once. Sorting on the
+   column headers is done by the database while rows remain unfetched.
+   Exporting or copying the list fetches the rest first. Total columns
+   cover every row: the database sums the rows not fetched yet.
+ */
+void display::setPageSize(int pSize)
+{
+  _data->_pageSize = qMax(0, pSize);
+  if (! _data->_pageSize)
+    _data->_pageLabel->setVisible(false);
+}
+
+int display::pageSize() const
+{
+  return _data->_pageSize;
+}
+
 void display::setNewVisible(bool show)
 {
   _data->_newAct->setVisible(show);
@@ -752,6 +1200,7 @@ void display::sFillList()
 
 void display::sFillList(ParameterList pParams, bool forceSetParams)
 {
+  XtTraceSpan span("sFillList", "window", this);
   emit fillListBefore();
   if (forceSetParams || !pParams.count())
   {
@@ -759,49 +1208,24 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
       return;
   }
   int itemid = _data->_list->id();
-  MetaSQLQuery mql(omfgThis->_mqlhash->value(_data->metasqlGroup, _data->metasqlName));
-  XSqlQuery xq = mql.toQuery(pParams, QSqlDatabase(), false);
-
-  QString column;
-  QVariant param;
-  bool valid;
-
-  foreach (QVariant columnid, _data->_charidstext)
+  if (_data->_pageSize > 0)
   {
-    column = QString("char%1").arg(columnid.toString());
-    param = pParams.value(column, &valid);
-    if (valid)
-      xq.bindValue(QString(":%1").arg(column), param.toString());
-  }
-
-  foreach (QVariant columnid, _data->_charidslist)
-  {
-    column = QString("char%1").arg(columnid.toString());
-    param = pParams.value(column, &valid);
-    if (valid)
+    _data->_pageParams = pParams;
+    if (_data->fetchPage(true, itemid))
     {
-      QStringList list = param.toStringList();
-      for (int j = 0; j < list.count(); j++)
-        xq.bindValue(QString(":%1_%2").arg(column).arg(j), list.at(j));
+      emit fillListAfter();
+      return;
     }
   }
 
-  foreach (QVariant columnid, _data->_charidsdate)
-  {
-    // Look for start date
-    column = QString("char%1startDate").arg(columnid.toString());
-    param = pParams.value(column, &valid);
-    if (valid)
-      xq.bindValue(QString(":%1").arg(column), param.toString());
-
-    // Look for end date
-    column = QString("char%1endDate").arg(columnid.toString());
-    param = pParams.value(column, &valid);
-    if (valid)
-      xq.bindValue(QString(":%1").arg(column), param.toString());
-  }
+  MetaSQLQuery mql(omfgThis->_mqlhash->value(_data->metasqlGroup, _data->metasqlName));
+  XSqlQuery xq = mql.toQuery(pParams, _data->_useReadReplica ? XReadReplica::database()
+                                                              : QSqlDatabase(), false);
+  _data->bindCharacteristics(xq, pParams);
 
+  XSqlProfiler timing(_data->metasqlGroup, _data->metasqlName, objectName());
   xq.exec();
+  timing.finish(xq);
 
   _data->_list->populate(xq, itemid, _data->_useAltId);
   if (xq.lastError().type() != QSqlError::NoError)
@@ -38,6 +38,12 @@ public:
     Q_INVOKABLE void setUseAltId(bool);
     Q_INVOKABLE bool useAltId() const;
 
+    Q_INVOKABLE void setUseReadReplica(bool);
+    Q_INVOKABLE bool useReadReplica() const;
+
+    Q_INVOKABLE void setPageSize(int);
+    Q_INVOKABLE int  pageSize() const;
+
     Q_INVOKABLE void setNewVisible(bool);
     Q_INVOKABLE bool newVisible() const;
 
@@ -13,11 +13,16 @@
 
 #include "ui_display.h"
 
+#include <QMap>
+#include <QSqlDatabase>
+
 #include <parameter.h>
 
 #include "parameterlistsetup.h"
 
+class QLabel;
 class QToolButton;
+class XSqlQuery;
 class display;
 
 class displayPrivate : public QObject, public Ui::display
@@ -30,12 +35,18 @@ class displayPrivate : public QObject, public Ui::display
     bool setParams(ParameterList &params);
     void setupCharacteristics(QStringList uses);
     void print(ParameterList pParams, bool showPreview, bool forceSetParams);
+    void bindCharacteristics(XSqlQuery &pQuery, const ParameterList &pParams);
+    bool fetchPage(bool pFirst, int pItemId = -1);
+    bool loadPageTotals(const QString &pInner, const QSqlDatabase &pDb);
+    bool pageByKey() const;
+    QString pagedSource(const QString &pSource, bool pTies) const;
 
     QString reportName;
     QString metasqlName;
     QString metasqlGroup;
 
     bool _useAltId;
+    bool _useReadReplica;
     bool _queryOnStartEnabled;
     bool _autoUpdateEnabled;
     bool _filterChanged;
@@ -72,10 +83,30 @@ class displayPrivate : public QObject, public Ui::display
     QList<QVariant> _charidslist;
     QList<QVariant> _charidsdate;
 
+    // keyset pagination, see display::setPageSize()
+    int           _pageSize;
+    bool          _pageMore;
+    bool          _pageFetching;
+    int           _pageRows;
+    ParameterList _pageParams;
+    QString       _pageIdColumn;
+    QStringList   _pageColumns;   // server-side sort columns
+    QList<Qt::SortOrder> _pageOrders;
+    QList<QPair<int, Qt::SortOrder> > _pageSort;
+    QList<QVariant> _pageKey;     // _pageColumns and id values of the last row
+    QMap<int, QMap<int, double> > _pageTotals; // totals of the rows not fetched yet
+    QLabel       *_pageLabel;
+
   public slots:
     void sFilterChanged();
+    void sPageScrolled(int = 0);
+    void sPagePopulated();
+    void sPageResorted();
+    void sPageFetchAll();
 
   private:
+    void updatePageLabel();
+
     ::display *_parent;
 };
 
@@ -57,6 +57,7 @@ dspAROpenItems::dspAROpenItems(QWidget* parent, const char*, Qt::WindowFlags fl)
   setReportName("AROpenItems");
   setMetaSQLOptions("arOpenItems", "detail");
   setUseAltId(true);
+  setUseReadReplica(true);
   setNewVisible(true);
 
   connect(_customerSelector, SIGNAL(updated()), list(), SLOT(clear()));
@@ -32,6 +32,7 @@ dspCashReceipts::dspCashReceipts(QWidget* parent, const char*, Qt::WindowFlags f
   setMetaSQLOptions("cashReceipts", "detail");
   setNewVisible(true);
   setUseAltId(true);
+  setUseReadReplica(true);
 
   _fundsType->populate("SELECT fundstype_id, fundstype_name, fundstype_code FROM fundstype;");
 
@@ -38,6 +38,7 @@ dspCreditCardTransactions::dspCreditCardTransactions(QWidget* parent, const char
   connect(_customerSelector, SIGNAL(newCustTypeId(int)), this, SLOT(sClear()));
   connect(_customerSelector, SIGNAL(newTypePattern(QString)), this, SLOT(sClear()));
 
+  _preauth->setSelectionMode(QAbstractItemView::ExtendedSelection);
   _preauth->addColumn(tr("Timestamp"),   _dateColumn, Qt::AlignLeft, true,  "ccpay_transaction_datetime"  ); 
   _preauth->addColumn(tr("Cust. #"),    _orderColumn, Qt::AlignLeft,  true, "cust_number");  
   _preauth->addColumn(tr("Name"),                 -1, Qt::AlignLeft,  !omfgThis->singleCurrency(), "cust_name");
@@ -195,6 +196,43 @@ void dspCreditCardTransactions::sPostPreauth()
 
   _postPreauth->setEnabled(false);
   _voidPreauth->setEnabled(false);
+
+  QList<XTreeWidgetItem*> selected = _preauth->selectedItems();
+  if (selected.size() > 1)
+  {
+    QList<int> ccpayids;
+    QHash<int, XTreeWidgetItem*> items;
+    foreach (XTreeWidgetItem *item, selected)
+    {
+      if (item->altId())
+      {
+        ccpayids.append(item->id());
+        items.insert(item->id(), item);
+      }
+    }
+
+    QHash<int, int>     results;
+    QHash<int, QString> errors;
+    if (cardproc->chargePreauthorized(ccpayids, results, errors) > 0)
+    {
+      QStringList failures;
+      foreach (int ccpayid, ccpayids)
+      {
+        if (results.value(ccpayid) < 0)
+          failures << tr("%1: %2").arg(items.value(ccpayid)->text("docnumber"),
+                                       errors.value(ccpayid));
+      }
+      QMessageBox::critical(this, tr("Credit Card Processing Error"),
+                            failures.join("\n"));
+    }
+
+    sFillList();
+
+    _voidPreauth->setEnabled(true);
+    _postPreauth->setEnabled(true);
+    return;
+  }
+
   int ccpayid   = _preauth->id();
   QString neworder = _preauth->currentItem()->text("docnumber");
   QString reforder = neworder;
@@ -244,6 +282,7 @@ void dspCreditCardTransactions::sVoidPreauth()
 
   _postPreauth->setEnabled(false);
   _voidPreauth->setEnabled(false);
+
   int ccpayid   = _preauth->id();
   QString ordernum;
   int returnVal = cardproc->voidPrevious(ccpayid);
@@ -19,15 +19,20 @@
 #include <QStringList>
 #include <QDateTime>
 #include <QSqlError>
+#include <QtAlgorithms>
 
 #include "xtsettings.h"
 
+#define MAXPROFILEDSTATEMENTS 2000
+
 static QStringList _errorList;
 static errorLogListener * listener = 0;
+static queryProfileListener * profiler = 0;
 
 void errorLogListener::initialize()
 {
   listener = new errorLogListener();
+  queryProfileListener::setEnabled(xtsettingsValue("profileQueries").toBool());
 }
 
 void errorLogListener::destroy()
@@ -35,6 +40,7 @@ void errorLogListener::destroy()
   if(listener)
     delete listener;
   listener = 0;
+  queryProfileListener::setEnabled(false);
 }
 
 errorLog::errorLog(QWidget* parent, const char * name, Qt::WindowFlags flags)
@@ -58,6 +64,39 @@ errorLog::errorLog(QWidget* parent, const char * name, Qt::WindowFlags flags)
   connect(_warning, SIGNAL(toggled(bool)),        this,     SLOT(toggleWarning(bool)));
   connect(_critical,SIGNAL(toggled(bool)),        this,     SLOT(toggleCritical(bool)));
   connect(_fatal,   SIGNAL(toggled(bool)),        this,     SLOT(toggleFatal(bool)));
+
+  _queries->addColumn(tr("Group"),      _itemColumn,  Qt::AlignLeft,  true, "group");
+  _queries->addColumn(tr("Name"),       _itemColumn,  Qt::AlignLeft,  true, "name");
+  _queries->addColumn(tr("Window"),     _itemColumn,  Qt::AlignLeft,  true, "window");
+  _queries->addColumn(tr("Script"),     _itemColumn,  Qt::AlignLeft,  true, "script");
+  _queries->addColumn(tr("Count"),      _qtyColumn,   Qt::AlignRight, true, "count");
+  _queries->addColumn(tr("Total ms"),   _qtyColumn,   Qt::AlignRight, true, "total");
+  _queries->addColumn(tr("Average ms"), _qtyColumn,   Qt::AlignRight, true, "average");
+  _queries->addColumn(tr("Max. ms"),    _qtyColumn,   Qt::AlignRight, true, "max");
+  _queries->addColumn(tr("Rows"),       _qtyColumn,   Qt::AlignRight, true, "rows");
+  _queries->addColumn(tr("Failed"),     _qtyColumn,   Qt::AlignRight, false, "failed");
+  _queries->addColumn(tr("Statement"),  -1,           Qt::AlignLeft,  true, "sql");
+
+  _orderBy->addItem(tr("Total Time"));
+  _orderBy->addItem(tr("Count"));
+  _orderBy->addItem(tr("Maximum Time"));
+  _profile->setChecked(queryProfileListener::isEnabled());
+
+  _refresh.setSingleShot(true);
+  _refresh.setInterval(500);
+
+  connect(&_refresh,       SIGNAL(timeout()),                this, SLOT(sFillQueries()));
+  connect(_profile,        SIGNAL(toggled(bool)),            this, SLOT(toggleProfiling(bool)));
+  connect(_orderBy,        SIGNAL(currentIndexChanged(int)), this, SLOT(sFillQueries()));
+  connect(_topN,           SIGNAL(valueChanged(int)),        this, SLOT(sFillQueries()));
+  connect(_exportQueries,  SIGNAL(clicked()),            _queries, SLOT(sExport()));
+  if (profiler)
+  {
+    connect(_resetQueries, SIGNAL(clicked()), profiler, SLOT(clear()));
+    connect(profiler,      SIGNAL(updated()), this,     SLOT(sQueriesUpdated()));
+  }
+
+  sFillQueries();
 }
 
 errorLog::~errorLog()
@@ -75,6 +114,80 @@ void errorLog::updateErrors(const QString & msg)
   _errorLog->append(msg);
 }
 
+static bool byTotalTime(const queryProfileListener::Stats &a,
+                        const queryProfileListener::Stats &b)
+{
+  return a.totalUsecs > b.totalUsecs;
+}
+
+static bool byCount(const queryProfileListener::Stats &a,
+                    const queryProfileListener::Stats &b)
+{
+  return a.count > b.count;
+}
+
+static bool byMaxTime(const queryProfileListener::Stats &a,
+                      const queryProfileListener::Stats &b)
+{
+  return a.maxUsecs > b.maxUsecs;
+}
+
+static double toMsecs(qint64 usecs)
+{
+  return qRound64(usecs / 100.0) / 10.0;
+}
+
+/* Show the top N statements, either by total time spent in them, by how
+   often they run (the usual sign of an N+1 loop) or by the single slowest
+   execution.
+ */
+void errorLog::sFillQueries()
+{
+  _queries->clear();
+  if (! profiler)
+    return;
+
+  QList<queryProfileListener::Stats> stats = profiler->stats();
+  switch (_orderBy->currentIndex())
+  {
+    case 1:  qSort(stats.begin(), stats.end(), byCount);     break;
+    case 2:  qSort(stats.begin(), stats.end(), byMaxTime);   break;
+    default: qSort(stats.begin(), stats.end(), byTotalTime); break;
+  }
+
+  int rows = qMin(_topN->value(), stats.size());
+  for (int i = 0; i < rows; i++)
+  {
+    const queryProfileListener::Stats &stat = stats.at(i);
+    new XTreeWidgetItem(_queries, i,
+                        stat.group, stat.name, stat.window, stat.script,
+                        stat.count,
+                        toMsecs(stat.totalUsecs),
+                        toMsecs(stat.totalUsecs / qMax(stat.count, qint64(1))),
+                        toMsecs(stat.maxUsecs),
+                        stat.rows, stat.failures,
+                        stat.sql.simplified());
+  }
+}
+
+void errorLog::sQueriesUpdated()
+{
+  if (isVisible() && ! _refresh.isActive())
+    _refresh.start();
+}
+
+void errorLog::toggleProfiling(bool y)
+{
+  xtsettingsSetValue("profileQueries", y);
+  queryProfileListener::setEnabled(y);
+  if (profiler)
+  {
+    connect(_resetQueries, SIGNAL(clicked()), profiler, SLOT(clear()), Qt::UniqueConnection);
+    connect(profiler,      SIGNAL(updated()), this,     SLOT(sQueriesUpdated()), Qt::UniqueConnection);
+  }
+  sFillQueries();
+}
+
 void errorLog::toggleDebug(bool y)
 {
   xtsettingsSetValue("catchQDebug", y);
@@ -129,6 +242,90 @@ void errorLogListener::clear()
   (void)blockSignals(blocked);
 }
 
+queryProfileListener::queryProfileListener(QObject * parent)
+  : QObject(parent)
+{
+  XSqlProfiler::addListener(this);
+}
+
+queryProfileListener::~queryProfileListener()
+{
+  XSqlProfiler::removeListener(this);
+}
+
+queryProfileListener *queryProfileListener::instance()
+{
+  return profiler;
+}
+
+bool queryProfileListener::isEnabled()
+{
+  return profiler != 0;
+}
+
+void queryProfileListener::setEnabled(bool enabled)
+{
+  if (enabled && ! profiler)
+    profiler = new queryProfileListener();
+  else if (! enabled && profiler)
+  {
+    delete profiler;
+    profiler = 0;
+  }
+}
+
+void queryProfileListener::timed(const XSqlQueryTiming &timing)
+{
+  QString key = timing.group  + "\n" + timing.name   + "\n" +
+                timing.window + "\n" + timing.script + "\n" + timing.sql;
+
+  QHash<QString, Stats>::iterator it = _stats.find(key);
+  if (it == _stats.end())
+  {
+    Stats stat;
+    stat.group      = timing.group;
+    stat.name       = timing.name;
+    stat.window     = timing.window;
+    stat.script     = timing.script;
+    stat.sql        = timing.sql;
+    stat.count      = 0;
+    stat.totalUsecs = 0;
+    stat.maxUsecs   = 0;
+    stat.rows       = 0;
+    stat.failures   = 0;
+
+    if (_stats.size() >= MAXPROFILEDSTATEMENTS)
+    {
+      key      = QString();
+      stat.sql = tr("(other statements)");
+      stat.group = stat.name = stat.window = stat.script = QString();
+      it = _stats.find(key);
+    }
+    if (it == _stats.end())
+      it = _stats.insert(key, stat);
+  }
+
+  it->count++;
+  it->totalUsecs += timing.usecs;
+  it->maxUsecs    = qMax(it->maxUsecs, timing.usecs);
+  if (timing.rows > 0)
+    it->rows     += timing.rows;
+  if (timing.failed)
+    it->failures++;
+
+  emit updated();
+}
+
+QList<queryProfileListener::Stats> queryProfileListener::stats() const
+{
+  return _stats.values();
+}
+
+void queryProfileListener::clear()
+{
+  _stats.clear();
+  emit updated();
+}
 
 #if QT_VERSION >= 0x050000
 void xTupleMessageOutput(QtMsgType type, const QMessageLogContext&, const QString &pMsg)
@@ -11,8 +11,12 @@
 #ifndef ERRORLOG_H
 #define ERRORLOG_H
 
+#include <QHash>
+#include <QTimer>
+
 #include "xwidget.h"
 #include <xsqlquery.h>
+#include "xsqlprofiler.h"
 
 #include "ui_errorLog.h"
 
@@ -26,13 +30,19 @@ public:
 
 public slots:
     virtual void updateErrors(const QString &);
+    virtual void sFillQueries();
 
 protected slots:
     virtual void languageChange();
+    virtual void sQueriesUpdated();
+    virtual void toggleProfiling(bool);
     virtual void toggleDebug(bool);
     virtual void toggleWarning(bool);
     virtual void toggleCritical(bool);
     virtual void toggleFatal(bool);
+
+private:
+    QTimer _refresh;
 };
 
 class errorLogListener : public QObject, public XSqlQueryErrorListener {
@@ -54,5 +64,45 @@ class errorLogListener : public QObject, public XSqlQueryErrorListener {
     void updated(const QString &);
 };
 
+/* Collects XSqlQueryTiming reports, summed up by where each statement came
+   from, for the Queries tab of the Database Log.
+ */
+class queryProfileListener : public QObject, public XSqlQueryTimingListener {
+  Q_OBJECT
+
+  public:
+    struct Stats
+    {
+      QString group;
+      QString name;
+      QString window;
+      QString script;
+      QString sql;
+      qint64  count;
+      qint64  totalUsecs;
+      qint64  maxUsecs;
+      qint64  rows;
+      qint64  failures;
+    };
+
+    queryProfileListener(QObject * parent = 0);
+    virtual ~queryProfileListener();
+
+    virtual void timed(const XSqlQueryTiming &);
+    QList<Stats> stats() const;
+
+    static queryProfileListener *instance();
+    static bool isEnabled();
+    static void setEnabled(bool);
+
+  public slots:
+    void clear();
+
+  signals:
+    void updated();
+
+  private:
+    QHash<QString, Stats> _stats;
+};
 
 #endif // ERRORLOG_H
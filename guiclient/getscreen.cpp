@@ -10,6 +10,8 @@
 
 #include "getscreen.h"
 
+#include "xttrace.h"
+
 #define STARTCLASSLIST \
   if(classname.isEmpty()) \
     return 0;
@@ -25,6 +27,7 @@
 QWidget * xtGetScreen(const QString & classname, QWidget * parent, Qt::WindowFlags wflags, const QString & objectname)
 {
   QWidget * w = 0;
+  XtTraceSpan span("construct", "window", classname);
 
 STARTCLASSLIST
 #include "getscreen_classlist.h"
@@ -108,6 +108,7 @@ CLASSITEM(createCycleCountTags)
 CLASSITEM(createInvoices)
 CLASSITEM(createItemSitesByClassCode)
 CLASSITEM(createLotSerial)
+CLASSITEM(createLotSerials)
 CLASSITEM(createPlannedOrdersByItem)
 CLASSITEM(createPlannedOrdersByPlannerCode)
 CLASSITEM(createRecurringInvoices)
@@ -108,6 +108,7 @@
 #include "createInvoices.h"
 #include "createItemSitesByClassCode.h"
 #include "createLotSerial.h"
+#include "createLotSerials.h"
 #include "createPlannedOrdersByItem.h"
 #include "createPlannedOrdersByPlannerCode.h"
 #include "createRecurringInvoices.h"
@@ -28,18 +28,27 @@
 #include <QTextStream>
 #include <QCloseEvent>
 #include <QDesktopWidget>
+#include <QMetaMethod>
 #include <QDebug>
 #include <QScriptEngine>
 #include <QScriptValue>
 #include <QBuffer>
+#include <QDataStream>
 #include <QDesktopServices>
 #include <QScriptEngineDebugger>
 
 #include <parameter.h>
 #include <dbtools.h>
-#include <quuencode.h>
 #include <xvariant.h>
 
+#include "applock.h"
+#include "scriptcache.h"
+#include "xdiskcache.h"
+#include "xdocumenttransfer.h"
+#include "ximagecache.h"
+#include "xreadreplica.h"
+#include "xpreparedquery.h"
+#include "xttrace.h"
 #include "xtsettings.h"
 #include "xuiloader.h"
 #include "guiclient.h"
@@ -323,7 +332,8 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
     _shuttingDown(false),
     _spellCodec(0),
     _spellChecker(0),
-    _menu(0)
+    _menu(0),
+    _diskCache(0)
 {
   XSqlQuery qry;
 
@@ -333,7 +343,8 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   qApp->processEvents();
 
   _showTopLevel = (_preferences->value("InterfaceWindowOption") != "Workspace");
-  _mqlhash = new MqlHash(this);
+  _mqlhash    = new MqlHash(this);
+  _uiformhash = new UiFormHash(this);
 
   qry.exec("SELECT startOfTime() AS sot, endOfTime() AS eot;");
   if (qry.first())
@@ -390,18 +401,9 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
 
   if (_preferences->value("BackgroundImageid").toInt() > 0)
   {
-    qry.prepare("SELECT image_data"
-                "  FROM image "
-                " WHERE (image_id=:image_id);");
-    qry.bindValue(":image_id", _preferences->value("BackgroundImageid").toInt());
-    qry.exec();
-    if (qry.first())
-    {
-      QImage background;
-
-      background.loadFromData(QUUDecode(qry.value("image_data").toString()));
+    QImage background = XImageCache::instance()->image(_preferences->value("BackgroundImageid").toInt());
+    if (! background.isNull())
       _workspace->setBackground(QBrush(QPixmap::fromImage(background)));
-    }
   }
 
   _splash->showMessage(tr("Initializing Internal Timers"), SplashTextAlignment, SplashTextColor);
@@ -433,6 +435,10 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   XTextEditHighlighter::_guiClientInterface = VirtualClusterLineEdit::_guiClientInterface;
   // }
 
+  _splash->showMessage(tr("Loading Cached Definitions"), SplashTextAlignment, SplashTextColor);
+  qApp->processEvents();
+  loadDiskCache();
+
   _splash->showMessage(tr("Completing Initialization"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
   _splash->finish(this);
@@ -485,6 +491,17 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
 
   hunspell_initialize();
 
+  // every xxxUpdated broadcast follows a save, after which reads that have
+  // to see the save wait for the read replica to catch up
+  QMetaMethod noteWrite = metaObject()->method(metaObject()->indexOfSlot("sNoteWrite()"));
+  for (int i = metaObject()->methodOffset(); i < metaObject()->methodCount(); i++)
+  {
+    QMetaMethod method = metaObject()->method(i);
+    if (method.methodType() == QMetaMethod::Signal &&
+        QString(method.name()).endsWith("Updated"))
+      connect(this, method, this, noteWrite);
+  }
+
   // load plugins before building the menus
   // TODO? add a step later to add to the menus from the plugins?
   QStringList checkForPlugins;
@@ -523,11 +540,14 @@ GUIClient::~GUIClient()
 {
   QApplication::closeAllWindows();
 
+  saveDiskCache();
   errorLogListener::destroy();
   //omfgThis = 0;
 
-  // Close the database connection
+  // Close the database connection, after dropping the pooled statements
+  // that would otherwise be destroyed after the driver is gone
   XSqlQuery qlc("SELECT logout();");
+  XPreparedQuery::clear();
   QSqlDatabase::database().close();
 }
 
@@ -624,6 +644,21 @@ void GUIClient::setCaption()
 {
 }
 
+/** @brief Re-evaluate the privileges of the actions in a menu whose
+           privileges changed while it was hidden.
+ */
+void GUIClient::sEvaluateMenu()
+{
+  QMenu *menu = qobject_cast<QMenu*>(sender());
+  if (! menu || ! menu->property("xtStalePrivileges").toBool())
+    return;
+
+  menu->setProperty("xtStalePrivileges", false);
+  QList<QAction*> actionlist = menu->actions();
+  for(int i = 0; i < actionlist.size(); ++i)
+    __menuEvaluate(actionlist.at(i));
+}
+
 /** @brief Build the application menus and toolbars based on
            the current user's preferences for menu and toolbar visibility.
  */
@@ -635,12 +670,35 @@ void GUIClient::initMenuBar()
 
   if(!firstRun)
   {
+    // Only actions whose privileges changed need another look. Revoked
+    // ones are disabled now so scripts and shortcuts can't trigger them,
+    // as are any that can be triggered without opening their menu. Other
+    // newly granted actions are enabled when their menu is next shown.
     QList<QMenu*> menulist = findChildren<QMenu*>();
     for(int m = 0; m < menulist.size(); ++m)
     {
-      QList<QAction*> actionlist = menulist.at(m)->actions();
+      QMenu *menu = menulist.at(m);
+      bool   stale = false;
+      QList<QAction*> actionlist = menu->actions();
       for(int i = 0; i < actionlist.size(); ++i)
-        __menuEvaluate(actionlist.at(i));
+      {
+        QAction *act   = actionlist.at(i);
+        QString  privs = act->data().toString();
+        if (privs.isEmpty() || privs == "true" || privs == "false" ||
+            ! _privileges->changed(privs))
+          continue;
+
+        if (! _privileges->check(privs) ||
+            ! act->shortcut().isEmpty() || act->associatedWidgets().size() > 1)
+          __menuEvaluate(act);
+        else
+          stale = true;
+      }
+      if (stale)
+      {
+        menu->setProperty("xtStalePrivileges", true);
+        connect(menu, SIGNAL(aboutToShow()), this, SLOT(sEvaluateMenu()), Qt::UniqueConnection);
+      }
     }
   }
   else
@@ -915,6 +973,73 @@ void GUIClient::sReportError(const QString &pError)
     @todo Make the check for lost database connections more intelligent.
     @todo If the database connection really is gone, try to reconnect.
     */
+/* Fill the MetaSQL, script and UI form caches with what was saved at the end
+   of the last session, as long as none of it has changed on the server.
+ */
+void GUIClient::loadDiskCache()
+{
+  _diskCache = new XDiskCache();
+  if (! _diskCache->load())
+  {
+    qWarning() << "Could not load cached definitions:" << _diskCache->lastError();
+    return;
+  }
+
+  QByteArray data = _diskCache->section("metasql");
+  if (! data.isEmpty())
+  {
+    QDataStream in(data);
+    _mqlhash->restore(in);
+  }
+
+  data = _diskCache->section("script");
+  if (! data.isEmpty())
+  {
+    QDataStream in(data);
+    ScriptableWidget::scriptCache()->restore(in);
+  }
+
+  data = _diskCache->section("uiform");
+  if (! data.isEmpty())
+  {
+    QDataStream in(data);
+    _uiformhash->restore(in);
+  }
+}
+
+void GUIClient::saveDiskCache()
+{
+  if (! _diskCache)
+    return;
+
+  QByteArray data;
+  {
+    QDataStream out(&data, QIODevice::WriteOnly);
+    _mqlhash->save(out);
+  }
+  _diskCache->setSection("metasql", data);
+
+  data.clear();
+  {
+    QDataStream out(&data, QIODevice::WriteOnly);
+    ScriptableWidget::scriptCache()->save(out);
+  }
+  _diskCache->setSection("script", data);
+
+  data.clear();
+  {
+    QDataStream out(&data, QIODevice::WriteOnly);
+    _uiformhash->save(out);
+  }
+  _diskCache->setSection("uiform", data);
+
+  if (! _diskCache->save())
+    qWarning() << "Could not save cached definitions:" << _diskCache->lastError();
+
+  delete _diskCache;
+  _diskCache = 0;
+}
+
 void GUIClient::sTick()
 {
   XSqlQuery tickle("SELECT CURRENT_DATE AS dbdate, hasEvents() AS events, processAlarms();" );
@@ -957,6 +1082,8 @@ void GUIClient::sTick()
   }
   else if (! QSqlDatabase::database().isOpen())
   {
+    XPreparedQuery::clear();
+    AppLock::clearCache();
     emit dbConnectionLost();
     if (QMessageBox::question(this, tr("Database disconnected"),
                               tr("It appears that you have been disconnected from the "
@@ -1090,6 +1217,14 @@ void GUIClient::sSystemMessageAdded()
     @{
 */
 
+/** @brief This slot records that something was saved, so windows reading
+    from the read replica wait until it has the change.
+  */
+void GUIClient::sNoteWrite()
+{
+  XReadReplica::noteWrite();
+}
+
 /** @brief This slot tells other open windows the definition or status of one or more Items has changed.
     @param pItemid the internal id of the Item or -1 for multiple or unspecified items
     @param pLocal unknown purpose
@@ -1820,15 +1955,8 @@ void GUIClient::sCustomCommand()
       }
       if(asName.isEmpty())
         return;
-      GCustomCommand.prepare("SELECT *"
-                "  FROM uiform"
-                " WHERE((uiform_name=:uiform_name)"
-                "   AND (uiform_enabled))"
-                " ORDER BY uiform_order DESC"
-                " LIMIT 1;");
-      GCustomCommand.bindValue(":uiform_name", asName);
-      GCustomCommand.exec();
-      if(!GCustomCommand.first())
+      QString source = _uiformhash->value(asName);
+      if(source.isEmpty())
       {
         QMessageBox::critical(this, tr("Could Not Create Form"),
                               tr("<p>Could not create the '%1' form. Either an "
@@ -1838,7 +1966,7 @@ void GUIClient::sCustomCommand()
       }
 
       XUiLoader loader;
-      QByteArray ba = GCustomCommand.value("uiform_source").toString().toUtf8();
+      QByteArray ba = source.toUtf8();
       QBuffer uiFile(&ba);
       if(!uiFile.open(QIODevice::ReadOnly))
       {
@@ -1853,7 +1981,7 @@ void GUIClient::sCustomCommand()
       if(asDialog)
       {
         XDialog dlg(this);
-        dlg.setObjectName(GCustomCommand.value("uiform_name").toString());
+        dlg.setObjectName(asName);
         QVBoxLayout *layout = new QVBoxLayout;
         layout->addWidget(ui);
         dlg.setLayout(layout);
@@ -1864,7 +1992,7 @@ void GUIClient::sCustomCommand()
       else
       {
         XMainWindow * wnd = new XMainWindow();
-        wnd->setObjectName(GCustomCommand.value("uiform_name").toString());
+        wnd->setObjectName(asName);
         wnd->setCentralWidget(ui);
         wnd->setWindowTitle(ui->windowTitle());
         wnd->resize(size);
@@ -2007,6 +2135,7 @@ void GUIClient::handleNewWindow(QWidget *w, Qt::WindowModality m, bool forceFloa
 {
   // TODO:  replace this function with a centralized openWindow function
   // used by toolbox, guiclient interface, and core windows
+  XtTraceSpan span("handleNewWindow", "window", w);
 
   #ifdef Q_OS_MAC
     	updateMacDockMenu(w);
@@ -2389,7 +2518,6 @@ bool GUIClient::removeDocumentWatch(QString path)
 
 void GUIClient::handleDocument(QString path)
 {
-  QByteArray  bytarr;
   QFile sourceFile(path);
   bool opened = false;
 
@@ -2416,13 +2544,11 @@ void GUIClient::handleDocument(QString path)
 
   int id = _fileMap.value(path);
 
-  bytarr = sourceFile.readAll();
-  XSqlQuery qry;
-  qry.prepare( "UPDATE url SET url_stream = :stream "
-               "WHERE (url_id = :id);" );
-  qry.bindValue(":id", id);
-  qry.bindValue(":stream", bytarr);
-  qry.exec();
+  XDocumentTransfer transfer(this);
+  if (! transfer.upload(&sourceFile, id) && ! transfer.wasCancelled())
+    qWarning("File %s could not be saved to the database: %s",
+             qPrintable(path), qPrintable(transfer.lastError()));
+  sourceFile.close();
   addDocumentWatch(path, id);
 }
 
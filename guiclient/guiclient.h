@@ -21,6 +21,7 @@
 #include "format.h"
 #include "../hunspell/hunspell.hxx"
 #include "mqlhash.h"
+#include "uiformhash.h"
 
 #include <xtuplecommon.h>
 #include <version.h>
@@ -55,6 +56,7 @@ class menuSystem;
 class TimeoutHandler;
 class InputManager;
 class ReportHandler;
+class XDiskCache;
 
 class XMainWindow;
 class XWidget;
@@ -237,7 +239,8 @@ class GUIClient : public QMainWindow
     QString _key;
     Q_INVOKABLE QString key() { return _key; }
 
-    MqlHash *_mqlhash;
+    MqlHash    *_mqlhash;
+    UiFormHash *_uiformhash;
     QString _singleWindow;
 
     Q_INVOKABLE        void  launchBrowser(QWidget*, const QString &);
@@ -407,6 +410,8 @@ class GUIClient : public QMainWindow
 
   private slots:
     void handleDocument(QString path);
+    void sNoteWrite();
+    void sEvaluateMenu();
     void hunspell_uninitialize();
 
   private:
@@ -467,6 +472,10 @@ class GUIClient : public QMainWindow
     QStringList _spellAddWords;
 
     QMenu *_menu;
+
+    XDiskCache *_diskCache;
+    void        loadDiskCache();
+    void        saveDiskCache();
 };
 extern GUIClient *omfgThis;
 
@@ -3,7 +3,7 @@ include( ../global.pri )
 TARGET   = xtuple
 CONFIG   += qt warn_on
 
-QT += xml sql script scripttools network
+QT += xml sql script scripttools network concurrent
 QT += webkit xmlpatterns printsupport webkitwidgets
 
 isEqual(QT_MAJOR_VERSION, 5) {
@@ -204,6 +204,7 @@ FORMS =   absoluteCalendarItem.ui               \
           createInvoices.ui                     \
           createItemSitesByClassCode.ui         \
           createLotSerial.ui                    \
+          createLotSerials.ui                   \
           createPlannedOrdersByItem.ui          \
           createPlannedOrdersByPlannerCode.ui   \
           createRecurringInvoices.ui            \
@@ -771,6 +772,7 @@ HEADERS = ../common/format.h                    \
           createInvoices.h                      \
           createItemSitesByClassCode.h          \
           createLotSerial.h                     \
+          createLotSerials.h                    \
           createPlannedOrdersByItem.h           \
           createPlannedOrdersByPlannerCode.h    \
           createRecurringInvoices.h             \
@@ -780,6 +782,7 @@ HEADERS = ../common/format.h                    \
           creditMemo.h                          \
           creditMemoEditList.h                  \
           creditMemoItem.h                      \
+          creditcardgateway.h                   \
           creditcardprocessor.h                 \
           crmaccount.h                          \
           crmaccountMerge.h                     \
@@ -951,6 +954,7 @@ HEADERS = ../common/format.h                    \
           lotSerial.h                   \
           lotSerialSequence.h           \
           lotSerialSequences.h          \
+          lotSerialBatch.h              \
           lotSerialRegistration.h       \
           lotSerialUtils.h              \
           maintainBudget.h              \
@@ -1262,6 +1266,7 @@ HEADERS = ../common/format.h                    \
           woMaterialItem.h              \
           workOrder.h                   \
           workOrderMaterials.h          \
+          workbenchPages.h              \
           xTupleDesigner.h              \
           xTupleDesignerActions.h       \
           xabstractconfigure.h          \
@@ -1393,6 +1398,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           createInvoices.cpp                    \
           createItemSitesByClassCode.cpp        \
           createLotSerial.cpp                   \
+          createLotSerials.cpp                  \
           createPlannedOrdersByItem.cpp         \
           createPlannedOrdersByPlannerCode.cpp  \
           createRecurringInvoices.cpp           \
@@ -1402,6 +1408,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           creditMemo.cpp                        \
           creditMemoEditList.cpp                \
           creditMemoItem.cpp                    \
+          creditcardgateway.cpp                 \
           creditcardprocessor.cpp               \
           crmaccount.cpp                        \
           crmaccountMerge.cpp                   \
@@ -1569,6 +1576,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           lotSerial.cpp                 \
           lotSerialSequence.cpp         \
           lotSerialSequences.cpp        \
+          lotSerialBatch.cpp            \
           lotSerialRegistration.cpp     \
           lotSerialUtils.cpp            \
           main.cpp                      \
@@ -1881,6 +1889,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           woMaterialItem.cpp                    \
           workOrder.cpp                         \
           workOrderMaterials.cpp                \
+          workbenchPages.cpp                    \
           xTupleDesigner.cpp                    \
           xTupleDesignerActions.cpp             \
           xabstractconfigure.cpp                \
@@ -22,24 +22,17 @@
 
 #include <QDebug>
 
-#include <quuencode.h>
-
 #include "guiclient.h"
 #include "helpView.h"
 #include "helpViewBrowser.h"
+#include "ximagecache.h"
 #include "xtHelp.h"
 
 static QIcon iconFromImageByName(QString name)
 {
-  QImage    image;
-  XSqlQuery imageq;
-  imageq.prepare("SELECT image_data FROM image WHERE image_name=:name LIMIT 1;");
-  imageq.bindValue(":name", name);
-  if (imageq.exec() && imageq.first())
-  {
-    image.loadFromData(QUUDecode(imageq.value("image_data").toString()));
+  QImage image = XImageCache::instance()->image(name);
+  if (! image.isNull())
     return QIcon(QPixmap::fromImage(image));
-  }
   return QIcon();
 }
 
@@ -8,16 +8,19 @@
  * to be bound by its terms.
  */
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QEvent>
 #include <QKeyEvent>
 #include <QList>
 #include <QObject>
 #include <QSqlError>
+#include <QTimerEvent>
 #include <QScriptEngine>
 #include <QScriptValue>
 
 #include <xsqlquery.h>
+#include <xpreparedquery.h>
 
 #include "guiclient.h"
 
@@ -64,6 +67,9 @@ class ScanEvent
 #define cPrologCtrl   0x80    /* Macintosh-only */
 #endif
 
+#define cDefaultQueueCapacity 64
+#define cMaxBatch             16
+
 ReceiverItem::ReceiverItem()
   : _type(0),
     _parent(0),
@@ -92,7 +98,11 @@ InputManagerPrivate::InputManagerPrivate(InputManager *parent)
   : QObject(parent),
     _parent(parent),
     _state(cIdle),
-    _event(0)
+    _event(0),
+    _capacity(cDefaultQueueCapacity),
+    _dispatching(false),
+    _generatedNext(0),
+    _generatedLeft(0)
 {
   if (eventList.isEmpty())
   {
@@ -109,7 +119,7 @@ InputManagerPrivate::InputManagerPrivate(InputManager *parent)
     addToEventList("TOLI", cBCTransferOrderLineItem, 1, 1, 0, "Transfer Order Line %1-%2",      "SELECT tohead_id AS id, toitem_id AS altid, toitem_item_id AS seq FROM tohead JOIN toitem ON toitem_tohead_id=tohead_id WHERE tohead_number = :f1 AND toitem_linenumber = :f2;" );
     addToEventList("ISXX", cBCItemSite,              2, 1, 0, "Item %1, Site %2",               "SELECT itemsite_id AS id, itemsite_item_id AS altid FROM itemsite JOIN item ON itemsite_item_id=item_id JOIN whsinfo ON itemsite_warehous_id = warehous_id WHERE item_number = :f1 AND warehous_code = :f2;" );
     addToEventList("ITXX", cBCItem,                  2, 0, 0, "Item %1",                        "SELECT item_id AS id FROM item WHERE item_number = :f1;" );
-    addToEventList("ITUP", cBCUPCCode,               0, 0, 0, "UPC %1 for Item %2",             "SELECT item_id, item_number FROM item WHERE item_upccode = :f1 AND item_active);" );
+    addToEventList("ITUP", cBCUPCCode,               0, 0, 0, "UPC %1 for Item %2",             "SELECT item_id AS id, item_number FROM item WHERE item_upccode = :f1 AND item_active;" );
 //  addToEventList("ITEA", cBCEANCode,               0, 0, 0 );
     addToEventList("CTXX", cBCCountTag,              2, 0, 0, "Count Tag %1",                   "SELECT invcnt_id AS id FROM invcnt WHERE invcnt_tagnumber = :f1;" );
     addToEventList("LOXX", cBCLocation,              1, 2, 0, "Site %1, Location %2",           "SELECT location_id AS id FROM location JOIN whsinfo ON location_warehous_id = warehous_id WHERE warehous_code = :f1 AND location_name = :f2;" );
@@ -341,7 +351,7 @@ bool InputManager::eventFilter(QObject *, QEvent *pEvent)
             case cBCUPCCode:
             case cBCLocationIssue:
             case cBCLocationContents:
-              _private->dispatchScan(_private->_event->type);
+              _private->enqueueScan(_private->_event->type);
               // FALLTHROUGH
 
             default:
@@ -411,79 +421,357 @@ QString InputManagerPrivate::queryFieldName(int barcodeType, int receiverType)
   return result;
 }
 
-void InputManagerPrivate::dispatchScan(int type)
+/* The event's query without its trailing semicolon, to use as a subquery */
+static QString queryBody(const QString &query)
+{
+  QString result = query.trimmed();
+  while (result.endsWith(";"))
+    result.chop(1);
+  return result;
+}
+
+/* Copy the scan out of the state machine and queue it for delivery. The
+   lookup and delivery happen once the events already waiting have been
+   handled, so a scanner that sends scans back to back gets its keystrokes
+   read while earlier scans are still being looked up, and scans that
+   arrive together are looked up together.
+ */
+void InputManagerPrivate::enqueueScan(int type)
 {
   if (DEBUG)
-    qDebug("dispatchScan(%d) entered", type);
+    qDebug("enqueueScan(%d) entered", type);
+  if (! _clock.isValid())
+    _clock.start();
+  count("received");
+
   ReceiverItem receiver = findReceiver(type);
-  if (! receiver.isNull())
+  if (receiver.isNull())
   {
-    if (DEBUG)
-      qDebug() << "dispatchScan() receiver:"     << receiver.type()
-               << receiver.parent()      << "->" << receiver.target()
-               << "[" << receiver.slot() << "]"  << receiver.isNull();
+    count("unclaimed");
+    return;
+  }
 
-    QString number    = _buffer.left(_length1);
-    QString subNumber = _buffer.mid(_length1, _length2);
-    QString seqNumber = _buffer.right(_length3);
-    if (DEBUG)
-      qDebug() << "dispatchScan:" << _length1 << _length2 << _length3 << number << subNumber << seqNumber;
-
-    // TODO: can we remove this special-casing for kit sales order items?
-    if (type & cBCSalesOrderLineItem) {
-      int subsep = subNumber.indexOf(".");
-      if (subsep >= 0)
-      {
-        subNumber = subNumber.left(subsep);
-        seqNumber = subNumber.right(subNumber.length() - (subsep + 1));
-      }
-      if (seqNumber.isEmpty())
-        seqNumber = "0";
+  if (_queue.size() >= _capacity)
+  {
+    count("dropped");
+    message(tr("Scan dropped, the scanner is ahead of the application"), 1000);
+    return;
+  }
+
+  InputScan scan;
+  scan.event     = _event;
+  scan.receiver  = receiver;
+  scan.target    = receiver.target();
+  scan.scannedAt = _clock.elapsed();
+  scan.number    = _buffer.left(_length1);
+  scan.subNumber = _buffer.mid(_length1, _length2);
+  scan.seqNumber = _buffer.right(_length3);
+  if (DEBUG)
+    qDebug() << "enqueueScan:" << _length1 << _length2 << _length3
+             << scan.number << scan.subNumber << scan.seqNumber;
+
+  // TODO: can we remove this special-casing for kit sales order items?
+  if (type & cBCSalesOrderLineItem) {
+    int subsep = scan.subNumber.indexOf(".");
+    if (subsep >= 0)
+    {
+      scan.seqNumber = scan.subNumber.mid(subsep + 1);
+      scan.subNumber = scan.subNumber.left(subsep);
     }
+    if (scan.seqNumber.isEmpty())
+      scan.seqNumber = "0";
+  }
+
+  if (_length3 > 0)
+    scan.descrip = _event->descrip.arg(scan.number, scan.subNumber, scan.seqNumber);
+  else if (_length2 > 0)
+    scan.descrip = _event->descrip.arg(scan.number, scan.subNumber);
+  else
+    scan.descrip = _event->descrip.arg(scan.number);
+
+  _queue.enqueue(scan);
+  if (_queue.size() > _stats.value("maxQueued").toInt())
+    _stats.insert("maxQueued", _queue.size());
+  if (! _dispatchTimer.isActive())
+    _dispatchTimer.start(0, this);
+}
+
+/* Deliver the queued scans in the order they were scanned. Runs of scans
+   of the same kind are looked up together. A receiver's slot can open a
+   window or dialog and so process events; scans that come in meanwhile
+   join the queue and this loop picks them up when the slot returns.
+ */
+void InputManagerPrivate::dispatchQueue()
+{
+  if (_dispatching)
+    return;
+  _dispatching = true;
+
+  while (! _queue.isEmpty())
+  {
+    QList<InputScan> batch;
+    batch.append(_queue.dequeue());
+    while (! _queue.isEmpty() && batch.size() < cMaxBatch &&
+           _queue.head().event == batch.first().event)
+      batch.append(_queue.dequeue());
+
+    lookup(batch);
+    for (int i = 0; i < batch.size(); i++)
+      deliver(batch[i]);
+  }
+
+  _dispatching = false;
+}
 
-    QString descrip;
-    if (_length3 > 0)
-      descrip = _event->descrip.arg(number, subNumber, seqNumber);
-    else if (_length2 > 0)
-      descrip = _event->descrip.arg(number, subNumber);
-    else
-      descrip = _event->descrip.arg(number);
-
-    XSqlQuery q;
-    q.prepare(_event->query);
-    q.bindValue(":f1", number);
-    q.bindValue(":f2", subNumber);
-    q.bindValue(":f3", seqNumber);
+/* A single scan uses the event's own query. Several use one statement
+   that runs the query once per scan, so the round trip is shared. Both
+   are kept prepared between scans.
+ */
+void InputManagerPrivate::lookup(QList<InputScan> &batch)
+{
+  count("lookups");
+  if (batch.size() == 1)
+  {
+    InputScan &scan = batch[0];
+    XPreparedQuery q(scan.event->query);
+    q->bindValue(":f1", scan.number);
+    q->bindValue(":f2", scan.subNumber);
+    q->bindValue(":f3", scan.seqNumber);
     q.exec();
-    if (q.first())
+    if (q->first())
+    {
+      scan.found  = true;
+      scan.result = q->record();
+    }
+    else if (q->lastError().type() != QSqlError::NoError)
+      scan.error = q->lastError().text();
+    return;
+  }
+
+  QString query = queryBody(batch.first().event->query);
+  QStringList parts;
+  for (int i = 0; i < batch.size(); i++)
+  {
+    QString part = query;
+    part.replace(":f1", QString(":s%1f1").arg(i))
+        .replace(":f2", QString(":s%1f2").arg(i))
+        .replace(":f3", QString(":s%1f3").arg(i));
+    parts << QString("SELECT %1 AS xtscan, xtscan%1.*"
+                     "  FROM (%2 LIMIT 1) AS xtscan%1").arg(i).arg(part);
+  }
+
+  XPreparedQuery q(parts.join(" UNION ALL ") + ";");
+  for (int i = 0; i < batch.size(); i++)
+  {
+    q->bindValue(QString(":s%1f1").arg(i), batch.at(i).number);
+    q->bindValue(QString(":s%1f2").arg(i), batch.at(i).subNumber);
+    q->bindValue(QString(":s%1f3").arg(i), batch.at(i).seqNumber);
+  }
+  q.exec();
+  while (q->next())
+  {
+    int i = q->value("xtscan").toInt();
+    if (i >= 0 && i < batch.size())
     {
-      message(tr("Scanned %1").arg(descrip), 1000);
-
-      QString fieldName = queryFieldName(type, receiver.type());
-
-      if (fieldName.isEmpty())
-      {
-        message(tr("Don't know how to send %1 (barcode %2, receiver %3)")
-                .arg(descrip).arg(type, receiver.type()));
-        return;
-      }
-
-      int id = q.value(fieldName).toInt();
-      QGenericArgument idArg = Q_ARG(int, id);
-      // convert "1methodName(args)(stuff)" to just "methodName"
-      QString methodName = receiver.slot();
-      methodName.replace(QRegExp("^1([a-z][a-z0-9_]*).*", Qt::CaseInsensitive), "\\1");
-
-      if (DEBUG)
-        qDebug() << receiver.target() << methodName.toLatin1().data() << id;
-      (void)QMetaObject::invokeMethod(receiver.target(),
-                                      methodName.toLatin1().data(), idArg);
-      emit gotBarCode(type, id);
+      batch[i].found  = true;
+      batch[i].result = q->record();
     }
-    else if (q.lastError().type() != QSqlError::NoError)
-      message(tr("Error Scanning %1: %2").arg(descrip, q.lastError().text()), 1000);
-    else
-      message(tr("%1 not found").arg(descrip));
+  }
+  if (q->lastError().type() != QSqlError::NoError)
+    for (int i = 0; i < batch.size(); i++)
+      batch[i].error = q->lastError().text();
+}
+
+void InputManagerPrivate::deliver(InputScan &scan)
+{
+  if (! scan.target)
+  {
+    count("undelivered");
+    return;
+  }
+
+  int type = scan.event->type;
+  if (! scan.error.isEmpty())
+  {
+    count("errors");
+    message(tr("Error Scanning %1: %2").arg(scan.descrip, scan.error), 1000);
+    return;
+  }
+  if (! scan.found)
+  {
+    count("notFound");
+    message(tr("%1 not found").arg(scan.descrip));
+    return;
+  }
+
+  message(tr("Scanned %1").arg(scan.descrip), 1000);
+
+  QString fieldName = queryFieldName(type, scan.receiver.type());
+  if (fieldName.isEmpty())
+  {
+    count("undelivered");
+    message(tr("Don't know how to send %1 (barcode %2, receiver %3)")
+            .arg(scan.descrip).arg(type).arg(scan.receiver.type()));
+    return;
+  }
+
+  int id = scan.result.value(fieldName).toInt();
+  QGenericArgument idArg = Q_ARG(int, id);
+  // convert "1methodName(args)(stuff)" to just "methodName"
+  QString methodName = scan.receiver.slot();
+  methodName.replace(QRegExp("^1([a-z][a-z0-9_]*).*", Qt::CaseInsensitive), "\\1");
+
+  count("delivered");
+  count("latencyMs", _clock.elapsed() - scan.scannedAt);
+
+  if (DEBUG)
+    qDebug() << scan.target << methodName.toLatin1().data() << id;
+  (void)QMetaObject::invokeMethod(scan.target,
+                                  methodName.toLatin1().data(), idArg);
+  emit gotBarCode(type, id);
+}
+
+void InputManagerPrivate::count(const QString &counter, qint64 increment)
+{
+  _stats.insert(counter, _stats.value(counter).toLongLong() + increment);
+}
+
+/* Post the keystrokes a scanner would send for barcode, prolog first. */
+void InputManagerPrivate::postScan(const QString &barcode)
+{
+#ifdef Q_OS_MAC
+  QCoreApplication::postEvent(this, new QKeyEvent(QEvent::KeyPress, Qt::Key_Meta,
+                                                  Qt::NoModifier));
+  QCoreApplication::postEvent(this, new QKeyEvent(QEvent::KeyPress, Qt::Key_K,
+                                                  Qt::MetaModifier));
+#else
+  QCoreApplication::postEvent(this, new QKeyEvent(QEvent::KeyPress, Qt::Key_K,
+                                                  Qt::ControlModifier,
+                                                  QString(QChar(cBCCProlog[0]))));
+#endif
+  QString keys = QString(cBCCProlog).mid(1) + barcode;
+  for (int i = 0; i < keys.length(); i++)
+    QCoreApplication::postEvent(this, new QKeyEvent(QEvent::KeyPress,
+                                                    keys.at(i).toUpper().unicode(),
+                                                    Qt::NoModifier,
+                                                    QString(keys.at(i))));
+}
+
+void InputManagerPrivate::timerEvent(QTimerEvent *event)
+{
+  if (event->timerId() == _dispatchTimer.timerId())
+  {
+    _dispatchTimer.stop();
+    dispatchQueue();
+  }
+  else if (event->timerId() == _generatorTimer.timerId())
+  {
+    if (_generatedLeft <= 0 || _generated.isEmpty())
+    {
+      _generatorTimer.stop();
+      return;
+    }
+    postScan(_generated.at(_generatedNext));
+    _generatedNext = (_generatedNext + 1) % _generated.size();
+    _generatedLeft--;
+  }
+  else
+    QObject::timerEvent(event);
+}
+
+/** The most scans waiting to be looked up and delivered. Scans that
+    arrive when the queue is full are dropped and counted.
+ */
+int InputManager::queueCapacity() const
+{
+  return _private->_capacity;
+}
+
+void InputManager::setQueueCapacity(int capacity)
+{
+  _private->_capacity = qMax(1, capacity);
+}
+
+/** Counters for the scan pipeline since the last resetStatistics():
+    scans received, delivered, dropped because the queue was full,
+    notFound, errors, unclaimed (nobody was listening), undelivered
+    (the receiver went away), lookups (queries run), the maxQueued and
+    currently queued scans, scansPerSecond delivered, and the
+    meanLatencyMs from the end of a scan to its delivery.
+ */
+QVariantMap InputManager::statistics() const
+{
+  QVariantMap result = _private->_stats;
+  qint64 delivered = result.value("delivered").toLongLong();
+  qint64 elapsed   = _private->_clock.isValid() ? _private->_clock.elapsed() : 0;
+
+  result.insert("capacity",       _private->_capacity);
+  result.insert("queued",         _private->_queue.size());
+  result.insert("scansPerSecond", elapsed > 0 ? delivered * 1000.0 / elapsed : 0.0);
+  result.insert("meanLatencyMs",  delivered > 0
+                                  ? result.value("latencyMs").toLongLong() / (double)delivered
+                                  : 0.0);
+  result.remove("latencyMs");
+  return result;
+}
+
+void InputManager::resetStatistics()
+{
+  _private->_stats.clear();
+  _private->_clock.invalidate();
+}
+
+/** Return the characters a scanner sends for a barcode of the given
+    prefix, after the prolog, or an empty string if the prefix is unknown
+    or a field is too long for its length header.
+ */
+QString InputManager::barcode(const QString &prefix, const QString &f1,
+                              const QString &f2, const QString &f3) const
+{
+  ScanEvent *event = InputManagerPrivate::eventList.value(prefix, 0);
+  if (! event)
+    return QString();
+
+  QString header;
+  int     widths[] = { event->length1, event->length2, event->length3 };
+  QString fields[] = { f1, f2, f3 };
+  QString data;
+  for (int i = 0; i < 3; i++)
+  {
+    if (widths[i] == 0)
+      continue;
+    QString length = QString::number(fields[i].length())
+                                    .rightJustified(widths[i], '0');
+    if (length.length() > widths[i])
+      return QString();
+    header += length;
+    data   += fields[i];
+  }
+  return prefix + header + data;
+}
+
+/** Feed count scans through the pipeline as if a scanner sent them,
+    cycling through barcodes (built with barcode()). With perSecond > 0
+    the scans are spaced out to that rate, otherwise they are all posted
+    at once to see what happens when the scanner outruns the client.
+ */
+void InputManager::generateScans(const QStringList &barcodes, int count, int perSecond)
+{
+  _private->_generatorTimer.stop();
+  _private->_generated     = barcodes;
+  _private->_generatedNext = 0;
+  _private->_generatedLeft = barcodes.isEmpty() ? 0 : count;
+
+  if (perSecond > 0)
+  {
+    _private->_generatorTimer.start(qMax(1, 1000 / perSecond), _private);
+    return;
+  }
+
+  for (; _private->_generatedLeft > 0; _private->_generatedLeft--)
+  {
+    _private->postScan(barcodes.at(_private->_generatedNext));
+    _private->_generatedNext = (_private->_generatedNext + 1) % barcodes.size();
   }
 }
 
@@ -13,6 +13,8 @@
 
 #include <QObject>
 #include <QEvent>
+#include <QStringList>
+#include <QVariantMap>
 
 class InputManagerPrivate;
 class QScriptEngine;
@@ -47,6 +49,17 @@ class InputManager : public QObject
     Q_INVOKABLE void notify(int, QObject *, QObject *, const QString &);
     Q_INVOKABLE QString slotName(const QString &);
 
+    Q_INVOKABLE int         queueCapacity() const;
+    Q_INVOKABLE void        setQueueCapacity(int capacity);
+    Q_INVOKABLE QVariantMap statistics()    const;
+    Q_INVOKABLE void        resetStatistics();
+
+    Q_INVOKABLE QString barcode(const QString &prefix, const QString &f1,
+                                const QString &f2 = QString(),
+                                const QString &f3 = QString()) const;
+    Q_INVOKABLE void    generateScans(const QStringList &barcodes, int count,
+                                      int perSecond = 0);
+
     void scriptAPI(QScriptEngine *engine, QString globalName);
 
   public slots:
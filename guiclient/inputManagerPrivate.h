@@ -11,9 +11,16 @@
 #ifndef __INPUTMANAGERPRIVATE_H__
 #define __INPUTMANAGERPRIVATE_H__
 
+#include <QBasicTimer>
+#include <QElapsedTimer>
 #include <QHash>
 #include <QList>
 #include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSqlRecord>
+#include <QStringList>
+#include <QVariantMap>
 
 class InputManager;
 class ScanEvent;
@@ -39,6 +46,28 @@ class ReceiverItem
     bool    _null;
 };
 
+/* One complete scan, copied out of the character state machine so the
+   machine can go on assembling the next one while this one waits for its
+   lookup and delivery.
+ */
+class InputScan
+{
+  public:
+    InputScan() : event(0), found(false), scannedAt(0) {}
+
+    ScanEvent          *event;
+    QString             number;
+    QString             subNumber;
+    QString             seqNumber;
+    QString             descrip;
+    ReceiverItem        receiver;
+    QPointer<QObject>   target;
+    QSqlRecord          result;
+    bool                found;
+    QString             error;
+    qint64              scannedAt;
+};
+
 class InputManagerPrivate : public QObject
 {
   Q_OBJECT
@@ -58,7 +87,24 @@ class InputManagerPrivate : public QObject
     int                 _length3;
     QString             _buffer;
 
-    void dispatchScan(int type);
+    QQueue<InputScan>   _queue;
+    int                 _capacity;
+    bool                _dispatching;
+    QBasicTimer         _dispatchTimer;
+    QElapsedTimer       _clock;
+    QVariantMap         _stats;
+
+    QBasicTimer         _generatorTimer;
+    QStringList         _generated;
+    int                 _generatedNext;
+    int                 _generatedLeft;
+
+    void enqueueScan(int type);
+    void dispatchQueue();
+    void lookup(QList<InputScan> &batch);
+    void deliver(InputScan &scan);
+    void count(const QString &counter, qint64 increment = 1);
+    void postScan(const QString &barcode);
 
     void         addToEventList(QString prefix, int type, int length1, int length2, int length3, QString descrip, QString query);
     ReceiverItem findReceiver(int pMask);
@@ -66,6 +112,9 @@ class InputManagerPrivate : public QObject
 
   signals:
     void gotBarCode(int type, int id);
+
+  protected:
+    void timerEvent(QTimerEvent *event);
 };
 
 #endif
@@ -28,6 +28,7 @@
 #include "dspSingleLevelWhereUsed.h"
 #include "dspSingleLevelBOM.h"
 #include "item.h"
+#include "workbenchPages.h"
 
 #include <parameter.h>
 
@@ -43,12 +44,18 @@ public:
 
 public slots:
     virtual SetResponse set( const ParameterList & pParams );
+    virtual QWidget *createPage(QWidget *pPage);
     virtual void populate();
     virtual void sFillList();
     virtual void sHandleButtons();
 
+signals:
+    void pageCreated(QWidget *pPage);
+
 protected slots:
     virtual void languageChange();
+    virtual void sCreatePage(QWidget *pPage);
+    virtual void sRefreshPage(QWidget *pPage);
 
 protected:
   dspCostedIndentedBOM *_dspCostedIndentedBOM;
@@ -65,6 +72,8 @@ protected:
   dspSingleLevelWhereUsed *_dspSingleLevelWhereUsed;
   dspSingleLevelBOM *_dspSingleLevelBOM;
   item *_itemMaster;
+  WorkbenchPages *_pages;
+  bool _sold;
 
 };
 
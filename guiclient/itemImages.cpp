@@ -12,7 +12,8 @@
 
 #include <QVariant>
 #include <QImage>
-#include <quuencode.h>
+
+#include "ximagecache.h"
 
 itemImages::itemImages(QWidget* parent, const char* name, Qt::WindowFlags fl)
   : XWidget(parent, name, fl)
@@ -24,6 +25,8 @@ itemImages::itemImages(QWidget* parent, const char* name, Qt::WindowFlags fl)
   connect(_prev, SIGNAL(clicked()), this, SLOT(sPrevious()));
   connect(_next, SIGNAL(clicked()), this, SLOT(sNext()));
   connect(_item, SIGNAL(newId(int)), this, SLOT(sFillList()));
+  connect(XImageCache::instance(), SIGNAL(decoded(int, QImage)),
+          this,                    SLOT(sImageDecoded(int, QImage)));
 
 #ifndef Q_OS_MAC
   _prev->setMaximumWidth(25);
@@ -68,7 +71,7 @@ void itemImages::sNext()
 
 void itemImages::sFillList()
 {
-  _images.prepare( "SELECT imageass_id, image_data, image_descrip,"
+  _images.prepare( "SELECT imageass_id, image_id, image_descrip,"
                    "       CASE WHEN (imageass_purpose='I') THEN :inventoryDescription"
                    "            WHEN (imageass_purpose='P') THEN :productDescription"
                    "            WHEN (imageass_purpose='E') THEN :engineeringReference"
@@ -104,8 +107,26 @@ void itemImages::loadImage()
 
   _description->setText(_images.value("purpose").toString() + " - " + _images.value("image_descrip").toString());
 
-  QImage image;
-  image.loadFromData(QUUDecode(_images.value("image_data").toString()));
-  _image->setPixmap(QPixmap::fromImage(image));
+  // show nothing until the image is decoded, sImageDecoded() fills it in
+  QImage image = XImageCache::instance()->fetch(_images.value("image_id").toInt());
+  if (image.isNull())
+    _image->clear();
+  else
+    _image->setPixmap(QPixmap::fromImage(image));
+
+  // start decoding the neighbors so paging through them doesn't wait
+  int current = _images.at();
+  if (_images.next())
+    XImageCache::instance()->fetch(_images.value("image_id").toInt());
+  if (_images.seek(current - 1))
+    XImageCache::instance()->fetch(_images.value("image_id").toInt());
+  _images.seek(current);
+}
+
+void itemImages::sImageDecoded(int pImageid, const QImage &pImage)
+{
+  if (_images.isValid() && _images.value("image_id").toInt() == pImageid &&
+      ! pImage.isNull())
+    _image->setPixmap(QPixmap::fromImage(pImage));
 }
 
@@ -13,6 +13,8 @@
 
 #include "guiclient.h"
 #include "xwidget.h"
+#include <QImage>
+
 #include <parameter.h>
 
 #include "ui_itemImages.h"
@@ -34,6 +36,7 @@ public slots:
 
 protected slots:
     virtual void languageChange();
+    virtual void sImageDecoded(int pImageid, const QImage &pImage);
 
 private:
     XSqlQuery _images;
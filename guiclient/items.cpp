@@ -29,6 +29,8 @@ items::items(QWidget* parent, const char*, Qt::WindowFlags fl)
   setWindowTitle(tr("Items"));
   setReportName("Items");
   setMetaSQLOptions("items", "detail");
+  setUseReadReplica(true);
+  setPageSize(200);
   setNewVisible(true);
   setSearchVisible(true);
   setQueryOnStartEnabled(true);
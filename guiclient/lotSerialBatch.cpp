@@ -0,0 +1,467 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "lotSerialBatch.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QRegExp>
+#include <QSqlError>
+#include <QVariant>
+
+#include "guiclient.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+#define MAXRANGE 100000
+
+static int _blockSize = 500;
+
+/* Build a PostgreSQL array literal so a whole list can be bound as one
+   parameter. Every element is quoted since Lot/Serial #s can contain
+   commas, braces and quotes.
+ */
+static QString toArray(const QStringList &list)
+{
+  QStringList quoted;
+  foreach (QString element, list)
+    quoted << "\"" + element.replace("\\", "\\\\").replace("\"", "\\\"") + "\"";
+  return "{" + quoted.join(",") + "}";
+}
+
+static QString toArray(const QList<double> &list)
+{
+  QStringList numbers;
+  foreach (double element, list)
+    numbers << QString::number(element, 'g', 15);
+  return "{" + numbers.join(",") + "}";
+}
+
+/* Undo what distribute() did since its savepoint and drop the savepoint,
+   leaving the caller's transaction as it was, or end the transaction
+   distribute() began for itself.
+ */
+static void rollbackBatch(bool ownTransaction)
+{
+  XSqlQuery rollback("ROLLBACK TO SAVEPOINT lotserialbatch;");
+  XSqlQuery release("RELEASE SAVEPOINT lotserialbatch;");
+  if (ownTransaction)
+    XSqlQuery end("ROLLBACK;");
+}
+
+LotSerialBatch::LotSerialBatch(QObject *parent)
+  : QObject(parent),
+    _canceled(false),
+    _itemid(-1),
+    _itemlocdistid(-1),
+    _itemlocSeries(-1),
+    _itemsiteid(-1),
+    _lsseqid(-1),
+    _fractional(false),
+    _perishable(false),
+    _serial(false),
+    _warranty(false),
+    _qtyRemaining(0.0)
+{
+}
+
+/** Get ready to assign Lot/Serial #s to the given distribution, adding
+    them to the given itemloc series.
+ */
+bool LotSerialBatch::setItemlocdist(int itemlocdistid, int itemlocSeries)
+{
+  _itemlocdistid = itemlocdistid;
+  _itemlocSeries = itemlocSeries;
+  _preassigned.clear();
+  clear();
+
+  XSqlQuery ild;
+  ild.prepare("SELECT item_id, item_fractional, itemsite_id,"
+              "       itemsite_controlmethod, itemsite_perishable, itemsite_warrpurc,"
+              "       COALESCE(itemsite_lsseq_id,-1) AS itemsite_lsseq_id,"
+              "       itemlocdist_order_type AS ordtype,"
+              "       itemlocdist_qty - COALESCE((SELECT SUM(c.itemlocdist_qty)"
+              "                                     FROM itemlocdist c"
+              "                                    WHERE c.itemlocdist_series=:itemlocseries), 0)"
+              "         AS remaining"
+              "  FROM itemlocdist"
+              "  JOIN itemsite ON itemlocdist_itemsite_id = itemsite_id"
+              "  JOIN item ON itemsite_item_id = item_id"
+              " WHERE itemlocdist_id = :itemlocdist_id;");
+  ild.bindValue(":itemlocdist_id", _itemlocdistid);
+  ild.bindValue(":itemlocseries",  _itemlocSeries);
+  ild.exec();
+  if (! ild.first())
+  {
+    _lastError = ild.lastError().type() != QSqlError::NoError
+               ? ild.lastError().databaseText()
+               : tr("Could not find the distribution to assign Lot/Serial #s to.");
+    return false;
+  }
+
+  _itemid       = ild.value("item_id").toInt();
+  _itemsiteid   = ild.value("itemsite_id").toInt();
+  _lsseqid      = ild.value("itemsite_lsseq_id").toInt();
+  _fractional   = ild.value("item_fractional").toBool();
+  _perishable   = ild.value("itemsite_perishable").toBool();
+  _serial       = ild.value("itemsite_controlmethod").toString() == "S";
+  _warranty     = ild.value("itemsite_warrpurc").toBool() && ild.value("ordtype").toString() == "PO";
+  _qtyRemaining = ild.value("remaining").toDouble();
+
+  // numbers associated with the original transaction may be reused
+  XSqlQuery assoc;
+  assoc.prepare("SELECT UPPER(ls_number) AS lotserial"
+                "  FROM ls"
+                " WHERE ls_id = ANY(getAssocLotSerialIds(pItemlocdistId := :itemlocdist_id));");
+  assoc.bindValue(":itemlocdist_id", _itemlocdistid);
+  assoc.exec();
+  while (assoc.next())
+    _preassigned.insert(assoc.value("lotserial").toString());
+  if (assoc.lastError().type() != QSqlError::NoError)
+  {
+    _lastError = assoc.lastError().databaseText();
+    return false;
+  }
+
+  return true;
+}
+
+void LotSerialBatch::clear()
+{
+  _lotserials.clear();
+  _qtys.clear();
+  _errors.clear();
+  _existing.clear();
+  _lastError.clear();
+}
+
+void LotSerialBatch::append(const QString &lotserial, double qty)
+{
+  QString number = lotserial.trimmed().toUpper();
+  if (number.isEmpty())
+    return;
+  _lotserials.append(number);
+  _qtys.append(_serial ? 1.0 : qty);
+}
+
+/** Add one Lot/Serial # per line, as pasted from a spreadsheet or typed
+    by a scanner. A Lot # may be followed by a tab, comma or semicolon and
+    its own quantity; otherwise it gets @a qty.
+
+    @return the number of Lot/Serial #s added
+ */
+int LotSerialBatch::appendList(const QString &text, double qty)
+{
+  int before = count();
+  foreach (QString line, text.split(QRegExp("[\\r\\n]+"), QString::SkipEmptyParts))
+  {
+    double lineqty = qty;
+    if (! _serial)
+    {
+      QStringList fields = line.split(QRegExp("[\\t,;]"));
+      bool ok = false;
+      if (fields.size() == 2)
+        lineqty = fields.at(1).trimmed().toDouble(&ok);
+      if (ok)
+        line = fields.at(0);
+      else
+        lineqty = qty;
+    }
+    append(line, lineqty);
+  }
+  return count() - before;
+}
+
+/** Add every Lot/Serial # from @a from through @a to, such as SN00100
+    through SN00299. Both ends must have the same text around the
+    number, and the number keeps the width it has in @a from.
+ */
+bool LotSerialBatch::appendRange(const QString &from, const QString &to, double qty)
+{
+  QRegExp pattern("^(.*\\D)?(\\d+)(\\D*)$");
+
+  QString first = from.trimmed().toUpper();
+  QString last  = to.trimmed().toUpper();
+  if (! pattern.exactMatch(first))
+  {
+    _lastError = tr("%1 does not end with a number.").arg(first);
+    return false;
+  }
+  QString prefix = pattern.cap(1);
+  QString digits = pattern.cap(2);
+  QString suffix = pattern.cap(3);
+
+  if (! pattern.exactMatch(last) || pattern.cap(1) != prefix || pattern.cap(3) != suffix)
+  {
+    _lastError = tr("%1 and %2 must only differ by their numbers.").arg(first, last);
+    return false;
+  }
+  if (digits.length() > 18 || pattern.cap(2).length() > 18)
+  {
+    _lastError = tr("The numbers in %1 and %2 are too long.").arg(first, last);
+    return false;
+  }
+  qlonglong start = digits.toLongLong();
+  qlonglong end   = pattern.cap(2).toLongLong();
+  if (end < start)
+  {
+    _lastError = tr("%1 comes after %2.").arg(first, last);
+    return false;
+  }
+  if (end - start >= MAXRANGE)
+  {
+    _lastError = tr("%1 through %2 is more than %3 Lot/Serial #s.")
+                   .arg(first, last).arg(MAXRANGE);
+    return false;
+  }
+
+  for (qlonglong i = start; i <= end; i++)
+    append(prefix + QString("%1").arg(i, digits.length(), 10, QChar('0')) + suffix, qty);
+  return true;
+}
+
+/** Add @a count numbers from the Item Site's Lot/Serial sequence, all
+    fetched with one query.
+ */
+bool LotSerialBatch::appendSequence(int count, double qty)
+{
+  if (! hasSequence())
+  {
+    _lastError = tr("This Item Site does not have a Lot/Serial sequence.");
+    return false;
+  }
+  if (count <= 0)
+    return true;
+
+  XSqlQuery seq;
+  seq.prepare("SELECT fetchlsnumber(:lsseq_id) AS lotserial"
+              "  FROM generate_series(1, :count);");
+  seq.bindValue(":lsseq_id", _lsseqid);
+  seq.bindValue(":count",    count);
+  seq.exec();
+  while (seq.next())
+    append(seq.value("lotserial").toString(), qty);
+  if (seq.lastError().type() != QSqlError::NoError)
+  {
+    _lastError = seq.lastError().databaseText();
+    return false;
+  }
+  return true;
+}
+
+double LotSerialBatch::totalQty() const
+{
+  double total = 0.0;
+  foreach (double qty, _qtys)
+    total += qty;
+  return total;
+}
+
+/** Check every Lot/Serial # the way Create Lot/Serial # checks one:
+    quantities, numbers listed twice, and Serial #s already in use. The
+    database is checked for all of them with one query.
+
+    Lot #s that already exist are not errors; they are listed in
+    existing() so the caller can ask before referencing them.
+ */
+bool LotSerialBatch::validate()
+{
+  _errors.clear();
+  _existing.clear();
+  _lastError.clear();
+
+  if (_lotserials.isEmpty())
+  {
+    _errors << tr("There are no Lot/Serial #s to assign.");
+    return false;
+  }
+
+  QHash<QString, int> seen;
+  for (int i = 0; i < _lotserials.size(); i++)
+  {
+    QString number = _lotserials.at(i);
+    double  qty    = _qtys.at(i);
+    if (seen.contains(number))
+    {
+      if (seen[number]++ == 1)
+        _errors << tr("%1 is listed more than once.").arg(number);
+      continue;
+    }
+    seen.insert(number, 1);
+
+    if (qty <= 0.0)
+      _errors << tr("%1: You must enter a positive quantity.").arg(number);
+    else if (! _fractional && qty != qRound64(qty))
+      _errors << tr("%1: The Item is not stored in fractional quantities.").arg(number);
+  }
+
+  if (totalQty() > _qtyRemaining + 0.0000001)
+    _errors << tr("These Lot/Serial #s total %1 but only %2 remain to be assigned.")
+                 .arg(totalQty()).arg(_qtyRemaining);
+
+  XSqlQuery used;
+  if (_serial)
+    used.prepare("SELECT UPPER(ls_number) AS lotserial"
+                 "  FROM itemsite"
+                 "  JOIN itemloc ON itemloc_itemsite_id = itemsite_id"
+                 "  JOIN ls ON ls_id = itemloc_ls_id"
+                 " WHERE itemsite_item_id = :item_id"
+                 "   AND UPPER(ls_number) = ANY(CAST(:lotserials AS TEXT[]))"
+                 " UNION "
+                 "SELECT UPPER(ls_number) AS lotserial"
+                 "  FROM itemsite"
+                 "  JOIN itemlocdist ON itemlocdist_itemsite_id = itemsite_id"
+                 "  JOIN ls ON ls_id = itemlocdist_ls_id"
+                 " WHERE itemsite_item_id = :item_id"
+                 "   AND UPPER(ls_number) = ANY(CAST(:lotserials AS TEXT[]))"
+                 "   AND itemlocdist_source_type = 'D';");
+  else
+    used.prepare("SELECT DISTINCT UPPER(ls_number) AS lotserial"
+                 "  FROM ls"
+                 " WHERE ls_item_id = :item_id"
+                 "   AND UPPER(ls_number) = ANY(CAST(:lotserials AS TEXT[]));");
+  used.bindValue(":item_id",    _itemid);
+  used.bindValue(":lotserials", toArray(seen.keys()));
+  used.exec();
+  while (used.next())
+  {
+    QString number = used.value("lotserial").toString();
+    if (_preassigned.contains(number))
+      continue;
+    if (_serial)
+      _errors << tr("Serial # %1 has already been used and cannot be reused.").arg(number);
+    else
+      _existing << number;
+  }
+  if (used.lastError().type() != QSqlError::NoError)
+  {
+    _lastError = used.lastError().databaseText();
+    _errors << _lastError;
+  }
+
+  return _errors.isEmpty();
+}
+
+/** Create every Lot/Serial # and its distribution detail. The work is
+    done blockSize() numbers per query under a savepoint, with progress()
+    emitted between blocks. If a block fails or cancel() is called, the
+    batch is rolled back to the savepoint. If the caller has a transaction
+    open it stays open and the batch commits with it; otherwise the batch
+    runs in a transaction of its own.
+ */
+bool LotSerialBatch::distribute(const QDate &expiration, const QDate &warranty)
+{
+  _canceled = false;
+  _lastError.clear();
+
+  int total = count();
+  if (DEBUG)
+    qDebug() << "LotSerialBatch::distribute() creating" << total
+             << "in blocks of" << _blockSize;
+
+  /* Inside a transaction block every statement starts after the
+     transaction did. If the caller's transaction has already failed this
+     query fails too, and the transaction is left for the caller to roll
+     back.
+   */
+  XSqlQuery state("SELECT statement_timestamp() <> transaction_timestamp()"
+                  "       AS intransaction;");
+  if (! state.first())
+  {
+    _lastError = state.lastError().databaseText();
+    return false;
+  }
+  bool ownTransaction = ! state.value("intransaction").toBool();
+  if (ownTransaction)
+    XSqlQuery begin("BEGIN;");
+
+  XSqlQuery mark("SAVEPOINT lotserialbatch;");
+  if (mark.lastError().type() != QSqlError::NoError)
+  {
+    _lastError = mark.lastError().databaseText();
+    if (ownTransaction)
+      XSqlQuery rollback("ROLLBACK;");
+    return false;
+  }
+
+  XSqlQuery create;
+  create.prepare("SELECT createlotserial(:itemsite_id, batch.lotserial, :itemlocseries, 'I', NULL,"
+                 "                       :itemlocdist_id, batch.qty, :expiration, :warranty) AS id"
+                 "  FROM unnest(CAST(:lotserials AS TEXT[]), CAST(:qtys AS NUMERIC[]))"
+                 "       AS batch(lotserial, qty);");
+  for (int start = 0; start < total; start += _blockSize)
+  {
+    emit progress(start, total);
+    if (_canceled)
+    {
+      rollbackBatch(ownTransaction);
+      _lastError = tr("Assigning Lot/Serial #s was canceled.");
+      return false;
+    }
+
+    create.bindValue(":itemsite_id",    _itemsiteid);
+    create.bindValue(":itemlocseries",  _itemlocSeries);
+    create.bindValue(":itemlocdist_id", _itemlocdistid);
+    create.bindValue(":lotserials",     toArray(_lotserials.mid(start, _blockSize)));
+    create.bindValue(":qtys",           toArray(_qtys.mid(start, _blockSize)));
+    if (_perishable)
+      create.bindValue(":expiration", expiration);
+    else
+      create.bindValue(":expiration", omfgThis->endOfTime());
+    if (_warranty)
+      create.bindValue(":warranty", warranty);
+    else
+      create.bindValue(":warranty", QVariant(QVariant::Date));
+    create.exec();
+    if (create.lastError().type() != QSqlError::NoError)
+    {
+      _lastError = create.lastError().databaseText();
+      rollbackBatch(ownTransaction);
+      return false;
+    }
+  }
+
+  XSqlQuery release("RELEASE SAVEPOINT lotserialbatch;");
+  if (release.lastError().type() != QSqlError::NoError)
+  {
+    _lastError = release.lastError().databaseText();
+    rollbackBatch(ownTransaction);
+    return false;
+  }
+  if (ownTransaction)
+  {
+    XSqlQuery commit("COMMIT;");
+    if (commit.lastError().type() != QSqlError::NoError)
+    {
+      _lastError = commit.lastError().databaseText();
+      return false;
+    }
+  }
+
+  emit progress(total, total);
+  return true;
+}
+
+void LotSerialBatch::cancel()
+{
+  _canceled = true;
+}
+
+/** How many Lot/Serial #s distribute() creates per query. */
+int LotSerialBatch::blockSize()
+{
+  return _blockSize;
+}
+
+void LotSerialBatch::setBlockSize(int size)
+{
+  _blockSize = qMax(1, size);
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef LOTSERIALBATCH_H
+#define LOTSERIALBATCH_H
+
+#include <QDate>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/** @class LotSerialBatch
+    @brief Assigns many Lot/Serial #s to one distribution at a time.
+
+    Collect the numbers from ranges, pasted or scanned lists, or the
+    Item Site's Lot/Serial sequence, check them all with one query with
+    validate(), then create them with distribute(). Numbers are created
+    blockSize() at a time under a savepoint, so either all of them are
+    assigned or, if anything fails or the user cancels, none are. A
+    transaction the caller already has open is left open.
+ */
+class LotSerialBatch : public QObject
+{
+  Q_OBJECT
+
+  public:
+    LotSerialBatch(QObject *parent = 0);
+
+    bool        setItemlocdist(int itemlocdistid, int itemlocSeries);
+
+    int         itemsiteId()   const { return _itemsiteid; }
+    bool        isSerial()     const { return _serial; }
+    bool        isFractional() const { return _fractional; }
+    bool        isPerishable() const { return _perishable; }
+    bool        hasWarranty()  const { return _warranty; }
+    bool        hasSequence()  const { return _lsseqid > 0; }
+    double      qtyRemaining() const { return _qtyRemaining; }
+
+    void        clear();
+    void        append(const QString &lotserial, double qty = 1.0);
+    int         appendList(const QString &text, double qty = 1.0);
+    bool        appendRange(const QString &from, const QString &to, double qty = 1.0);
+    bool        appendSequence(int count, double qty = 1.0);
+
+    int         count()      const { return _lotserials.size(); }
+    QStringList lotSerials() const { return _lotserials; }
+    double      totalQty()   const;
+
+    bool        validate();
+    QStringList errors()   const { return _errors; }
+    QStringList existing() const { return _existing; }
+
+    bool        distribute(const QDate &expiration, const QDate &warranty = QDate());
+    QString     lastError() const { return _lastError; }
+
+    static int  blockSize();
+    static void setBlockSize(int size);
+
+  public slots:
+    void        cancel();
+
+  signals:
+    void        progress(int done, int total);
+
+  private:
+    bool          _canceled;
+    int           _itemid;
+    int           _itemlocdistid;
+    int           _itemlocSeries;
+    int           _itemsiteid;
+    int           _lsseqid;
+    bool          _fractional;
+    bool          _perishable;
+    bool          _serial;
+    bool          _warranty;
+    double        _qtyRemaining;
+    QSet<QString> _preassigned;
+    QStringList   _lotserials;
+    QList<double> _qtys;
+    QStringList   _errors;
+    QStringList   _existing;
+    QString       _lastError;
+};
+
+#endif // LOTSERIALBATCH_H
@@ -89,6 +89,7 @@
 #include <stdlib.h>
 
 #include <QApplication>
+#include <QDir>
 #include <QFile>
 #include <QHash>
 #include <QImage>
@@ -131,6 +132,8 @@
 
 #include "splashconst.h"
 #include "xtsettings.h"
+#include "xttrace.h"
+#include "xreadreplica.h"
 
 #include <QtPlugin>
 Q_IMPORT_PLUGIN(xTuplePlugin)
@@ -159,6 +162,7 @@ int main(int argc, char *argv[])
   bool    haveEnhancedAuth= false;
   bool    _enhancedAuth   = false;
   bool    havePasswd      = false;
+  QString replicaURL;
 #if QT_VERSION >= 0x050000
   qInstallMessageHandler(xTupleMessageOutput);
 #else
@@ -211,6 +215,10 @@ int main(int argc, char *argv[])
         if(argument.contains("=no", Qt::CaseInsensitive) || argument.contains("=false", Qt::CaseInsensitive))
           _enhancedAuth = false;
       }
+      else if (argument.contains("-trace=", Qt::CaseInsensitive))
+        XtTrace::start(argument.right(argument.length() - 7));
+      else if (argument.contains("-replicaURL=", Qt::CaseInsensitive))
+        replicaURL = argument.right(argument.length() - 12);
     }
   }
 
@@ -527,10 +535,14 @@ int main(int argc, char *argv[])
     url.addQueryItem("tot", QString::number(tot));
     url.addQueryItem("ver", _Version);
 #endif
-    QMutex wait;
-    xtNetworkRequestManager _networkManager(url, wait);
+    xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
+    int notice = network->get(url, xtNetworkRequestManager::NoCache);
     if(forced)
+    {
+      network->wait(notice);  // give the notice a chance to go out before quitting
       return 0;
+    }
+    network->detach(notice);
 
     _splash->show();
   }
@@ -576,6 +588,19 @@ int main(int argc, char *argv[])
   _splash->showMessage(QObject::tr("Loading User Preferences"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
   _preferences = new Preferences(username);
+  if (! XtTrace::isEnabled() && _preferences->boolean("TraceWindows"))
+    XtTrace::start(QDir::temp().filePath("xtuple-trace.json"));
+
+  if (replicaURL.isEmpty())
+    replicaURL = _metrics->value("ReadReplicaURL");
+  if (! replicaURL.isEmpty())
+  {
+    _splash->showMessage(QObject::tr("Connecting to the Read Replica"), SplashTextAlignment, SplashTextColor);
+    qApp->processEvents();
+    if (_metrics->value("ReadReplicaMaxLag").length())
+      XReadReplica::setMaxLag(_metrics->value("ReadReplicaMaxLag").toInt());
+    XReadReplica::open(replicaURL);
+  }
 
   _splash->showMessage(QObject::tr("Loading User Privileges"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
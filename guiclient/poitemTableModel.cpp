@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -13,6 +13,7 @@
 #include "poitemTableModel.h"
 
 #include <QMessageBox>
+#include <QModelIndex>
 #include <QSqlError>
 #include <QSqlField>
 #include <QSqlRecord>
@@ -73,6 +74,7 @@ PoitemTableModel::PoitemTableModel(QObject * parent, QSqlDatabase db) :
 
   _poheadid	= -1;
   _poitemid	= -1;
+  _batching	= false;
   findHeadData();
   _dirty = false;
 
@@ -201,8 +203,18 @@ bool PoitemTableModel::select()
 
 bool PoitemTableModel::submitAll()
 {
+  if (! prepareRows())
+  {
+    clearBatch();
+    if (lastError().type() != QSqlError::NoError)
+      ErrorReporter::error(QtCriticalMsg, 0, tr("Error Saving PO Information"),
+                           lastError().databaseText(), __FILE__, __LINE__);
+    return false;
+  }
+
   XSqlQuery begin("BEGIN;");
   bool returnVal = QSqlRelationalTableModel::submitAll();
+  clearBatch();
   if (returnVal)
   {
     _dirty = false;
@@ -241,16 +253,13 @@ bool PoitemTableModel::removeRow(int row, const QModelIndex & parent)
 }
 
 /*
-    Make sure the row is internally consistent. If so then fix it so the
-    parent class has a valid row to insert (some of the SELECTed columns
-    shouldn't be directly modified in the db 'cause they're not part of the
-    model's current table).
+    Check the row on its own, without looking anything up. Problems that
+    keep it from being saved go in errormsg, ones the user may choose to
+    ignore in warningmsg.
 */
-bool PoitemTableModel::validRow(QSqlRecord& record)
+void PoitemTableModel::checkRow(const QSqlRecord& record, QString& errormsg,
+                                QString& warningmsg) const
 {
-  QString errormsg;
-  QString warningmsg;
-
   // TODO: what is a better way to decide if this is an inventory item or not?
   bool inventoryItem = ! record.value("item_number").toString().isEmpty();
 
@@ -301,32 +310,60 @@ bool PoitemTableModel::validRow(QSqlRecord& record)
     errormsg = tr("<p>There is no Purchase Order header yet. "
 	     "Try entering a Vendor if you are using the Purchase Order "
 	     "window.");
+}
 
-  else if (inventoryItem &&
-	   record.value("item_id").toInt() > 0 &&
-	   record.value("warehous_id").toInt() > 0)
+/*
+    Make sure the row is internally consistent. If so then fix it so the
+    parent class has a valid row to insert (some of the SELECTed columns
+    shouldn't be directly modified in the db 'cause they're not part of the
+    model's current table).
+
+    While submitAll() is saving, the rows have already been checked and
+    warned about together and the lookups done in bulk by prepareRows(),
+    so this only takes its answers from there.
+*/
+bool PoitemTableModel::validRow(QSqlRecord& record)
+{
+  QString errormsg;
+  QString warningmsg;
+
+  checkRow(record, errormsg, warningmsg);
+
+  bool inventoryItem = ! record.value("item_number").toString().isEmpty();
+  if (errormsg.isEmpty() &&
+      inventoryItem &&
+      record.value("item_id").toInt() > 0 &&
+      record.value("warehous_id").toInt() > 0)
   {
-    XSqlQuery isq;
-    isq.prepare("SELECT itemsite_id, item_id "
-		"FROM itemsite, item "
-		"WHERE ((itemsite_item_id=item_id)"
-		"  AND  (itemsite_warehous_id=:whs_id)"
-		"  AND  (item_id=:item_id));");
-    isq.bindValue(":whs_id", record.value("warehous_id").toInt());
-    isq.bindValue(":item_id", record.value("item_id").toInt());
-    isq.exec();
-    if (isq.first())
+    QPair<int, int> key(record.value("item_id").toInt(),
+                        record.value("warehous_id").toInt());
+    int itemsiteid = _batchItemsites.value(key, -1);
+    if (itemsiteid < 0 && ! _batching)
+    {
+      XSqlQuery isq;
+      isq.prepare("SELECT itemsite_id, item_id "
+                  "FROM itemsite, item "
+                  "WHERE ((itemsite_item_id=item_id)"
+                  "  AND  (itemsite_warehous_id=:whs_id)"
+                  "  AND  (item_id=:item_id));");
+      isq.bindValue(":whs_id", key.second);
+      isq.bindValue(":item_id", key.first);
+      isq.exec();
+      if (isq.first())
+        itemsiteid = isq.value("itemsite_id").toInt();
+      else if (isq.lastError().type() != QSqlError::NoError)
+        errormsg = isq.lastError().databaseText();
+    }
+
+    if (itemsiteid > 0)
     {
-      int itemsiteid = isq.value("itemsite_id").toInt();
       if (itemsiteid != record.value("poitem_itemsite_id").toInt())
 	record.setValue("poitem_itemsite_id", itemsiteid);
     }
-    else if (isq.lastError().type() != QSqlError::NoError)
-      errormsg = isq.lastError().databaseText();
-    else
+    else if (errormsg.isEmpty())
       errormsg = tr("<p>There is no Item Site for this Site (%1) and "
 	       "Item Number (%2).")
-	       .arg(record.value("warehous_code").toInt())
+	       .arg(record.value("warehous_code").toString())
 	       .arg(record.value("item_number").toString());
   }
 
@@ -340,54 +377,17 @@ bool PoitemTableModel::validRow(QSqlRecord& record)
   else
     record.setValue(index, _poheadid);
 
-  XSqlQuery ln;
-  /*
-  ln.prepare("SELECT MAX(poitem_linenumber) + 1 AS newln "
-	     "FROM poitem "
-	     "WHERE (poitem_pohead_id=:pohead_id);");
-             */
-  // get the smallest available line number
-  ln.prepare("SELECT MIN(sequence_value) AS newln "
-             "FROM sequence "
-             "WHERE sequence_value NOT IN (SELECT poitem_linenumber "
-             "                             FROM poitem"
-             "                             WHERE (poitem_pohead_id=:pohead_id));");
-  ln.bindValue(":pohead_id", _poheadid);
   if (record.indexOf("poitem_linenumber") < 0)
   {
-    ln.exec();
-    if (ln.first())
-    {
-      QSqlField field("poitem_linenumber", QVariant::Int);
-      field.setValue(ln.value("newln"));
-      record.append(field);
-    }
-    else if (ln.lastError().type() != QSqlError::NoError)
-    {
-      errormsg = ln.lastError().databaseText();
-    }
+    QSqlField field("poitem_linenumber", QVariant::Int);
+    field.setValue(nextLineNumber(errormsg));
+    record.append(field);
   }
   else if (record.value("poitem_linenumber").toInt() <= 0)
-  {
-    ln.exec();
-    if (ln.first())
-      record.setValue("poitem_linenumber", ln.value("newln"));
-    else if (ln.lastError().type() != QSqlError::NoError)
-    {
-      errormsg = ln.lastError().databaseText();
-    }
-  }
+    record.setValue("poitem_linenumber", nextLineNumber(errormsg));
 
   if (record.value("poitem_id").isNull())
-  {
-    XSqlQuery idq("SELECT NEXTVAL('poitem_poitem_id_seq') AS poitem_id;");
-    if (idq.first())
-      record.setValue("poitem_id", idq.value("poitem_id"));
-    else
-    {
-      errormsg = idq.lastError().databaseText();
-    }
-  }
+    record.setValue("poitem_id", nextPoitemId(errormsg));
 
   if (_postatus.isEmpty())
     findHeadData();
@@ -414,7 +414,7 @@ bool PoitemTableModel::validRow(QSqlRecord& record)
 			   errormsg, QSqlError::UnknownError));
     return false;
   }
-  else if (! warningmsg.isEmpty())
+  else if (! warningmsg.isEmpty() && ! _batching)
   {
     if (QMessageBox::question(0, tr("Are you sure you want to continue?"),
 		    warningmsg + tr("<p>Do you wish to Save this Order?"),
@@ -441,6 +441,41 @@ bool PoitemTableModel::validRow(QSqlRecord& record)
 }
 
 bool PoitemTableModel::insertRowIntoTable(const QSqlRecord& record)
+{
+  if (isBlank(record))
+    return true;
+
+  QSqlRecord newRecord(record);
+  if (! validRow(newRecord))
+    return false;
+
+  return QSqlRelationalTableModel::insertRowIntoTable(newRecord);
+}
+
+bool PoitemTableModel::updateRowInTable(int row, const QSqlRecord& record)
+{
+  // touch everything so we can distinguish unchanged fields from NULL/0 as new val
+  for (int i = 0; i < columnCount(); i++)
+    setData(index(row, i), data(index(row, i)));
+
+  QSqlRecord newRecord(record);
+  if (! validRow(newRecord))
+    return false;
+
+  return QSqlRelationalTableModel::updateRowInTable(row, newRecord);
+}
+
+void PoitemTableModel::markDirty(QModelIndex, QModelIndex)
+{
+  _dirty = true;
+
+  disconnect(this, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(markDirty(QModelIndex, QModelIndex)));
+}
+
+/* A row nobody has typed anything into, like the one select() leaves at
+   the bottom for entering the next line.
+*/
+bool PoitemTableModel::isBlank(const QSqlRecord& record) const
 {
   if (record.isEmpty())
     return true;
@@ -458,32 +493,281 @@ bool PoitemTableModel::insertRowIntoTable(const QSqlRecord& record)
       continue;
     isNull &= record.isNull(i);
   }
-  if (isNull)
+  return isNull;
+}
+
+/* The rows submitAll() will insert or update, in the order it will. */
+QList<int> PoitemTableModel::pendingRows() const
+{
+  QList<int> rows;
+  for (int row = 0; row < rowCount(); row++)
+  {
+    if (! isDirty(index(row, 0)) ||
+        headerData(row, Qt::Vertical).toString() == "!" ||   // being deleted
+        isBlank(record(row)))
+      continue;
+    rows.append(row);
+  }
+  return rows;
+}
+
+QString PoitemTableModel::rowLabel(int row, const QSqlRecord& record) const
+{
+  int linenumber = record.value("poitem_linenumber").toInt();
+  return linenumber > 0 ? tr("Line %1").arg(linenumber)
+                        : tr("Row %1").arg(row + 1);
+}
+
+/*
+    Check every pending row and look up all of their Item Sites with one
+    query. Each problem is prefixed with the row it belongs to.
+    Returns false if the lookup itself failed.
+*/
+bool PoitemTableModel::checkRows(QStringList& errors, QStringList& warnings)
+{
+  _batchItemsites.clear();
+
+  QList<int> rows = pendingRows();
+  QList<int> lookupRows;
+  QStringList items;
+  QStringList sites;
+  foreach (int row, rows)
+  {
+    QSqlRecord rec = record(row);
+    QString errormsg;
+    QString warningmsg;
+    checkRow(rec, errormsg, warningmsg);
+    if (! errormsg.isEmpty())
+      errors << QString("<p>%1: %2").arg(rowLabel(row, rec), errormsg.remove("<p>"));
+    if (! warningmsg.isEmpty())
+      warnings << QString("<p>%1: %2").arg(rowLabel(row, rec), warningmsg.remove("<p>"));
+
+    if (errormsg.isEmpty() &&
+        ! rec.value("item_number").toString().isEmpty() &&
+        rec.value("item_id").toInt() > 0 && rec.value("warehous_id").toInt() > 0)
+    {
+      lookupRows << row;
+      items << QString::number(rec.value("item_id").toInt());
+      sites << QString::number(rec.value("warehous_id").toInt());
+    }
+  }
+
+  if (lookupRows.isEmpty())
     return true;
 
-  QSqlRecord newRecord(record);
-  if (! validRow(newRecord))
+  XSqlQuery isq;
+  isq.prepare("SELECT itemsite_id, itemsite_item_id, itemsite_warehous_id"
+              "  FROM itemsite"
+              "  JOIN unnest(CAST(:items AS INTEGER[]), CAST(:sites AS INTEGER[]))"
+              "       AS wanted(item_id, warehous_id)"
+              "    ON (itemsite_item_id=wanted.item_id"
+              "   AND  itemsite_warehous_id=wanted.warehous_id);");
+  isq.bindValue(":items", "{" + items.join(",") + "}");
+  isq.bindValue(":sites", "{" + sites.join(",") + "}");
+  isq.exec();
+  while (isq.next())
+    _batchItemsites.insert(qMakePair(isq.value("itemsite_item_id").toInt(),
+                                     isq.value("itemsite_warehous_id").toInt()),
+                           isq.value("itemsite_id").toInt());
+  if (isq.lastError().type() != QSqlError::NoError)
+  {
+    setLastError(isq.lastError());
     return false;
+  }
 
-  return QSqlRelationalTableModel::insertRowIntoTable(newRecord);
+  foreach (int row, lookupRows)
+  {
+    QSqlRecord rec = record(row);
+    if (! _batchItemsites.contains(qMakePair(rec.value("item_id").toInt(),
+                                             rec.value("warehous_id").toInt())))
+      errors << QString("<p>%1: %2").arg(rowLabel(row, rec),
+                                         tr("There is no Item Site for this Site (%1) and "
+                                            "Item Number (%2).")
+                                         .arg(rec.value("warehous_code").toString())
+                                         .arg(rec.value("item_number").toString()));
+  }
+  return true;
 }
 
-bool PoitemTableModel::updateRowInTable(int row, const QSqlRecord& record)
+/*
+    Get every pending row ready to save before any of them is: report all
+    of their errors at once, ask about all of their warnings at once, and
+    allocate the line numbers and ids the new rows need in one query
+    each. validRow() takes its answers from here while saving.
+*/
+bool PoitemTableModel::prepareRows()
 {
-  // touch everything so we can distinguish unchanged fields from NULL/0 as new val
-  for (int i = 0; i < columnCount(); i++)
-    setData(index(row, i), data(index(row, i)));
+  clearBatch();
+  setLastError(QSqlError());
 
-  QSqlRecord newRecord(record);
-  if (! validRow(newRecord))
+  QStringList errors;
+  QStringList warnings;
+  if (! checkRows(errors, warnings))
+    return false;
+  if (! errors.isEmpty())
+  {
+    setLastError(QSqlError(QString("PoitemTableModel::prepareRows() error"),
+                           errors.join(""), QSqlError::UnknownError));
+    return false;
+  }
+  if (! warnings.isEmpty() &&
+      QMessageBox::question(0, tr("Are you sure you want to continue?"),
+                            warnings.join("") + tr("<p>Do you wish to Save this Order?"),
+                            QMessageBox::Yes,
+                            QMessageBox::No | QMessageBox::Default) == QMessageBox::No)
     return false;
 
-  return QSqlRelationalTableModel::updateRowInTable(row, newRecord);
+  int needLineNumbers = 0;
+  int needIds = 0;
+  QStringList taken;    // line numbers on rows that aren't saved yet
+  for (int row = 0; row < rowCount(); row++)
+  {
+    int linenumber = data(index(row, POITEM_LINENUMBER_COL)).toInt();
+    if (linenumber > 0)
+      taken << QString::number(linenumber);
+  }
+  foreach (int row, pendingRows())
+  {
+    if (data(index(row, POITEM_LINENUMBER_COL)).toInt() <= 0)
+      needLineNumbers++;
+    if (data(index(row, POITEM_ID_COL)).isNull())
+      needIds++;
+  }
+
+  if (needLineNumbers > 0)
+  {
+    // the smallest available line numbers, as validRow() would pick one at a time
+    XSqlQuery ln;
+    ln.prepare("SELECT sequence_value AS newln "
+               "FROM sequence "
+               "WHERE sequence_value NOT IN (SELECT poitem_linenumber "
+               "                             FROM poitem"
+               "                             WHERE (poitem_pohead_id=:pohead_id))"
+               "  AND sequence_value != ALL (CAST(:taken AS INTEGER[])) "
+               "ORDER BY sequence_value "
+               "LIMIT :count;");
+    ln.bindValue(":pohead_id", _poheadid);
+    ln.bindValue(":taken",     "{" + taken.join(",") + "}");
+    ln.bindValue(":count",     needLineNumbers);
+    ln.exec();
+    while (ln.next())
+      _batchLineNumbers.append(ln.value("newln").toInt());
+    if (ln.lastError().type() != QSqlError::NoError)
+    {
+      setLastError(ln.lastError());
+      return false;
+    }
+  }
+
+  if (needIds > 0)
+  {
+    XSqlQuery idq;
+    idq.prepare("SELECT NEXTVAL('poitem_poitem_id_seq') AS poitem_id "
+                "FROM generate_series(1, :count);");
+    idq.bindValue(":count", needIds);
+    idq.exec();
+    while (idq.next())
+      _batchIds.append(idq.value("poitem_id").toInt());
+    if (idq.lastError().type() != QSqlError::NoError)
+    {
+      setLastError(idq.lastError());
+      return false;
+    }
+  }
+
+  _batching = true;
+  return true;
 }
 
-void PoitemTableModel::markDirty(QModelIndex, QModelIndex)
+void PoitemTableModel::clearBatch()
 {
-  _dirty = true;
+  _batching = false;
+  _batchItemsites.clear();
+  _batchLineNumbers.clear();
+  _batchIds.clear();
+}
 
-  disconnect(this, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(markDirty(QModelIndex, QModelIndex)));
+QVariant PoitemTableModel::nextLineNumber(QString& errormsg)
+{
+  if (! _batchLineNumbers.isEmpty())
+    return _batchLineNumbers.takeFirst();
+
+  // get the smallest available line number
+  XSqlQuery ln;
+  ln.prepare("SELECT MIN(sequence_value) AS newln "
+             "FROM sequence "
+             "WHERE sequence_value NOT IN (SELECT poitem_linenumber "
+             "                             FROM poitem"
+             "                             WHERE (poitem_pohead_id=:pohead_id));");
+  ln.bindValue(":pohead_id", _poheadid);
+  ln.exec();
+  if (ln.first())
+    return ln.value("newln");
+  else if (ln.lastError().type() != QSqlError::NoError)
+    errormsg = ln.lastError().databaseText();
+  return QVariant();
+}
+
+QVariant PoitemTableModel::nextPoitemId(QString& errormsg)
+{
+  if (! _batchIds.isEmpty())
+    return _batchIds.takeFirst();
+
+  XSqlQuery idq("SELECT NEXTVAL('poitem_poitem_id_seq') AS poitem_id;");
+  if (idq.first())
+    return idq.value("poitem_id");
+  errormsg = idq.lastError().databaseText();
+  return QVariant();
+}
+
+/** Add a line with the given column values, such as item_id,
+    warehous_id, poitem_qty_ordered, poitem_unitprice and poitem_duedate,
+    for scripts that build a Purchase Order. Nothing is saved until
+    submitAll(), which checks all of the new lines together.
+
+    @return the new row, or -1 if a column name isn't known
+*/
+int PoitemTableModel::appendLine(const QVariantMap &values)
+{
+  int row = rowCount() - 1;
+  if (row < 0 || ! isBlank(record(row)))
+  {
+    row = rowCount();
+    insertRow(row);
+  }
+
+  for (QVariantMap::const_iterator it = values.constBegin(); it != values.constEnd(); ++it)
+  {
+    int column = record().indexOf(it.key());
+    if (column < 0)
+    {
+      setLastError(QSqlError(QString("PoitemTableModel::appendLine() error"),
+                             tr("There is no column named %1").arg(it.key()),
+                             QSqlError::UnknownError));
+      return -1;
+    }
+    setData(index(row, column), it.value());
+  }
+
+  insertRow(rowCount());  // keep a blank line at the bottom for the editor
+  return row;
+}
+
+/** Check the unsaved lines without saving them.
+
+    @return a map with "errors" and "warnings", each a list of messages
+            that start with the line they are about
+*/
+QVariantMap PoitemTableModel::validateRows()
+{
+  QStringList errors;
+  QStringList warnings;
+  if (! checkRows(errors, warnings))
+    errors << lastError().databaseText();
+  _batchItemsites.clear();
+
+  QVariantMap result;
+  result.insert("errors",   errors);
+  result.insert("warnings", warnings);
+  return result;
 }
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -18,6 +18,8 @@
 #include <QSqlError>
 #include <QSqlRelationalTableModel>
 #include <QString>
+#include <QStringList>
+#include <QVariantMap>
 
 /*
  Represent as a Table Model either the entire POITEM table, the POITEMS for
@@ -93,6 +95,10 @@ class PoitemTableModel : public QSqlRelationalTableModel
     virtual bool	  isDirty() const;
     virtual bool	  removeRow(int, const QModelIndex & = QModelIndex());
     inline virtual QDate  transDate() const {return _poheaddate; };
+
+    Q_INVOKABLE int         appendLine(const QVariantMap &values);
+    Q_INVOKABLE QVariantMap validateRows();
+
     int		_vendid;
     bool	_vendrestrictpurch;
 
@@ -109,6 +115,7 @@ class PoitemTableModel : public QSqlRelationalTableModel
     virtual QString	selectStatement() const;
     virtual bool	updateRowInTable(int, const QSqlRecord&);
     virtual bool	validRow(QSqlRecord&);
+    virtual void	checkRow(const QSqlRecord&, QString&, QString&) const;
 
     QString		_selectStatement;
 
@@ -116,7 +123,22 @@ class PoitemTableModel : public QSqlRelationalTableModel
     virtual void	markDirty(QModelIndex, QModelIndex);
 
   private:
+    void	clearBatch();
+    bool	checkRows(QStringList&, QStringList&);
     void	findHeadData();
+    bool	isBlank(const QSqlRecord&) const;
+    QVariant	nextLineNumber(QString&);
+    QVariant	nextPoitemId(QString&);
+    QList<int>	pendingRows() const;
+    bool	prepareRows();
+    QString	rowLabel(int, const QSqlRecord&) const;
+
+    // looked up for all pending rows at once by prepareRows()
+    bool			_batching;
+    QHash<QPair<int, int>, int>	_batchItemsites; // (item, site) -> itemsite
+    QList<int>			_batchLineNumbers;
+    QList<int>			_batchIds;
+
     bool	_dirty;
     int		_poheadcurrid;
     QDate	_poheaddate;
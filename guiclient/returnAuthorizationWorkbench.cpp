@@ -44,8 +44,12 @@ returnAuthorizationWorkbench::returnAuthorizationWorkbench(QWidget* parent, cons
   connect(_printdue, SIGNAL(clicked()), this, SLOT(sPrintDue()));
   connect(_process, SIGNAL(clicked()), this, SLOT(sProcess()));
   connect(_radue, SIGNAL(valid(bool)), this, SLOT(sHandleButton()));
-  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated()), this, SLOT(sFillListReview()));
-  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated()), this, SLOT(sFillListDue()));
+  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated()), this, SLOT(sRefreshLists()));
+
+  _pages = new WorkbenchPages(this);
+  _pages->addPage(_open);
+  _pages->addPage(_dueCredit);
+  connect(_pages, SIGNAL(refresh(QWidget*)), this, SLOT(sRefreshPage(QWidget*)));
 
   _ra->addColumn(tr("Auth. #"),      _orderColumn,    Qt::AlignLeft,   true, "rahead_number"   );
   _ra->addColumn(tr("Customer"),     _bigMoneyColumn, Qt::AlignLeft,   true, "cust_name"  );
@@ -424,8 +428,22 @@ void returnAuthorizationWorkbench::sFillLists()
     return;
   }
   
-  sFillListReview();
-  sFillListDue();
+  sRefreshLists();
+}
+
+/* Refresh the list the user can see. The other catches up when shown. */
+void returnAuthorizationWorkbench::sRefreshLists()
+{
+  _pages->setStale();
+  _pages->refreshCurrent();
+}
+
+void returnAuthorizationWorkbench::sRefreshPage(QWidget *pPage)
+{
+  if (pPage == _open)
+    sFillListReview();
+  else if (pPage == _dueCredit)
+    sFillListDue();
 }
 
 void returnAuthorizationWorkbench::sFillListReview()
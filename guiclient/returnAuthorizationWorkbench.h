@@ -13,6 +13,7 @@
 
 #include "guiclient.h"
 #include "xwidget.h"
+#include "workbenchPages.h"
 #include <parameter.h>
 
 #include "ui_returnAuthorizationWorkbench.h"
@@ -40,13 +41,17 @@ public slots:
     virtual void sFillLists();
     virtual void sFillListReview();
     virtual void sFillListDue();
+    virtual void sRefreshLists();
     virtual void sPopulateReviewMenu( QMenu * pMenu, QTreeWidgetItem * pSelected );
     virtual void sPopulateDueMenu( QMenu * pMenu, QTreeWidgetItem * pSelected );
 
 protected slots:
     virtual void languageChange();
     virtual void setParams(ParameterList&);
+    virtual void sRefreshPage(QWidget *pPage);
 
+protected:
+    WorkbenchPages *_pages;
 };
 
 #endif // RETURNAUTHORIZATIONWORKBENCH_H
@@ -18,6 +18,7 @@
 #include "scripttoolbox.h"
 #include "qeventproto.h"
 #include "parameterlistsetup.h"
+#include "xttrace.h"
 
 ScriptablePrivate::ScriptablePrivate(QWidget *parent, QWidget *self)
   : ScriptableWidget(self),
@@ -58,6 +59,7 @@ QScriptEngine *ScriptablePrivate::engine()
 
 enum SetResponse ScriptablePrivate::callSet(const ParameterList & params)
 {
+  XtTraceSpan span("set", "window", _self);
   loadScriptEngine();
 
   enum SetResponse returnValue = NoError;
@@ -49,6 +49,8 @@
 #include "xuiloader.h"
 #include "getscreen.h"
 #include "errorReporter.h"
+#include "xsqlprofiler.h"
+#include "xttrace.h"
 
 /** @ingroup scriptapi
 
@@ -144,7 +146,7 @@ XSqlQuery ScriptToolbox::executeQuery(const QString & query)
 {
   ParameterList params;
   MetaSQLQuery mql(query);
-  return mql.toQuery(params);
+  return profiledQuery(mql, params);
 }
 /** @example initMenu_executeQueryExample.js */
 
@@ -181,7 +183,7 @@ XSqlQuery ScriptToolbox::executeQuery(const QString & query)
 XSqlQuery ScriptToolbox::executeQuery(const QString & query, const ParameterList & params)
 {
   MetaSQLQuery mql(query);
-  return mql.toQuery(params);
+  return profiledQuery(mql, params);
 }
 /** @example itemSiteViewItem.js */
 
@@ -211,7 +213,7 @@ XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & n
 {
   ParameterList params;
   MetaSQLQuery mql(omfgThis->_mqlhash->value(group, name));
-  return mql.toQuery(params);
+  return profiledQuery(mql, params, group, name);
 }
 
 /** @brief Execute a MetaSQL query loaded from the @c metasql table.
@@ -253,10 +255,36 @@ XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & n
 XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & name, const ParameterList & params)
 {
   MetaSQLQuery mql(omfgThis->_mqlhash->value(group, name));
-  return mql.toQuery(params);
+  return profiledQuery(mql, params, group, name);
 }
 /** @example ccvoid.js */
 
+/* Run the query, telling any XSqlQueryTimingListeners which script and
+   window asked for it. Script names come from the file name the script
+   was evaluated with, so look up the call stack for the first one.
+ */
+XSqlQuery ScriptToolbox::profiledQuery(MetaSQLQuery &mql, const ParameterList &params,
+                                       const QString &group, const QString &name)
+{
+  if (! XSqlProfiler::isActive())
+    return mql.toQuery(params);
+
+  QString script;
+  for (QScriptContext *ctx = _engine->currentContext(); ctx && script.isEmpty();
+       ctx = ctx->parentContext())
+    script = QScriptContextInfo(ctx).fileName();
+
+  QString window;
+  QObject *mywindow = _engine->globalObject().property("mywindow").toQObject();
+  if (mywindow)
+    window = mywindow->objectName();
+
+  XSqlProfiler timing(group, name, window, script);
+  XSqlQuery result = mql.toQuery(params);
+  timing.finish(result);
+  return result;
+}
+
 /** @brief This is a convenience function that simply begins a database transaction.
  */
 XSqlQuery ScriptToolbox::executeBegin()
@@ -806,16 +834,8 @@ QWidget * ScriptToolbox::loadUi(const QString & screenName, QWidget * parent)
   if(screenName.isEmpty())
     return 0;
 
-  XSqlQuery qui;
-  qui.prepare("SELECT *"
-              "  FROM uiform"
-              " WHERE((uiform_name=:uiform_name)"
-              "   AND (uiform_enabled))"
-              " ORDER BY uiform_order DESC"
-              " LIMIT 1;");
-  qui.bindValue(":uiform_name", screenName);
-  qui.exec();
-  if(!qui.first())
+  QString source = omfgThis->_uiformhash->value(screenName);
+  if(source.isEmpty())
   {
     QMessageBox::critical(0, tr("Could Not Create Form"),
                               tr("<p>Could not create the '%1' form. Either an "
@@ -825,7 +845,7 @@ QWidget * ScriptToolbox::loadUi(const QString & screenName, QWidget * parent)
   }
 
   XUiLoader loader;
-  QByteArray ba = qui.value("uiform_source").toByteArray();
+  QByteArray ba = source.toUtf8();
   QBuffer uiFile(&ba);
   if(!uiFile.open(QIODevice::ReadOnly))
   {
@@ -1328,6 +1348,7 @@ void ScriptToolbox::setLastWindow(QWidget * lw)
   */
 QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowModality modality, Qt::WindowFlags flags)
 {
+  XtTraceSpan span("openWindow", "window", pname);
   QWidget *returnVal = xtGetScreen(pname, parent, flags, 0);
 
   if(returnVal)
@@ -1338,19 +1359,11 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
     return returnVal;
   }
 
-  XSqlQuery screenq;
-  screenq.prepare("SELECT * "
-                  "  FROM uiform "
-                  " WHERE((uiform_name=:uiform_name)"
-                  "   AND (uiform_enabled))"
-                  " ORDER BY uiform_order DESC"
-                  " LIMIT 1;");
-  screenq.bindValue(":uiform_name", pname);
-  screenq.exec();
-  if (screenq.first())
+  QString source = omfgThis->_uiformhash->value(pname);
+  if (! source.isEmpty())
   {
     XUiLoader loader;
-    QByteArray ba = screenq.value("uiform_source").toString().toUtf8();
+    QByteArray ba = source.toUtf8();
     QBuffer uiFile(&ba);
     if (!uiFile.open(QIODevice::ReadOnly))
     {
@@ -1359,7 +1372,11 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
                                "from the database."));
       return 0;
     }
-    QWidget *ui = loader.load(&uiFile);
+    QWidget *ui = 0;
+    {
+      XtTraceSpan loadSpan("XUiLoader::load", "window", pname);
+      ui = loader.load(&uiFile);
+    }
     if (! ui)
     {
       QMessageBox::critical(0, tr("Could not load UI"),
@@ -1378,7 +1395,7 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
     }
 
     XMainWindow *window = new XMainWindow(parent,
-                                          screenq.value("uiform_name").toString().toLatin1().data(),
+                                          pname.toLatin1().data(),
                                           flags);
 
     window->setCentralWidget(ui);
@@ -1414,7 +1431,7 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
     _lastWindow = window;
   }
   else if (ErrorReporter::error(QtCriticalMsg, 0, tr("Error Opening New Window"),
-                                screenq, __FILE__, __LINE__))
+                                omfgThis->_uiformhash->lastError(), __FILE__, __LINE__))
   {
     return 0;
   }
@@ -28,6 +28,7 @@ class QGridLayout;
 class QBoxLayout;
 class QStackedLayout;
 class QScriptEngine;
+class MetaSQLQuery;
 
 /* TODO: remove this enum and use AddressCluster::SaveFlags directly
    for some reason working with AddressCluster::SaveFlags failed but this works.
@@ -181,6 +182,10 @@ class ScriptToolbox : public QObject
     QString storedProcErrorLookup(const QString proc, const int result);
 
   private:
+    XSqlQuery profiledQuery(MetaSQLQuery &mql, const ParameterList &params,
+                            const QString &group = QString(),
+                            const QString &name  = QString());
+
     QScriptEngine * _engine;
     static QWidget * _lastWindow;
 };
@@ -495,19 +495,11 @@ void setup::setCurrentIndex(XTreeWidgetItem* item)
     else
     {
       // No class, so look for an extension
-      XSqlQuery screenq;
-      screenq.prepare("SELECT * "
-                      "  FROM uiform "
-                      " WHERE((uiform_name=:uiform_name)"
-                      "   AND (uiform_enabled))"
-                      " ORDER BY uiform_order DESC"
-                      " LIMIT 1;");
-      screenq.bindValue(":uiform_name", uiName);
-      screenq.exec();
-      if (screenq.first())
+      QString source = omfgThis->_uiformhash->value(uiName);
+      if (! source.isEmpty())
       {     
         QUiLoader loader;
-        QByteArray ba = screenq.value("uiform_source").toByteArray();
+        QByteArray ba = source.toUtf8();
         QBuffer uiFile(&ba);
 
          if (!uiFile.open(QIODevice::ReadOnly))
@@ -15,27 +15,25 @@
 #include <QDir>
 #include <QFile>
 #include <QMenu>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
-#include <QNetworkRequest>
 #include <QTranslator>
 
 #include <parameter.h>
 
 #include "errorReporter.h"
+#include "xtNetworkRequestManager.h"
 
 translations::translations(QWidget* parent, const char* name, Qt::WindowFlags fl)
   : XWidget(parent, name, fl)
 {
   setupUi(this);
 
-  nwam = new QNetworkAccessManager(this);
-
+  xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
   connect(_check,       SIGNAL(clicked()),                                 this, SLOT(sDownload()));
   connect(_locale,      SIGNAL(newID(int)),                                this, SLOT(sLocaleChanged()));
   connect(_translations,SIGNAL(itemDoubleClicked(QTreeWidgetItem*, int)),  this, SLOT(sLanguageSelected(QTreeWidgetItem*, int)));
   connect(_translations,SIGNAL(populateMenu(QMenu*,QTreeWidgetItem*,int)), this, SLOT(sPopulateMenu(QMenu*, QTreeWidgetItem*, int)));
-  connect(nwam,         SIGNAL(finished(QNetworkReply*)),                  this, SLOT(finished(QNetworkReply*)));
+  connect(network,      SIGNAL(finished(int)),                             this, SLOT(finished(int)));
+  connect(network,      SIGNAL(downloadProgress(int, qint64, qint64)),     this, SLOT(downloadProgress(int, qint64, qint64)));
 
   _translations->addColumn(tr("Package"),  _itemColumn, Qt::AlignLeft,   true, "package" );
   _translations->addColumn(tr("Found"),    _ynColumn,   Qt::AlignCenter, true, "found" );
@@ -48,7 +46,8 @@ translations::translations(QWidget* parent, const char* name, Qt::WindowFlags fl
 
 translations::~translations()
 {
-  // no need to delete child widgets, Qt does it all for us
+  foreach (int request, _requests.keys())
+    xtNetworkRequestManager::instance()->release(request);
 }
 
 void translations::languageChange()
@@ -121,15 +120,23 @@ void translations::sLanguageSelected(QTreeWidgetItem * item, int /*column*/)
   if(!item)
     return;
 
-  QNetworkReply * nwrep = nwam->get(QNetworkRequest(QUrl("http://www.xtuple.org/xttranslate/guiexport/" + item->text(0) + "/" + langext + "/current")));
-  nwrep->setProperty("package_name", item->text(0));
-  connect(nwrep, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(downloadProgress(qint64, qint64)));
+  int request = xtNetworkRequestManager::instance()->get(QUrl("http://www.xtuple.org/xttranslate/guiexport/" + item->text(0) + "/" + langext + "/current"));
+  _requests.insert(request, item->text(0));
   item->setText(2, tr("Connecting..."));
 }
 
-void translations::finished(QNetworkReply * nwrep)
+void translations::finished(int request)
 {
-  QList<XTreeWidgetItem*> ilist = _translations->findItems(nwrep->property("package_name").toString(), Qt::MatchFixedString, 0);
+  if(!_requests.contains(request))
+    return;
+
+  xtNetworkRequestManager *network = xtNetworkRequestManager::instance();
+  QString package = _requests.take(request);
+  QByteArray ba = network->data(request);
+  bool ok = network->error(request) == QNetworkReply::NoError;
+  network->release(request);
+
+  QList<XTreeWidgetItem*> ilist = _translations->findItems(package, Qt::MatchFixedString, 0);
   if(ilist.isEmpty())
   {
     qDebug() << "No items found matching replies package name";
@@ -141,69 +148,57 @@ void translations::finished(QNetworkReply * nwrep)
     qDebug() << "Found item is not valid";
     return;
   }
-  if(nwrep->header(QNetworkRequest::LocationHeader).isValid())
-  {
-    QNetworkReply * newrep = nwam->get(QNetworkRequest(QUrl(nwrep->header(QNetworkRequest::LocationHeader).toString())));
-    newrep->setProperty("package_name", nwrep->property("package_name"));
-    connect(newrep, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(downloadProgress(qint64, qint64)));
-  }
-  else
+  if(ok)
   {
-    if(nwrep->error() == QNetworkReply::NoError)
+    if(!ba.isEmpty())
     {
-      QByteArray ba = nwrep->readAll();
-      if(!ba.isEmpty())
-      {
-        #if QT_VERSION >= 0x050000
-          QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
-          if(!dir.exists())
-            dir.mkpath(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
-          QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + item->text(0) + "." + langext + ".qm");
-        #else
-          QDir dir(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
-          if(!dir.exists())
-            dir.mkpath(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
-          QFile file(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/" + item->text(0) + "." + langext + ".qm");
-        #endif
-          if(file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-          {
-          file.write(ba);
-          file.close();
-          QTranslator * translator = new QTranslator(qApp);
-          if (translator->load(translationFile(langext, item->text(0))))
-          {
-            qApp->installTranslator(translator);
-            qDebug("updated/installed %s", (item->text(0)).toLatin1().data());
-          }
-          item->setText(1, tr("Yes"));
-          item->setText(2, translationFile(langext, item->text(0)));
-        }
-        else
+      #if QT_VERSION >= 0x050000
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
+        if(!dir.exists())
+          dir.mkpath(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
+        QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + item->text(0) + "." + langext + ".qm");
+      #else
+        QDir dir(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
+        if(!dir.exists())
+          dir.mkpath(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
+        QFile file(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/" + item->text(0) + "." + langext + ".qm");
+      #endif
+        if(file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+        file.write(ba);
+        file.close();
+        QTranslator * translator = new QTranslator(qApp);
+        if (translator->load(translationFile(langext, item->text(0))))
         {
-          item->setText(2, tr("Could not save file."));
+          qApp->installTranslator(translator);
+          qDebug("updated/installed %s", (item->text(0)).toLatin1().data());
         }
+        item->setText(1, tr("Yes"));
+        item->setText(2, translationFile(langext, item->text(0)));
       }
       else
       {
-        item->setText(2, tr("No translation is currently available."));
+        item->setText(2, tr("Could not save file."));
       }
     }
     else
     {
-      item->setText(2, tr("Could not retrieve translation at this time."));
+      item->setText(2, tr("No translation is currently available."));
     }
   }
-  nwrep->deleteLater();
+  else
+  {
+    item->setText(2, tr("Could not retrieve translation at this time."));
+  }
 }
 
-void translations::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+void translations::downloadProgress(int request, qint64 bytesReceived, qint64 bytesTotal)
 {
   if(bytesReceived == bytesTotal)
     return; // Don't do anything since the download is done and the finished function will do the rest.
-  QNetworkReply * nwrep = qobject_cast<QNetworkReply*>(sender());
-  if(!nwrep)
+  if(!_requests.contains(request))
     return;
-  QList<XTreeWidgetItem*> ilist = _translations->findItems(nwrep->property("package_name").toString(), Qt::MatchFixedString, 0);
+  QList<XTreeWidgetItem*> ilist = _translations->findItems(_requests.value(request), Qt::MatchFixedString, 0);
   if(ilist.isEmpty())
   {
     qDebug() << "No items found matching replies package name";
@@ -11,14 +11,13 @@
 #ifndef TRANSLATIONS_H
 #define TRANSLATIONS_H
 
+#include <QHash>
+
 #include "guiclient.h"
 #include "xwidget.h"
 
 #include "ui_translations.h"
 
-class QNetworkAccessManager;
-class QNetworkReply;
-
 class translations : public XWidget, public Ui::translations
 {
     Q_OBJECT
@@ -35,11 +34,11 @@ public slots:
 
 protected slots:
     virtual void languageChange();
-    virtual void finished(QNetworkReply*);
-    virtual void downloadProgress(qint64, qint64);
+    virtual void finished(int);
+    virtual void downloadProgress(int, qint64, qint64);
 
 private:
-    QNetworkAccessManager * nwam;
+    QHash<int, QString> _requests;   // download id -> package
     QString langext;
 };
 
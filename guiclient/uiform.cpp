@@ -212,6 +212,7 @@ void uiform::sSave()
   {
     return;
   }
+  omfgThis->_uiformhash->remove(_name->text());
 
   if (_package->id() != _pkgheadidOrig &&
       QMessageBox::question(this, tr("Move to different package?"),
@@ -89,6 +89,9 @@ void uiforms::sDelete()
                             QMessageBox::No) == QMessageBox::No)
     return;
 
+  QString name = _uiform->currentItem() ?
+                 _uiform->currentItem()->rawValue("uiform_name").toString() : QString();
+
   XSqlQuery delq;
   delq.prepare("DELETE FROM uiform WHERE (uiform_id=:uiform_id);" );
   delq.bindValue(":uiform_id", _uiform->id());
@@ -96,6 +99,7 @@ void uiforms::sDelete()
   if (ErrorReporter::error(QtCriticalMsg, this, tr("Deleting Screen"),
                            delq, __FILE__, __LINE__))
     return;
+  omfgThis->_uiformhash->remove(name);
 
   sFillList();
 }
@@ -247,50 +247,92 @@ void unpostedPurchaseOrders::sPrintForms()
   }
 }
 
+/* Lock the selected orders, leaving out any another user has locked so
+   the rest can still be processed. Returns a description of each order
+   that was left out.
+ */
+QStringList unpostedPurchaseOrders::lockAvailable(QList<XTreeWidgetItem*> &selected,
+                                                  AppLockSet &locks)
+{
+  QStringList skipped;
+  while (! selected.isEmpty() && ! locks.acquire(AppLock::Silent))
+  {
+    QList<XTreeWidgetItem*> available;
+    foreach (XTreeWidgetItem *item, selected)
+    {
+      QString holder = locks.holder("pohead", item->id());
+      if (holder.isEmpty())
+        available.append(item);
+      else
+        skipped.append(tr("%1 (locked by %2)")
+                         .arg(item->rawValue("pohead_number").toString(), holder));
+    }
+
+    // the lock failed without naming anyone, so give up on the whole set
+    if (available.size() == selected.size())
+    {
+      foreach (XTreeWidgetItem *item, selected)
+        skipped.append(item->rawValue("pohead_number").toString());
+      available.clear();
+    }
+
+    selected = available;
+    locks.clear();
+    foreach (XTreeWidgetItem *item, selected)
+      locks.append("pohead", item->id());
+  }
+  return skipped;
+}
+
 void unpostedPurchaseOrders::sRelease()
 {
   XSqlQuery unpostedRelease;
   unpostedRelease.prepare("SELECT releasePurchaseOrder(:pohead_id) AS result;");
 
-  QList<XTreeWidgetItem*> selected = list()->selectedItems();
-  bool done = false;
-  for (int i = 0; i < selected.size(); i++)
+  QList<XTreeWidgetItem*> selected;
+  AppLockSet locks;
+  foreach (XTreeWidgetItem *item, list()->selectedItems())
   {
-    if ((selected[i]->rawValue("pohead_status").toString() == "U")
+    if ((item->rawValue("pohead_status").toString() == "U")
       && (_privileges->check("ReleasePurchaseOrders"))
-      && (checkSitePrivs(((XTreeWidgetItem*)(selected[i]))->id())))
+      && (checkSitePrivs(item->id())))
     {
-      // If locked, don't proceed
-      if (!_lock.acquire("pohead", ((XTreeWidgetItem*)(selected[i]))->id(), AppLock::Interactive))
-      {
-        if (i == selected.size() - 1)
-          return;
-        else
-          continue;
-      }
+      selected.append(item);
+      locks.append("pohead", item->id());
+    }
+  }
 
-      unpostedRelease.bindValue(":pohead_id", ((XTreeWidgetItem*)(selected[i]))->id());
-      unpostedRelease.exec();
-      if (unpostedRelease.first())
-      {
-        int result = unpostedRelease.value("result").toInt();
-        if (result < 0)
-          ErrorReporter::error(QtCriticalMsg, this, tr("Error Releasing Purchase Order"),
-                                 storedProcErrorLookup("releasePurchaseOrder", result),
-                                 __FILE__, __LINE__);
-        else
-          done = true;
-      }
-      else if (unpostedRelease.lastError().type() != QSqlError::NoError)
-        ErrorReporter::error(QtCriticalMsg, this, tr("Error Releasing Purchase Order"),
-                           unpostedRelease, __FILE__, __LINE__);
+  QStringList skipped = lockAvailable(selected, locks);
 
-      _lock.release();
+  bool done = false;
+  for (int i = 0; i < selected.size(); i++)
+  {
+    unpostedRelease.bindValue(":pohead_id", selected[i]->id());
+    unpostedRelease.exec();
+    if (unpostedRelease.first())
+    {
+      int result = unpostedRelease.value("result").toInt();
+      if (result < 0)
+        ErrorReporter::error(QtCriticalMsg, this, tr("Error Releasing Purchase Order"),
+                               storedProcErrorLookup("releasePurchaseOrder", result),
+                               __FILE__, __LINE__);
+      else
+        done = true;
     }
+    else if (unpostedRelease.lastError().type() != QSqlError::NoError)
+      ErrorReporter::error(QtCriticalMsg, this, tr("Error Releasing Purchase Order"),
+                         unpostedRelease, __FILE__, __LINE__);
   }
+  locks.release();
   if (done)
     omfgThis->sPurchaseOrdersUpdated(-1, true);
-  else
+
+  if (! skipped.isEmpty())
+    QMessageBox::warning(this, tr("Purchase Orders Not Released"),
+                         tr("<p>These Purchase Orders are being edited by "
+                            "another user and were not released:<br>%1")
+                           .arg(skipped.join("<br>")));
+  else if (! done)
     QMessageBox::information(this, tr("Nothing To Release"),
                              tr("<p>There were no selected Purchase Orders "
                                 "to be released."),
@@ -303,45 +345,50 @@ void unpostedPurchaseOrders::sUnrelease()
   XSqlQuery unRelease;
   unRelease.prepare("SELECT unreleasePurchaseOrder(:pohead_id) AS result;");
   
-  QList<XTreeWidgetItem*> selected = list()->selectedItems();
-  bool done = false;
-  for (int i = 0; i < selected.size(); i++)
+  QList<XTreeWidgetItem*> selected;
+  AppLockSet locks;
+  foreach (XTreeWidgetItem *item, list()->selectedItems())
   {
-    if ((selected[i]->rawValue("pohead_status").toString() == "O")
+    if ((item->rawValue("pohead_status").toString() == "O")
         && (_privileges->check("UnreleasePurchaseOrders"))
-        && (checkSitePrivs(((XTreeWidgetItem*)(selected[i]))->id())))
+        && (checkSitePrivs(item->id())))
     {
-      // If locked, don't proceed
-      if (!_lock.acquire("pohead", ((XTreeWidgetItem*)(selected[i]))->id(), AppLock::Interactive))
-      {
-        if (i == selected.size() - 1)
-          return;
-        else
-          continue;
-      }
+      selected.append(item);
+      locks.append("pohead", item->id());
+    }
+  }
 
-      unRelease.bindValue(":pohead_id", ((XTreeWidgetItem*)(selected[i]))->id());
-      unRelease.exec();
-      if (unRelease.first())
-      {
-        int result = unRelease.value("result").toInt();
-        if (result < 0)
-          ErrorReporter::error(QtCriticalMsg, this, tr("Error Unreleasing Purchase Order"),
-                                 storedProcErrorLookup("unreleasePurchaseOrder", result),
-                                 __FILE__, __LINE__);
-        else
-          done = true;
-      }
-      else if (unRelease.lastError().type() != QSqlError::NoError)
-        ErrorReporter::error(QtCriticalMsg, this, tr("Error Unreleasing Purchase Order"),
-                           unRelease, __FILE__, __LINE__);
+  QStringList skipped = lockAvailable(selected, locks);
 
-      _lock.release();
+  bool done = false;
+  for (int i = 0; i < selected.size(); i++)
+  {
+    unRelease.bindValue(":pohead_id", selected[i]->id());
+    unRelease.exec();
+    if (unRelease.first())
+    {
+      int result = unRelease.value("result").toInt();
+      if (result < 0)
+        ErrorReporter::error(QtCriticalMsg, this, tr("Error Unreleasing Purchase Order"),
+                               storedProcErrorLookup("unreleasePurchaseOrder", result),
+                               __FILE__, __LINE__);
+      else
+        done = true;
     }
+    else if (unRelease.lastError().type() != QSqlError::NoError)
+      ErrorReporter::error(QtCriticalMsg, this, tr("Error Unreleasing Purchase Order"),
+                         unRelease, __FILE__, __LINE__);
   }
+  locks.release();
   if (done)
     omfgThis->sPurchaseOrdersUpdated(-1, true);
-  else
+
+  if (! skipped.isEmpty())
+    QMessageBox::warning(this, tr("Purchase Orders Not Unreleased"),
+                         tr("<p>These Purchase Orders are being edited by "
+                            "another user and were not unreleased:<br>%1")
+                           .arg(skipped.join("<br>")));
+  else if (! done)
     QMessageBox::information(this, tr("Nothing To Unrelease"),
                              tr("<p>There were no selected Purchase Orders "
                                 "to be unreleased."),
@@ -38,6 +38,8 @@ public slots:
     virtual bool setParams(ParameterList &);
 
 private:
+    QStringList lockAvailable(QList<XTreeWidgetItem*> &selected, AppLockSet &locks);
+
     AppLock _lock;
 };
 
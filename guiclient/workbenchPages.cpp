@@ -0,0 +1,116 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "workbenchPages.h"
+
+#include <QStackedWidget>
+#include <QWidget>
+#include <QtDebug>
+
+#define DEBUG false
+
+WorkbenchPages::WorkbenchPages(QWidget *pParent)
+  : QObject(pParent),
+    _root(pParent)
+{
+}
+
+/** Register a page. Every QStackedWidget between the page and the
+    workbench, including the ones inside QTabWidgets, is watched so the page
+    can be built and refreshed as soon as it is shown.
+ */
+void WorkbenchPages::addPage(QWidget *pPage)
+{
+  if (! pPage || _pages.contains(pPage))
+    return;
+
+  _pages.append(pPage);
+  for (QWidget *w = pPage; w && w != _root; w = w->parentWidget())
+  {
+    QStackedWidget *stack = qobject_cast<QStackedWidget *>(w->parentWidget());
+    if (stack)
+      connect(stack, SIGNAL(currentChanged(int)), this, SLOT(sCurrentChanged()),
+              Qt::UniqueConnection);
+  }
+}
+
+void WorkbenchPages::ensureCreated(QWidget *pPage)
+{
+  if (! _pages.contains(pPage) || _created.contains(pPage))
+    return;
+
+  if (DEBUG) qDebug() << "WorkbenchPages creating" << pPage->objectName();
+  _created.insert(pPage);
+  emit create(pPage);
+  emit created(pPage);
+}
+
+bool WorkbenchPages::isCreated(QWidget *pPage) const
+{
+  return _created.contains(pPage);
+}
+
+/** A page is current if it is the current page of every stack it is in. */
+bool WorkbenchPages::isCurrent(QWidget *pPage) const
+{
+  for (QWidget *w = pPage; w && w != _root; w = w->parentWidget())
+  {
+    QStackedWidget *stack = qobject_cast<QStackedWidget *>(w->parentWidget());
+    if (stack && stack->currentWidget() != w)
+      return false;
+  }
+  return true;
+}
+
+bool WorkbenchPages::isStale(QWidget *pPage) const
+{
+  return _stale.contains(pPage);
+}
+
+/** Build and refresh every current page, stale or not. */
+void WorkbenchPages::refreshCurrent()
+{
+  foreach (QWidget *page, _pages)
+  {
+    if (! isCurrent(page))
+      continue;
+    ensureCreated(page);
+    _stale.remove(page);
+    if (DEBUG) qDebug() << "WorkbenchPages refreshing" << page->objectName();
+    emit refresh(page);
+  }
+}
+
+void WorkbenchPages::setStale()
+{
+  _stale = _pages.toSet();
+}
+
+void WorkbenchPages::setStale(QWidget *pPage)
+{
+  if (_pages.contains(pPage))
+    _stale.insert(pPage);
+}
+
+/** Build pages that just became current and refresh the stale ones. */
+void WorkbenchPages::sCurrentChanged()
+{
+  foreach (QWidget *page, _pages)
+  {
+    if (! isCurrent(page))
+      continue;
+    ensureCreated(page);
+    if (_stale.remove(page))
+    {
+      if (DEBUG) qDebug() << "WorkbenchPages refreshing" << page->objectName();
+      emit refresh(page);
+    }
+  }
+}
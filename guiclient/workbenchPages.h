@@ -0,0 +1,66 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef WORKBENCHPAGES_H
+#define WORKBENCHPAGES_H
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+class QWidget;
+
+/** \class WorkbenchPages
+    \brief Build workbench pages when they are first shown and refresh only
+           the pages the user can see.
+
+    A workbench registers each page, either a QTabWidget tab or a
+    QStackedWidget page, with addPage(). The first time a page becomes
+    current, create() is emitted so the workbench can build its contents,
+    then created() once it's built. ensureCreated() builds a page on demand.
+    The workbenches offer both to scripts as createPage() and
+    pageCreated(), for scripts that need an embedded window before the
+    user opens its page.
+    When the workbench's driving parameter changes, setStale() marks every
+    page out of date and refreshCurrent() refreshes the visible ones. The
+    other pages are refreshed when they are next shown.
+ */
+class WorkbenchPages : public QObject
+{
+  Q_OBJECT
+
+  public:
+    WorkbenchPages(QWidget *pParent);
+
+    virtual void addPage(QWidget *pPage);
+    virtual void ensureCreated(QWidget *pPage);
+    virtual bool isCreated(QWidget *pPage) const;
+    virtual bool isCurrent(QWidget *pPage) const;
+    virtual bool isStale(QWidget *pPage)   const;
+
+  public slots:
+    virtual void refreshCurrent();
+    virtual void setStale();
+    virtual void setStale(QWidget *pPage);
+    virtual void sCurrentChanged();
+
+  signals:
+    void create(QWidget *pPage);
+    void created(QWidget *pPage);
+    void refresh(QWidget *pPage);
+
+  private:
+    QList<QWidget *> _pages;
+    QSet<QWidget *>  _created;
+    QSet<QWidget *>  _stale;
+    QWidget         *_root;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+# A local stand-in for the credit card processing services the client
+# talks to, for testing and timing credit card processing offline.
+# It answers Authorize.Net AIM, CyberSource SOAP and Paymentech Orbital
+# requests in the formats the client's processors expect, approving
+# everything unless told to decline or fail some share of them.
+#
+# Point the client at it by setting the credit card server to
+# http://localhost:8080 (or https with --cert and --key) and the port to
+# 8080, then, for example, capture a batch of preauthorizations:
+#
+#   mockccgateway.py --latency 150 --decline-rate 0.05 --drop-rate 0.02
+#
+# Connections are kept open between requests like a real service's.
+# Requests carrying an Idempotency-Key that was seen before get the same
+# answer again instead of a new transaction. A summary is printed every
+# --report requests and on exit.
+
+import argparse
+import hashlib
+import random
+import re
+import ssl
+import sys
+import threading
+import time
+import uuid
+from datetime import datetime, timezone
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs
+from xml.sax.saxutils import escape
+
+SOAP_ENV = 'http://schemas.xmlsoap.org/soap/envelope/'
+CS_DATA  = 'urn:schemas-cybersource-com:transaction-data-1.53'
+
+
+class Gateway:
+    def __init__(self, args):
+        self.args    = args
+        self.lock    = threading.Lock()
+        self.replies = {}       # idempotency key -> (status, content type, body)
+        self.counts  = {}
+        self.started = time.time()
+
+    def count(self, name):
+        with self.lock:
+            self.counts[name] = self.counts.get(name, 0) + 1
+            total = self.counts.get('requests', 0)
+        if name == 'requests' and self.args.report and total % self.args.report == 0:
+            self.summary()
+
+    def summary(self):
+        with self.lock:
+            counts = dict(self.counts)
+        elapsed = max(time.time() - self.started, 0.001)
+        print('%s, %.1f requests/s' % (', '.join('%s %d' % item for item in sorted(counts.items())),
+                                       counts.get('requests', 0) / elapsed),
+              file=sys.stderr)
+
+    def outcome(self):
+        roll = random.random()
+        if roll < self.args.error_rate:
+            return 'error'
+        if roll < self.args.error_rate + self.args.decline_rate:
+            return 'decline'
+        return 'approve'
+
+
+def transaction_id():
+    return str(random.randint(10 ** 9, 10 ** 10 - 1))
+
+
+def auth_code():
+    return '%06d' % random.randint(0, 999999)
+
+
+def authorize_net(gateway, body):
+    """Answer an AIM name/value request with a delimited AIM response."""
+    fields = {k: v[0] for k, v in parse_qs(body, keep_blank_values=True).items()}
+    delim  = fields.get('x_delim_char') or ','
+    encap  = fields.get('x_encap_char', '')
+    kind   = fields.get('x_type', 'AUTH_CAPTURE').upper()
+    amount = '%.2f' % float(fields.get('x_amount') or 0)
+    transid = fields.get('x_trans_id') if kind in ('PRIOR_AUTH_CAPTURE', 'VOID', 'CREDIT') \
+              and fields.get('x_trans_id') else transaction_id()
+    outcome = gateway.outcome()
+    gateway.count(outcome)
+    code, reason, text = {
+        'approve': ('1', '1',  'This transaction has been approved.'),
+        'decline': ('2', '2',  'This transaction has been declined.'),
+        'error':   ('3', '11', 'A duplicate transaction has been submitted.'),
+    }[outcome]
+    md5 = hashlib.md5((gateway.args.md5_hash + fields.get('x_login', '') + transid + amount)
+                      .encode()).hexdigest().upper()
+
+    response = [''] * 69            # AIM numbers its fields from 1
+    response[1]  = code
+    response[2]  = '1'
+    response[3]  = reason
+    response[4]  = text
+    response[5]  = auth_code() if outcome == 'approve' else ''
+    response[6]  = 'Y'
+    response[7]  = transid
+    response[8]  = fields.get('x_invoice_num', '')
+    response[9]  = fields.get('x_description', '')
+    response[10] = amount
+    response[11] = 'CC'
+    response[12] = kind.lower()
+    response[33] = fields.get('x_tax', '')
+    response[34] = fields.get('x_duty', '')
+    response[35] = fields.get('x_freight', '')
+    response[38] = md5
+    response[39] = 'M'
+    response[51] = 'XXXX' + fields.get('x_card_num', '1111')[-4:]
+    response[52] = 'Visa'
+    return 'text/plain', delim.join(encap + f + encap for f in response[1:])
+
+
+def cybersource(gateway, body):
+    """Answer a CyberSource runTransaction request with a replyMessage."""
+    def value(tag):
+        match = re.search(r'<(?:\w+:)?%s>([^<]*)<' % tag, body)
+        return match.group(1) if match else ''
+
+    def requested(service):
+        return re.search(r'<(?:\w+:)?%s\s+run="true"' % service, body) is not None
+
+    outcome = gateway.outcome()
+    gateway.count(outcome)
+    decision, reason = {'approve': ('ACCEPT', '100'),
+                        'decline': ('REJECT', '203'),
+                        'error':   ('ERROR',  '150')}[outcome]
+    amount = value('grandTotalAmount') or '0.00'
+    now    = datetime.now(timezone.utc).strftime('%Y-%m-%dT%H:%M:%SZ')
+    code   = auth_code()
+
+    replies = []
+    if requested('ccAuthService'):
+        replies.append('<c:ccAuthReply><c:reasonCode>%s</c:reasonCode><c:amount>%s</c:amount>'
+                       '<c:authorizationCode>%s</c:authorizationCode><c:avsCode>Y</c:avsCode>'
+                       '<c:cvCode>M</c:cvCode><c:authorizedDateTime>%s</c:authorizedDateTime>'
+                       '<c:requestAmount>%s</c:requestAmount></c:ccAuthReply>'
+                       % (reason, amount, code, now, amount))
+    if requested('ccCaptureService'):
+        replies.append('<c:ccCaptureReply><c:reasonCode>%s</c:reasonCode>'
+                       '<c:requestDateTime>%s</c:requestDateTime><c:amount>%s</c:amount>'
+                       '</c:ccCaptureReply>' % (reason, now, amount))
+    if requested('ccCreditService'):
+        replies.append('<c:ccCreditReply><c:reasonCode>%s</c:reasonCode>'
+                       '<c:requestDateTime>%s</c:requestDateTime><c:amount>%s</c:amount>'
+                       '</c:ccCreditReply>' % (reason, now, amount))
+    if requested('voidService'):
+        replies.append('<c:ccVoidReply><c:reasonCode>%s</c:reasonCode>'
+                       '<c:requestDateTime>%s</c:requestDateTime><c:amount>%s</c:amount>'
+                       '</c:ccVoidReply>' % (reason, now, amount))
+    if requested('ccAuthReversalService'):
+        replies.append('<c:ccAuthReversalReply><c:reasonCode>%s</c:reasonCode>'
+                       '<c:amount>%s</c:amount><c:authorizationCode>%s</c:authorizationCode>'
+                       '<c:requestDateTime>%s</c:requestDateTime></c:ccAuthReversalReply>'
+                       % (reason, amount, code, now))
+
+    reply = ('<?xml version="1.0" encoding="utf-8"?>'
+             '<soap:Envelope xmlns:soap="%s"><soap:Body>'
+             '<c:replyMessage xmlns:c="%s">'
+             '<c:merchantReferenceCode>%s</c:merchantReferenceCode>'
+             '<c:requestID>%s</c:requestID><c:decision>%s</c:decision>'
+             '<c:reasonCode>%s</c:reasonCode><c:requestToken>%s</c:requestToken>'
+             '%s</c:replyMessage></soap:Body></soap:Envelope>'
+             % (SOAP_ENV, CS_DATA, escape(value('merchantReferenceCode')),
+                transaction_id() + transaction_id(), decision, reason,
+                uuid.uuid4().hex, ''.join(replies)))
+    return 'text/xml; charset=utf-8', reply
+
+
+def paymentech(gateway, body):
+    """Answer an Orbital fixed-width request with a fixed-width response."""
+    order   = body[4:26]
+    outcome = gateway.outcome()
+    gateway.count(outcome)
+    code    = {'approve': '100', 'decline': '302', 'error': '201'}[outcome]
+    today   = datetime.now().strftime('%m%d%y')
+    return 'text/plain', ('P74V' + order.ljust(22)[:22] + code + today
+                          + (auth_code() if outcome == 'approve' else ' ' * 6)
+                          + 'Y ' + 'M' + '\r')
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'   # keep connections open between requests
+    gateway = None
+
+    def log_message(self, fmt, *args):
+        if self.gateway.args.verbose:
+            BaseHTTPRequestHandler.log_message(self, fmt, *args)
+
+    def do_POST(self):
+        gateway = self.gateway
+        length  = int(self.headers.get('Content-Length', 0))
+        body    = self.rfile.read(length).decode('utf-8', 'replace')
+        gateway.count('requests')
+
+        if gateway.args.latency:
+            time.sleep(random.uniform(0.5, 1.5) * gateway.args.latency / 1000.0)
+
+        if random.random() < gateway.args.drop_rate:
+            gateway.count('dropped')
+            self.close_connection = True
+            return
+
+        key = self.headers.get('Idempotency-Key')
+        with gateway.lock:
+            reply = gateway.replies.get(key) if key else None
+        if reply:
+            gateway.count('replayed')
+        else:
+            if body.startswith('P74V'):
+                kind, text = paymentech(gateway, body)
+            elif 'Envelope' in body and CS_DATA.split('-1.')[0] in body:
+                kind, text = cybersource(gateway, body)
+            elif 'x_login=' in body or 'x_type=' in body:
+                kind, text = authorize_net(gateway, body)
+            else:
+                gateway.count('unrecognized')
+                kind, text = 'text/plain', 'Unrecognized request'
+            reply = (200, kind, text.encode('utf-8'))
+            if key:
+                with gateway.lock:
+                    gateway.replies[key] = reply
+
+        status, kind, data = reply
+        self.send_response(status)
+        self.send_header('Content-Type', kind)
+        self.send_header('Content-Length', str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Mock credit card gateway.')
+    parser.add_argument('-p', '--port', type=int, default=8080, help='port to listen on [8080]')
+    parser.add_argument('--bind', default='127.0.0.1', help='address to listen on [127.0.0.1]')
+    parser.add_argument('--cert', help='certificate file, to serve https')
+    parser.add_argument('--key', help='private key file for --cert')
+    parser.add_argument('--latency', type=float, default=0,
+                        help='average time to answer, in ms [0]')
+    parser.add_argument('--decline-rate', type=float, default=0,
+                        help='share of transactions to decline, 0-1 [0]')
+    parser.add_argument('--error-rate', type=float, default=0,
+                        help='share of transactions to answer with an error, 0-1 [0]')
+    parser.add_argument('--drop-rate', type=float, default=0,
+                        help='share of requests to hang up on without answering, 0-1 [0]')
+    parser.add_argument('--md5-hash', default='',
+                        help='Authorize.Net MD5 hash value to sign responses with')
+    parser.add_argument('--report', type=int, default=100,
+                        help='print a summary every this many requests, 0 for never [100]')
+    parser.add_argument('--seed', type=int, help='random seed, for repeatable runs')
+    parser.add_argument('-v', '--verbose', action='store_true', help='log every request')
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+
+    Handler.gateway = Gateway(args)
+    server = ThreadingHTTPServer((args.bind, args.port), Handler)
+    scheme = 'http'
+    if args.cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        scheme = 'https'
+
+    print('Mock credit card gateway at %s://%s:%d/' % (scheme, args.bind, args.port),
+          file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    Handler.gateway.summary()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
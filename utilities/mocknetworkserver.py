@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+# A local stand-in for the xTuple web services the client downloads from
+# through xtNetworkRequestManager: update checks and installers from
+# updates.xtuple.com, spell check dictionaries and translations from
+# www.xtuple.org, and the registration notice. Use it to test and time
+# those requests offline, including the on-disk cache.
+#
+# Every file carries an ETag and a Last-Modified date, and a conditional
+# request for a file that hasn't changed gets 304 Not Modified, so a
+# second fetch of the same URL should show up here as notModified rather
+# than downloaded. --change-every makes the files change now and then to
+# check that the client notices. Files come from --root when it is given;
+# otherwise any path answers with --size bytes of made-up content.
+#
+# The client's URLs name the real hosts, so either map them to this
+# server in the hosts file and listen on port 80,
+#
+#   127.0.0.1  updates.xtuple.com www.xtuple.org
+#
+# or use it as the client's HTTP proxy, which it also understands:
+#
+#   mocknetworkserver.py --size 2000000 --rate 500000 --change-every 60
+#
+# /redirect/N/path answers with N redirects before serving /path, and
+# --latency, --error-rate and --drop-rate make it slow or unreliable.
+# A summary is printed every --report requests and on exit.
+
+import argparse
+import hashlib
+import os
+import random
+import sys
+import threading
+import time
+from email.utils import formatdate, parsedate_to_datetime
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlsplit, unquote
+
+CHUNK = 16 * 1024
+
+
+class Server:
+    def __init__(self, args):
+        self.args    = args
+        self.lock    = threading.Lock()
+        self.counts  = {}
+        self.started = time.time()
+
+    def count(self, name, amount=1):
+        with self.lock:
+            self.counts[name] = self.counts.get(name, 0) + amount
+            total = self.counts.get('requests', 0)
+        if name == 'requests' and self.args.report and total % self.args.report == 0:
+            self.summary()
+
+    def summary(self):
+        with self.lock:
+            counts = dict(self.counts)
+        elapsed = max(time.time() - self.started, 0.001)
+        print('%s, %.1f requests/s' % (', '.join('%s %d' % item for item in sorted(counts.items())),
+                                       counts.get('requests', 0) / elapsed),
+              file=sys.stderr)
+
+    def version(self):
+        """When the files last changed, as a whole number of seconds."""
+        if not self.args.change_every:
+            return int(self.started)
+        every = self.args.change_every
+        return int(self.started + (time.time() - self.started) // every * every)
+
+    def content(self, path):
+        """The body and modification time for path, or None if there is none."""
+        if self.args.root:
+            name = os.path.normpath(os.path.join(self.args.root, path.lstrip('/')))
+            if not name.startswith(os.path.abspath(self.args.root)) or not os.path.isfile(name):
+                return None
+            with open(name, 'rb') as f:
+                body = f.read()
+            return body, max(int(os.path.getmtime(name)), self.version())
+
+        version = self.version()
+        seed    = hashlib.sha256(('%s@%d' % (path, version)).encode()).digest()
+        body    = (seed * (self.args.size // len(seed) + 1))[:self.args.size]
+        return body, version
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'   # keep connections open between requests
+    server_state = None
+
+    def log_message(self, fmt, *args):
+        if self.server_state.args.verbose:
+            BaseHTTPRequestHandler.log_message(self, fmt, *args)
+
+    def reply(self, status, headers=(), body=b''):
+        self.send_response(status)
+        for name, value in headers:
+            self.send_header(name, value)
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        if self.command != 'HEAD':
+            self.send_body(body)
+
+    def send_body(self, body):
+        rate = self.server_state.args.rate
+        for start in range(0, len(body), CHUNK):
+            self.wfile.write(body[start:start + CHUNK])
+            if rate:
+                time.sleep(min(CHUNK, len(body) - start) / float(rate))
+
+    def not_modified(self, etag, modified):
+        match = self.headers.get('If-None-Match')
+        if match:
+            return etag in [tag.strip() for tag in match.split(',')] or match.strip() == '*'
+        since = self.headers.get('If-Modified-Since')
+        if since:
+            try:
+                return modified <= parsedate_to_datetime(since).timestamp()
+            except (TypeError, ValueError):
+                return False
+        return False
+
+    def do_GET(self):
+        state = self.server_state
+        args  = state.args
+        state.count('requests')
+
+        if args.latency:
+            time.sleep(random.uniform(0.5, 1.5) * args.latency / 1000.0)
+
+        if random.random() < args.drop_rate:
+            state.count('dropped')
+            self.close_connection = True
+            return
+
+        if random.random() < args.error_rate:
+            state.count('errors')
+            self.reply(500, [('Content-Type', 'text/plain')], b'Internal Server Error')
+            return
+
+        url  = urlsplit(self.path)     # a proxy request carries the whole URL
+        path = unquote(url.path) or '/'
+        parts = path.split('/', 3)
+        if len(parts) > 2 and parts[1] == 'redirect' and parts[2].isdigit():
+            state.count('redirected')
+            hops = int(parts[2]) - 1
+            rest = '/' + (parts[3] if len(parts) > 3 else '')
+            target = '/redirect/%d%s' % (hops, rest) if hops > 0 else rest
+            if url.netloc:
+                target = '%s://%s%s' % (url.scheme or 'http', url.netloc, target)
+            self.reply(302, [('Location', target)])
+            return
+
+        found = state.content(path)
+        if found is None:
+            state.count('notFound')
+            self.reply(404, [('Content-Type', 'text/plain')], b'Not Found')
+            return
+
+        body, modified = found
+        headers = [('Cache-Control', 'max-age=%d' % args.max_age)]
+        etag    = '"%s"' % hashlib.sha1(body).hexdigest()[:16]
+        if not args.no_validators:
+            headers.append(('ETag', etag))
+            headers.append(('Last-Modified', formatdate(modified, usegmt=True)))
+            if self.not_modified(etag, modified):
+                state.count('notModified')
+                self.reply(304, headers)
+                return
+
+        state.count('downloaded')
+        if self.command != 'HEAD':
+            state.count('bytes', len(body))
+        headers.append(('Content-Type', 'application/octet-stream'))
+        self.reply(200, headers, body)
+
+    do_HEAD = do_GET
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Mock xTuple web services.')
+    parser.add_argument('-p', '--port', type=int, default=8080, help='port to listen on [8080]')
+    parser.add_argument('--bind', default='127.0.0.1', help='address to listen on [127.0.0.1]')
+    parser.add_argument('--root', help='directory to serve files from instead of made-up content')
+    parser.add_argument('--size', type=int, default=64 * 1024,
+                        help='size of made-up files, in bytes [65536]')
+    parser.add_argument('--change-every', type=float, default=0,
+                        help='change every file this often, in seconds, 0 for never [0]')
+    parser.add_argument('--max-age', type=int, default=0,
+                        help='Cache-Control max-age to send, in seconds [0]')
+    parser.add_argument('--no-validators', action='store_true',
+                        help='send neither ETag nor Last-Modified, so nothing can be revalidated')
+    parser.add_argument('--rate', type=int, default=0,
+                        help='bytes per second to send each response at, 0 for no limit [0]')
+    parser.add_argument('--latency', type=float, default=0,
+                        help='average time to start answering, in ms [0]')
+    parser.add_argument('--error-rate', type=float, default=0,
+                        help='share of requests to answer with 500, 0-1 [0]')
+    parser.add_argument('--drop-rate', type=float, default=0,
+                        help='share of requests to hang up on without answering, 0-1 [0]')
+    parser.add_argument('--report', type=int, default=100,
+                        help='print a summary every this many requests, 0 for never [100]')
+    parser.add_argument('--seed', type=int, help='random seed, for repeatable runs')
+    parser.add_argument('-v', '--verbose', action='store_true', help='log every request')
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+    if args.root:
+        args.root = os.path.abspath(args.root)
+
+    Handler.server_state = Server(args)
+    server = ThreadingHTTPServer((args.bind, args.port), Handler)
+
+    print('Mock xTuple web services at http://%s:%d/' % (args.bind, args.port),
+          file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    Handler.server_state.summary()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+# Summarize a trace written by the client's -trace=<file> option and
+# optionally compare it against a baseline summary.
+#
+# A typical benchmark run opens the same windows before and after a change,
+# offscreen, against the same database:
+#
+#   QT_QPA_PLATFORM=offscreen xtuple -databaseURL=... -username=... \
+#                                    -passwd=... -trace=before.json
+#   tracesummary.py before.json -o baseline.json
+#   ...
+#   tracesummary.py after.json -b baseline.json
+#
+# The exit status is 1 if any span got slower than the baseline by more
+# than the tolerance, so the comparison can gate a build.
+#
+# benchmarks/widgetbench writes summaries in the same format, so a
+# baseline from either can be checked with the other.
+
+import argparse
+import json
+import sys
+
+
+def percentile(ordered, fraction):
+    if not ordered:
+        return 0
+    index = min(len(ordered) - 1, int(round(fraction * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def summarize(trace, bydetail):
+    durations = {}
+    for event in trace.get('traceEvents', []):
+        if event.get('ph') != 'X':
+            continue
+        key = event['name']
+        detail = event.get('args', {}).get('detail', '')
+        if bydetail and detail:
+            key += ' ' + detail
+        durations.setdefault(key, []).append(event.get('dur', 0))
+
+    summary = {}
+    for key, values in durations.items():
+        values.sort()
+        summary[key] = {
+            'count':    len(values),
+            'total_us': sum(values),
+            'median_us': percentile(values, 0.5),
+            'p95_us':   percentile(values, 0.95),
+            'max_us':   values[-1],
+        }
+    return summary
+
+
+def compare(summary, baseline, tolerance, minimum_us):
+    regressions = []
+    for key, old in sorted(baseline.items()):
+        new = summary.get(key)
+        if new is None or not old.get('count'):
+            continue   # a count of 0 is a placeholder for a span not yet measured
+        limit = old['median_us'] * (1.0 + tolerance / 100.0)
+        if new['median_us'] > limit and \
+           new['median_us'] - old['median_us'] >= minimum_us:
+            regressions.append((key, old['median_us'], new['median_us']))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Summarize an xTuple trace file.')
+    parser.add_argument('trace', help='trace file written with -trace=<file>')
+    parser.add_argument('-o', '--output', help='write the summary here instead of stdout')
+    parser.add_argument('-b', '--baseline', help='summary to compare against')
+    parser.add_argument('-t', '--tolerance', type=float, default=20.0,
+                        help='allowed slowdown of the median, in percent [20]')
+    parser.add_argument('-m', '--minimum', type=float, default=1.0,
+                        help='ignore slowdowns smaller than this many ms [1]')
+    parser.add_argument('-d', '--detail', action='store_true',
+                        help='keep spans with different details (window names) apart')
+    args = parser.parse_args()
+
+    with open(args.trace) as f:
+        summary = summarize(json.load(f), args.detail)
+
+    text = json.dumps(summary, indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text + '\n')
+    elif not args.baseline:
+        print(text)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(summary, baseline, args.tolerance, args.minimum * 1000)
+        for key, old, new in regressions:
+            print('%s: median %.1f ms, baseline %.1f ms' % (key, new / 1000.0, old / 1000.0),
+                  file=sys.stderr)
+        return 1 if regressions else 0
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
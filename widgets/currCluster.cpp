@@ -18,6 +18,8 @@
 #include <QtScript>
 
 #include "xsqlquery.h"
+#include "xpreparedquery.h"
+#include "currratecache.h"
 #include "xcombobox.h"
 #include "format.h"
 #include "xdoublevalidator.h"
@@ -746,6 +748,23 @@ void CurrDisplay::sValueBaseChanged(double newValue)
     }
     else
     {
+      double local = 0;
+      CurrRateCache::Status status =
+        CurrRateCache::instance()->toLocal(id(), newValue, _effective, local);
+      if (status == CurrRateCache::Found)
+      {
+        _valueLocal = local;
+        sZeroErrorCount(id(), effective());
+        _localKnown = true;
+      }
+      else if (status == CurrRateCache::NoRate)
+      {
+        emit noConversionRate();
+        sNoConversionRate(this, id(), effective(), "sValueBaseChanged");
+        _localKnown = false;
+      }
+      else
+      {
 	XSqlQuery convertVal;
 	convertVal.prepare("SELECT currToLocal(:curr_id, :value, :date) "
 			     " AS localValue;");
@@ -773,6 +792,7 @@ void CurrDisplay::sValueBaseChanged(double newValue)
 				    convertVal.lastError().databaseText());
 	    _localKnown = false;
 	}
+      }
     }
     if (ABS(oldLocal - _valueLocal) > EPSILON(_localScale))
 	emit valueLocalChanged(_valueLocal);
@@ -810,6 +830,23 @@ void CurrDisplay::sValueLocalChanged(double newValue)
     }
     else
     {
+      double base = 0;
+      CurrRateCache::Status status =
+        CurrRateCache::instance()->toBase(id(), newValue, _effective, base);
+      if (status == CurrRateCache::Found)
+      {
+        _valueBase = base;
+        sZeroErrorCount(id(), effective());
+        _baseKnown = true;
+      }
+      else if (status == CurrRateCache::NoRate)
+      {
+        emit noConversionRate();
+        sNoConversionRate(this, id(), effective(), "sValueLocalChanged");
+        _baseKnown = false;
+      }
+      else
+      {
 	XSqlQuery convertVal;
 	convertVal.prepare("SELECT currToBase(:curr_id, :value, :date) "
 			   " AS baseValue;");
@@ -837,6 +874,7 @@ void CurrDisplay::sValueLocalChanged(double newValue)
 				    convertVal.lastError().databaseText());
 	    _baseKnown = false;
 	}
+      }
     }
     
     if (ABS(oldBase - _valueBase) > EPSILON(_baseScale))
@@ -895,11 +933,13 @@ bool CurrDisplay::isZero() const
 	return ABS(_valueBase) < EPSILON(_baseScale);
 }
 
-// cache it?
 QString	CurrDisplay::currAbbr() const
 {
-    QString returnValue("");
+    QString returnValue = CurrRateCache::instance()->currConcat(id());
+    if (! returnValue.isNull())
+      return returnValue;
 
+    returnValue = "";
     XSqlQuery getAbbr;
     getAbbr.prepare("SELECT currConcat(:curr_id) AS currConcat;");
     getAbbr.bindValue(":curr_id", id());
@@ -916,9 +956,14 @@ QString	CurrDisplay::currAbbr() const
 
 QString CurrDisplay::currSymbol(const int pid)
 {
+  QString symbol = CurrRateCache::instance()->currSymbol(pid);
+  if (! symbol.isNull())
+    return symbol;
+
   XSqlQuery symq;
   symq.prepare("SELECT curr_symbol FROM curr_symbol WHERE (curr_id=:id);");
   symq.bindValue(":id", pid);
+  symq.exec();
   if (symq.first())
       return symq.value("curr_symbol").toString();
   else if (symq.lastError().type() != QSqlError::NoError)
@@ -958,24 +1003,35 @@ double CurrDisplay::convert(const int from, const int to, const double amount, c
   if (from == to)
     return amount;
 
-  XSqlQuery convq;
-  convq.prepare("SELECT currToCurr(:from, :to, :amount, :date) AS result;");
-  convq.bindValue(":from",   from);
-  convq.bindValue(":to",     to);
-  convq.bindValue(":amount", amount);
-  convq.bindValue(":date",   date);
+  double result = 0;
+  switch (CurrRateCache::instance()->toCurr(from, to, amount, date, result))
+  {
+    case CurrRateCache::Found:
+      return result;
+    case CurrRateCache::NoRate:
+      sNoConversionRate(0, from, date, "convert");
+      return 0.0;
+    case CurrRateCache::Unavailable:
+      break;
+  }
+
+  XPreparedQuery convq("SELECT currToCurr(:from, :to, :amount, :date) AS result;");
+  convq->bindValue(":from",   from);
+  convq->bindValue(":to",     to);
+  convq->bindValue(":amount", amount);
+  convq->bindValue(":date",   date);
   convq.exec();
-  if (convq.first())
-    return convq.value("result").toDouble();
-  else if (convq.lastError().type() != QSqlError::NoError)
+  if (convq->first())
+    return convq->value("result").toDouble();
+  else if (convq->lastError().type() != QSqlError::NoError)
   {
-    if (convq.lastError().databaseText().contains("No exchange rate"))
+    if (convq->lastError().databaseText().contains("No exchange rate"))
       sNoConversionRate(0, from, date, "convert");
     else
       QMessageBox::critical(0, tr("A System Error occurred at %1::%2.")
 			    .arg(__FILE__)
 			    .arg(__LINE__),
-			    convq.lastError().databaseText());
+			    convq->lastError().databaseText());
   }
   return 0.0;
 }
@@ -0,0 +1,504 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "currratecache.h"
+
+#include <QApplication>
+#include <QSqlError>
+#include <QVector>
+#include <QtDebug>
+
+#include "currcluster.h"
+#include "guiclientinterface.h"
+#include "xcombobox.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+// how many days either side of a requested date to load
+#define WINDOWDAYS 90
+
+// how long loaded rates and currencies are used before being read again
+#define EXPIREMSECS (5 * 60 * 1000)
+
+/* Just enough of PostgreSQL's NUMERIC arithmetic to convert amounts the way
+   currToBase() and currToLocal() do: products are exact and quotients are
+   rounded half away from zero to the scale numeric_div() picks.
+ */
+class CurrNumeric
+{
+  public:
+    CurrNumeric() : _negative(false), _scale(0) {}
+
+    static CurrNumeric fromString(const QString &pText);
+
+    bool    isZero()   const { return _digits.isEmpty(); }
+    double  toDouble() const { return toString().toDouble(); }
+    QString toString() const;
+
+    CurrNumeric multiply(const CurrNumeric &pOther) const;
+    CurrNumeric divide(const CurrNumeric &pOther)   const;
+
+  private:
+    void leadingDigit(int &pWeight, int &pDigit) const;
+
+    static int        compare(const QByteArray &pA, const QByteArray &pB);
+    static QByteArray trimmed(const QByteArray &pDigits);
+
+    bool       _negative;
+    QByteArray _digits;   // unscaled magnitude without leading zeros, "" for 0
+    int        _scale;    // digits after the decimal point
+};
+
+QByteArray CurrNumeric::trimmed(const QByteArray &pDigits)
+{
+  int first = 0;
+  while (first < pDigits.size() && pDigits.at(first) == '0')
+    first++;
+  return pDigits.mid(first);
+}
+
+// compare two magnitudes without leading zeros
+int CurrNumeric::compare(const QByteArray &pA, const QByteArray &pB)
+{
+  if (pA.size() != pB.size())
+    return pA.size() < pB.size() ? -1 : 1;
+  return qstrcmp(pA, pB);
+}
+
+// accepts what QString::number() and PostgreSQL print, e.g. -12.50 or 1e-07
+CurrNumeric CurrNumeric::fromString(const QString &pText)
+{
+  CurrNumeric result;
+  QString text     = pText.trimmed().toLower();
+  int     exponent = 0;
+  int     e        = text.indexOf('e');
+  if (e >= 0)
+  {
+    exponent = text.mid(e + 1).toInt();
+    text     = text.left(e);
+  }
+  if (text.startsWith('-') || text.startsWith('+'))
+  {
+    result._negative = text.startsWith('-');
+    text = text.mid(1);
+  }
+
+  int point = text.indexOf('.');
+  if (point >= 0)
+  {
+    result._scale = text.size() - point - 1;
+    text.remove(point, 1);
+  }
+  result._scale -= exponent;
+  if (result._scale < 0)
+  {
+    text += QString(-result._scale, '0');
+    result._scale = 0;
+  }
+
+  result._digits = trimmed(text.toLatin1());
+  if (result._digits.isEmpty())
+    result._negative = false;
+  return result;
+}
+
+QString CurrNumeric::toString() const
+{
+  QByteArray digits = _digits;
+  if (digits.size() <= _scale)
+    digits.prepend(QByteArray(_scale - digits.size() + 1, '0'));
+  if (_scale > 0)
+    digits.insert(digits.size() - _scale, '.');
+  return QString::fromLatin1((_negative ? "-" : "") + digits);
+}
+
+/* The weight and value of the first non-zero base-10000 digit, which is
+   how numeric.c sizes a quotient. The groups of four decimal digits line
+   up on the decimal point.
+ */
+void CurrNumeric::leadingDigit(int &pWeight, int &pDigit) const
+{
+  QByteArray integer  = _digits.left(qMax(0, _digits.size() - _scale));
+  QByteArray fraction = _digits.right(qMin(_digits.size(), _scale));
+  fraction.prepend(QByteArray(_scale - fraction.size(), '0'));
+  integer.prepend(QByteArray((4 - integer.size() % 4) % 4, '0'));
+  fraction.append(QByteArray((4 - fraction.size() % 4) % 4, '0'));
+
+  QByteArray all = integer + fraction;
+  pWeight = 0;
+  pDigit  = 0;
+  for (int i = 0; i < all.size(); i += 4)
+  {
+    pDigit = all.mid(i, 4).toInt();
+    if (pDigit != 0)
+    {
+      pWeight = integer.size() / 4 - 1 - i / 4;
+      return;
+    }
+  }
+}
+
+CurrNumeric CurrNumeric::multiply(const CurrNumeric &pOther) const
+{
+  CurrNumeric result;
+  result._scale = _scale + pOther._scale;
+  if (isZero() || pOther.isZero())
+    return result;
+
+  QVector<int> sum(_digits.size() + pOther._digits.size(), 0);
+  for (int i = _digits.size() - 1; i >= 0; i--)
+    for (int j = pOther._digits.size() - 1; j >= 0; j--)
+      sum[i + j + 1] += (_digits.at(i) - '0') * (pOther._digits.at(j) - '0');
+  for (int k = sum.size() - 1; k > 0; k--)
+  {
+    sum[k - 1] += sum[k] / 10;
+    sum[k]     %= 10;
+  }
+
+  QByteArray digits;
+  foreach (int digit, sum)
+    digits.append(char('0' + digit));
+  result._digits   = trimmed(digits);
+  result._negative = _negative != pOther._negative;
+  return result;
+}
+
+/* numeric_div() keeps at least 16 significant digits and never fewer
+   decimals than either operand, then rounds the last one half away from
+   zero. Like select_div_scale() it guesses the quotient is below one
+   base-10000 digit when the leading digits don't show otherwise.
+ */
+CurrNumeric CurrNumeric::divide(const CurrNumeric &pOther) const
+{
+  CurrNumeric result;
+  if (isZero() || pOther.isZero())
+    return result;
+
+  int weight1, digit1, weight2, digit2;
+  leadingDigit(weight1, digit1);
+  pOther.leadingDigit(weight2, digit2);
+  int qweight = weight1 - weight2;
+  if (digit1 <= digit2)
+    qweight--;
+
+  int rscale = 16 - qweight * 4;
+  rscale = qMax(rscale, qMax(_scale, pOther._scale));
+  rscale = qBound(0, rscale, 1000);
+
+  // (A / 10^sa) / (B / 10^sb) * 10^(rscale + 1) = A * 10^(sb - sa + rscale + 1) / B
+  QByteArray dividend = _digits + QByteArray(pOther._scale - _scale + rscale + 1, '0');
+  QByteArray quotient;
+  QByteArray remainder;
+  for (int i = 0; i < dividend.size(); i++)
+  {
+    remainder = trimmed(remainder + dividend.at(i));
+    int count = 0;
+    while (compare(remainder, pOther._digits) >= 0)
+    {
+      // remainder -= divisor, both without leading zeros
+      QByteArray difference(remainder.size(), '0');
+      int borrow = 0;
+      for (int r = remainder.size() - 1, d = pOther._digits.size() - 1; r >= 0; r--, d--)
+      {
+        int digit = remainder.at(r) - '0' - borrow - (d >= 0 ? pOther._digits.at(d) - '0' : 0);
+        borrow = digit < 0 ? 1 : 0;
+        difference[r] = char('0' + digit + borrow * 10);
+      }
+      remainder = trimmed(difference);
+      count++;
+    }
+    quotient.append(char('0' + count));
+  }
+
+  // drop the extra digit, rounding on it
+  bool roundUp = quotient.at(quotient.size() - 1) >= '5';
+  quotient.chop(1);
+  for (int i = quotient.size() - 1; roundUp && i >= 0; i--)
+  {
+    roundUp = quotient.at(i) == '9';
+    quotient[i] = roundUp ? '0' : char(quotient.at(i) + 1);
+  }
+  if (roundUp)
+    quotient.prepend('1');
+
+  result._digits   = trimmed(quotient);
+  result._scale    = rscale;
+  result._negative = ! result._digits.isEmpty() && _negative != pOther._negative;
+  return result;
+}
+
+// 15 significant digits is all a double holds, and what the user typed
+static CurrNumeric toNumeric(double pValue)
+{
+  return CurrNumeric::fromString(QString::number(pValue, 'g', 15));
+}
+
+CurrRateCache *CurrRateCache::_instance = 0;
+
+CurrRateCache *CurrRateCache::instance()
+{
+  if (! _instance)
+    _instance = new CurrRateCache(qApp);
+  return _instance;
+}
+
+CurrRateCache::CurrRateCache(QObject *pParent)
+  : QObject(pParent),
+    _currenciesLoaded(false)
+{
+  if (XComboBox::_guiClientInterface)
+    connect(XComboBox::_guiClientInterface, SIGNAL(dbConnectionLost()), this, SLOT(clear()));
+}
+
+void CurrRateCache::clear()
+{
+  if (DEBUG) qDebug() << "CurrRateCache::clear()";
+  _currenciesLoaded = false;
+  _concat.clear();
+  _symbol.clear();
+  _windows.clear();
+}
+
+bool CurrRateCache::loadCurrencies()
+{
+  XSqlQuery currq;
+  currq.prepare("SELECT curr_id, curr_symbol, currConcat(curr_id) AS currconcat"
+                "  FROM curr_symbol;");
+  currq.exec();
+  if (currq.lastError().type() != QSqlError::NoError)
+  {
+    if (DEBUG) qDebug() << "CurrRateCache::loadCurrencies()" << currq.lastError().databaseText();
+    return false;
+  }
+
+  _concat.clear();
+  _symbol.clear();
+  while (currq.next())
+  {
+    int id = currq.value("curr_id").toInt();
+    _concat.insert(id, currq.value("currconcat").toString());
+    _symbol.insert(id, currq.value("curr_symbol").toString());
+  }
+  _currenciesLoaded = true;
+  _currenciesTimer.start();
+  return true;
+}
+
+/* Load every rate for pCurrId in effect at any time between pStart and pEnd.
+   Overlapping or adjacent windows are merged so paging through dates
+   doesn't throw away what's already known.
+ */
+bool CurrRateCache::load(int pCurrId, const QDate &pStart, const QDate &pEnd)
+{
+  QDate start = pStart;
+  QDate end   = pEnd;
+  if (_windows.contains(pCurrId) && ! _windows[pCurrId].loaded.hasExpired(EXPIREMSECS))
+  {
+    const Window &old = _windows[pCurrId];
+    if (start <= old.end.addDays(1) && end >= old.start.addDays(-1))
+    {
+      start = qMin(start, old.start);
+      end   = qMax(end,   old.end);
+    }
+  }
+
+  XSqlQuery rateq;
+  rateq.prepare("SELECT curr_rate, CAST(curr_rate AS TEXT) AS exactrate,"
+                "       curr_effective, curr_expires"
+                "  FROM curr_rate"
+                " WHERE curr_id = :curr_id"
+                "   AND curr_expires >= :start"
+                "   AND curr_effective <= :end"
+                " ORDER BY curr_effective;");
+  rateq.bindValue(":curr_id", pCurrId);
+  rateq.bindValue(":start",   start);
+  rateq.bindValue(":end",     end);
+  rateq.exec();
+  if (rateq.lastError().type() != QSqlError::NoError)
+  {
+    if (DEBUG) qDebug() << "CurrRateCache::load()" << rateq.lastError().databaseText();
+    return false;
+  }
+
+  Window window;
+  window.start = start;
+  window.end   = end;
+  window.loaded.start();
+  while (rateq.next())
+  {
+    Range range;
+    range.rate      = rateq.value("curr_rate").toDouble();
+    range.exactRate = rateq.value("exactrate").toString();
+    range.effective = rateq.value("curr_effective").toDate();
+    range.expires   = rateq.value("curr_expires").toDate();
+    window.ranges.append(range);
+  }
+  _windows.insert(pCurrId, window);
+
+  if (DEBUG)
+    qDebug() << "CurrRateCache::load()" << pCurrId << start << end
+             << window.ranges.size() << "rates";
+  return true;
+}
+
+/** Load the rates for several currencies over a date range up front, for
+    windows that are about to convert many amounts.
+ */
+bool CurrRateCache::preload(const QList<int> &pCurrIds, const QDate &pStart, const QDate &pEnd)
+{
+  bool result = true;
+  foreach (int id, pCurrIds)
+  {
+    if (id == CurrDisplay::baseId())
+      continue;
+    if (_windows.contains(id) && _windows[id].start <= pStart && _windows[id].end >= pEnd &&
+        ! _windows[id].loaded.hasExpired(EXPIREMSECS))
+      continue;
+    result = load(id, pStart, pEnd) && result;
+  }
+  return result;
+}
+
+CurrRateCache::Status CurrRateCache::findRate(int pCurrId, const QDate &pDate, Range &pRange)
+{
+  if (! pDate.isValid())
+    return Unavailable;
+
+  if (! _windows.contains(pCurrId) ||
+      pDate < _windows[pCurrId].start || pDate > _windows[pCurrId].end ||
+      _windows[pCurrId].loaded.hasExpired(EXPIREMSECS))
+  {
+    if (! load(pCurrId, pDate.addDays(-WINDOWDAYS), pDate.addDays(WINDOWDAYS)))
+      return Unavailable;
+  }
+
+  // binary search for the last range that starts on or before pDate
+  const QList<Range> &ranges = _windows[pCurrId].ranges;
+  int lo = 0;
+  int hi = ranges.size() - 1;
+  int found = -1;
+  while (lo <= hi)
+  {
+    int mid = (lo + hi) / 2;
+    if (ranges.at(mid).effective <= pDate)
+    {
+      found = mid;
+      lo = mid + 1;
+    }
+    else
+      hi = mid - 1;
+  }
+  if (found < 0 || ranges.at(found).expires < pDate)
+    return NoRate;
+
+  pRange = ranges.at(found);
+  return Found;
+}
+
+CurrRateCache::Status CurrRateCache::rate(int pCurrId, const QDate &pDate, double &pRate)
+{
+  Range range;
+  Status status = findRate(pCurrId, pDate, range);
+  if (status == Found)
+    pRate = range.rate;
+  return status;
+}
+
+/** Same as currToLocal(pCurrId, pValue, pDate). */
+CurrRateCache::Status CurrRateCache::toLocal(int pCurrId, double pValue, const QDate &pDate, double &pResult)
+{
+  // zero is zero in any currency, even without a rate on file
+  if (pValue == 0 || pCurrId == CurrDisplay::baseId())
+  {
+    pResult = pValue;
+    return Found;
+  }
+
+  Range range;
+  Status status = findRate(pCurrId, pDate, range);
+  if (status == Found)
+    pResult = toNumeric(pValue).multiply(CurrNumeric::fromString(range.exactRate)).toDouble();
+  return status;
+}
+
+/** Same as currToBase(pCurrId, pValue, pDate). */
+CurrRateCache::Status CurrRateCache::toBase(int pCurrId, double pValue, const QDate &pDate, double &pResult)
+{
+  if (pValue == 0 || pCurrId == CurrDisplay::baseId())
+  {
+    pResult = pValue;
+    return Found;
+  }
+
+  Range range;
+  Status status = findRate(pCurrId, pDate, range);
+  if (status == Found)
+  {
+    CurrNumeric rate = CurrNumeric::fromString(range.exactRate);
+    if (rate.isZero())
+      return Unavailable;   // let the database report it
+    pResult = toNumeric(pValue).divide(rate).toDouble();
+  }
+  return status;
+}
+
+/** Same as currToCurr(pFromId, pToId, pValue, pDate). The amount in base
+    currency stays a NUMERIC between the two steps, as it does in the
+    database.
+ */
+CurrRateCache::Status CurrRateCache::toCurr(int pFromId, int pToId, double pValue, const QDate &pDate, double &pResult)
+{
+  if (pValue == 0 || pFromId == pToId)
+  {
+    pResult = pValue;
+    return Found;
+  }
+
+  CurrNumeric value = toNumeric(pValue);
+  if (pFromId != CurrDisplay::baseId())
+  {
+    Range from;
+    Status status = findRate(pFromId, pDate, from);
+    if (status != Found)
+      return status;
+    CurrNumeric rate = CurrNumeric::fromString(from.exactRate);
+    if (rate.isZero())
+      return Unavailable;
+    value = value.divide(rate);
+  }
+
+  if (pToId != CurrDisplay::baseId() && ! value.isZero())
+  {
+    Range to;
+    Status status = findRate(pToId, pDate, to);
+    if (status != Found)
+      return status;
+    value = value.multiply(CurrNumeric::fromString(to.exactRate));
+  }
+
+  pResult = value.toDouble();
+  return Found;
+}
+
+/** Same as currConcat(pCurrId), or a null string if it isn't known. */
+QString CurrRateCache::currConcat(int pCurrId)
+{
+  if ((! _currenciesLoaded || _currenciesTimer.hasExpired(EXPIREMSECS)) && ! loadCurrencies())
+    return QString();
+  return _concat.value(pCurrId);
+}
+
+QString CurrRateCache::currSymbol(int pCurrId)
+{
+  if ((! _currenciesLoaded || _currenciesTimer.hasExpired(EXPIREMSECS)) && ! loadCurrencies())
+    return QString();
+  return _symbol.value(pCurrId);
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef currratecache_h
+#define currratecache_h
+
+#include <QDate>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include "widgets.h"
+
+/** \class CurrRateCache
+    \brief A client-side copy of curr_rate used to convert money amounts
+           without a round trip to the database for every keystroke.
+
+    Rates are loaded one currency at a time, for a window of dates around
+    the date being converted. Conversions inside a loaded window are done
+    locally the same way currToLocal(), currToBase() and currToCurr() do
+    them, with PostgreSQL NUMERIC arithmetic rather than doubles so the
+    results match the database to the last digit.
+
+    The database doesn't announce rate changes, so loaded rates and
+    currencies are read again once they are more than a few minutes old.
+    The cache is also cleared when the database connection is lost and
+    when this client saves or deletes a rate.
+
+    Every method returns Unavailable if the rates couldn't be loaded, in
+    which case the caller should fall back to the database function.
+ */
+class XTUPLEWIDGETS_EXPORT CurrRateCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    enum Status { Found, NoRate, Unavailable };
+
+    static CurrRateCache *instance();
+
+    virtual Status  rate(int pCurrId, const QDate &pDate, double &pRate);
+    virtual Status  toLocal(int pCurrId, double pValue, const QDate &pDate, double &pResult);
+    virtual Status  toBase(int pCurrId, double pValue, const QDate &pDate, double &pResult);
+    virtual Status  toCurr(int pFromId, int pToId, double pValue, const QDate &pDate, double &pResult);
+    virtual QString currConcat(int pCurrId);
+    virtual QString currSymbol(int pCurrId);
+    virtual bool    preload(const QList<int> &pCurrIds, const QDate &pStart, const QDate &pEnd);
+
+  public slots:
+    virtual void clear();
+
+  protected:
+    CurrRateCache(QObject *pParent = 0);
+
+    virtual bool load(int pCurrId, const QDate &pStart, const QDate &pEnd);
+    virtual bool loadCurrencies();
+
+  private:
+    struct Range
+    {
+      QDate  effective;
+      QDate   expires;
+      double  rate;
+      QString exactRate;     // curr_rate as the database prints it
+    };
+    struct Window
+    {
+      QDate         start;
+      QDate         end;
+      QElapsedTimer loaded;
+      QList<Range>  ranges;  // ordered by effective date
+    };
+
+    virtual Status findRate(int pCurrId, const QDate &pDate, Range &pRange);
+
+    static CurrRateCache *_instance;
+
+    bool                   _currenciesLoaded;
+    QElapsedTimer          _currenciesTimer;
+    QHash<int, QString>    _concat;
+    QHash<int, QString>    _symbol;
+    QHash<int, Window>     _windows;
+};
+
+#endif
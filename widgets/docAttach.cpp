@@ -12,6 +12,7 @@
 
 #include <QDebug>
 #include <QDialog>
+#include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFormLayout>
@@ -26,6 +27,7 @@
 #include "errorReporter.h"
 #include "../common/shortcuts.h"
 #include "imageview.h"
+#include "xdocumenttransfer.h"
 
 #define DEBUG false
 
@@ -241,7 +243,9 @@ void docAttach::set(const ParameterList &pParams)
     if (DEBUG) qDebug() << "got url_id" << param;
     XSqlQuery qry;
     _id = param.toInt();
-    qry.prepare("SELECT url_source, url_source_id, url_title, url_url, url_stream, url_mime_type, docass_target_id "
+    qry.prepare("SELECT url_source, url_source_id, url_title, url_url,"
+                "       COALESCE(octet_length(url_stream), 0) AS url_stream_size,"
+                "       url_mime_type, docass_target_id "
                 "  FROM url"
                 "  JOIN docass ON url_id = docass_id"
                 " WHERE (url_id=:url_id);" );
@@ -263,12 +267,12 @@ void docAttach::set(const ParameterList &pParams)
         if (DEBUG)
           qDebug() << "file title:"    << qry.value("url_title").toString()
                    << " text:"         << url.toString()
-                   << "stream length:" << qry.value("url_stream").toString().length();
+                   << "stream length:" << qry.value("url_stream_size").toLongLong();
         _docType->setId(-2);
         _filetitle->setText(qry.value("url_title").toString());
         _file->setText(url.toString());
         _mimeType->setText(qry.value("url_mime_type").toString());
-        if (qry.value("url_stream").toString().length())
+        if (qry.value("url_stream_size").toLongLong() > 0)
         {
           _fileList->setEnabled(false);
           _file->setEnabled(false);
@@ -362,6 +366,7 @@ void docAttach::sSave()
   XSqlQuery newDocass;
   QString title;
   QUrl url;
+  QFile sourceFile;
 
   //set the purpose
   if (_docAttachPurpose->currentIndex() == 0)
@@ -505,7 +510,6 @@ void docAttach::sSave()
       return;
     }
 
-    QByteArray  bytarr;
     QFileInfo fi(url.toLocalFile());
 
     if(_saveDbCheck->isChecked() &&
@@ -521,7 +525,7 @@ void docAttach::sSave()
         emit saveAfterRollback(new XSqlQuery());
         return;
       }
-      QFile sourceFile(url.toLocalFile());
+      sourceFile.setFileName(url.toLocalFile());
       if (!sourceFile.open(QIODevice::ReadOnly))
       {
         QMessageBox::warning( this, tr("File Open Error"),
@@ -532,12 +536,11 @@ void docAttach::sSave()
         emit saveAfterRollback(new XSqlQuery());
         return;
       }
-      bytarr = sourceFile.readAll();
       url.setPath(fi.fileName().remove(" "));
       url.setScheme("");
     }
 
-    if (_mode == "new" && bytarr.isNull())
+    if (_mode == "new" && ! sourceFile.isOpen())
     {
       newDocass.prepare( "INSERT INTO docass ("
                          "  docass_source_id, docass_source_type,"
@@ -557,14 +560,13 @@ void docAttach::sSave()
                          "  docass_purpose"
                          ") VALUES ("
                          "  :docass_source_id, :docass_source_type,"
-                         "  createfile(:title, :url, :stream, :mime_type), 'FILE'::text,"
+                         "  createfile(:title, :url, ''::bytea, :mime_type), 'FILE'::text,"
                          "  'S'::bpchar"
                          ") RETURNING docass_id, docass_target_id;");
 
       QMimeDatabase mimeDb;
-      QMimeType mime = mimeDb.mimeTypeForFileNameAndData(_filetitle->text(), bytarr);
+      QMimeType mime = mimeDb.mimeTypeForFileNameAndData(_filetitle->text(), &sourceFile);
 
-      newDocass.bindValue(":stream", bytarr);
       newDocass.bindValue(":mime_type", mime.name());
     }
     else
@@ -624,6 +626,24 @@ void docAttach::sSave()
     _targetid = newDocass.value("docass_target_id").toInt();
   }
 
+  // the file goes into the row createfile() made, in the same transaction;
+  // documents are addressed by url_id, which is the docass_id
+  if (sourceFile.isOpen())
+  {
+    XDocumentTransfer transfer(this);
+    if (! transfer.upload(&sourceFile, _id))
+    {
+      if (! transfer.wasCancelled())
+        QMessageBox::critical(this, tr("Error saving"),
+                              tr("Could not save %1 to the database:\n%2")
+                                .arg(sourceFile.fileName(), transfer.lastError()));
+      emit saveBeforeRollback(&newDocass);
+      rollback.exec();
+      emit saveAfterRollback(&newDocass);
+      return;
+    }
+  }
+
   emit saveBeforeCommit();
 
   if (_saveStatus==Failed)
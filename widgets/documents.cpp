@@ -12,6 +12,7 @@
 #include <QDesktopServices>
 #include <QDialog>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QMenu>
 #include <QMessageBox>
@@ -30,6 +31,7 @@
 #include "imageview.h"
 #include "imageAssignment.h"
 #include "docAttach.h"
+#include "xdocumenttransfer.h"
 
 QMap<QString, struct DocumentMap*> Documents::_strMap;
 QMap<int,     struct DocumentMap*> Documents::_intMap;
@@ -307,7 +309,7 @@ void Documents::sOpenDoc(QString mode)
     }
 
     XSqlQuery qfile;
-    qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url, url_stream"
+    qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url"
                   " FROM url"
                   " WHERE (url_id=:url_id);");
 
@@ -337,19 +339,30 @@ void Documents::sOpenDoc(QString mode)
       if (! tdir.exists(filePath))
         tdir.mkpath(filePath);
 
-      if (!tfile.open(QIODevice::WriteOnly))
+      // the cached copy is shared, so give the user a copy of their own
+      XDocumentTransfer transfer(this);
+      QString cached = transfer.fetch(qfile.value("url_id").toInt());
+      if (cached.isEmpty())
+      {
+        if (! transfer.wasCancelled())
+          QMessageBox::warning(this, tr("File Open Error"),
+                               tr("Could not read the document from the database:\n%1")
+                                 .arg(transfer.lastError()));
+        return;
+      }
+      tfile.remove();
+      if (! QFile::copy(cached, tfile.fileName()))
       {
         QMessageBox::warning( this, tr("File Open Error"),
                              tr("Could Not Create File %1.").arg(tfile.fileName()) );
         return;
       }
-      tfile.write(qfile.value("url_stream").toByteArray());
+      tfile.setPermissions(tfile.permissions() | QFile::WriteOwner);
       QUrl urldb;
       urldb.setUrl(tfile.fileName());
 #ifndef Q_OS_WIN
       urldb.setScheme("file");
 #endif
-      tfile.close();
       if (! QDesktopServices::openUrl(urldb))
       {
         QMessageBox::warning(this, tr("File Open Error"),
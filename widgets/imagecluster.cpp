@@ -15,10 +15,10 @@
 #include <QPixmap>
 #include <QScrollArea>
 
-#include <quuencode.h>
 #include <xsqlquery.h>
 
 #include "xcheckbox.h"
+#include "ximagecache.h"
 #include "xtreewidget.h"
 
 #define DEBUG   false
@@ -40,6 +40,9 @@ ImageCluster::ImageCluster(QWidget* pParent, const char* pName) :
   _name->hide();
 
   _nullPixmap = QPixmap();
+
+  connect(XImageCache::instance(), SIGNAL(decoded(int, QImage)),
+          this,                    SLOT(sImageDecoded(int, QImage)));
 }
 
 void ImageCluster::clear()
@@ -65,26 +68,25 @@ void ImageCluster::sRefresh()
   }
   else
   {
-    XSqlQuery data;
-    data.prepare("SELECT image_data FROM image WHERE image_id=:image_id");
-    data.bindValue(":image_id", id());
-    data.exec();
-    if (data.first())
-    {
-      if (DEBUG)
-        qDebug("ImageCluster::sRefresh() has picture %s, %d",
-               qPrintable(_description->text().right(128)),
-               data.value("image_data").toString().length());
-      QImage tmpImage;
-      tmpImage.loadFromData(QUUDecode(data.value("image_data").toString()));
-      _image->setPixmap(QPixmap::fromImage(tmpImage));
-    }
+    // a null image means it's being decoded, sImageDecoded() will show it
+    QImage tmpImage = XImageCache::instance()->fetch(id());
+    if (DEBUG)
+      qDebug("ImageCluster::sRefresh() has picture %s, %s",
+             qPrintable(_description->text().right(128)),
+             tmpImage.isNull() ? "decoding" : "cached");
+    _image->setPixmap(tmpImage.isNull() ? _nullPixmap : QPixmap::fromImage(tmpImage));
   }
 
   if (DEBUG)
     qDebug("ImageCluster::sRefresh() returning");
 }
 
+void ImageCluster::sImageDecoded(int pImageid, const QImage &pImage)
+{
+  if (pImageid == id() && ! pImage.isNull())
+    _image->setPixmap(QPixmap::fromImage(pImage));
+}
+
 void ImageCluster::setNumberVisible(const bool p)
 {
   _number->setVisible(p);
@@ -70,6 +70,7 @@ class XTUPLEWIDGETS_EXPORT ImageCluster : public VirtualCluster
       virtual void setNumberVisible(const bool p);
 
   protected slots:
+      virtual void sImageDecoded(int pImageid, const QImage &pImage);
 
   private:
     QLabel *_image;
@@ -23,6 +23,8 @@
 #include <QScrollArea>
 #include <quuencode.h>
 
+#include "ximagecache.h"
+
 imageview::imageview(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : QDialog(parent, fl)
 {
@@ -124,7 +126,7 @@ void imageview::set(const ParameterList &pParams)
 void imageview::populate()
 {
   XSqlQuery image;
-  image.prepare( "SELECT image_name, image_descrip, image_data "
+  image.prepare( "SELECT image_name, image_descrip "
                  "FROM image "
                  "WHERE (image_id=:image_id);" );
   image.bindValue(":image_id", _imageviewid);
@@ -134,7 +136,7 @@ void imageview::populate()
     _name->setText(image.value("image_name").toString());
     _descrip->setText(image.value("image_descrip").toString());
 
-    __imageview.loadFromData(QUUDecode(image.value("image_data").toString()));
+    __imageview = XImageCache::instance()->image(_imageviewid);
     _imageview->setPixmap(QPixmap::fromImage(__imageview));
   }
 }
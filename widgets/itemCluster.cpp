@@ -17,6 +17,8 @@
 #include <QtScript>
 
 #include <xsqlquery.h>
+#include <xpreparedquery.h>
+#include <xreadreplica.h>
 
 #include "guiclientinterface.h"
 #include "itemcluster.h"
@@ -397,25 +399,15 @@ void ItemLineEdit::silentSetId(const int pId)
     qDebug("%s::silentSetId(%d) entered",
            qPrintable(objectName()), pId);
 
-  XSqlQuery item;
-  bool      found = false;
+  QString sql;
+  bool    found = false;
 
   _parsed = true;
 
   if (_useValidationQuery)
-  {
-    item.prepare(_validationSql);
-    item.bindValue(":item_id", pId);
-    item.exec();
-    if (item.first())
-      found = true;
-  }
+    sql = _validationSql;
   else if (_useQuery)
-  {
-    item.prepare(_sql);
-    item.exec();
-    found = (item.findFirst("item_id", pId) != -1);
-  }
+    sql = _sql;
   else if (pId != -1)
   {
     QString pre( "SELECT DISTINCT item_number, item_descrip1, item_descrip2,"
@@ -425,11 +417,21 @@ void ItemLineEdit::silentSetId(const int pId)
     clauses = _extraClauses;
     clauses << "(item_id=:item_id)";
 
-    item.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, false));
-    item.bindValue(":item_id", pId);
-    item.exec();
+    sql = buildItemLineEditQuery(pre, clauses, QString::null, _type, false);
+  }
 
-    found = item.first();
+  // the same few statements run every time a grid row or cluster gets an id
+  XPreparedQuery item(sql);
+  if (_useQuery)
+  {
+    item.exec();
+    found = (item->findFirst("item_id", pId) != -1);
+  }
+  else if (! sql.isEmpty())
+  {
+    item->bindValue(":item_id", pId);
+    item.exec();
+    found = item->first();
   }
 
   if (found)
@@ -440,24 +442,24 @@ void ItemLineEdit::silentSetId(const int pId)
       static_cast<QSqlQueryModel* >(completer()->model())->setQuery(QSqlQuery());
     }
 
-    _itemNumber = item.value("item_number").toString();
-    _uom        = item.value("uom_name").toString();
-    _itemType   = item.value("item_type").toString();
-    _configured = item.value("item_config").toBool();
-    _fractional = item.value("item_fractional").toBool();
-    _upc        = item.value("item_upccode").toString();
+    _itemNumber = item->value("item_number").toString();
+    _uom        = item->value("uom_name").toString();
+    _itemType   = item->value("item_type").toString();
+    _configured = item->value("item_config").toBool();
+    _fractional = item->value("item_fractional").toBool();
+    _upc        = item->value("item_upccode").toString();
     _id         = pId;
     _valid      = true;
 
-    setText(item.value("item_number").toString());
+    setText(item->value("item_number").toString());
     emit aliasChanged("");
     emit typeChanged(_itemType);
-    emit descrip1Changed(item.value("item_descrip1").toString());
-    emit descrip2Changed(item.value("item_descrip2").toString());
-    emit uomChanged(item.value("uom_name").toString());
-    emit configured(item.value("item_config").toBool());
-    emit fractional(item.value("item_fractional").toBool());
-    emit upcChanged(item.value("item_upccode").toString());
+    emit descrip1Changed(item->value("item_descrip1").toString());
+    emit descrip2Changed(item->value("item_descrip2").toString());
+    emit uomChanged(item->value("uom_name").toString());
+    emit configured(item->value("item_config").toBool());
+    emit fractional(item->value("item_fractional").toBool());
+    emit upcChanged(item->value("item_upccode").toString());
 
     emit valid(true);
 
@@ -505,16 +507,15 @@ void ItemLineEdit::setItemsiteid(int pItemsiteid)
   if (DEBUG)
     qDebug("%s::setItemsiteId(%d) entered",
            qPrintable(objectName()), pItemsiteid);
-  XSqlQuery itemsite;
-  itemsite.prepare( "SELECT itemsite_item_id, itemsite_warehous_id "
-                    "FROM itemsite "
-                    "WHERE (itemsite_id=:itemsite_id);" );
-  itemsite.bindValue(":itemsite_id", pItemsiteid);
+  XPreparedQuery itemsite("SELECT itemsite_item_id, itemsite_warehous_id "
+                          "FROM itemsite "
+                          "WHERE (itemsite_id=:itemsite_id);");
+  itemsite->bindValue(":itemsite_id", pItemsiteid);
   itemsite.exec();
-  if (itemsite.first())
+  if (itemsite->first())
   {
-    setId(itemsite.value("itemsite_item_id").toInt());
-    emit warehouseIdChanged(itemsite.value("itemsite_warehous_id").toInt());
+    setId(itemsite->value("itemsite_item_id").toInt());
+    emit warehouseIdChanged(itemsite->value("itemsite_warehous_id").toInt());
   }
   else
   {
@@ -572,7 +573,7 @@ void ItemLineEdit::sHandleCompleter()
   QSqlQueryModel* model = static_cast<QSqlQueryModel *>(_completer->model());
   QTreeView * view = static_cast<QTreeView *>(_completer->popup());
   _parsed = true;
-  XSqlQuery numQ;
+  XSqlQuery numQ(XReadReplica::database(XReadReplica::StaleOk));
 
   if (_useQuery)
   {
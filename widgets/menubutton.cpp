@@ -11,7 +11,6 @@
 #include "menubutton.h"
 
 #include <parameter.h>
-#include <quuencode.h>
 #include <xsqlquery.h>
 
 #include <QImage>
@@ -20,6 +19,8 @@
 #include <QtScript>
 #include <QVBoxLayout>
 
+#include "ximagecache.h"
+
 GuiClientInterface* MenuButton::_guiClientInterface = 0;
 
 MenuButton::MenuButton(QWidget *pParent) :
@@ -131,25 +132,11 @@ void MenuButton::setImage(const QString & image)
 
   if (_shown)
   {
-    XSqlQuery qry;
-    qry.prepare("SELECT image_data "
-                "FROM image "
-                "WHERE (image_name=:image);");
-    qry.bindValue(":image", _image);
-    qry.exec();
-    if (qry.first())
-    {
-      QImage img;
-      img.loadFromData(QUUDecode(qry.value("image_data").toString()));
+    QImage img = XImageCache::instance()->image(_image);
+    if (img.isNull())
+      _button->setIcon(QIcon(QPixmap(":/widgets/images/folder_zoom_64.png")));
+    else
       _button->setIcon(QIcon(QPixmap::fromImage(img)));
-      return;
-    }
-    else if (qry.lastError().type() != QSqlError::NoError)
-      QMessageBox::critical(this, tr("A System Error occurred at %1::%2.")
-                            .arg(__FILE__)
-                            .arg(__LINE__),
-                            qry.lastError().databaseText());
-    _button->setIcon(QIcon(QPixmap(":/widgets/images/folder_zoom_64.png")));
   }
 }
 
@@ -26,6 +26,7 @@
 #include "parameterlistsetup.h"
 #include "widgets.h"
 #include "xsqlquery.h"
+#include "xttrace.h"
 #include "metasql.h"
 #include "mqlutil.h"
 
@@ -40,19 +41,29 @@ ScriptableWidget::ScriptableWidget(QWidget *self)
     _scriptLoaded(false)
 {
   _self = (self ? self : dynamic_cast<QWidget *>(this));
-  if (! _cache)
-    _cache = new ScriptCache(_guiClientInterface);
+  (void)scriptCache();
 }
 
 ScriptableWidget::~ScriptableWidget()
 {
 }
 
+/** The scripts shared by every ScriptableWidget, keyed by script id and by
+    the widget name that loaded them.
+ */
+ScriptCache *ScriptableWidget::scriptCache()
+{
+  if (! _cache)
+    _cache = new ScriptCache(_guiClientInterface);
+  return _cache;
+}
+
 QScriptEngine *ScriptableWidget::engine()
 {
   QWidget *w = _self;
   if (w && ! _engine)
   {
+    XtTraceSpan span("createScriptEngine", "script", w);
     _engine = new QScriptEngine(w);
     if (_x_preferences && _x_preferences->boolean("EnableScriptDebug"))
     {
@@ -79,6 +90,7 @@ void ScriptableWidget::loadScript(const QStringList &list)
   // assume a coherent cache has the whole list if it has the last
   if (! _cache->_idsByName.contains(widgetName))
   {
+    XtTraceSpan span("fetchScripts", "script", widgetName);
     _cache->_idsByName.insert(widgetName, QList<int>());
 
     // make one query to get all relevant scripts, using a JSON object
@@ -116,6 +128,7 @@ void ScriptableWidget::loadScript(const QStringList &list)
   {
     QPair<QString, QString> script = _cache->_scriptsById.value(id);
     if (DEBUG) qDebug() << "evaluating" << id << script.first;
+    XtTraceSpan span("evaluateScript", "script", script.first);
     QScriptValue result = engine()->evaluate(script.second, script.first);
     if (engine()->hasUncaughtException())
     {
@@ -137,6 +150,7 @@ void ScriptableWidget::loadScriptEngine()
   if (_scriptLoaded || ! w)
     return;
   _scriptLoaded = true;
+  XtTraceSpan span("loadScriptEngine", "script", w);
 
   QStringList scriptList;
 
@@ -28,6 +28,7 @@ class ScriptableWidget
     virtual ~ScriptableWidget();
 
     static GuiClientInterface *_guiClientInterface;
+    static ScriptCache        *scriptCache();
 
     virtual QScriptEngine    *engine();
     virtual void              loadScript(const QStringList &list);
@@ -10,6 +10,7 @@
 
 #include "scriptcache.h"
 
+#include <QDataStream>
 #include <QSqlDatabase>
 #include <QSqlDriver>
 
@@ -40,6 +41,34 @@ void ScriptCache::clear()
   _idsByName.clear();
 }
 
+/** Add the scripts written by save(), e.g. in an earlier session. */
+void ScriptCache::restore(QDataStream &in)
+{
+  QHash<int, QPair<QString, QString> > scriptsById;
+  QHash<QString, QList<int> >          idsByName;
+  in >> scriptsById >> idsByName;
+  if (in.status() != QDataStream::Ok)
+    return;
+
+  for (QHash<int, QPair<QString, QString> >::const_iterator it = scriptsById.constBegin();
+       it != scriptsById.constEnd(); ++it)
+  {
+    if (! _scriptsById.contains(it.key()))
+      _scriptsById.insert(it.key(), it.value());
+  }
+  for (QHash<QString, QList<int> >::const_iterator it = idsByName.constBegin();
+       it != idsByName.constEnd(); ++it)
+  {
+    if (! _idsByName.contains(it.key()))
+      _idsByName.insert(it.key(), it.value());
+  }
+}
+
+void ScriptCache::save(QDataStream &out) const
+{
+  out << _scriptsById << _idsByName;
+}
+
 void ScriptCache::sDbConnectionLost()
 {
   clear();
@@ -22,6 +22,8 @@
 #include "widgets.h"
 #include "xsqlquery.h"
 
+class QDataStream;
+
 class ScriptCache : public QObject
 {
   Q_OBJECT
@@ -34,6 +36,9 @@ class ScriptCache : public QObject
     QHash<QString, QList<int> >          _idsByName;
     QStringList                          _tablesToWatch;
 
+    virtual void restore(QDataStream &in);
+    virtual void save(QDataStream &out) const;
+
   public slots:
     virtual void clear();
     virtual void sDbConnectionLost();
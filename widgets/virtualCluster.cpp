@@ -30,6 +30,8 @@
 #include "xdatawidgetmapper.h"
 #include "xsqlquery.h"
 #include "xtreewidget.h"
+#include "xreadreplica.h"
+#include "xttrace.h"
 
 #include "virtualCluster.h"
 
@@ -554,11 +556,12 @@ void VirtualClusterLineEdit::sHandleCompleter()
   if (stripped.isEmpty())
     return;
 
+  XtTraceSpan span("completer", "widget", this);
   int width = 0;
   QSqlQueryModel *model = static_cast<QSqlQueryModel *>(_completer->model());
   QTreeView *view = static_cast<QTreeView *>(_completer->popup());
   _parsed = true;
-  XSqlQuery numQ;
+  XSqlQuery numQ(XReadReplica::database(XReadReplica::StaleOk));
   numQ.prepare(_query + _numClause +
                (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
                ((_hasActive && ! _showInactive) ? _activeClause : "") +
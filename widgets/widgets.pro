@@ -3,7 +3,7 @@ include( ../global.pri )
 TARGET   = xtuplewidgets
 TEMPLATE = lib
 CONFIG  += qt warn_on plugin
-QT      += core network printsupport script scripttools sql \
+QT      += concurrent core network printsupport script scripttools sql \
            webkit webkitwidgets widgets xml
 
 greaterThan(QT_MAJOR_VERSION, 4) {
@@ -138,6 +138,7 @@ SOURCES += widgets.cpp \
     crmacctCluster.cpp \
     crmCluster.cpp \
     currCluster.cpp \
+    currratecache.cpp \
     custCluster.cpp \
     customerselector.cpp \
     datecluster.cpp \
@@ -211,6 +212,8 @@ SOURCES += widgets.cpp \
     xtextedit.cpp \
     xtreeview.cpp \
     xtreewidget.cpp \
+    xtreewidgetexport.cpp \
+    xtreewidgetfilter.cpp \
     xtreewidgetprogress.cpp \
     xurllabel.cpp \
 
@@ -236,6 +239,7 @@ HEADERS += widgets.h \
     crmacctcluster.h \
     crmcluster.h \
     currcluster.h \
+    currratecache.h \
     custcluster.h \
     customerselector.h \
     datecluster.h \
@@ -311,6 +315,8 @@ HEADERS += widgets.h \
     xtextedit.h \
     xtreeview.h \
     xtreewidget.h \
+    xtreewidgetexport.h \
+    xtreewidgetfilter.h \
     xtreewidgetprogress.h \
     xurllabel.h \
 
@@ -28,6 +28,7 @@
 #include "xcomboboxprivate.h"
 #include "xdatawidgetmapper.h"
 #include "xsqltablemodel.h"
+#include "xttrace.h"
 
 #define DEBUG false
 
@@ -1388,6 +1389,7 @@ void XComboBox::populate(XSqlQuery pQuery, int pSelected)
   if (DEBUG)
     qDebug("%s::populate(%s, %d) entered",
            qPrintable(objectName()), qPrintable(pQuery.lastQuery()), pSelected);
+  XtTraceSpan span("XComboBox::populate", "widget", this);
 
   int selected = (pSelected >= 0) ? pSelected : id();
   clear();
@@ -17,7 +17,7 @@
 #include <QtScript>
 
 #include "format.h"
-#include <quuencode.h>
+#include "ximagecache.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -80,25 +80,8 @@ void XLabel::setImage(QString image)
     return;
 
   _data->_image = image;
-  XSqlQuery qry;
-  qry.prepare("SELECT image_data "
-              "FROM image "
-              "WHERE (image_name=:image);");
-  qry.bindValue(":image", _data->_image);
-  qry.exec();
-  if (qry.first())
-  {
-    QImage img;
-    img.loadFromData(QUUDecode(qry.value("image_data").toString()));
-    setPixmap(QPixmap::fromImage(img));
-    return;
-  }
-  else if (qry.lastError().type() != QSqlError::NoError)
-    QMessageBox::critical(this, tr("A System Error occurred at %1::%2.")
-                          .arg(__FILE__)
-                          .arg(__LINE__),
-                          qry.lastError().databaseText());
-  setPixmap(QPixmap());
+  QImage img = XImageCache::instance()->image(_data->_image);
+  setPixmap(img.isNull() ? QPixmap() : QPixmap::fromImage(img));
 }
 
 void XLabel::setPrecision(QValidator *pVal)
@@ -15,6 +15,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QAbstractItemView>
+#include <QBuffer>
 #include <QClipboard>
 #include <QDate>
 #include <QDateTime>
@@ -27,6 +28,7 @@
 #include <QMouseEvent>
 #include <QProgressBar>
 #include <QPushButton>
+#include <QSet>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QTextCharFormat>
@@ -40,8 +42,11 @@
 #include <QtScript>
 #include <QMessageBox>
 
+#include "xtreewidgetexport.h"
+#include "xtreewidgetfilter.h"
 #include "xtreewidgetprogress.h"
 #include "xtsettings.h"
+#include "xttrace.h"
 #include "xsqlquery.h"
 #include "format.h"
 
@@ -77,8 +82,6 @@
 
 GuiClientInterface *XTreeWidget::_guiClientInterface = 0;
 
-static QTreeWidgetItem *searchChildren(XTreeWidgetItem *item, int pId);
-
 // cint() and round() regarding Issue #8897
 #include <cmath>
 
@@ -120,6 +123,13 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
     _rowRole[i] = 0;
   _progress = 0;
   _subtotals = 0;
+  _exporter  = 0;
+  _exportProgress = 0;
+  _filter         = 0;
+  _calc           = 0;
+  _calcInProgress = false;
+  _sorting        = false;
+  _idIndexValid   = false;
 
   setUniformRowHeights(true); //#13439 speed improvement if all rows are known to be the same height
   setContextMenuPolicy(Qt::CustomContextMenu);
@@ -140,6 +150,13 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   connect(this,           SIGNAL(itemChanged(QTreeWidgetItem*, int)),                       SLOT(sItemChanged(QTreeWidgetItem*, int)));
   connect(this,           SIGNAL(itemClicked(QTreeWidgetItem*, int)),                       SLOT(sItemClicked(QTreeWidgetItem*, int)));
   connect(&_workingTimer, SIGNAL(timeout()), this, SLOT(populateWorker()));
+  connect(model(), SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,    SLOT(sRowsInserted(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)),
+          this,    SLOT(sRowsAboutToBeRemoved(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(modelAboutToBeReset()), this, SLOT(sInvalidateIdIndex()));
+  connect(model(), SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+          this,    SLOT(sDataChanged(const QModelIndex &, const QModelIndex &)));
 
   emit valid(false);
   setColumnCount(0);
@@ -158,12 +175,28 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   connect(menuAct, SIGNAL(triggered()), this, SLOT(sShowMenu()));
   addAction(menuAct);
 
+  QAction* filterAct = new QAction(this);
+  filterAct->setShortcut(QKeySequence(tr("Ctrl+Shift+F")));
+  filterAct->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+  connect(filterAct, SIGNAL(triggered()), this, SLOT(sShowFilter()));
+  addAction(filterAct);
+
 }
 
 XTreeWidget::~XTreeWidget()
 {
   qApp->restoreOverrideCursor();
 
+  // the items outlive this part of the object so stop maintaining the index
+  disconnect(model(), 0, this, 0);
+  sInvalidateIdIndex();
+
+  if (_exporter)
+  {
+    delete _exporter;   // waits for the worker thread to stop
+    _exporter = 0;
+  }
+
   cleanupAfterPopulate();
 
   if (_subtotals)
@@ -177,6 +210,9 @@ XTreeWidget::~XTreeWidget()
     _subtotals = 0;
   }
 
+  delete _calc;
+  _calc = 0;
+
   if (_x_preferences)
   {
       xtsettingsSetValue( _settingsName + "/isForgetful",       _forgetful);
@@ -246,6 +282,7 @@ void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, Populat
   {
     clear();
     _workingParams.clear();
+    _totalSeeds.clear();
   }
   _workingParams.append(args);
 
@@ -266,6 +303,8 @@ void XTreeWidget::populateWorker()
     return;
   }
 
+  XtTraceSpan span("populate", "window", this);
+
   XTreeWidgetPopulateParams args = _workingParams.first();
   XSqlQuery     pQuery     = args._workingQuery;
   int           pIndex     = args._workingIndex;
@@ -1146,6 +1185,8 @@ void XTreeWidget::merge(int low, int high, int mid){
 }
 void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 {
+  XtTraceSpan span("sortItems", "window", this);
+
   // if old style then maintain backwards compatibility
   if (_roles.size() <= 0)
   {
@@ -1191,6 +1232,7 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
   QString totalrole("totalrole");
   int     itemcount      = topLevelItemCount();
    
+  _sorting = true;
 #ifdef USENEWSORT
   mergeSort(0,itemcount-1);
 #else
@@ -1209,7 +1251,7 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
     {
       if (DEBUG)
         qDebug("sortItems() removing row %d because it's a totalrole", i);
-      takeTopLevelItem(i);
+      delete takeTopLevelItem(i);
       itemcount--;
       i--;
     }
@@ -1259,6 +1301,7 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
     prev = static_cast<XTreeWidgetItem *>(topLevelItem(i));
   }
 #endif
+  _sorting = false;
   populateCalculatedColumns();
 
   setId(previd);
@@ -1270,65 +1313,215 @@ QList<QPair<int, Qt::SortOrder> > XTreeWidget::sortColumnOrder()
   return _sort;
 }
 
+/* Columnar copy of the values behind the xtrunningrole and xttotalrole
+   columns, kept between calls to populateCalculatedColumns() so rows that
+   haven't moved since the last call don't have to be read or redrawn.
+*/
+class XTreeWidgetCalcCache
+{
+  public:
+    struct Column
+    {
+      int             col;
+      bool            running;
+      QVector<int>    set;
+      QVector<double> value;    // raw value, or totalForItem() for totals
+      QVector<double> init;     // running or total init for the row
+      QVector<double> result;   // running value shown in the row
+      QVector<int>    scale;
+    };
+
+    XTreeWidgetCalcCache() : valid(false) {}
+
+    bool                       valid;
+    QList<Column>              columns;
+    QVector<XTreeWidgetItem *> rows;
+};
+
+/* Calculate the running (xtrunningrole) and total (xttotalrole) columns
+   in one pass over the top-level rows. Running values are only
+   recalculated from the first row that moved since the last call, so
+   sorts that don't move anything and appended rows are cheap. Each
+   non-zero total set gets its own subtotal row above the total row for
+   set 0.
+*/
 void XTreeWidget::populateCalculatedColumns()
 {
-  QMap<int, QMap<int, double> > totals; // <col <totalset, subtotal> >
-  QMap<int, int> scales;                // keep scale for the col, not col[totalset]
-  for (int col = 0; topLevelItem(0) &&
-       col < topLevelItem(0)->columnCount(); col++)
+  XtTraceSpan span("populateCalculatedColumns", "window", this);
+  _calcInProgress = true;
+
+  // total rows are always at the end; they're rebuilt below
+  for (int i = QTreeWidget::topLevelItemCount() - 1; i >= 0; i--)
+  {
+    if (QTreeWidget::topLevelItem(i)->data(0, Qt::UserRole).toString() != "totalrole")
+      break;
+    delete takeTopLevelItem(i);
+  }
+
+  if (! _calc)
+    _calc = new XTreeWidgetCalcCache();
+
+  QList<int> running;
+  QList<int> totaled;
+  for (int col = 0; col < columnCount(); col++)
+  {
+    QString role = headerItem()->data(col, Qt::UserRole).toString();
+    if (role == "xtrunningrole")
+      running.append(col);
+    else if (role == "xttotalrole")
+      totaled.append(col);
+  }
+
+  if (_calc->columns.size() != running.size() + totaled.size())
+    _calc->valid = false;
+  for (int i = 0; _calc->valid && i < _calc->columns.size(); i++)
+  {
+    const XTreeWidgetCalcCache::Column &c = _calc->columns.at(i);
+    if (c.col != (c.running ? running.value(i, -1) : totaled.value(i - running.size(), -1)))
+      _calc->valid = false;
+  }
+  if (! _calc->valid)
+  {
+    _calc->columns.clear();
+    _calc->rows.clear();
+    foreach (int col, running + totaled)
+    {
+      XTreeWidgetCalcCache::Column c;
+      c.col     = col;
+      c.running = running.contains(col);
+      _calc->columns.append(c);
+    }
+  }
+
+  if (_calc->columns.isEmpty())
+  {
+    _calcInProgress = false;
+    return;
+  }
+
+  // find the first row that isn't where it was last time
+  int rowcnt = topLevelItemCount();
+  int first  = qMin(rowcnt, _calc->rows.size());
+  QVector<XTreeWidgetItem *> rows(rowcnt);
+  for (int row = 0; row < rowcnt; row++)
   {
-    if (headerItem()->data(col, Qt::UserRole).toString() == "xtrunningrole")
+    rows[row] = topLevelItem(row);
+    if (row < first && rows.at(row) != _calc->rows.at(row))
+      first = row;
+  }
+
+  QMap<int, QMap<int, double> > totals; // <col <totalset, subtotal> >
+  QMap<int, int>                scales; // keep scale for the col, not col[totalset]
+  QSet<int>                     sets;
+  for (int i = 0; i < _calc->columns.size(); i++)
+  {
+    XTreeWidgetCalcCache::Column &c = _calc->columns[i];
+    c.set.resize(rowcnt);
+    c.value.resize(rowcnt);
+    c.init.resize(rowcnt);
+    c.result.resize(rowcnt);
+    c.scale.resize(rowcnt);
+
+    for (int row = first; row < rowcnt; row++)
+    {
+      XTreeWidgetItem *item = rows.at(row);
+      c.scale[row] = item->data(c.col, Xt::ScaleRole).toInt();
+      if (c.running)
+      {
+        // assume that Xt::RunningSetRole exists if xtrunningrole exists
+        c.set[row]   = item->data(c.col, Xt::RunningSetRole).toInt();
+        c.value[row] = item->data(c.col, Xt::RawRole).toDouble();
+        c.init[row]  = item->data(c.col, Xt::RunningInitRole).toDouble();
+      }
+      else
+      {
+        // assume that Xt::TotalSetRole exists if xttotalrole exists
+        c.set[row]   = item->data(c.col, Xt::TotalSetRole).toInt();
+        c.value[row] = item->totalForItem(c.col, c.set.at(row));
+        c.init[row]  = item->data(c.col, Xt::TotalInitRole).toDouble();
+      }
+    }
+
+    if (c.running)
     {
-      QMap<int, double> subtotals;
-      // assume that Xt::RunningSetRole exists if xtrunningrole exists
-      for (int row = 0; row < topLevelItemCount(); row++)
+      QHash<int, double> subtotals;
+      for (int row = 0; row < first; row++)
+        subtotals[c.set.at(row)] = c.result.at(row);
+      for (int row = first; row < rowcnt; row++)
       {
-        int set = topLevelItem(row)->data(col, Xt::RunningSetRole).toInt();
-        if (!subtotals.contains(set))
-          subtotals[set] = topLevelItem(row)->data(col, Xt::RunningInitRole).toDouble();
-        subtotals[set] += topLevelItem(row)->data(col, Xt::RawRole).toDouble();
+        int set = c.set.at(row);
+        if (! subtotals.contains(set))
+          subtotals[set] = c.init.at(row);
+        subtotals[set] += c.value.at(row);
+        c.result[row] = subtotals.value(set);
 
         // setData apparently knows if the value hasn't changed
-        topLevelItem(row)->setData(col, Qt::DisplayRole,
-                                   QLocale().toString(subtotals[set], 'f',
-                                                      topLevelItem(row)->data(col, Xt::ScaleRole).toInt()));
+        rows.at(row)->setData(c.col, Qt::DisplayRole,
+                              QLocale().toString(c.result.at(row), 'f', c.scale.at(row)));
       }
     }
-    else if (headerItem()->data(col, Qt::UserRole).toString() == "xttotalrole")
+    else
     {
       QMap<int, double> totalset;
       int colscale = -99999;
-      // assume that Xt::TotalSetRole exists if xttotalrole exists
-      for (int row = 0; row < topLevelItemCount(); row++)
+      for (int row = 0; row < rowcnt; row++)
       {
-        int set = topLevelItem(row)->data(col, Xt::TotalSetRole).toInt();
-        if (!totalset.contains(set))
-          totalset[set] = topLevelItem(row)->data(col, Xt::TotalInitRole).toInt();
-        totalset[set] += topLevelItem(row)->totalForItem(col, set);
-        if (topLevelItem(row)->data(col, Xt::ScaleRole).toInt() > colscale)
-          colscale = topLevelItem(row)->data(col, Xt::ScaleRole).toInt();
+        int set = c.set.at(row);
+        if (! totalset.contains(set))
+          totalset[set] = c.init.at(row);
+        totalset[set] += c.value.at(row);
+        if (c.scale.at(row) > colscale)
+          colscale = c.scale.at(row);
       }
-      totals.insert(col, totalset);
-      scales.insert(col, colscale);
+      QMapIterator<int, double> seed(_totalSeeds.value(c.col));
+      while (seed.hasNext())
+      {
+        seed.next();
+        totalset[seed.key()] += seed.value();
+      }
+      totals.insert(c.col, totalset);
+      scales.insert(c.col, colscale);
+      sets.unite(totalset.keys().toSet());
     }
   }
 
-  // punt: for now only report values of totalset[0] for each totaled col
-  // TODO: figure out how to handle multiple totalsets
+  _calc->rows  = rows;
+  _calc->valid = true;
+
   if (totals.size() > 0)
   {
-    XTreeWidgetItem *last = new XTreeWidgetItem(this, -1, -1,
-                                                (totals.size() == 1) ? tr("Total") : tr("Totals"));
-    last->setData(0, Qt::UserRole, "totalrole");
-    QMapIterator<int, QMap<int, double> > it(totals);
-    while (it.hasNext())
+    // only the grand total unless the display asked for other sets
+    QList<int> setlist;
+    foreach (int set, _subtotalLabels.keys())
+      if (set != 0 && sets.contains(set))
+        setlist.append(set);
+    setlist.append(0);
+
+    foreach (int set, setlist)
     {
-      it.next();
-      last->setData(it.key(), Qt::DisplayRole,
-                    QLocale().toString(it.value().value(0), 'f',
-                                       scales.value(it.key())));
+      QString label = set ? _subtotalLabels.value(set)
+                          : (totals.size() == 1) ? tr("Total") : tr("Totals");
+      XTreeWidgetItem *last = new XTreeWidgetItem(this, -1, -1, label);
+      last->setData(0, Qt::UserRole, "totalrole");
+      QMapIterator<int, QMap<int, double> > it(totals);
+      while (it.hasNext())
+      {
+        it.next();
+        last->setData(it.key(), Qt::DisplayRole,
+                      QLocale().toString(it.value().value(set), 'f',
+                                         scales.value(it.key())));
+      }
     }
   }
+
+  _calcInProgress = false;
+}
+
+// changes made outside populateCalculatedColumns() make its cache stale
+void XTreeWidget::sDataChanged(const QModelIndex &, const QModelIndex &)
+{
+  if (_calc && ! _calcInProgress)
+    _calc->valid = false;
 }
 
 int XTreeWidget::id() const
@@ -1382,18 +1575,7 @@ void XTreeWidget::setId(int pId, bool pClear)
   else
     flag = QItemSelectionModel::Select;
 
-  XTreeWidgetItem *item  = (XTreeWidgetItem *)topLevelItem(0);
-  QTreeWidgetItem *found = 0;
-  while (item)
-  {
-    if (item && item->id() == pId)
-      found = item;
-    else if (item && item->childCount() > 0)
-      found = searchChildren(item, pId);
-    if (found)
-      break;
-    item = (XTreeWidgetItem *)itemBelow(item);
-  }
+  XTreeWidgetItem *found = firstItemWithId(pId);
   if (found)
   {
     scrollToItem(found);
@@ -1404,27 +1586,6 @@ void XTreeWidget::setId(int pId, bool pClear)
   }
 }
 
-// This is a static local function to help searching children recursively
-QTreeWidgetItem *searchChildren(XTreeWidgetItem *parent, int pId)
-{
-  if (!parent)
-    return 0;
-
-  XTreeWidgetItem *item  = 0;
-  QTreeWidgetItem *found = 0;
-  for (int i = 0; i < parent->childCount(); ++i)
-  {
-    item = (XTreeWidgetItem *)parent->child(i);
-    if (item && item->id() == pId)
-      found = item;
-    else if (item && item->childCount() > 0)
-      found = searchChildren(item, pId);
-    if (found)
-      return found;
-  }
-  return 0;
-}
-
 /*!
 Selects a row with a matching values \a pId and \a pAltId on the first and second columns
 respectively in the result set. If \a pClear is true then any previous selections are cleared.
@@ -1440,19 +1601,192 @@ void XTreeWidget::setId(int pId, int pAltId, bool pClear)
   else
     flag = QItemSelectionModel::Select;
 
-  for (QModelIndex i = indexFromItem(topLevelItem(0)); i.isValid(); i = indexBelow(i))
+  XTreeWidgetItem *found = firstItemWithId(pId, pAltId);
+  if (found)
+    selectionModel()->setCurrentIndex(indexFromItem(found),
+                                      flag |
+                                      QItemSelectionModel::Rows);
+}
+
+/* true if a comes before b in a depth-first walk of the tree. The rows
+   come from the model, which remembers where each item was last seen, so
+   this doesn't search every sibling list on the way up the way
+   indexOfChild() does.
+ */
+static bool indexPrecedes(const QModelIndex &a, const QModelIndex &b)
+{
+  QList<int> apath, bpath;
+  for (QModelIndex i = a; i.isValid(); i = i.parent())
+    apath.prepend(i.row());
+  for (QModelIndex i = b; i.isValid(); i = i.parent())
+    bpath.prepend(i.row());
+
+  for (int i = 0; i < apath.size() && i < bpath.size(); i++)
+    if (apath.at(i) != bpath.at(i))
+      return apath.at(i) < bpath.at(i);
+  return apath.size() < bpath.size();
+}
+
+/* Return the first item, in tree order, with id \a pId.
+   If \a ancestor is given then only look at its descendants.
+ */
+XTreeWidgetItem *XTreeWidget::firstItemWithId(int pId, const XTreeWidgetItem *ancestor) const
+{
+  if (! _idIndexValid)
   {
-    XTreeWidgetItem *item = (XTreeWidgetItem *)itemFromIndex(i);
-    if (item && item->id() == pId && item->altId() == pAltId)
+    _idIndex.clear();
+    _altIdIndex.clear();
+    _idIndexValid = true;
+    for (int i = 0; i < QTreeWidget::topLevelItemCount(); i++)
+      indexItem(dynamic_cast<XTreeWidgetItem *>(QTreeWidget::topLevelItem(i)), true);
+  }
+
+  XTreeWidgetItem *found = 0;
+  QModelIndex      foundIndex;
+  QMultiHash<int, XTreeWidgetItem *>::const_iterator it = _idIndex.constFind(pId);
+  for ( ; it != _idIndex.constEnd() && it.key() == pId; ++it)
+  {
+    XTreeWidgetItem *item = it.value();
+    if (ancestor)
     {
-      selectionModel()->setCurrentIndex(i,
-                                        flag |
-                                        QItemSelectionModel::Rows);
-      return;
+      QTreeWidgetItem *parent = item->QTreeWidgetItem::parent();
+      while (parent && parent != ancestor)
+        parent = parent->parent();
+      if (! parent)
+        continue;
     }
+    if (! found)
+      found = item;
+    else
+    {
+      QModelIndex index = indexFromItem(item);
+      if (! foundIndex.isValid())
+        foundIndex = indexFromItem(found);
+      if (indexPrecedes(index, foundIndex))
+      {
+        found      = item;
+        foundIndex = index;
+      }
+    }
+  }
+  return found;
+}
+
+/* Return the first item, in display order, with id \a pId and altId \a pAltId,
+   skipping items hidden inside collapsed parents.
+ */
+XTreeWidgetItem *XTreeWidget::firstItemWithId(int pId, int pAltId) const
+{
+  if (! _idIndexValid)
+    (void)firstItemWithId(pId);
+
+  XTreeWidgetItem *found = 0;
+  QModelIndex      foundIndex;
+  QPair<int, int> key = qMakePair(pId, pAltId);
+  QMultiHash<QPair<int, int>, XTreeWidgetItem *>::const_iterator it = _altIdIndex.constFind(key);
+  for ( ; it != _altIdIndex.constEnd() && it.key() == key; ++it)
+  {
+    XTreeWidgetItem *item = it.value();
+    bool expanded = true;
+    for (QTreeWidgetItem *parent = item->QTreeWidgetItem::parent();
+         parent && expanded; parent = parent->parent())
+      expanded = parent->isExpanded();
+    if (! expanded)
+      continue;
+    if (! found)
+      found = item;
+    else
+    {
+      QModelIndex index = indexFromItem(item);
+      if (! foundIndex.isValid())
+        foundIndex = indexFromItem(found);
+      if (indexPrecedes(index, foundIndex))
+      {
+        found      = item;
+        foundIndex = index;
+      }
+    }
+  }
+  return found;
+}
+
+void XTreeWidget::indexItem(XTreeWidgetItem *item, bool add) const
+{
+  if (! item || ! _idIndexValid)
+    return;
+
+  if (add)
+  {
+    _idIndex.insert(item->_id, item);
+    _altIdIndex.insert(qMakePair(item->_id, item->_altId), item);
+  }
+  else
+  {
+    _idIndex.remove(item->_id, item);
+    _altIdIndex.remove(qMakePair(item->_id, item->_altId), item);
+  }
+
+  for (int i = 0; i < item->childCount(); i++)
+    indexItem(dynamic_cast<XTreeWidgetItem *>(item->QTreeWidgetItem::child(i)), add);
+}
+
+void XTreeWidget::reindexItem(XTreeWidgetItem *item, int oldId, int oldAltId)
+{
+  if (! item || ! _idIndexValid)
+    return;
+
+  _idIndex.remove(oldId, item);
+  _altIdIndex.remove(qMakePair(oldId, oldAltId), item);
+  _idIndex.insert(item->_id, item);
+  _altIdIndex.insert(qMakePair(item->_id, item->_altId), item);
+}
+
+/* QTreeWidgetItem inserts itself before the XTreeWidgetItem constructor
+   has set the id, so the dynamic_cast fails for brand-new items and
+   XTreeWidgetItem::constructor() indexes them itself.
+*/
+void XTreeWidget::sRowsInserted(const QModelIndex &parent, int first, int last)
+{
+  if (! _idIndexValid)
+    return;
+
+  QTreeWidgetItem *parentItem = parent.isValid() ? itemFromIndex(parent) : 0;
+  for (int row = first; row <= last; row++)
+  {
+    QTreeWidgetItem *item = parentItem ? parentItem->child(row)
+                                       : QTreeWidget::topLevelItem(row);
+    indexItem(dynamic_cast<XTreeWidgetItem *>(item), true);
   }
 }
 
+void XTreeWidget::sRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+  // a new row could be allocated where a deleted one used to be
+  if (_calc && ! _sorting && ! _calcInProgress)
+    _calc->valid = false;
+
+  if (! _idIndexValid)
+    return;
+
+  QTreeWidgetItem *parentItem = parent.isValid() ? itemFromIndex(parent) : 0;
+  for (int row = first; row <= last; row++)
+  {
+    QTreeWidgetItem *item = parentItem ? parentItem->child(row)
+                                       : QTreeWidget::topLevelItem(row);
+    indexItem(dynamic_cast<XTreeWidgetItem *>(item), false);
+  }
+}
+
+void XTreeWidget::sInvalidateIdIndex()
+{
+  if (_calc)
+    _calc->valid = false;
+
+  _idIndexValid = false;
+  _idIndex.clear();
+  _altIdIndex.clear();
+}
+
 QString XTreeWidget:: dragString() const { return _dragString; }
 void XTreeWidget::    setDragString(QString pDragString)
 {
@@ -1555,13 +1889,14 @@ void XTreeWidget::sShowMenu(const QPoint &pntThis)
     {
       _menu->addSeparator();
       QMenu* copyMenu = _menu->addMenu(tr("Copy to Clipboard"));
-      copyMenu->addAction(tr("All"),  this, SLOT(sCopyVisibleToClipboard()));
+      copyMenu->addAction(tr("All"),  this, SLOT(sCopyVisibleToClipboardAsync()));
       copyMenu->addAction(tr("Row"),  this, SLOT(sCopyRowToClipboard()));
       copyMenu->addAction(tr("Cell"),  this, SLOT(sCopyCellToClipboard()));
       copyMenu->addAction(tr("Column"),this, SLOT(sCopyColumnToClipboard()));
       _menu->addSeparator();
       _menu->addAction(tr("Export As..."),  this, SLOT(sExport()));
     }
+    _menu->addAction(tr("Filter Rows..."), this, SLOT(sShowFilter()));
 
     if(! _menu->isEmpty())
       _menu->popup(mapToGlobal(pntThis));
@@ -1616,15 +1951,41 @@ void XTreeWidget::sShowHeaderMenu(const QPoint &pntThis)
     _menu->popup(mapToGlobal(pntThis));
 }
 
+// the vcard is built from the first selected row's contact and address
+static QVariantMap selectedContact(const XTreeWidget *tree)
+{
+  QVariantMap result;
+  QList<XTreeWidgetItem *> selected = tree->selectedItems();
+  if (selected.isEmpty())
+    return result;
+
+  XSqlQuery qry;
+  qry.prepare("SELECT cntct.*, addr.*"
+              "  FROM cntct"
+              "  LEFT OUTER JOIN addr ON (cntct_addr_id=addr_id)"
+              " WHERE (cntct_id=:cntct_id);");
+  qry.bindValue(":cntct_id", selected.at(0)->id());
+  qry.exec();
+  if (qry.first())
+  {
+    QSqlRecord record = qry.record();
+    for (int i = 0; i < record.count(); i++)
+      result.insert(record.fieldName(i), record.value(i));
+  }
+  return result;
+}
+
 void XTreeWidget::sExport()
 {
   QString   path = xtsettingsValue(_settingsName + "/exportPath").toString();
   QString selectedFilter;
   QFileInfo fi(QFileDialog::getSaveFileName(this, tr("Export Save Filename"), path,
-                                            tr("Text CSV (*.csv);;Text VCF (*.vcf);;Text (*.txt);;ODF Text Document (*.odt);;HTML Document (*.html)"), &selectedFilter));
+                                            tr("Text CSV (*.csv);;Excel Workbook (*.xlsx);;Text VCF (*.vcf);;Text (*.txt);;ODF Text Document (*.odt);;HTML Document (*.html)"), &selectedFilter));
   QString defaultSuffix;
   if(selectedFilter.contains("csv"))
     defaultSuffix = ".csv";
+  else if(selectedFilter.contains("xlsx"))
+    defaultSuffix = ".xlsx";
   else if(selectedFilter.contains("vcf"))
     defaultSuffix = ".vcf";
   else if(selectedFilter.contains("odt"))
@@ -1636,42 +1997,106 @@ void XTreeWidget::sExport()
 
   if (!fi.filePath().isEmpty())
   {
-    QTextDocument       *doc = new QTextDocument();
-    QTextDocumentWriter writer;
     if (fi.suffix().isEmpty())
       fi.setFile(fi.filePath() += defaultSuffix);
     xtsettingsSetValue(_settingsName + "/exportPath", fi.path());
-    writer.setFileName(fi.filePath());
 
-    if (fi.suffix() == "txt")
+    // row-by-row formats are written in the background
+    bool streamable = false;
+    int  format     = XTreeWidgetExporter::formatForSuffix(fi.suffix(), &streamable);
+    if (streamable)
     {
-      doc->setPlainText(toTxt());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "csv")
-    {
-      doc->setPlainText(toCsv());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "vcf")
-    {
-      doc->setPlainText(toVcf());
-      writer.setFormat("plaintext");
+      startExport(format, fi.filePath());
+      return;
     }
-    else if (fi.suffix() == "odt")
+
+    QTextDocument       *doc = new QTextDocument();
+    QTextDocumentWriter writer;
+    writer.setFileName(fi.filePath());
+
+    if (fi.suffix() == "odt")
     {
       doc->setHtml(toHtml());
       writer.setFormat("odf");
     }
-    else if (fi.suffix() == "html")
+    else
     {
-      doc->setHtml(toHtml());
-      writer.setFormat("HTML");
+      doc->setPlainText(toTxt());
+      writer.setFormat("plaintext");
     }
     writer.write(doc);
   }
 }
 
+/* Snapshot the visible rows and hand them to an XTreeWidgetExporter
+   running on a worker thread. An empty filename exports to the clipboard.
+   Returns false if an export is already running.
+*/
+bool XTreeWidget::startExport(int format, const QString &filename)
+{
+  if (_exporter)
+    return false;
+
+  XTreeWidgetExportSnapshot snapshot;
+  if (format == XTreeWidgetExporter::Vcf)
+    snapshot.contact = selectedContact(this);
+  else
+  {
+    prepareExport();
+    snapshot = XTreeWidgetExportSnapshot(this);
+  }
+
+  _exporter = new XTreeWidgetExporter(snapshot, (XTreeWidgetExporter::Format)format, this);
+  connect(_exporter, SIGNAL(progress(int)),  this, SLOT(sExportProgress(int)));
+  connect(_exporter, SIGNAL(finished(bool)), this, SLOT(sExportFinished(bool)));
+
+  if (! _exportProgress)
+    _exportProgress = new XTreeWidgetProgress(this);
+  connect(_exportProgress, SIGNAL(cancel()), _exporter, SLOT(cancel()));
+  _exportProgress->setValue(0);
+  _exportProgress->setMaximum(_exporter->rowCount());
+  _exportProgress->show();
+
+  _exporter->start(filename);
+  return true;
+}
+
+void XTreeWidget::sExportProgress(int rows)
+{
+  if (_exportProgress)
+    _exportProgress->setValue(rows);
+}
+
+void XTreeWidget::sExportFinished(bool ok)
+{
+  XTreeWidgetExporter *exporter = _exporter;
+  _exporter = 0;
+  if (! exporter)
+    return;
+
+  if (_exportProgress)
+  {
+    disconnect(_exportProgress, SIGNAL(cancel()), exporter, SLOT(cancel()));
+    _exportProgress->hide();
+  }
+
+  if (ok && exporter->filename().isEmpty())
+  {
+    QMimeData *mime = new QMimeData();
+    if (exporter->format() == XTreeWidgetExporter::Html)
+      mime->setHtml(QString::fromUtf8(exporter->result()));
+    else
+      mime->setText(QString::fromUtf8(exporter->result()));
+    QApplication::clipboard()->setMimeData(mime);
+  }
+  else if (! ok && ! exporter->wasCancelled() && ! exporter->errorString().isEmpty())
+    QMessageBox::warning(this, tr("Export Failed"),
+                         tr("<p>Could not export the list: %1")
+                         .arg(exporter->errorString()));
+
+  exporter->deleteLater();
+}
+
 void XTreeWidget::mousePressEvent(QMouseEvent *event)
 {
   if (event->button() == Qt::LeftButton)
@@ -1849,6 +2274,9 @@ void XTreeWidget::setColumnVisible(int pColumn, bool pVisible)
   else
     header()->hideSection(pColumn);
 
+  if (_filter)
+    _filter->invalidate();
+
   // Save changes to db
   if (!_forgetful)
   {
@@ -1895,30 +2323,22 @@ void XTreeWidget::setColumnLocked(int pColumn, bool pLocked)
 
 XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid)
 {
-  if (pid < 0)
+  if (pid < 0 || ! ptree)
     return 0;
 
-  for (int i = 0; i < ptree->topLevelItemCount(); i++)
-  {
-    XTreeWidgetItem *item = ptree->topLevelItem(i);
-    if (item->id() == pid)
-      return item;
-    else
-    {
-      item = findXTreeWidgetItemWithId(item, pid);
-      if (item)
-        return item;
-    }
-  }
-
-  return 0;
+  return ptree->firstItemWithId(pid);
 }
 
 XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid)
 {
-  if (pid < 0)
+  if (pid < 0 || ! ptreeitem)
     return 0;
 
+  XTreeWidget *tree = dynamic_cast<XTreeWidget *>(ptreeitem->treeWidget());
+  if (tree)
+    return tree->firstItemWithId(pid, ptreeitem);
+
+  // not in a tree yet so there's no index to use
   for (int i = 0; i < ptreeitem->childCount(); i++)
   {
     XTreeWidgetItem *item = ptreeitem->child(i);
@@ -1983,11 +2403,23 @@ XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *pParent, XTreeWidgetItem *itm
   constructor(pId, pAltId, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
+XTreeWidgetItem::~XTreeWidgetItem()
+{
+  // by the time QTreeWidgetItem removes itself this is no longer an XTreeWidgetItem
+  XTreeWidget *tree = dynamic_cast<XTreeWidget *>(treeWidget());
+  if (tree)
+    tree->indexItem(this, false);
+}
+
 void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 )
 {
   _id    = pId;
   _altId = pAltId;
 
+  XTreeWidget *tree = dynamic_cast<XTreeWidget *>(treeWidget());
+  if (tree)
+    tree->indexItem(this, true);
+
   if (!v0.isNull())
     setText(0,  v0);
 
@@ -2029,6 +2461,26 @@ void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1,
   }
 }
 
+void XTreeWidgetItem::setId(int pId)
+{
+  int oldId = _id;
+  _id = pId;
+
+  XTreeWidget *tree = dynamic_cast<XTreeWidget *>(treeWidget());
+  if (tree)
+    tree->reindexItem(this, oldId, _altId);
+}
+
+void XTreeWidgetItem::setAltId(int pId)
+{
+  int oldAltId = _altId;
+  _altId = pId;
+
+  XTreeWidget *tree = dynamic_cast<XTreeWidget *>(treeWidget());
+  if (tree)
+    tree->reindexItem(this, _id, oldAltId);
+}
+
 int XTreeWidgetItem::id(const QString p)
 {
   int id = data(((XTreeWidget *)treeWidget())->column(p), Xt::IdRole).toInt();
@@ -2390,8 +2842,21 @@ void XTreeWidget::sCopyCellToClipboard()
   }
 }
 
-void XTreeWidget::sCopyVisibleToClipboard()
+/* The context menu copies in the background with a progress bar. Called
+   without async, such as from a script that reads the clipboard next, it
+   copies synchronously as it always has.
+ */
+void XTreeWidget::sCopyVisibleToClipboard(bool async)
 {
+  if (async)
+  {
+    if (_x_preferences->boolean("CopyListsPlainText"))
+      startExport(XTreeWidgetExporter::Txt, QString());
+    else
+      startExport(XTreeWidgetExporter::Html, QString());
+    return;
+  }
+
   QMimeData   *mime      = new QMimeData();
   QClipboard  *clipboard = QApplication::clipboard();
 
@@ -2402,8 +2867,14 @@ void XTreeWidget::sCopyVisibleToClipboard()
   clipboard->setMimeData(mime);
 }
 
+void XTreeWidget::sCopyVisibleToClipboardAsync()
+{
+  sCopyVisibleToClipboard(true);
+}
+
 void XTreeWidget::sCopyColumnToClipboard()
 {
+  prepareExport();
   QTextEdit       text;
   QMimeData       *mime      = new QMimeData();
   QClipboard      *clipboard = QApplication::clipboard();
@@ -2442,293 +2913,152 @@ void XTreeWidget::sSearch(const QString &pTarget)
   }
 }
 
-QString XTreeWidget::toTxt() const
+// the text formats share the background exporter's formatting
+static QString exportToString(const XTreeWidget *tree, XTreeWidgetExporter::Format format)
 {
-  QString line;
-  QString opText;
-  int     counter;
+  QByteArray data;
+  QBuffer    buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
 
-  QTreeWidgetItem *header = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-      line = line + header->text(counter).replace("\r\n"," ") + "\t";
-  }
-  opText = line + "\r\n";
+  XTreeWidgetExporter exporter(XTreeWidgetExportSnapshot(tree), format);
+  exporter.exportTo(&buffer);
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-            line = line + item->text(counter) + "\t";
-        }
-      }
-      opText = opText + line + "\r\n";
-    }
-  }
-  return opText;
+  return QString::fromUtf8(data);
 }
 
-QString XTreeWidget::toCsv() const
+/*!
+  Returns the text of the quick filter, or an empty string if the rows
+  are not filtered.
+*/
+QString XTreeWidget::filterText() const
 {
-  QString line;
-  QString opText;
-  int     counter;
-  int     colcount         = 0;
-
-  QTreeWidgetItem *header  = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      if (colcount)
-        line = line + ",";
-      line = line + header->text(counter).replace("\"","\"\"").replace("\r\n"," ").replace("\n"," ");
-      colcount++;
-    }
-  }
-  opText = line + "\r\n";
+  return _filter ? _filter->text() : QString();
+}
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
-    {
-      colcount = 0;
-      item     = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            if (colcount)
-              line = line + ",";
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            line = line + item->text(counter).replace("\"","\"\"");
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            colcount++;
-          }
-        }
-      }
-      opText = opText + line + "\r\n";
-    }
-  }
-  return opText;
+QString XTreeWidget::subtotalLabel(int set) const
+{
+  return _subtotalLabels.value(set);
 }
 
-QString XTreeWidget::toVcf() const
+/*!
+  Adds a row below the list with the totals for the rows whose
+  Xt::TotalSetRole is \a set, labeled \a label. The grand total for
+  set 0 is always shown; other sets only get a row when a label has been
+  set for them. An empty \a label removes the row again.
+*/
+void XTreeWidget::setSubtotalLabel(int set, const QString &label)
 {
-  XSqlQuery qry;
-  qry.prepare("SELECT * FROM cntct WHERE (cntct_id=:cntct_id);");
-  qry.bindValue(":cntct_id", this->selectedItems().at(0)->id());
-  qry.exec();
-  if (qry.first()) {
-    QString name;
-    QString fullName;
-    QString first = qry.value("cntct_first_name").toString();
-    QString middle = qry.value("cntct_middle").toString();
-    QString last = qry.value("cntct_last_name").toString();
-    if (!last.isEmpty()) {
-      name = last;
-      fullName = last;
-    }
-    if (!middle.isEmpty()) {
-      name = name + ";" + middle;
-      fullName = middle + " " + fullName;
-    }
-    if (!first.isEmpty()) {
-      name = name + ";" + first;
-      fullName = first + " " + fullName;
-    }
-    QString begin = "VCARD";
-    QString version = "3.0";
-    QString org = "";
-    QString title = qry.value("cntct_title").toString();
-    QString photo = "";
-    QString phoneWork = qry.value("cntct_phone").toString();
-    QString phoneHome = qry.value("cntct_phone2").toString();
-    QString addressId = qry.value("cntct_addr_id").toString();
-    XSqlQuery qry2;
-    qry2.prepare("SELECT * FROM addr WHERE (addr_id=:addr_id);");
-    qry2.bindValue(":addr_id", addressId);
-    qry2.exec();
-    QStringList address;
-    QString addressWork= "";
-    QString labelWork = "";
-    if (qry2.first()) {
-      /*
-      * this is tricky, because sometimes (in the test database at least)
-      * our addr_line1 is the company name, and sometimes it's really the
-      * first line of the actual address.  For the former, we can use
-      * the addr_line1 as the organization name.
-      */
-      if(qry2.value("addr_line1").toString().at(0).isDigit())
-        address.append(qry2.value("addr_line1").toString());
-      else
-        org = qry2.value("addr_line1").toString();
-      address.append(qry2.value("addr_line2").toString());
-      address.append(qry2.value("addr_line3").toString());
-      address.append(qry2.value("addr_city").toString());
-      address.append(qry2.value("addr_state").toString());
-      address.append(qry2.value("addr_postalcode").toString());
-      address.append(qry2.value("addr_country").toString());
-    }
-    //for address, set address with semicolon delimiters
-    //for label, set address with ESCAPED newline delimiters
-    for (int i = 0; i < address.length(); i++) {
-      if(!address.at(i).isEmpty()) {
-        addressWork = addressWork + address.at(i) + ";";
-        labelWork = labelWork + address.at(i) + "\\n";
-      }
-    }
-    QString addressHome = "";
-    QString labelHome = "";
-    QString email = qry.value("cntct_email").toString();
-    QDate date = QDate::currentDate();
-    QString revision = date.toString(Qt::ISODate);
-    QString end = "VCARD";
-
-    QString stringToSave;
-
-    stringToSave.append("BEGIN:" + begin + "\n");
-    stringToSave.append("VERSION:" + version + "\n");
-    stringToSave.append("N:" + name + "\n");
-    stringToSave.append("FN:" + fullName + "\n");
-    if (!org.isEmpty())
-      stringToSave.append("ORG:" + org + "\n");
-    if (!title.isEmpty())
-      stringToSave.append("TITLE:" + title + "\n");
-    if (!phoneWork.isEmpty())
-      stringToSave.append("TEL;TYPE=WORK,VOICE:" + phoneWork + "\n");
-    if (!phoneHome.isEmpty())
-      stringToSave.append("TEL;TYPE=HOME,VOICE:" + phoneHome + "\n");
-    if (!addressWork.isEmpty())
-      stringToSave.append("ADR;TYPE=WORK:;;" + addressWork + "\n");
-    if (!labelWork.isEmpty())
-      stringToSave.append("LABEL;TYPE=WORK:;;" + labelWork + "\n");
-    if (!email.isEmpty())
-      stringToSave.append("EMAIL;TYPE=PREF,INTERNET:" + email + "\n");
-    stringToSave.append("REV:" + revision + "\n");
-    stringToSave.append("END:" + end + "\n");
-
-    return stringToSave;
-  }
+  if (label.isEmpty())
+    _subtotalLabels.remove(set);
   else
-    return "failed to select contact for export";
+    _subtotalLabels.insert(set, label);
 }
 
-QString XTreeWidget::toHtml() const
+/*!
+  Adds \a seeds to the totals of the xttotalrole columns, as
+  <column <total set, amount> >, and recalculates them. This lets a caller
+  that loads the list in pieces show totals for rows it has not loaded
+  yet. Populating the list with XTreeWidget::Replace clears the seeds.
+*/
+void XTreeWidget::setTotalSeeds(const QMap<int, QMap<int, double> > &seeds)
 {
-  QTextDocument     *doc     = new QTextDocument();
-  QTextCursor       *cursor  = new QTextCursor(doc);
-  QTextTableFormat  tableFormat;
-  QTextTableCell    cell;
-  QTextCharFormat   format;
-  QString font;
-  int     colcnt = 0;
-  int     rowcnt = 0;
-  int     row = 0;
-  double  limit = 0;
-  qlonglong maxDataCount = 0;
-  qlonglong dataCount = 0;
+  if (seeds == _totalSeeds)
+    return;
+  _totalSeeds = seeds;
+  if (topLevelItemCount() > 0)
+    populateCalculatedColumns();
+}
 
-  if (_x_preferences)
-  {
-    limit = _x_preferences->value("XTreeWidgetDataLimit").toDouble();
-    if (limit > 0)
-      maxDataCount = (qlonglong)(limit * 1e9);
-  }
+/*!
+  Hides the rows that don't contain every word of \a text in one of
+  their visible columns. This works on the rows already loaded and does
+  not query the database. An empty \a text shows all of the rows again.
+*/
+void XTreeWidget::setFilterText(const QString &text)
+{
+  if (! _filter && text.isEmpty())
+    return;
+  if (! _filter)
+    _filter = new XTreeWidgetFilter(this);
+  _filter->setText(text);
+}
 
-  tableFormat.setHeaderRowCount(1);
+void XTreeWidget::sShowFilter()
+{
+  if (! _filter)
+    _filter = new XTreeWidgetFilter(this);
+  _filter->sActivate();
+}
 
-  QTreeWidgetItem *header = headerItem();
-  for (int i = 0; i < header->columnCount(); i++)
-    if (!QTreeWidget::isColumnHidden(i))
-      colcnt++;
+/* Emit aboutToExport() so an owner that holds rows back, such as a display
+   loading its list a page at a time, can add them before they're copied.
+*/
+void XTreeWidget::prepareExport() const
+{
+  emit const_cast<XTreeWidget *>(this)->aboutToExport();
+}
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-        rowcnt++;
-    }
-  }
+QString XTreeWidget::toTxt() const
+{
+  prepareExport();
+  return exportToString(this, XTreeWidgetExporter::Txt);
+}
 
-  cursor->insertTable(rowcnt + 1, colcnt, tableFormat);
+QString XTreeWidget::toCsv() const
+{
+  prepareExport();
+  return exportToString(this, XTreeWidgetExporter::Csv);
+}
 
-  for (int counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      cell   = cursor->currentTable()->cellAt(cursor->position());
-      format = cell.format();
-      format.setBackground(Qt::lightGray);
-      cell.setFormat(format);
-      cursor->insertText(header->text(counter));
-      cursor->movePosition(QTextCursor::NextCell);
-
-      dataCount += (qlonglong)(header->text(counter).size());
-    }
-  }
+QString XTreeWidget::toVcf() const
+{
+  XTreeWidgetExportSnapshot snapshot;
+  snapshot.contact = selectedContact(this);
+  if (snapshot.contact.isEmpty())
+    return "failed to select contact for export";
 
-  item = topLevelItem(0);
-  if (item)
+  QByteArray data;
+  QBuffer    buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  XTreeWidgetExporter exporter(snapshot, XTreeWidgetExporter::Vcf);
+  exporter.exportTo(&buffer);
+  return QString::fromUtf8(data);
+}
+
+QString XTreeWidget::toHtml() const
+{
+  prepareExport();
+  XTreeWidgetExportSnapshot snapshot(this);
+
+  // rich text copies stop at the user's XTreeWidgetDataLimit, in GB
+  double limit = _x_preferences ? _x_preferences->value("XTreeWidgetDataLimit").toDouble() : 0;
+  if (limit > 0)
   {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid() && (maxDataCount <= 0 || dataCount < maxDataCount); idx = indexBelow(idx), row++)
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        for (int counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            cell   = cursor->currentTable()->cellAt(cursor->position());
-            format = cell.format();
-            if (item->data(counter, Qt::BackgroundRole).isValid())
-              format.setBackground(item->data(counter, Qt::BackgroundRole).value<QColor>());
-            if (item->data(counter, Qt::ForegroundRole).isValid())
-              format.setForeground(item->data(counter, Qt::ForegroundRole).value<QColor>());
-
-            if (item->data(counter,Qt::FontRole).isValid())
-            {
-              font = item->data(counter,Qt::FontRole).toString();
-              if (!font.isEmpty())
-                format.setFont(QFont(font));
-            }
-
-            cell.setFormat(format);
-            cursor->insertText(item->text(counter));
-            cursor->movePosition(QTextCursor::NextCell);
-
-            dataCount += (qlonglong)(item->text(counter).size());
-          }
-        }
-      }
-    }
+    qlonglong maxDataCount = (qlonglong)(limit * 1e9);
+    qlonglong dataCount    = 0;
+    foreach (QString header, snapshot.headers)
+      dataCount += header.size();
 
-    if (maxDataCount > 0 && dataCount > maxDataCount)
+    int rowcnt = snapshot.rows.size();
+    int row    = 0;
+    for ( ; row < rowcnt && dataCount < maxDataCount; row++)
+      foreach (const XTreeWidgetExportSnapshot::Cell &cell, snapshot.rows.at(row))
+        dataCount += cell.text.size();
+
+    if (dataCount > maxDataCount)
     {
+      snapshot.rows.resize(row);
       QString overflowMsg = tr("Maximum data limit was encountered.  Only %1 of %2 rows could be processed.");
       QMessageBox::warning(NULL, tr("Data Limit Reached"), overflowMsg.arg(row).arg(rowcnt));
     }
   }
-  return doc->toHtml();
+
+  QByteArray data;
+  QBuffer    buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  XTreeWidgetExporter exporter(snapshot, XTreeWidgetExporter::Html);
+  exporter.exportTo(&buffer);
+  return QString::fromUtf8(data);
 }
 
 QList<XTreeWidgetItem *> XTreeWidget::selectedItems() const
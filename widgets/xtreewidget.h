@@ -13,6 +13,8 @@
 
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
+#include <QMultiHash>
+#include <QPair>
 #include <QVariant>
 #include <QVector>
 #include <QTimer>
@@ -57,6 +59,9 @@ class QAction;
 class QMenu;
 class QScriptEngine;
 class XTreeWidget;
+class XTreeWidgetCalcCache;
+class XTreeWidgetExporter;
+class XTreeWidgetFilter;
 class XTreeWidgetProgress;
 
 class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetItem
@@ -114,6 +119,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
                     QVariant = QVariant(), QVariant = QVariant(),
                     QVariant = QVariant(), QVariant = QVariant(),
                     QVariant = QVariant(), QVariant = QVariant() );
+    virtual ~XTreeWidgetItem();
 
     Q_INVOKABLE virtual void    setText(int, const QVariant&);
     Q_INVOKABLE virtual QString text(int p) const { return QTreeWidgetItem::text(p); }
@@ -123,8 +129,8 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
 
     Q_INVOKABLE inline int              id() const        { return _id;    }
     Q_INVOKABLE inline int              altId() const     { return _altId; }
-    Q_INVOKABLE inline void             setId(int pId)    { _id = pId;     }
-    Q_INVOKABLE inline void             setAltId(int pId) { _altId = pId;  }
+    Q_INVOKABLE void                    setId(int pId);
+    Q_INVOKABLE void                    setAltId(int pId);
 
     Q_INVOKABLE inline QVariant         data(int colidx,    int role) const { return QTreeWidgetItem::data(colidx, role); }
     Q_INVOKABLE inline void             setData(int colidx, int role, const QVariant &val) { QTreeWidgetItem::setData(colidx, role, val); }
@@ -166,6 +172,10 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
   Q_PROPERTY( QString altDragString READ altDragString WRITE setAltDragString)
   Q_PROPERTY( bool populateLinear READ populateLinear WRITE setPopulateLinear)
 
+  friend class XTreeWidgetExportSnapshot;
+  friend class XTreeWidgetFilter;
+  friend class XTreeWidgetItem;
+
   public :
     enum PopulateStyle { Replace, Append };
     Q_ENUM(PopulateStyle)
@@ -210,6 +220,14 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid);
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid);
 
+    Q_INVOKABLE QString filterText() const;
+    Q_INVOKABLE void    setFilterText(const QString &text);
+
+    Q_INVOKABLE QString subtotalLabel(int set) const;
+    Q_INVOKABLE void    setSubtotalLabel(int set, const QString &label);
+
+    void setTotalSeeds(const QMap<int, QMap<int, double> > &seeds);
+
     Q_INVOKABLE QString toTxt() const;
     Q_INVOKABLE QString toCsv() const;
     Q_INVOKABLE QString toVcf() const;
@@ -262,11 +280,12 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  showColumn(int colnum)  { QTreeWidget::showColumn(colnum); };
     void  showColumn(const QString&);
     void  sExport();
-    void  sCopyVisibleToClipboard();
+    void  sCopyVisibleToClipboard(bool async = false);
     void  sCopyRowToClipboard();
     void  sCopyCellToClipboard();
     void  sCopyColumnToClipboard();
     void  sSearch(const QString&);
+    void  sShowFilter();
 
   signals:
     void  valid(bool);
@@ -287,6 +306,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  populateMenu(QMenu *, XTreeWidgetItem *, int);
     void  resorted();
     void  populated();
+    void  aboutToExport();
 
   protected slots:
     void  sHeaderClicked(int);
@@ -301,6 +321,9 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sItemExpanded(QTreeWidgetItem *item);
     void  sItemPressed(QTreeWidgetItem *item, int column);
     void  populateWorker();
+    void  sCopyVisibleToClipboardAsync();
+    void  sExportFinished(bool);
+    void  sExportProgress(int);
 
   protected:
     QPoint        dragStartPosition;
@@ -341,6 +364,26 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void             cleanupAfterPopulate();
     XTreeWidgetProgress *_progress;
     QList<QMap<int, double> *> *_subtotals;
+    QMap<int, QString> _subtotalLabels;
+    QMap<int, QMap<int, double> > _totalSeeds; // <col <totalset, seed> >
+    XTreeWidgetExporter *_exporter;
+    XTreeWidgetProgress *_exportProgress;
+    XTreeWidgetFilter   *_filter;
+    XTreeWidgetCalcCache *_calc;
+    bool             _calcInProgress;
+    bool             _sorting;
+    bool             startExport(int format, const QString &filename);
+    void             prepareExport() const;
+
+    // id -> items and (id, altId) -> items, built on first lookup and then
+    // kept current as rows are inserted and removed
+    mutable QMultiHash<int, XTreeWidgetItem *>               _idIndex;
+    mutable QMultiHash<QPair<int, int>, XTreeWidgetItem *>   _altIdIndex;
+    mutable bool     _idIndexValid;
+    void             indexItem(XTreeWidgetItem *item, bool add) const;
+    void             reindexItem(XTreeWidgetItem *item, int oldId, int oldAltId);
+    XTreeWidgetItem *firstItemWithId(int pId, const XTreeWidgetItem *ancestor = 0) const;
+    XTreeWidgetItem *firstItemWithId(int pId, int pAltId) const;
 
   private slots:
     void  sSelectionChanged();
@@ -356,6 +399,10 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sToggleForgetfulness();
     void  sToggleForgetfulnessOrder();
     void  popupMenuActionTriggered(QAction *);
+    void  sRowsInserted(const QModelIndex &, int, int);
+    void  sRowsAboutToBeRemoved(const QModelIndex &, int, int);
+    void  sInvalidateIdIndex();
+    void  sDataChanged(const QModelIndex &, const QModelIndex &);
 };
 
 class XTreeWidgetPopulateParams
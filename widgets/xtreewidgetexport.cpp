@@ -0,0 +1,876 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetexport.h"
+
+#include <QBuffer>
+#include <QColor>
+#include <QDateTime>
+#include <QLocale>
+#include <QPair>
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrent>
+
+#include "xtreewidget.h"
+#include "xttrace.h"
+
+#define DEBUG false
+
+// rows formatted by one task; a batch of tasks is formatted in parallel
+#define ROWSPERCHUNK    1000
+#define CHUNKSPERTHREAD 2
+
+// Snapshot ///////////////////////////////////////////////////////////////////
+
+XTreeWidgetExportSnapshot::XTreeWidgetExportSnapshot()
+{
+}
+
+/* Walk the tree in display order, the same way the old toTxt() and toCsv()
+   did, and keep only the visible columns.
+ */
+XTreeWidgetExportSnapshot::XTreeWidgetExportSnapshot(const XTreeWidget *tree)
+{
+  if (! tree)
+    return;
+
+  QVector<int>     columns;
+  QTreeWidgetItem *hitem = tree->headerItem();
+  for (int col = 0; col < hitem->columnCount(); col++)
+  {
+    if (! tree->isColumnHidden(col))
+    {
+      columns.append(col);
+      headers.append(hitem->text(col));
+    }
+  }
+
+  XTreeWidgetItem *item = tree->topLevelItem(0);
+  if (! item)
+    return;
+
+  for (QModelIndex idx = tree->indexFromItem(item); idx.isValid();
+       idx = tree->indexBelow(idx))
+  {
+    item = static_cast<XTreeWidgetItem *>(tree->itemFromIndex(idx));
+    if (! item)
+      continue;
+
+    QVector<Cell> row(columns.size());
+    for (int i = 0; i < columns.size(); i++)
+    {
+      int   col  = columns.at(i);
+      Cell &cell = row[i];
+      cell.text       = item->text(col);
+      cell.background = 0;
+      cell.foreground = 0;
+      cell.flags      = 0;
+
+      if (item->data(col, Qt::DisplayRole).type() == QVariant::String)
+        cell.flags |= Quoted;
+
+      switch (item->data(col, Xt::RawRole).type())
+      {
+        case QVariant::Double:
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+          cell.flags |= Numeric;
+          break;
+        default:
+          break;
+      }
+
+      QVariant bg = item->data(col, Qt::BackgroundRole);
+      if (bg.isValid() && bg.value<QColor>().isValid())
+      {
+        cell.background = bg.value<QColor>().rgb();
+        cell.flags |= HasBackground;
+      }
+      QVariant fg = item->data(col, Qt::ForegroundRole);
+      if (fg.isValid() && fg.value<QColor>().isValid())
+      {
+        cell.foreground = fg.value<QColor>().rgb();
+        cell.flags |= HasForeground;
+      }
+    }
+    rows.append(row);
+  }
+}
+
+// helpers ////////////////////////////////////////////////////////////////////
+
+static QByteArray xmlEscaped(const QString &text)
+{
+  QString result;
+  result.reserve(text.size());
+  for (int i = 0; i < text.size(); i++)
+  {
+    QChar c = text.at(i);
+    if (c == '&')       result += "&amp;";
+    else if (c == '<')  result += "&lt;";
+    else if (c == '>')  result += "&gt;";
+    else if (c == '"')  result += "&quot;";
+    else if (c.unicode() < 0x20 && c != '\t' && c != '\n' && c != '\r')
+      continue; // not allowed in xml 1.0
+    else
+      result += c;
+  }
+  return result.toUtf8();
+}
+
+static QByteArray colorName(QRgb rgb)
+{
+  return QColor(rgb).name().toLatin1();
+}
+
+// A, B, ... Z, AA, AB, ... for spreadsheet cell references
+static QByteArray columnName(int col)
+{
+  QByteArray name;
+  for (++col; col > 0; col = (col - 1) / 26)
+    name.prepend(char('A' + (col - 1) % 26));
+  return name;
+}
+
+static const char *xlsxContentTypes =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+  "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+  "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+  "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+  "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+  "<Override PartName=\"/xl/worksheets/sheet1.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"
+  "<Override PartName=\"/xl/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>"
+  "</Types>";
+
+static const char *xlsxRels =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+  "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+  "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" Target=\"xl/workbook.xml\"/>"
+  "</Relationships>";
+
+static const char *xlsxWorkbook =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+  "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\""
+  " xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\">"
+  "<sheets><sheet name=\"Sheet1\" sheetId=\"1\" r:id=\"rId1\"/></sheets>"
+  "</workbook>";
+
+static const char *xlsxWorkbookRels =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+  "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+  "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" Target=\"worksheets/sheet1.xml\"/>"
+  "<Relationship Id=\"rId2\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\" Target=\"styles.xml\"/>"
+  "</Relationships>";
+
+// style 1 is bold, for the header row
+static const char *xlsxStyles =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+  "<styleSheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+  "<fonts count=\"2\"><font><sz val=\"11\"/><name val=\"Calibri\"/></font>"
+  "<font><b/><sz val=\"11\"/><name val=\"Calibri\"/></font></fonts>"
+  "<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill>"
+  "<fill><patternFill patternType=\"gray125\"/></fill></fills>"
+  "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+  "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+  "<cellXfs count=\"2\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/>"
+  "<xf numFmtId=\"0\" fontId=\"1\" fillId=\"0\" borderId=\"0\" xfId=\"0\" applyFont=\"1\"/></cellXfs>"
+  "</styleSheet>";
+
+/* A minimal zip archive writer for building .xlsx files. Entries are
+   stored uncompressed and their sizes and crcs are patched into the local
+   header after the data have been streamed, so the target must be seekable.
+ */
+class XTreeWidgetZipWriter : public QIODevice
+{
+  public:
+    XTreeWidgetZipWriter(QIODevice *target)
+      : _crc(0), _entries(0), _headerPos(0), _size(0), _target(target)
+    {
+      QDateTime now = QDateTime::currentDateTime();
+      _dosTime = (now.time().hour() << 11) | (now.time().minute() << 5) |
+                 (now.time().second() / 2);
+      _dosDate = ((now.date().year() - 1980) << 9) | (now.date().month() << 5) |
+                 now.date().day();
+    }
+
+    bool addEntry(const QString &name, const QByteArray &data)
+    {
+      return beginEntry(name) && write(data) == data.size() && endEntry();
+    }
+
+    bool beginEntry(const QString &name)
+    {
+      _name      = name.toUtf8();
+      _crc       = 0;
+      _size      = 0;
+      _headerPos = _target->pos();
+
+      QByteArray header;
+      appendLong(header,  0x04034b50);
+      appendShort(header, 20);          // version needed to extract
+      appendShort(header, 0);           // flags
+      appendShort(header, 0);           // stored
+      appendShort(header, _dosTime);
+      appendShort(header, _dosDate);
+      appendLong(header,  0);           // crc, patched by endEntry()
+      appendLong(header,  0);           // compressed size
+      appendLong(header,  0);           // uncompressed size
+      appendShort(header, _name.size());
+      appendShort(header, 0);           // extra field length
+      header.append(_name);
+
+      if (! isOpen())
+        open(QIODevice::WriteOnly);
+      return _target->write(header) == header.size();
+    }
+
+    bool endEntry()
+    {
+      if (_size > 0xffffffffLL)
+      {
+        setErrorString(QObject::tr("The export is too large for an xlsx file."));
+        return false;
+      }
+
+      qint64 endPos = _target->pos();
+      QByteArray sizes;
+      appendLong(sizes, _crc);
+      appendLong(sizes, _size);
+      appendLong(sizes, _size);
+      if (! _target->seek(_headerPos + 14) ||
+          _target->write(sizes) != sizes.size() ||
+          ! _target->seek(endPos))
+        return false;
+
+      QByteArray entry;
+      appendLong(entry,  0x02014b50);
+      appendShort(entry, 20);           // version made by
+      appendShort(entry, 20);           // version needed to extract
+      appendShort(entry, 0);
+      appendShort(entry, 0);
+      appendShort(entry, _dosTime);
+      appendShort(entry, _dosDate);
+      appendLong(entry,  _crc);
+      appendLong(entry,  _size);
+      appendLong(entry,  _size);
+      appendShort(entry, _name.size());
+      appendShort(entry, 0);            // extra field length
+      appendShort(entry, 0);            // comment length
+      appendShort(entry, 0);            // disk number
+      appendShort(entry, 0);            // internal attributes
+      appendLong(entry,  0);            // external attributes
+      appendLong(entry,  _headerPos);
+      entry.append(_name);
+      _directory.append(entry);
+      _entries++;
+      return true;
+    }
+
+    bool finish()
+    {
+      qint64 dirPos = _target->pos();
+      QByteArray end;
+      appendLong(end,  0x06054b50);
+      appendShort(end, 0);
+      appendShort(end, 0);
+      appendShort(end, _entries);
+      appendShort(end, _entries);
+      appendLong(end,  _directory.size());
+      appendLong(end,  dirPos);
+      appendShort(end, 0);
+      close();
+      return _target->write(_directory) == _directory.size() &&
+             _target->write(end)        == end.size();
+    }
+
+  protected:
+    virtual qint64 readData(char *, qint64)
+    {
+      return -1;
+    }
+
+    virtual qint64 writeData(const char *data, qint64 len)
+    {
+      qint64 written = _target->write(data, len);
+      if (written > 0)
+      {
+        _crc   = updateCrc(_crc, data, written);
+        _size += written;
+      }
+      return written;
+    }
+
+  private:
+    static void appendShort(QByteArray &buf, quint32 val)
+    {
+      buf.append(char(val & 0xff));
+      buf.append(char((val >> 8) & 0xff));
+    }
+
+    static void appendLong(QByteArray &buf, quint32 val)
+    {
+      appendShort(buf, val & 0xffff);
+      appendShort(buf, (val >> 16) & 0xffff);
+    }
+
+    static quint32 updateCrc(quint32 crc, const char *data, qint64 len)
+    {
+      // the standard zip/PNG CRC-32 table, so worker threads share it
+      // without any lazy initialization
+      static const quint32 table[256] = {
+        0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+        0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+        0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+        0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+        0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+        0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+        0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
+        0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+        0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+        0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+        0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
+        0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+        0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+        0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+        0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+        0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+        0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+        0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+        0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+        0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+        0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+        0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+        0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+        0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+        0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+        0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+        0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+        0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+        0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+        0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+        0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+        0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+        0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+        0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+        0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+        0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+        0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+        0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+        0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+        0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+        0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+        0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+        0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+      };
+
+      crc = ~crc;
+      for (qint64 i = 0; i < len; i++)
+        crc = table[(crc ^ (uchar)data[i]) & 0xff] ^ (crc >> 8);
+      return ~crc;
+    }
+
+    quint32     _crc;
+    quint32     _dosDate;
+    quint32     _dosTime;
+    QByteArray  _directory;
+    int         _entries;
+    qint64      _headerPos;
+    QByteArray  _name;
+    qint64      _size;
+    QIODevice  *_target;
+};
+
+struct XTreeWidgetExportChunk
+{
+  typedef QByteArray result_type;
+
+  XTreeWidgetExportChunk(const XTreeWidgetExporter *exporter)
+    : _exporter(exporter)
+  {
+  }
+
+  QByteArray operator()(const QPair<int, int> &range) const
+  {
+    return _exporter->formatRows(range.first, range.second);
+  }
+
+  const XTreeWidgetExporter *_exporter;
+};
+
+// Exporter ///////////////////////////////////////////////////////////////////
+
+/** \class XTreeWidgetExporter
+
+    \brief Writes the contents of an XTreeWidget as text, csv, html or xlsx,
+           or the contact in its snapshot as a vcard.
+
+    The exporter works from an XTreeWidgetExportSnapshot so the rows can
+    be formatted off the GUI thread. exportTo() writes synchronously;
+    start() writes to a file, or to result() if no file is named, on a
+    worker thread and emits progress() and finished() as it goes.
+    Blocks of rows are formatted in parallel and written in order.
+ */
+XTreeWidgetExporter::XTreeWidgetExporter(const XTreeWidgetExportSnapshot &snapshot,
+                                         Format format, QObject *parent)
+  : QObject(parent),
+    _snapshot(snapshot),
+    _cancelled(0),
+    _format(format)
+{
+  connect(&_watcher, SIGNAL(finished()), this, SLOT(sWorkerFinished()));
+}
+
+XTreeWidgetExporter::~XTreeWidgetExporter()
+{
+  cancel();
+  _watcher.waitForFinished();
+}
+
+XTreeWidgetExporter::Format XTreeWidgetExporter::formatForSuffix(const QString &suffix, bool *ok)
+{
+  QString lower = suffix.toLower();
+  if (ok)
+    *ok = true;
+
+  if (lower == "csv")
+    return Csv;
+  else if (lower == "html" || lower == "htm")
+    return Html;
+  else if (lower == "xlsx")
+    return Xlsx;
+  else if (lower == "txt")
+    return Txt;
+  else if (lower == "vcf")
+    return Vcf;
+
+  if (ok)
+    *ok = false;
+  return Txt;
+}
+
+QString XTreeWidgetExporter::errorString() const
+{
+  return _errorString;
+}
+
+QString XTreeWidgetExporter::filename() const
+{
+  return _filename;
+}
+
+XTreeWidgetExporter::Format XTreeWidgetExporter::format() const
+{
+  return _format;
+}
+
+bool XTreeWidgetExporter::isRunning() const
+{
+  return _watcher.isRunning();
+}
+
+bool XTreeWidgetExporter::wasCancelled() const
+{
+  return _cancelled.loadAcquire();
+}
+
+QByteArray XTreeWidgetExporter::result() const
+{
+  return _result;
+}
+
+int XTreeWidgetExporter::rowCount() const
+{
+  return _snapshot.rows.size();
+}
+
+void XTreeWidgetExporter::cancel()
+{
+  _cancelled.fetchAndStoreOrdered(1);
+}
+
+void XTreeWidgetExporter::start(const QString &filename)
+{
+  if (isRunning())
+    return;
+
+  _filename = filename;
+  _errorString.clear();
+  _result.clear();
+  _cancelled.fetchAndStoreOrdered(0);
+  _watcher.setFuture(QtConcurrent::run(this, &XTreeWidgetExporter::run));
+}
+
+void XTreeWidgetExporter::sWorkerFinished()
+{
+  emit finished(_watcher.result());
+}
+
+// runs on a worker thread
+bool XTreeWidgetExporter::run()
+{
+  XtTraceSpan span("export", "window", _filename);
+
+  if (_filename.isEmpty())
+  {
+    QBuffer buffer(&_result);
+    buffer.open(QIODevice::WriteOnly);
+    return exportTo(&buffer);
+  }
+
+  // QSaveFile so a cancelled or failed export doesn't clobber an old file
+  QSaveFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly))
+  {
+    _errorString = file.errorString();
+    return false;
+  }
+  if (! exportTo(&file))
+  {
+    file.cancelWriting();
+    return false;
+  }
+  if (! file.commit())
+  {
+    _errorString = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool XTreeWidgetExporter::exportTo(QIODevice *device)
+{
+  if (_format == Xlsx)
+    return writeXlsx(device);
+
+  if (_format == Vcf)
+  {
+    if (_snapshot.contact.isEmpty())
+    {
+      _errorString = tr("There is no contact to export.");
+      return false;
+    }
+    QByteArray card = vcard();
+    if (device->write(card) != card.size())
+    {
+      _errorString = device->errorString();
+      return false;
+    }
+    return true;
+  }
+
+  return device->write(header()) >= 0 &&
+         writeRows(device)            &&
+         device->write(footer()) >= 0;
+}
+
+bool XTreeWidgetExporter::writeRows(QIODevice *device)
+{
+  int rowcnt    = _snapshot.rows.size();
+  int batchsize = qMax(1, QThread::idealThreadCount() * CHUNKSPERTHREAD);
+
+  for (int first = 0; first < rowcnt; )
+  {
+    QList<QPair<int, int> > batch;
+    for (int i = 0; i < batchsize && first < rowcnt; i++)
+    {
+      int last = qMin(first + ROWSPERCHUNK, rowcnt) - 1;
+      batch.append(qMakePair(first, last));
+      first = last + 1;
+    }
+
+    QList<QByteArray> formatted =
+      QtConcurrent::blockingMapped(batch, XTreeWidgetExportChunk(this));
+    for (int i = 0; i < formatted.size(); i++)
+    {
+      if (device->write(formatted.at(i)) != formatted.at(i).size())
+      {
+        _errorString = device->errorString();
+        return false;
+      }
+    }
+
+    if (_cancelled.loadAcquire())
+    {
+      _errorString = tr("The export was cancelled.");
+      return false;
+    }
+    emit progress(first);
+  }
+
+  return true;
+}
+
+bool XTreeWidgetExporter::writeXlsx(QIODevice *device)
+{
+  if (device->isSequential())
+  {
+    _errorString = tr("xlsx files can only be written to a file or buffer.");
+    return false;
+  }
+
+  XTreeWidgetZipWriter zip(device);
+  bool ok = zip.addEntry("[Content_Types].xml",        xlsxContentTypes) &&
+            zip.addEntry("_rels/.rels",                xlsxRels)         &&
+            zip.addEntry("xl/workbook.xml",            xlsxWorkbook)     &&
+            zip.addEntry("xl/_rels/workbook.xml.rels", xlsxWorkbookRels) &&
+            zip.addEntry("xl/styles.xml",              xlsxStyles)       &&
+            zip.beginEntry("xl/worksheets/sheet1.xml") &&
+            zip.write(header()) >= 0 &&
+            writeRows(&zip)          &&
+            zip.write(footer()) >= 0 &&
+            zip.endEntry()           &&
+            zip.finish();
+  if (! ok && _errorString.isEmpty())
+    _errorString = zip.errorString().isEmpty() ? device->errorString()
+                                               : zip.errorString();
+  return ok;
+}
+
+QByteArray XTreeWidgetExporter::header() const
+{
+  QByteArray result;
+  switch (_format)
+  {
+    case Txt:
+      for (int i = 0; i < _snapshot.headers.size(); i++)
+        result += QString(_snapshot.headers.at(i)).replace("\r\n", " ").toUtf8() + "\t";
+      result += "\r\n";
+      break;
+
+    case Csv:
+      for (int i = 0; i < _snapshot.headers.size(); i++)
+      {
+        if (i)
+          result += ",";
+        result += QString(_snapshot.headers.at(i)).replace("\"", "\"\"")
+                                                  .replace("\r\n", " ")
+                                                  .replace("\n", " ").toUtf8();
+      }
+      result += "\r\n";
+      break;
+
+    case Html:
+      result += "<html>\n<head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\"/></head>\n"
+                "<body>\n<table border=\"1\" cellspacing=\"0\" cellpadding=\"2\">\n<tr>";
+      for (int i = 0; i < _snapshot.headers.size(); i++)
+        result += "<th style=\"background-color:#d3d3d3\">" +
+                  xmlEscaped(_snapshot.headers.at(i)) + "</th>";
+      result += "</tr>\n";
+      break;
+
+    case Xlsx:
+      result += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+                "<sheetViews><sheetView workbookViewId=\"0\">"
+                "<pane ySplit=\"1\" topLeftCell=\"A2\" activePane=\"bottomLeft\" state=\"frozen\"/>"
+                "</sheetView></sheetViews><sheetData>\n<row r=\"1\">";
+      for (int i = 0; i < _snapshot.headers.size(); i++)
+        result += "<c r=\"" + columnName(i) + "1\" s=\"1\" t=\"inlineStr\"><is><t>" +
+                  xmlEscaped(_snapshot.headers.at(i).trimmed()) + "</t></is></c>";
+      result += "</row>\n";
+      break;
+
+    case Vcf:
+      break;
+  }
+  return result;
+}
+
+QByteArray XTreeWidgetExporter::footer() const
+{
+  switch (_format)
+  {
+    case Html:
+      return "</table>\n</body>\n</html>\n";
+    case Xlsx:
+      return "</sheetData></worksheet>";
+    default:
+      break;
+  }
+  return QByteArray();
+}
+
+// may run on several threads at once so it must not touch any shared state
+QByteArray XTreeWidgetExporter::formatRows(int first, int last) const
+{
+  typedef XTreeWidgetExportSnapshot Snapshot;
+
+  QByteArray result;
+  QLocale    locale;
+  for (int r = first; r <= last && r < _snapshot.rows.size(); r++)
+  {
+    const QVector<Snapshot::Cell> &row = _snapshot.rows.at(r);
+    switch (_format)
+    {
+      case Txt:
+        for (int i = 0; i < row.size(); i++)
+          result += row.at(i).text.toUtf8() + "\t";
+        result += "\r\n";
+        break;
+
+      case Csv:
+        for (int i = 0; i < row.size(); i++)
+        {
+          const Snapshot::Cell &cell = row.at(i);
+          if (i)
+            result += ",";
+          if (cell.flags & Snapshot::Quoted)
+            result += "\"" + QString(cell.text).replace("\"", "\"\"").toUtf8() + "\"";
+          else
+            result += QString(cell.text).replace("\"", "\"\"").toUtf8();
+        }
+        result += "\r\n";
+        break;
+
+      case Html:
+        result += "<tr>";
+        for (int i = 0; i < row.size(); i++)
+        {
+          const Snapshot::Cell &cell = row.at(i);
+          result += "<td";
+          if (cell.flags & (Snapshot::HasBackground | Snapshot::HasForeground))
+          {
+            result += " style=\"";
+            if (cell.flags & Snapshot::HasBackground)
+              result += "background-color:" + colorName(cell.background) + ";";
+            if (cell.flags & Snapshot::HasForeground)
+              result += "color:" + colorName(cell.foreground) + ";";
+            result += "\"";
+          }
+          result += ">" + xmlEscaped(cell.text) + "</td>";
+        }
+        result += "</tr>\n";
+        break;
+
+      case Xlsx:
+        {
+          QByteArray rownum = QByteArray::number(r + 2); // header is row 1
+          result += "<row r=\"" + rownum + "\">";
+          for (int i = 0; i < row.size(); i++)
+          {
+            const Snapshot::Cell &cell = row.at(i);
+            if (cell.text.isEmpty())
+              continue;
+
+            bool   ok    = false;
+            double value = 0.0;
+            if (cell.flags & Snapshot::Numeric)
+            {
+              value = locale.toDouble(cell.text, &ok);
+              if (! ok)
+                value = QLocale::c().toDouble(cell.text, &ok);
+            }
+
+            if (ok)
+              result += "<c r=\"" + columnName(i) + rownum + "\"><v>" +
+                        QByteArray::number(value, 'g', 15) + "</v></c>";
+            else
+              result += "<c r=\"" + columnName(i) + rownum +
+                        "\" t=\"inlineStr\"><is><t xml:space=\"preserve\">" +
+                        xmlEscaped(cell.text) + "</t></is></c>";
+          }
+          result += "</row>\n";
+        }
+        break;
+
+      case Vcf:
+        break;
+    }
+  }
+  return result;
+}
+
+QByteArray XTreeWidgetExporter::vcard() const
+{
+  const QVariantMap &c = _snapshot.contact;
+
+  QString name;
+  QString fullName;
+  QString first  = c.value("cntct_first_name").toString();
+  QString middle = c.value("cntct_middle").toString();
+  QString last   = c.value("cntct_last_name").toString();
+  if (! last.isEmpty())
+  {
+    name     = last;
+    fullName = last;
+  }
+  if (! middle.isEmpty())
+  {
+    name     = name + ";" + middle;
+    fullName = middle + " " + fullName;
+  }
+  if (! first.isEmpty())
+  {
+    name     = name + ";" + first;
+    fullName = first + " " + fullName;
+  }
+
+  /* sometimes addr_line1 is the company name and sometimes it's really
+     the first line of the address. For the former, use it as the
+     organization name.
+   */
+  QString     org;
+  QStringList address;
+  QString     line1 = c.value("addr_line1").toString();
+  if (! line1.isEmpty() && line1.at(0).isDigit())
+    address.append(line1);
+  else
+    org = line1;
+  address << c.value("addr_line2").toString()
+          << c.value("addr_line3").toString()
+          << c.value("addr_city").toString()
+          << c.value("addr_state").toString()
+          << c.value("addr_postalcode").toString()
+          << c.value("addr_country").toString();
+
+  // semicolons delimit the address, ESCAPED newlines the label
+  QString addressWork;
+  QString labelWork;
+  foreach (QString part, address)
+  {
+    if (! part.isEmpty())
+    {
+      addressWork += part + ";";
+      labelWork   += part + "\\n";
+    }
+  }
+
+  QString title     = c.value("cntct_title").toString();
+  QString phoneWork = c.value("cntct_phone").toString();
+  QString phoneHome = c.value("cntct_phone2").toString();
+  QString email     = c.value("cntct_email").toString();
+
+  QString result;
+  result += "BEGIN:VCARD\n";
+  result += "VERSION:3.0\n";
+  result += "N:" + name + "\n";
+  result += "FN:" + fullName + "\n";
+  if (! org.isEmpty())
+    result += "ORG:" + org + "\n";
+  if (! title.isEmpty())
+    result += "TITLE:" + title + "\n";
+  if (! phoneWork.isEmpty())
+    result += "TEL;TYPE=WORK,VOICE:" + phoneWork + "\n";
+  if (! phoneHome.isEmpty())
+    result += "TEL;TYPE=HOME,VOICE:" + phoneHome + "\n";
+  if (! addressWork.isEmpty())
+    result += "ADR;TYPE=WORK:;;" + addressWork + "\n";
+  if (! labelWork.isEmpty())
+    result += "LABEL;TYPE=WORK:;;" + labelWork + "\n";
+  if (! email.isEmpty())
+    result += "EMAIL;TYPE=PREF,INTERNET:" + email + "\n";
+  result += "REV:" + QDate::currentDate().toString(Qt::ISODate) + "\n";
+  result += "END:VCARD\n";
+
+  return result.toUtf8();
+}
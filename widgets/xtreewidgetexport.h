@@ -0,0 +1,114 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETEXPORT_H
+#define XTREEWIDGETEXPORT_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QRgb>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+#include "widgets.h"
+
+class QIODevice;
+class XTreeWidget;
+
+/* A copy of the visible rows and columns of an XTreeWidget, taken on the
+   GUI thread so the rows can be formatted elsewhere. The strings are
+   implicitly shared with the tree items so taking a snapshot is cheap.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetExportSnapshot
+{
+  public:
+    enum CellFlag
+    {
+      Quoted        = 0x01, // display value was a string, quote it in CSV
+      Numeric       = 0x02, // raw value was numeric
+      HasBackground = 0x04,
+      HasForeground = 0x08
+    };
+
+    struct Cell
+    {
+      QString text;
+      QRgb    background;
+      QRgb    foreground;
+      int     flags;
+    };
+
+    XTreeWidgetExportSnapshot();
+    XTreeWidgetExportSnapshot(const XTreeWidget *tree);
+
+    QStringList              headers;
+    QVector<QVector<Cell> >  rows;
+    QVariantMap              contact;   // cntct and addr columns, for Vcf
+};
+
+class XTUPLEWIDGETS_EXPORT XTreeWidgetExporter : public QObject
+{
+  Q_OBJECT
+
+  public:
+    enum Format { Txt, Csv, Html, Xlsx, Vcf };
+
+    XTreeWidgetExporter(const XTreeWidgetExportSnapshot &snapshot,
+                        Format format, QObject *parent = 0);
+    virtual ~XTreeWidgetExporter();
+
+    static Format formatForSuffix(const QString &suffix, bool *ok = 0);
+
+    virtual QString    errorString() const;
+    virtual QString    filename()    const;
+    virtual Format     format()      const;
+    virtual bool       isRunning()   const;
+    virtual bool       wasCancelled() const;
+    virtual QByteArray result()      const;
+    virtual int        rowCount()    const;
+
+    virtual bool exportTo(QIODevice *device);
+    virtual void start(const QString &filename = QString());
+
+    virtual QByteArray formatRows(int first, int last) const;
+    virtual QByteArray header() const;
+    virtual QByteArray footer() const;
+
+  public slots:
+    virtual void cancel();
+
+  signals:
+    void progress(int rowsWritten);
+    void finished(bool ok);
+
+  protected slots:
+    virtual void sWorkerFinished();
+
+  protected:
+    virtual bool run();
+    virtual bool writeRows(QIODevice *device);
+    virtual bool writeXlsx(QIODevice *device);
+    virtual QByteArray vcard() const;
+
+  private:
+    XTreeWidgetExportSnapshot _snapshot;
+    QAtomicInt                _cancelled;
+    QString                   _errorString;
+    QString                   _filename;
+    Format                    _format;
+    QByteArray                _result;
+    QFutureWatcher<bool>      _watcher;
+};
+
+#endif
@@ -0,0 +1,453 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetfilter.h"
+
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QToolButton>
+
+#include "xtreewidget.h"
+
+#define DEBUG false
+
+// wait this long after the last keystroke before filtering
+#define FILTERDELAY 150
+
+static inline quint64 trigram(const QChar *c)
+{
+  return (quint64(c[0].unicode()) << 32) |
+         (quint64(c[1].unicode()) << 16) |
+          quint64(c[2].unicode());
+}
+
+/** \class XTreeWidgetFilter
+
+    \brief A quick-filter bar that hides the rows of an XTreeWidget
+           that don't match what the user types.
+
+    Every whitespace-separated term must appear, ignoring case, in the
+    display text of one of the visible columns. Ancestors of matching
+    rows stay visible. The rows are never re-queried: a trigram index
+    over the display text is built the first time the filter is used and
+    dropped when the rows change. When the user adds to the filter text
+    only the rows that matched last time are checked again.
+
+    Rows hidden by the query (xthiddenrole) stay hidden.
+ */
+XTreeWidgetFilter::XTreeWidgetFilter(XTreeWidget *parent)
+  : QFrame(parent),
+    _tree(parent),
+    _indexValid(false),
+    _applying(false)
+{
+  setObjectName("_quickFilter");
+  setFrameStyle(QFrame::StyledPanel | QFrame::Raised);
+  setAutoFillBackground(true);
+
+  _edit = new QLineEdit(this);
+  _edit->setObjectName("_filterText");
+  _edit->setPlaceholderText(tr("Filter rows"));
+  _edit->setMinimumWidth(180);
+
+  _count = new QLabel(this);
+  _close = new QToolButton(this);
+  _close->setText(tr("X"));
+  _close->setAutoRaise(true);
+  _close->setToolTip(tr("Clear the filter"));
+
+  QHBoxLayout *lyt = new QHBoxLayout(this);
+  lyt->setContentsMargins(4, 2, 2, 2);
+  lyt->setSpacing(4);
+  lyt->addWidget(_edit);
+  lyt->addWidget(_count);
+  lyt->addWidget(_close);
+
+  _timer.setSingleShot(true);
+  _timer.setInterval(FILTERDELAY);
+
+  connect(_edit,  SIGNAL(textChanged(const QString &)), &_timer, SLOT(start()));
+  connect(&_timer, SIGNAL(timeout()), this, SLOT(sApply()));
+  connect(_close, SIGNAL(clicked()), this, SLOT(sClose()));
+
+  connect(_tree,          SIGNAL(populated()), this, SLOT(invalidate()));
+  connect(_tree,          SIGNAL(resorted()),  this, SLOT(reapply()));
+  connect(_tree->model(), SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,           SLOT(sRowsInserted(const QModelIndex &, int, int)));
+  connect(_tree->model(), SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)),
+          this,           SLOT(sRowsAboutToBeRemoved(const QModelIndex &, int, int)));
+  connect(_tree->model(), SIGNAL(modelReset()), this, SLOT(sReset()));
+  connect(_tree->model(), SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+          this,           SLOT(sDataChanged(const QModelIndex &, const QModelIndex &)));
+  _tree->installEventFilter(this);
+
+  hide();
+}
+
+QString XTreeWidgetFilter::text() const
+{
+  return _edit->text();
+}
+
+int XTreeWidgetFilter::matchCount() const
+{
+  return _pattern.isEmpty() ? _items.size() : _matches.size();
+}
+
+void XTreeWidgetFilter::setText(const QString &text)
+{
+  if (! text.isEmpty())
+  {
+    place();
+    show();
+  }
+  _edit->setText(text);
+  _timer.stop();
+  sApply();
+}
+
+void XTreeWidgetFilter::sActivate()
+{
+  place();
+  show();
+  raise();
+  _edit->setFocus();
+  _edit->selectAll();
+}
+
+void XTreeWidgetFilter::sClose()
+{
+  setText(QString());
+  hide();
+  _tree->setFocus();
+}
+
+/* Forget the index, e.g. because rows were added or columns shown.
+   If a filter is active then apply it again to the current rows.
+*/
+void XTreeWidgetFilter::invalidate()
+{
+  if (_applying)
+    return;
+
+  _indexValid = false;
+  if (! _pattern.isEmpty())
+  {
+    _pattern.clear();
+    QTimer::singleShot(0, this, SLOT(sApply()));
+  }
+}
+
+// all of the rows are gone so there is nothing left to unhide
+void XTreeWidgetFilter::sReset()
+{
+  _items.clear();
+  _parents.clear();
+  _text.clear();
+  _trigrams.clear();
+  _hidden.clear();
+  _removed.clear();
+  _matches.clear();
+  invalidate();
+}
+
+// sorting moves rows around, which can lose their hidden state
+void XTreeWidgetFilter::reapply()
+{
+  if (_pattern.isEmpty() || _applying)
+    return;
+
+  dropRemovedRows();
+
+  _applying = true;
+  foreach (QTreeWidgetItem *item, _hidden)
+  {
+    if (! item->isHidden())
+      item->setHidden(true);
+  }
+  _applying = false;
+}
+
+/* Rows that were taken out and not put back were deleted or moved to
+   another tree, so they must never be touched again. Returns true if
+   there were any, in which case the index is stale.
+*/
+bool XTreeWidgetFilter::dropRemovedRows()
+{
+  if (_removed.isEmpty())
+    return false;
+
+  foreach (QTreeWidgetItem *item, _removed)
+    _hidden.remove(item);
+  _removed.clear();
+  _indexValid = false;
+  return true;
+}
+
+void XTreeWidgetFilter::collect(QTreeWidgetItem *item, QSet<QTreeWidgetItem *> &items) const
+{
+  if (! item)
+    return;
+  items.insert(item);
+  for (int i = 0; i < item->childCount(); i++)
+    collect(item->child(i), items);
+}
+
+/* sortItems() takes rows out and puts them back, which leaves the index
+   intact, so only rows that disappear for good count as changes.
+*/
+void XTreeWidgetFilter::sRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+  if (_items.isEmpty() && _hidden.isEmpty())
+    return;
+
+  QTreeWidgetItem *parentItem = parent.isValid() ? _tree->itemFromIndex(parent) : 0;
+  for (int row = first; row <= last; row++)
+    collect(parentItem ? parentItem->child(row) : _tree->QTreeWidget::topLevelItem(row),
+            _removed);
+}
+
+void XTreeWidgetFilter::sRowsInserted(const QModelIndex &parent, int first, int last)
+{
+  if (_items.isEmpty() && _hidden.isEmpty())
+    return;
+
+  QTreeWidgetItem *parentItem = parent.isValid() ? _tree->itemFromIndex(parent) : 0;
+  for (int row = first; row <= last; row++)
+  {
+    QSet<QTreeWidgetItem *> inserted;
+    collect(parentItem ? parentItem->child(row) : _tree->QTreeWidget::topLevelItem(row),
+            inserted);
+    foreach (QTreeWidgetItem *item, inserted)
+    {
+      if (! _removed.remove(item))
+        _indexValid = false;    // a brand new row
+    }
+  }
+}
+
+void XTreeWidgetFilter::sDataChanged(const QModelIndex &, const QModelIndex &)
+{
+  if (! _applying)
+    _indexValid = false;
+}
+
+void XTreeWidgetFilter::buildIndex()
+{
+  _items.clear();
+  _parents.clear();
+  _text.clear();
+  _trigrams.clear();
+
+  QList<int> columns;
+  for (int col = 0; col < _tree->columnCount(); col++)
+    if (! _tree->isColumnHidden(col))
+      columns.append(col);
+
+  // depth-first walk remembering each item's parent
+  QList<QPair<QTreeWidgetItem *, int> > stack;
+  for (int i = _tree->topLevelItemCount() - 1; i >= 0; i--)
+    stack.append(qMakePair((QTreeWidgetItem *)_tree->topLevelItem(i), -1));
+
+  while (! stack.isEmpty())
+  {
+    QPair<QTreeWidgetItem *, int> next = stack.takeLast();
+    QTreeWidgetItem *item = next.first;
+    if (! item || item->data(0, Qt::UserRole).toString() == "totalrole")
+      continue;
+
+    int row = _items.size();
+    _items.append(item);
+    _parents.append(next.second);
+
+    QString text;
+    foreach (int col, columns)
+      text += item->text(col).toLower() + QChar('\n');
+    _text.append(text);
+
+    const QChar *c = text.constData();
+    for (int i = 0; i + 2 < text.size(); i++)
+    {
+      QVector<int> &rows = _trigrams[trigram(c + i)];
+      if (rows.isEmpty() || rows.last() != row)
+        rows.append(row);
+    }
+
+    for (int i = item->childCount() - 1; i >= 0; i--)
+      stack.append(qMakePair(item->child(i), row));
+  }
+
+  _indexValid = true;
+  if (DEBUG)
+    qDebug("%s::buildIndex() %d rows %d trigrams", qPrintable(_tree->objectName()),
+           _items.size(), _trigrams.size());
+}
+
+// the rows that might match: the shortest posting list for each term, intersected
+QVector<int> XTreeWidgetFilter::candidates(const QStringList &terms) const
+{
+  QVector<int> result;
+  bool         all = true;
+
+  foreach (QString term, terms)
+  {
+    if (term.size() < 3)
+      continue;
+
+    const QVector<int> *best = 0;
+    for (int i = 0; i + 2 < term.size(); i++)
+    {
+      QHash<quint64, QVector<int> >::const_iterator it = _trigrams.constFind(trigram(term.constData() + i));
+      if (it == _trigrams.constEnd())
+        return QVector<int>();
+      if (! best || it.value().size() < best->size())
+        best = &it.value();
+    }
+
+    if (all)
+    {
+      result = *best;
+      all    = false;
+    }
+    else
+    {
+      QVector<int> both;
+      int i = 0, j = 0;
+      while (i < result.size() && j < best->size())
+      {
+        if (result.at(i) < best->at(j))      i++;
+        else if (best->at(j) < result.at(i)) j++;
+        else { both.append(result.at(i)); i++; j++; }
+      }
+      result = both;
+    }
+  }
+
+  if (all)
+  {
+    result.resize(_items.size());
+    for (int i = 0; i < result.size(); i++)
+      result[i] = i;
+  }
+  return result;
+}
+
+void XTreeWidgetFilter::sApply()
+{
+  QString pattern = _edit->text().simplified().toLower();
+  dropRemovedRows();
+  if (pattern == _pattern && _indexValid)
+    return;
+
+  if (! pattern.isEmpty() && ! _indexValid)
+  {
+    // the old rows are gone or changed so start from scratch
+    _pattern.clear();
+    buildIndex();
+  }
+
+  QVector<int> matches;
+  if (! pattern.isEmpty())
+  {
+    QStringList  terms = pattern.split(' ', QString::SkipEmptyParts);
+    QVector<int> check = (! _pattern.isEmpty() && pattern.contains(_pattern))
+                         ? _matches : candidates(terms);
+    foreach (int row, check)
+    {
+      const QString &text = _text.at(row);
+      bool match = true;
+      for (int t = 0; match && t < terms.size(); t++)
+        match = text.contains(terms.at(t));
+      if (match)
+        matches.append(row);
+    }
+  }
+
+  _pattern = pattern;
+  _matches = matches;
+  setVisibleRows(matches);
+
+  if (_pattern.isEmpty())
+    _count->clear();
+  else
+    _count->setText(tr("%1 of %2").arg(_matches.size()).arg(_items.size()));
+}
+
+/* Hide and show only the rows whose state changes so a narrowing filter
+   costs as little relayout as possible.
+*/
+void XTreeWidgetFilter::setVisibleRows(const QVector<int> &matches)
+{
+  QSet<QTreeWidgetItem *> hide;
+  if (! _pattern.isEmpty())
+  {
+    QVector<bool> visible(_items.size(), false);
+    foreach (int row, matches)
+      for (int r = row; r >= 0 && ! visible.at(r); r = _parents.at(r))
+        visible[r] = true;
+
+    for (int r = 0; r < _items.size(); r++)
+    {
+      QTreeWidgetItem *item = _items.at(r);
+      if (! visible.at(r) && (_hidden.contains(item) || ! item->isHidden()))
+        hide.insert(item);
+    }
+  }
+
+  _applying = true;
+  bool updates = _tree->updatesEnabled();
+  _tree->setUpdatesEnabled(false);
+
+  foreach (QTreeWidgetItem *item, _hidden)
+    if (! hide.contains(item))
+      item->setHidden(false);
+  foreach (QTreeWidgetItem *item, hide)
+    if (! _hidden.contains(item))
+      item->setHidden(true);
+  _hidden = hide;
+
+  _tree->setUpdatesEnabled(updates);
+  _applying = false;
+
+  if (_tree->QTreeWidget::currentItem() && _tree->QTreeWidget::currentItem()->isHidden())
+    _tree->clearSelection();
+}
+
+bool XTreeWidgetFilter::eventFilter(QObject *obj, QEvent *event)
+{
+  if (obj == _tree && event->type() == QEvent::Resize && isVisible())
+    place();
+  return QFrame::eventFilter(obj, event);
+}
+
+void XTreeWidgetFilter::keyPressEvent(QKeyEvent *event)
+{
+  if (event->key() == Qt::Key_Escape)
+    sClose();
+  else if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter)
+  {
+    _timer.stop();
+    sApply();
+  }
+  else
+    QFrame::keyPressEvent(event);
+}
+
+// float over the top right corner of the rows, below the header
+void XTreeWidgetFilter::place()
+{
+  adjustSize();
+  QRect vp = _tree->viewport()->geometry();
+  move(qMax(vp.left(), vp.right() - width() - 2), vp.top() + 2);
+}
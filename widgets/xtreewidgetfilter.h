@@ -0,0 +1,82 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2018 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETFILTER_H
+#define XTREEWIDGETFILTER_H
+
+#include <QFrame>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+class QLabel;
+class QLineEdit;
+class QModelIndex;
+class QToolButton;
+class QTreeWidgetItem;
+class XTreeWidget;
+
+class XTreeWidgetFilter : public QFrame
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetFilter(XTreeWidget *parent);
+
+    virtual QString text() const;
+    virtual int     matchCount() const;
+
+  public slots:
+    virtual void setText(const QString &text);
+    virtual void invalidate();
+    virtual void reapply();
+    virtual void sActivate();
+    virtual void sClose();
+
+  protected slots:
+    virtual void sApply();
+    virtual void sRowsAboutToBeRemoved(const QModelIndex &, int, int);
+    virtual void sRowsInserted(const QModelIndex &, int, int);
+    virtual void sDataChanged(const QModelIndex &, const QModelIndex &);
+    virtual void sReset();
+
+  protected:
+    virtual bool eventFilter(QObject *obj, QEvent *event);
+    virtual void keyPressEvent(QKeyEvent *event);
+    virtual void place();
+
+  private:
+    void         buildIndex();
+    bool         dropRemovedRows();
+    void         collect(QTreeWidgetItem *item, QSet<QTreeWidgetItem *> &items) const;
+    QVector<int> candidates(const QStringList &terms) const;
+    void         setVisibleRows(const QVector<int> &matches);
+
+    QToolButton *_close;
+    QLabel      *_count;
+    QLineEdit   *_edit;
+    QTimer       _timer;
+    XTreeWidget *_tree;
+
+    bool                       _indexValid;
+    bool                       _applying;
+    QVector<QTreeWidgetItem *> _items;     // depth-first order
+    QVector<int>               _parents;   // _items index of each parent, or -1
+    QVector<QString>           _text;      // lower-cased visible columns
+    QHash<quint64, QVector<int> > _trigrams;
+    QSet<QTreeWidgetItem *>    _hidden;    // rows hidden by the filter itself
+    QSet<QTreeWidgetItem *>    _removed;   // taken out and not put back (yet)
+    QString                    _pattern;
+    QVector<int>               _matches;
+};
+
+#endif
@@ -14,6 +14,11 @@ SUBDIRS = common \
           widgets \
           guiclient
 
+# qmake CONFIG+=benchmarks also builds benchmarks/widgetbench
+benchmarks {
+  SUBDIRS += benchmarks/widgetbench.pro
+}
+
 CONFIG += ordered
 
 TRANSLATIONS = share/dict/xTuple.ar_eg.ts \